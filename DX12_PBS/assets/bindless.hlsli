@@ -0,0 +1,14 @@
+// Heap indices of the views the BINDLESS variants read from ResourceDescriptorHeap. Root constants,
+// matching BindlessIndices in sample_assets.h.
+
+cbuffer BindlessIndices : register(b2)
+{
+  uint irradianceMapIndex;
+  uint prefilterMapIndex;  // followed by the other PREFILTER_MIP_LEVELS - 1 mips
+  uint brdfLutIndex;
+  uint cubeMapIndex;
+  uint cascadeShadowMapsIndex;
+  uint pointShadowMapsIndex;
+  uint gbufferIndex;  // normal, material and depth
+  uint outputIndex;  // UAV of the tiled shading output
+};
@@ -87,7 +87,7 @@ float2 IntegrateBRDF(float NdotV, float roughness)
 
   float3 N = float3(0.0, 0.0, 1.0);
 
-  const uint SAMPLE_COUNT = 1024u;
+  const uint SAMPLE_COUNT = IBL_SAMPLE_COUNT;
   for (uint i = 0u; i < SAMPLE_COUNT; ++i)
   {
     // generates a sample vector that's biased towards the
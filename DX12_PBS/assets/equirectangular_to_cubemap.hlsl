@@ -1,7 +1,7 @@
-cbuffer ViewProjectionConstantBuffer : register(b0)
+// Root constants, one cube face at a time.
+cbuffer ViewProjectionConstants : register(b0)
 {
-  float4x4 view;
-  float4x4 projection;
+  float4x4 viewProjection;
 };
 
 struct PSInput
@@ -14,8 +14,7 @@ PSInput VSMain(float3 position : POSITION) {
   PSInput result;
   float4 inputPosition = float4(position, 1.0f);
   result.worldPos = position;
-  result.position = mul(inputPosition, view);
-  result.position = mul(result.position, projection);
+  result.position = mul(inputPosition, viewProjection);
 
   return result;
 }
@@ -0,0 +1,51 @@
+cbuffer SceneConstantBuffer : register(b0)
+{
+  float4x4 model;
+  float4x4 view;
+  float4x4 projection;
+  float3 camPos;
+};
+
+struct PSInput
+{
+  float4 position : SV_POSITION;
+  float3 normal : NORMAL;
+  float3 pbrProperty : COLOR0;
+};
+
+struct PSOutput
+{
+  float2 normal : SV_TARGET0;    // octahedral encoded world space normal
+  float4 material : SV_TARGET1;  // r: metallic, g: roughness, b: ao
+};
+
+PSInput VSMain(float3 position : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD,
+  float3 translation : INSTANCEPOS, float3 pbrProperty : INSTANCEPBRPROPERTIES) {
+  PSInput result;
+  float4 inputPosition = float4(position, 1.0f);
+  float4x4 instanceModel =
+  {
+    1.f,0.f,0.f,0.f,
+    0.f,1.f,0.f,0.f,
+    0.f,0.f,1.f,0.f,
+    translation.x,translation.y,translation.z,1.f
+  };
+  result.position = mul(inputPosition, instanceModel);
+  result.position = mul(result.position, view);
+  result.position = mul(result.position, projection);
+
+  float4 inputNormal = float4(normal, 0.0f);
+  result.normal = (float3)mul(inputNormal, instanceModel);
+
+  result.pbrProperty = pbrProperty;
+  return result;
+}
+
+#include "pbr_common.hlsli"
+
+PSOutput PSMain(PSInput input) {
+  PSOutput output;
+  output.normal = EncodeOctahedralNormal(normalize(input.normal));
+  output.material = float4(input.pbrProperty, 0.0);
+  return output;
+}
@@ -0,0 +1,181 @@
+// Shared by the forward (pbr.hlsl), G-buffer (gbuffer.hlsl) and tiled deferred (tiled_deferred.hlsl) paths,
+// so that both shading paths produce the same image.
+// PREFILTER_MIP_LEVELS, TONEMAP_OPERATOR and BINDLESS are defined by shader_features.h.
+
+// Matches the 32 byte LightState in sample_assets.h.
+struct LightState
+{
+  float3 position;
+  float radius;
+  float3 color;
+  int shadowIndex;  // cube in pointShadowMaps (shadows.hlsli), -1 for none
+};
+StructuredBuffer<LightState> lights : register(t10);
+// Lights that survived CPU culling; the count comes from each shader's constant buffer.
+StructuredBuffer<uint> visibleLightIndices : register(t11);
+
+#if BINDLESS
+#include "bindless.hlsli"
+
+TextureCube GetIrradianceMap() { return ResourceDescriptorHeap[irradianceMapIndex]; }
+// The mip differs between pixels.
+TextureCube GetPrefilterMap(uint mip) { return ResourceDescriptorHeap[NonUniformResourceIndex(prefilterMapIndex + mip)]; }
+Texture2D GetBRDFLut() { return ResourceDescriptorHeap[brdfLutIndex]; }
+#else
+TextureCube irradianceMap : register(t0);
+TextureCube prefilterMap[PREFILTER_MIP_LEVELS] : register(t1);
+Texture2D brdfLutTexture : register(t6);
+
+TextureCube GetIrradianceMap() { return irradianceMap; }
+TextureCube GetPrefilterMap(uint mip) { return prefilterMap[mip]; }
+Texture2D GetBRDFLut() { return brdfLutTexture; }
+#endif
+SamplerState basicSampler : register(s0);
+
+static const float PI = 3.14159265359;
+static const float3 ALBEDO = float3(0.5, 0.0, 0.0);
+
+float DistributionGGX(float3 N, float3 H, float roughness) {
+  float a = roughness * roughness;
+  float a2 = a * a;
+  float NdotH = max(dot(N, H), 0.0);
+  float NdotH2 = NdotH * NdotH;
+
+  float nom = a2;
+  float denom = NdotH2 * (a2 - 1.0) + 1.0;
+  denom = PI * denom * denom;
+
+  return nom / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness) {
+  float r = roughness + 1.0;
+  float k = (r * r) / 8.0;
+
+  float nom = NdotV;
+  float denom = NdotV * (1.0 - k) + k;
+
+  return nom / denom;
+}
+
+float GeometrySmith(float3 N, float3 V, float3 L, float roughness) {
+  float NdotV = max(dot(N, V), 0.0);
+  float NdotL = max(dot(N, L), 0.0);
+  float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+  float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+  return ggx1 * ggx2;
+}
+
+float3 fresnelSchlick(float cosTheta, float3 F0) {
+  return F0 + (1.0 - F0) * pow(saturate(1.0 - cosTheta), 5.0);
+}
+
+// Inverse-square falloff windowed to reach zero at the light radius, see "Real Shading in Unreal Engine 4".
+float LightAttenuation(float distanceSquared, float radius) {
+  float ratio = distanceSquared / (radius * radius);
+  float window = saturate(1.0 - ratio * ratio);
+  return window * window / max(distanceSquared, 0.0001);
+}
+
+// Outgoing radiance for light arriving from direction L (Cook-Torrance BRDF).
+float3 EvaluateBRDF(float3 L, float3 radiance, float3 N, float3 V, float3 F0, float metallic, float roughness) {
+  float3 H = normalize(V + L);
+
+  float NDF = DistributionGGX(N, H, roughness);
+  float G = GeometrySmith(N, V, L, roughness);
+  float3 F = fresnelSchlick(saturate(dot(H, V)), F0);
+
+  float3 numerator = NDF * G * F;
+  float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
+  float3 specular = numerator / denominator;
+
+  // kS is equal to Fresnel
+  float3 kS = F;
+  // for energy conservation, the diffuse and specular light can't
+  // be above 1.0 (unless the surface emits light); to preserve this
+  // relationship the diffuse component (kD) should equal 1.0 - kS.
+  float3 kD = 1.0 - kS;
+  // multiply kD by the inverse metalness such that only non-metals
+  // have diffuse lighting, or a linear blend if partly metal (pure metals
+  // have no diffuse light).
+  kD *= 1.0 - metallic;
+
+  float NdotL = max(dot(N, L), 0.0);
+
+  return (kD * ALBEDO / PI + specular) * radiance * NdotL;
+}
+
+// Outgoing radiance from a single point light.
+float3 EvaluatePointLight(LightState light, float3 N, float3 V, float3 worldPos, float3 F0, float metallic, float roughness) {
+  float3 toLight = light.position - worldPos;
+  float distanceSquared = dot(toLight, toLight);
+  if (distanceSquared >= light.radius * light.radius) {
+    return float3(0.0, 0.0, 0.0);
+  }
+
+  float3 L = toLight * rsqrt(distanceSquared);
+  float attenuation = LightAttenuation(distanceSquared, light.radius);
+  float3 radiance = light.color * attenuation;
+
+  return EvaluateBRDF(L, radiance, N, V, F0, metallic, roughness);
+}
+
+// Image based ambient lighting. Every IBL texture has a single mip, so SampleLevel(0) is
+// equivalent to Sample and also works in compute shaders.
+float3 EvaluateAmbientLighting(float3 N, float3 V, float3 F0, float metallic, float roughness) {
+  float3 F = fresnelSchlick(max(dot(N, V), 0.0), F0);
+
+  // diffuse indirect
+  float3 kS = F;
+  float3 kD = 1.0 - kS;
+  kD *= 1.0 - metallic;
+  float3 irradiance = GetIrradianceMap().SampleLevel(basicSampler, N, 0).rgb;
+  float3 diffuse = irradiance * ALBEDO;
+
+  // specular indirect
+  const float MAX_REFLECTION_LOD = 4.0f;
+  float roughnessLevel = roughness * MAX_REFLECTION_LOD;
+  const int floorLevel = floor(roughnessLevel);
+  const int ceilLevel = ceil(roughnessLevel);
+  float3 R = reflect(-V, N);
+  float3 floorPrefilter = GetPrefilterMap(floorLevel).SampleLevel(basicSampler, R, 0).rgb;
+  float3 ceilPrefilter = GetPrefilterMap(ceilLevel).SampleLevel(basicSampler, R, 0).rgb;
+  float3 prefilteredColor = lerp(floorPrefilter, ceilPrefilter, roughnessLevel - floorLevel);
+  float2 brdf = GetBRDFLut().SampleLevel(basicSampler, float2(max(dot(N, V), 0.0), roughness), 0).rg;
+  float3 specular = prefilteredColor * (F * brdf.x + brdf.y);
+
+  return kD * diffuse + specular;
+}
+
+float3 Tonemap(float3 color) {
+#if TONEMAP_OPERATOR == 1
+  // Fit of the ACES filmic curve, see "ACES Filmic Tone Mapping Curve" by Krzysztof Narkowicz.
+  color *= 0.6;
+  color = saturate((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14));
+#else
+  // Reinhard
+  color = color / (color + 1.0);
+#endif
+  return pow(color, 1.0 / 2.2);
+}
+
+// Octahedral normal encoding, see "A Survey of Efficient Representations for Independent Unit Vectors".
+// The conditions of ?: are scalar: HLSL 2021 doesn't accept vector ones.
+float2 OctWrap(float2 v) {
+  return (1.0 - abs(v.yx)) * float2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+float2 EncodeOctahedralNormal(float3 n) {
+  n /= (abs(n.x) + abs(n.y) + abs(n.z));
+  n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+  return n.xy;
+}
+
+float3 DecodeOctahedralNormal(float2 f) {
+  float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+  float t = saturate(-n.z);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
@@ -1,7 +1,7 @@
-cbuffer ViewProjectionConstantBuffer : register(b0)
+// Root constants, one cube face at a time.
+cbuffer ViewProjectionConstants : register(b0)
 {
-  float4x4 view;
-  float4x4 projection;
+  float4x4 viewProjection;
 };
 
 struct PSInput
@@ -14,13 +14,12 @@ PSInput VSMain(float3 position : POSITION) {
   PSInput result;
   float4 inputPosition = float4(position, 1.0f);
   result.worldPos = position;
-  result.position = mul(inputPosition, view);
-  result.position = mul(result.position, projection);
+  result.position = mul(inputPosition, viewProjection);
 
   return result;
 }
 
-cbuffer PrefilterConstantBuffer : register(b1)
+cbuffer PrefilterConstants : register(b1)  // a root constant
 {
   float roughness;
 };
@@ -77,7 +76,7 @@ float4 PSMain(PSInput input) : SV_TARGET {
   float3 R = N;
   float3 V = R;
 
-  const uint SAMPLE_COUNT = 1024u;
+  const uint SAMPLE_COUNT = IBL_SAMPLE_COUNT;
   float3 prefilteredColor = float3(0.0f, 0.0f, 0.0f);
   float totalWeight = 0.0f;
 
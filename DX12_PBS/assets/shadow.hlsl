@@ -0,0 +1,14 @@
+// Depth only pass rendering the sphere instances into one shadow map view of ShadowCache.
+
+cbuffer ShadowViewConstants : register(b0)
+{
+  float4x4 viewProjection;
+};
+
+float4 VSMain(float3 position : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD,
+  float3 translation : INSTANCEPOS, float3 pbrProperty : INSTANCEPBRPROPERTIES) : SV_POSITION {
+  return mul(float4(position + translation, 1.0), viewProjection);
+}
+
+void PSMain() {
+}
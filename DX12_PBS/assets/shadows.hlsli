@@ -0,0 +1,69 @@
+// Shadow maps of ShadowCache (shadow_cache.h); include after pbr_common.hlsli.
+// NUM_CASCADES, MAX_POINT_SHADOWS and SHADOWS are defined by shader_features.h. Without SHADOWS,
+// every position is lit.
+
+cbuffer ShadowConstantBuffer : register(b1)
+{
+  float4x4 cascadeViewProjection[NUM_CASCADES];
+  float4 cascadeParams[NUM_CASCADES];  // x: world size of a texel, y: 1 once rendered
+  float4 pointShadowParams[MAX_POINT_SHADOWS];  // x: near z, y: far z, z: 1 once rendered
+  float4 pointShadowPositions[MAX_POINT_SHADOWS];  // xyz: light position the cube was rendered from
+  float3 directionalLightDirection;  // direction the light travels in
+  float3 directionalLightColor;
+};
+
+#if BINDLESS
+Texture2DArray<float> GetCascadeShadowMaps() { return ResourceDescriptorHeap[cascadeShadowMapsIndex]; }
+TextureCubeArray<float> GetPointShadowMaps() { return ResourceDescriptorHeap[pointShadowMapsIndex]; }
+#else
+Texture2DArray<float> cascadeShadowMaps : register(t12);
+TextureCubeArray<float> pointShadowMaps : register(t13);
+
+Texture2DArray<float> GetCascadeShadowMaps() { return cascadeShadowMaps; }
+TextureCubeArray<float> GetPointShadowMaps() { return pointShadowMaps; }
+#endif
+SamplerComparisonState shadowSampler : register(s1);
+
+// Uses the first cascade that contains the position; cascades overlap, and nearer ones have smaller texels.
+float DirectionalShadow(float3 worldPos, float3 N) {
+#if SHADOWS
+  [unroll]
+  for (uint i = 0; i < NUM_CASCADES; ++i) {
+    if (cascadeParams[i].y == 0.0) {
+      continue;
+    }
+    // Offset along the normal by about a texel to avoid self shadowing.
+    float4 shadowPos = mul(float4(worldPos + N * cascadeParams[i].x * 1.5, 1.0), cascadeViewProjection[i]);
+    float2 uv = float2(shadowPos.x * 0.5 + 0.5, 0.5 - shadowPos.y * 0.5);
+    if (all(uv > 0.0) && all(uv < 1.0) && shadowPos.z < 1.0) {
+      return GetCascadeShadowMaps().SampleCmpLevelZero(shadowSampler, float3(uv, i), shadowPos.z - 0.0005);
+    }
+  }
+#endif
+  return 1.0;
+}
+
+float PointShadow(LightState light, float3 worldPos, float3 N) {
+  if (!SHADOWS || light.shadowIndex < 0 || pointShadowParams[light.shadowIndex].z == 0.0) {
+    return 1.0;
+  }
+
+  // The cube may lag behind a moving light, so it is looked up from where it was rendered, not light.position.
+  const float nearZ = pointShadowParams[light.shadowIndex].x;
+  const float farZ = pointShadowParams[light.shadowIndex].y;
+  float3 lightToPixel = worldPos + N * 0.02 - pointShadowPositions[light.shadowIndex].xyz;
+  // The cube face is picked by the major axis, whose length is the view space depth of that face.
+  float3 d = abs(lightToPixel);
+  float z = max(d.x, max(d.y, d.z));
+  float depth = farZ / (farZ - nearZ) - farZ * nearZ / ((farZ - nearZ) * z);
+  return GetPointShadowMaps().SampleCmpLevelZero(shadowSampler, float4(lightToPixel, light.shadowIndex), depth - 0.0001);
+}
+
+// Outgoing radiance from the directional light, including its shadow.
+float3 EvaluateDirectionalLight(float3 N, float3 V, float3 worldPos, float3 F0, float metallic, float roughness) {
+  float shadow = DirectionalShadow(worldPos, N);
+  if (shadow == 0.0) {
+    return float3(0.0, 0.0, 0.0);
+  }
+  return EvaluateBRDF(-directionalLightDirection, directionalLightColor * shadow, N, V, F0, metallic, roughness);
+}
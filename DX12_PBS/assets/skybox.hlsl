@@ -29,11 +29,20 @@ PSInput VSMain(float3 position : POSITION) {
   return result;
 }
 
+// BINDLESS is defined by shader_features.h.
+#if BINDLESS
+#include "bindless.hlsli"
+
+TextureCube GetSkyboxMap() { return ResourceDescriptorHeap[cubeMapIndex]; }
+#else
 TextureCube SkyboxMap : register(t0);
+
+TextureCube GetSkyboxMap() { return SkyboxMap; }
+#endif
 SamplerState SkyboxSampler : register(s0);
 
 float4 PSMain(PSInput input) : SV_TARGET {
-  float3 envColor = SkyboxMap.Sample(SkyboxSampler, input.worldPos).rgb;
+  float3 envColor = GetSkyboxMap().Sample(SkyboxSampler, input.worldPos).rgb;
   envColor = envColor / (envColor + 1.0);
   envColor = pow(envColor, 1.0 / 2.2);
   return float4(envColor, 1.0);
@@ -0,0 +1,133 @@
+// Tiled deferred shading: one thread group per screen tile. The group reduces the tile's depth bounds,
+// culls the lights against them, and then every thread shades its pixel once with the surviving lights.
+
+cbuffer TiledShadingConstantBuffer : register(b0)
+{
+  float4x4 view;
+  float4x4 invProjection;
+  float4x4 invView;
+  float3 camPos;
+  uint numLights;
+  uint2 screenSize;
+};
+
+#include "pbr_common.hlsli"
+#include "shadows.hlsli"
+
+#if BINDLESS
+Texture2D<float2> GetGBufferNormal() { return ResourceDescriptorHeap[gbufferIndex]; }
+Texture2D<float4> GetGBufferMaterial() { return ResourceDescriptorHeap[gbufferIndex + 1]; }
+Texture2D<float> GetDepthTexture() { return ResourceDescriptorHeap[gbufferIndex + 2]; }
+RWTexture2D<float4> GetOutputTexture() { return ResourceDescriptorHeap[outputIndex]; }
+#else
+Texture2D<float2> gbufferNormal : register(t7);
+Texture2D<float4> gbufferMaterial : register(t8);
+Texture2D<float> depthTexture : register(t9);
+RWTexture2D<float4> outputTexture : register(u0);
+
+Texture2D<float2> GetGBufferNormal() { return gbufferNormal; }
+Texture2D<float4> GetGBufferMaterial() { return gbufferMaterial; }
+Texture2D<float> GetDepthTexture() { return depthTexture; }
+RWTexture2D<float4> GetOutputTexture() { return outputTexture; }
+#endif
+
+// TILE_SIZE and MAX_LIGHTS_PER_TILE are defined by shader_features.h.
+groupshared uint tileMinDepth;
+groupshared uint tileMaxDepth;
+groupshared uint tileLightCount;
+groupshared uint tileLightIndices[MAX_LIGHTS_PER_TILE];
+
+float3 NdcToView(float2 ndc, float depth) {
+  float4 position = mul(float4(ndc, depth, 1.0), invProjection);
+  return position.xyz / position.w;
+}
+
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex) {
+  if (groupIndex == 0) {
+    tileMinDepth = 0x7f7fffff;  // FLT_MAX
+    tileMaxDepth = 0;
+    tileLightCount = 0;
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  const uint2 pixel = dispatchThreadId.xy;
+  const bool insideScreen = all(pixel < screenSize);
+  const float depth = insideScreen ? GetDepthTexture().Load(int3(pixel, 0)) : 1.0;
+  const bool isGeometry = depth < 1.0;
+  // Depth is a non-negative float, so its bit pattern orders the same way as its value.
+  if (isGeometry) {
+    InterlockedMin(tileMinDepth, asuint(depth));
+    InterlockedMax(tileMaxDepth, asuint(depth));
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  // Tiles that only contain the background need no lights.
+  if (tileMaxDepth != 0) {
+    const float minDepth = asfloat(tileMinDepth);
+    const float maxDepth = asfloat(tileMaxDepth);
+
+    // View space bounding box of the tile between its depth bounds.
+    const float2 invScreenSize = 1.0 / float2(screenSize);
+    const float2 tileMin = float2(groupId.xy * TILE_SIZE) * invScreenSize;
+    const float2 tileMax = min(float2((groupId.xy + 1) * TILE_SIZE) * invScreenSize, 1.0);
+    const float2 ndcMin = float2(tileMin.x * 2.0 - 1.0, 1.0 - tileMax.y * 2.0);
+    const float2 ndcMax = float2(tileMax.x * 2.0 - 1.0, 1.0 - tileMin.y * 2.0);
+    float3 aabbMin = NdcToView(ndcMin, minDepth);
+    float3 aabbMax = aabbMin;
+    [unroll]
+    for (uint corner = 1; corner < 8; ++corner) {
+      float2 ndc = float2((corner & 1) ? ndcMax.x : ndcMin.x, (corner & 2) ? ndcMax.y : ndcMin.y);
+      float3 position = NdcToView(ndc, (corner & 4) ? maxDepth : minDepth);
+      aabbMin = min(aabbMin, position);
+      aabbMax = max(aabbMax, position);
+    }
+
+    for (uint i = groupIndex; i < numLights; i += TILE_SIZE * TILE_SIZE) {
+      const uint lightIndex = visibleLightIndices[i];
+      const float3 lightPosition = mul(float4(lights[lightIndex].position, 1.0), view).xyz;
+      const float radius = lights[lightIndex].radius;
+      const float3 d = max(max(aabbMin - lightPosition, 0.0), lightPosition - aabbMax);
+      if (dot(d, d) <= radius * radius) {
+        uint slot;
+        InterlockedAdd(tileLightCount, 1, slot);
+        if (slot < MAX_LIGHTS_PER_TILE) {
+          tileLightIndices[slot] = lightIndex;
+        }
+      }
+    }
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  if (!insideScreen) {
+    return;
+  }
+  // The skybox pass fills the background afterwards.
+  if (!isGeometry) {
+    GetOutputTexture()[pixel] = float4(0.0, 0.0, 0.0, 1.0);
+    return;
+  }
+
+  const float2 ndc = float2((pixel.x + 0.5) / screenSize.x * 2.0 - 1.0, 1.0 - (pixel.y + 0.5) / screenSize.y * 2.0);
+  const float3 worldPos = mul(float4(NdcToView(ndc, depth), 1.0), invView).xyz;
+  const float3 N = DecodeOctahedralNormal(GetGBufferNormal().Load(int3(pixel, 0)));
+  const float3 V = normalize(camPos - worldPos);
+  const float4 material = GetGBufferMaterial().Load(int3(pixel, 0));
+  const float metallic = material.r;
+  const float roughness = material.g;
+
+  float3 F0 = float3(0.04, 0.04, 0.04);
+  F0 = lerp(F0, ALBEDO, metallic);
+
+  float3 Lo = float3(0.0, 0.0, 0.0);
+  const uint numTileLights = min(tileLightCount, MAX_LIGHTS_PER_TILE);
+  for (uint j = 0; j < numTileLights; ++j) {
+    LightState light = lights[tileLightIndices[j]];
+    Lo += EvaluatePointLight(light, N, V, worldPos, F0, metallic, roughness) * PointShadow(light, worldPos, N);
+  }
+  Lo += EvaluateDirectionalLight(N, V, worldPos, F0, metallic, roughness);
+
+  float3 ambient = EvaluateAmbientLighting(N, V, F0, metallic, roughness);
+
+  GetOutputTexture()[pixel] = float4(Tonemap(ambient + Lo), 1.0);
+}
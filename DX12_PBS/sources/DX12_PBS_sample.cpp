@@ -1,6 +1,42 @@
 #include "DX12_PBS_sample.h"
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "PBS_scene.h"
+#include "cpu_benchmarks.h"
+#include "cpu_profiler.h"
+#include "headless_benchmark.h"
+
+namespace {
+
+constexpr DXGI_FORMAT kBackBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+// The fixed scenarios of the headless benchmark, rendered one after the other.
+struct HeadlessScenario {
+  const char* name;
+  ShadingMode shadingMode;
+  UINT numLights;  // 0 for the regular scene's shadowed lights
+  UINT numInstanceLayers;
+};
+const HeadlessScenario kHeadlessScenarios[] = {
+  { "forward", ShadingMode::kForward, 0, 1 },
+  { "tiled_deferred", ShadingMode::kTiledDeferred, 0, 1 },
+  { "forward_256_lights_4_layers", ShadingMode::kForward, 256, 4 },
+  { "tiled_deferred_256_lights_4_layers", ShadingMode::kTiledDeferred, 256, 4 },
+};
+
+// The camera path of every headless scenario, t from 0 to 1 over its frames: from the start position
+// in front of the sphere grid, around and back to 20 units away, and back.
+void GetHeadlessCameraPose(float t, XMVECTOR* pEye, XMVECTOR* pAt) {
+  const float angle = XM_2PI * t;
+  *pEye = XMVectorSet(6.0f * std::sin(angle), 3.0f * std::sin(2.0f * angle), 11.5f - 8.5f * std::cos(angle), 1.0f);
+  *pAt = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+}  // namespace
 
 DX12PBSSample::DX12PBSSample(UINT width, UINT height, std::wstring name) :
   DXSample(width, height, name) {
@@ -10,35 +46,108 @@ DX12PBSSample::~DX12PBSSample() {
 }
 
 void DX12PBSSample::OnInit() {
+  QueryPerformanceCounter(&m_initStart);
+  m_startupPhaseStart = m_initStart;
+  CpuProfiler::Get().SetThreadName("main");
+  CPU_PROFILE_SCOPE("OnInit");
+
+  if (m_cpuBenchmark) {
+    // Only the device is needed, for the upload buffers. RunHeadless renders no frame after WM_QUIT.
+    LoadPipeline();
+    const bool passed = RunCpuBenchmarks(m_device.Get(), GetAssetFullPath(L"cpu_benchmark.csv"), GetAssetFullPath(L"cpu_benchmark_baseline.csv"));
+    PostQuitMessage(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+    return;
+  }
+
+  if (m_headless) {
+    std::vector<std::string> scenarioNames;
+    for (const HeadlessScenario& scenario : kHeadlessScenarios) {
+      scenarioNames.emplace_back(scenario.name);
+    }
+    // The GPU profiler reads a frame back when its frame resource is reused.
+    m_headlessBenchmark = std::make_unique<HeadlessBenchmark>(std::move(scenarioNames), m_headlessWarmupFrames, m_headlessMeasuredFrames, FrameCount);
+  }
+
   LoadPipeline();
+  RecordStartupPhase("load_pipeline");
   LoadAssets();
+  RecordStartupPhase("load_assets");
   LoadSizeDependentResources();
+  RecordStartupPhase("load_size_dependent_resources");
 
   GPUWorkForInitialization();
+  RecordStartupPhase("gpu_work_for_initialization");
 
+  if (m_syncLoading) {
+    m_scene->WaitForAssets();
+    RecordStartupPhase("wait_for_assets");
+  }
 }
 
 void DX12PBSSample::OnUpdate() {
+  CPU_PROFILE_SCOPE("OnUpdate");
+  // Block here rather than after presenting, so that input is sampled as late as possible.
+  WaitForFrameStart();
+
   m_timer.Tick();
-  m_scene->Update(m_timer.GetElapsedSeconds());
+  if (m_headlessBenchmark) {
+    UpdateHeadlessBenchmark();
+  }
+  m_scene->Update(m_timer.GetElapsedSeconds(), m_fence->GetCompletedValue());
 }
 
 void DX12PBSSample::OnRender() {
-  m_scene->Render(m_commandQueue.Get());
-  //ThrowIfFailed(m_swapChain->Present(0, DXGI_PRESENT_ALLOW_TEARING));
-  ThrowIfFailed(m_swapChain->Present(1, 0));
+  CPU_PROFILE_SCOPE("OnRender");
+  // MoveToNextFrame signals the frame's fence value once the frame is submitted.
+  m_scene->Render(m_commandQueue.Get(), m_fenceValues[m_frameIndex]);
+  // Offscreen frames are done once submitted.
+  if (!m_headless) {
+    Present();
+  }
+  LogLoadingTimes();
 
   MoveToNextFrame();
 }
 
+void DX12PBSSample::Present() {
+  double inputLatency = 0.0;
+  if (m_scene->ConsumeInputLatency(&inputLatency)) {
+    m_framePacingStats.AddInputLatency(inputLatency);
+  }
+
+  // The shading benchmark measures frame times, so it must not be capped by vsync either.
+  const bool uncapped = m_uncappedPresent || m_scene->IsBenchmarkRunning();
+  // Tearing is not allowed in exclusive fullscreen mode.
+  BOOL fullscreen = FALSE;
+  ThrowIfFailed(m_swapChain->GetFullscreenState(&fullscreen, nullptr));
+  const UINT presentFlags = uncapped && m_allowTearing && !fullscreen ? DXGI_PRESENT_ALLOW_TEARING : 0;
+  {
+    CPU_PROFILE_SCOPE("Present");
+    ThrowIfFailed(m_swapChain->Present(uncapped ? 0 : 1, presentFlags));
+  }
+  m_framePacingStats.EndFrame(m_swapChain.Get());
+}
+
 void DX12PBSSample::OnSizeChanged(UINT width, UINT height, bool minimized) {
 }
 
 void DX12PBSSample::OnDestroy() {
+  // Let the GPU finish with the resources that are about to be released.
+  WaitForGpu(m_commandQueue.Get());
+
+  if (m_frameLatencyWaitableObject != nullptr) {
+    CloseHandle(m_frameLatencyWaitableObject);
+  }
   CloseHandle(m_fenceEvent);
 }
 
 void DX12PBSSample::OnKeyDown(UINT8 key) {
+  if (key == VK_F5 && m_shaderHotReload) {
+    // The frames in flight still use the old pipeline states.
+    WaitForGpu(m_commandQueue.Get());
+    m_scene->ReloadShaders(m_device.Get());
+    return;
+  }
   m_scene->KeyDown(key);
 }
 
@@ -85,18 +194,43 @@ void DX12PBSSample::LoadPipeline() {
   ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
   NAME_D3D12_OBJECT(m_commandQueue);
 
+  // Headless runs render into offscreen targets instead, see LoadSizeDependentResources.
+  if (!m_headless) {
+    CreateSwapChain(factory.Get());
+  }
+
+  // Create synchronization objects.
+  {
+    ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+    m_fenceValues[m_frameIndex]++;
+
+    // Create an event handle to use for frame synchronization.
+    m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (m_fenceEvent == nullptr)
+    {
+      ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+  }
+}
+
+void DX12PBSSample::CreateSwapChain(IDXGIFactory4* pFactory) {
   // Describe and create the swap chain.
   DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
   swapChainDesc.BufferCount = FrameCount;
   swapChainDesc.Width = m_width;
   swapChainDesc.Height = m_height;
-  swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  swapChainDesc.Format = kBackBufferFormat;
   swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
   swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
   swapChainDesc.SampleDesc.Count = 1;
 
+  // The waitable object lets a frame start as late as the display allows, see WaitForFrameStart.
   // It is recommended to always use the tearing flag when it is available.
-  //swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+  m_allowTearing = m_tearingSupport;
+  swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+  if (m_allowTearing) {
+    swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+  }
 
   ComPtr<IDXGISwapChain1> swapChain;
   // DXGI does not allow creating a swapchain targeting a window which has fullscreen styles(no border + topmost).
@@ -106,7 +240,7 @@ void DX12PBSSample::LoadPipeline() {
   {
     Win32Application::SetWindowZorderToTopMost(false);
   }
-  ThrowIfFailed(factory->CreateSwapChainForHwnd(
+  ThrowIfFailed(pFactory->CreateSwapChainForHwnd(
     m_commandQueue.Get(),        // Swap chain needs the queue so that it can force a flush on it.
     Win32Application::GetHwnd(),
     &swapChainDesc,
@@ -122,23 +256,14 @@ void DX12PBSSample::LoadPipeline() {
 
   // With tearing support enabled we will handle ALT+Enter key presses in the
   // window message loop rather than let DXGI handle it by calling SetFullscreenState.
-  factory->MakeWindowAssociation(Win32Application::GetHwnd(), DXGI_MWA_NO_ALT_ENTER);
+  pFactory->MakeWindowAssociation(Win32Application::GetHwnd(), DXGI_MWA_NO_ALT_ENTER);
 
   ThrowIfFailed(swapChain.As(&m_swapChain));
   m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
-  // Create synchronization objects.
-  {
-    ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-    m_fenceValues[m_frameIndex]++;
-
-    // Create an event handle to use for frame synchronization.
-    m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (m_fenceEvent == nullptr)
-    {
-      ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-    }
-  }
+  // More queued frames than frame resources would not help, the fence wait limits the CPU then.
+  ThrowIfFailed(m_swapChain->SetMaximumFrameLatency((std::min)(m_maxFrameLatency, FrameCount)));
+  m_frameLatencyWaitableObject = m_swapChain->GetFrameLatencyWaitableObject();
 }
 
 void DX12PBSSample::LoadAssets() {
@@ -146,41 +271,33 @@ void DX12PBSSample::LoadAssets() {
     m_scene = std::make_unique<PBSScene>(FrameCount, this);
   }
 
-  // Create a temporary command queue and command list for initializing data on the GPU.
-    // Performance tip: Copy command queues are optimized for transfer over PCIe.
-  D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-  queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
-
-  ComPtr<ID3D12CommandQueue> copyCommandQueue;
-  ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&copyCommandQueue)));
-  NAME_D3D12_OBJECT(copyCommandQueue);
-
-  ComPtr<ID3D12CommandAllocator> commandAllocator;
-  ThrowIfFailed(m_device->CreateCommandAllocator(queueDesc.Type, IID_PPV_ARGS(&commandAllocator)));
-  NAME_D3D12_OBJECT(commandAllocator);
-
-  ComPtr<ID3D12GraphicsCommandList> commandList;
-  ThrowIfFailed(m_device->CreateCommandList(0, queueDesc.Type, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
-  NAME_D3D12_OBJECT(commandList);
-
-  m_scene->Initialize(m_device.Get(), m_commandQueue.Get(), commandList.Get(), m_frameIndex);
-
-  ThrowIfFailed(commandList->Close());
+  // The scene loads its assets in the background, nothing here waits for them.
+  m_scene->Initialize(m_device.Get(), m_commandQueue.Get(), m_frameIndex);
+}
 
-  ID3D12CommandList* ppCommandLists[] = { commandList.Get() };
-  copyCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+void DX12PBSSample::LoadSizeDependentResources() {
+  if (m_headless) {
+    CreateOffscreenRenderTargets();
+  } else {
+    for (UINT i = 0; i < FrameCount; i++)
+    {
+      ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])));
+    }
+  }
 
-  // Wait until assets have been uploaded to the GPU.
-  WaitForGpu(copyCommandQueue.Get());
+  m_scene->LoadSizeDependentResources(m_device.Get(), m_renderTargets, m_width, m_height);
 }
 
-void DX12PBSSample::LoadSizeDependentResources() {
+void DX12PBSSample::CreateOffscreenRenderTargets() {
+  // Like the swap chain's buffers, and in the state the scene expects a back buffer to be in between frames.
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+  const CD3DX12_RESOURCE_DESC renderTargetDesc = CD3DX12_RESOURCE_DESC::Tex2D(kBackBufferFormat, m_width, m_height, 1, 1, 1, 0,
+    D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
   for (UINT i = 0; i < FrameCount; i++)
   {
-    ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])));
+    ThrowIfFailed(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &renderTargetDesc,
+      D3D12_RESOURCE_STATE_PRESENT, nullptr, IID_PPV_ARGS(&m_renderTargets[i])));
   }
-
-  m_scene->LoadSizeDependentResources(m_device.Get(), m_renderTargets, m_width, m_height);
 }
 
 void DX12PBSSample::GPUWorkForInitialization() {
@@ -188,6 +305,95 @@ void DX12PBSSample::GPUWorkForInitialization() {
   WaitForGpu(m_commandQueue.Get());
 }
 
+void DX12PBSSample::LogLoadingTimes() {
+  if (m_firstFramePresented && m_sceneLoaded) {
+    return;
+  }
+
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  const double milliseconds = 1000.0 * static_cast<double>(now.QuadPart - m_initStart.QuadPart) / frequency.QuadPart;
+  char message[96];
+  if (!m_firstFramePresented) {
+    m_firstFramePresented = true;
+    sprintf_s(message, "loading: first frame presented after %.1f ms\n", milliseconds);
+    OutputDebugStringA(message);
+    if (m_headlessBenchmark) {
+      m_headlessBenchmark->AddStartupPhase("until_first_frame", milliseconds);
+    }
+  }
+  if (!m_sceneLoaded && !m_scene->IsLoading()) {
+    m_sceneLoaded = true;
+    sprintf_s(message, "loading: scene complete after %.1f ms\n", milliseconds);
+    OutputDebugStringA(message);
+    if (m_headlessBenchmark) {
+      m_headlessBenchmark->AddStartupPhase("until_scene_complete", milliseconds);
+    }
+  }
+}
+
+void DX12PBSSample::RecordStartupPhase(const char* name) {
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  const double milliseconds = 1000.0 * static_cast<double>(now.QuadPart - m_startupPhaseStart.QuadPart) / frequency.QuadPart;
+  m_startupPhaseStart = now;
+
+  char message[128];
+  sprintf_s(message, "loading: %s took %.1f ms\n", name, milliseconds);
+  OutputDebugStringA(message);
+  if (m_headlessBenchmark) {
+    m_headlessBenchmark->AddStartupPhase(name, milliseconds);
+  }
+}
+
+void DX12PBSSample::UpdateHeadlessBenchmark() {
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  const double elapsedSeconds = m_lastFrameStart.QuadPart == 0 ? 0.0 :
+    static_cast<double>(now.QuadPart - m_lastFrameStart.QuadPart) / frequency.QuadPart;
+  m_lastFrameStart = now;
+
+  // Loading frames are covered by the startup phases.
+  if (m_scene->IsLoading()) {
+    return;
+  }
+
+  GpuProfiler* pGpuProfiler = m_scene->GetGpuProfiler();
+  switch (m_headlessBenchmark->Tick(elapsedSeconds)) {
+  case HeadlessBenchmark::Step::kStartScenario: {
+    const HeadlessScenario& scenario = kHeadlessScenarios[m_headlessBenchmark->GetCurrentScenario()];
+    m_scene->SetConfiguration(scenario.shadingMode, scenario.numLights, scenario.numInstanceLayers);
+    break;
+  }
+  case HeadlessBenchmark::Step::kStartGpuMeasurement:
+    pGpuProfiler->ResetStatistics(m_headlessBenchmark->GetMeasuredFrames());
+    break;
+  case HeadlessBenchmark::Step::kEndGpuMeasurement:
+    m_headlessBenchmark->SetGpuPassTimes(pGpuProfiler->GetStatistics().GetEntries());
+    break;
+  case HeadlessBenchmark::Step::kFinished: {
+    std::ostringstream json;
+    m_headlessBenchmark->WriteJson(json);
+    std::ofstream jsonFile(GetAssetFullPath(L"headless_benchmark.json"));
+    jsonFile << json.str();
+    OutputDebugStringA(json.str().c_str());
+    // This frame is still rendered; the loop stops after it.
+    PostQuitMessage(EXIT_SUCCESS);
+    return;
+  }
+  default:
+    break;
+  }
+
+  // The path depends on the frame only, not on the time, so every run renders the same frames.
+  XMVECTOR eye, at;
+  GetHeadlessCameraPose(static_cast<float>(m_headlessBenchmark->GetFrameInScenario()) / m_headlessBenchmark->GetFramesPerScenario(), &eye, &at);
+  m_scene->SetCamera(eye, at);
+}
+
 void DX12PBSSample::WaitForGpu(ID3D12CommandQueue* pCommandQueue) {
   // Schedule a Signal command in the queue.
   ThrowIfFailed(pCommandQueue->Signal(m_fence.Get(), m_fenceValues[m_frameIndex]));
@@ -200,20 +406,38 @@ void DX12PBSSample::WaitForGpu(ID3D12CommandQueue* pCommandQueue) {
   m_fenceValues[m_frameIndex]++;
 }
 
-void DX12PBSSample::MoveToNextFrame() {
-  // Schedule a Signal command in the queue.
-  const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
-  ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
+void DX12PBSSample::WaitForFrameStart() {
+  LARGE_INTEGER frequency, waitStart, waitEnd;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&waitStart);
 
-  // Update the frame index.
-  m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+  // Wait until the swap chain can take another frame without exceeding the maximum frame latency.
+  if (!m_headless) {
+    CPU_PROFILE_SCOPE("wait for frame latency");
+    WaitForSingleObjectEx(m_frameLatencyWaitableObject, 1000, TRUE);
+  }
 
-  // If the next frame is not ready to be rendered yet, wait until it is ready.
-  if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
+  // The swap chain may have a free buffer while the GPU still uses this frame's resources.
+  if (m_fence->GetCompletedValue() < m_frameResourcesFenceValue)
   {
-    ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
+    CPU_PROFILE_SCOPE("wait for frame resources");
+    ThrowIfFailed(m_fence->SetEventOnCompletion(m_frameResourcesFenceValue, m_fenceEvent));
     WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
   }
+
+  QueryPerformanceCounter(&waitEnd);
+  m_framePacingStats.BeginFrame(static_cast<double>(waitEnd.QuadPart - waitStart.QuadPart) / frequency.QuadPart);
+}
+
+void DX12PBSSample::MoveToNextFrame() {
+  CPU_PROFILE_SCOPE("MoveToNextFrame");
+  // Schedule a Signal command in the queue.
+  const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
+  ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
+
+  // Update the frame index. Waiting for the frame's resources is left to the start of the next frame.
+  m_frameIndex = m_headless ? (m_frameIndex + 1) % FrameCount : m_swapChain->GetCurrentBackBufferIndex();
+  m_frameResourcesFenceValue = m_fenceValues[m_frameIndex];
   m_scene->SetFrameIndex(m_frameIndex);
 
   // Set the fence value for the next frame.
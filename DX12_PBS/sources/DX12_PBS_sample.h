@@ -3,8 +3,10 @@
 #include <memory>
 
 #include "core/DXSample.h"
+#include "frame_pacing.h"
 #include "util/StepTimer.h"
 
+class HeadlessBenchmark;
 class PBSScene;
 
 class DX12PBSSample : public DXSample {
@@ -28,12 +30,23 @@ protected:
 
 private:
   void LoadPipeline();
+  void CreateSwapChain(IDXGIFactory4* pFactory);
   void LoadAssets();
   void LoadSizeDependentResources();
+  // Stand-ins for the swap chain's buffers in headless runs.
+  void CreateOffscreenRenderTargets();
 
   void GPUWorkForInitialization();
+  // Logs the time from OnInit to the first presented frame, and to the first one with every asset.
+  void LogLoadingTimes();
+  // Logs the time since the previous phase of OnInit ended.
+  void RecordStartupPhase(const char* name);
+  // Advances the headless benchmark and places the camera on its path. Writes the results and quits once it is done.
+  void UpdateHeadlessBenchmark();
+  void Present();
 
   void WaitForGpu(ID3D12CommandQueue* pCommandQueue);
+  void WaitForFrameStart();
   void MoveToNextFrame();
 
   // D3D objects.
@@ -47,9 +60,25 @@ private:
   UINT   m_frameIndex = 0;
   HANDLE m_fenceEvent = nullptr;
   UINT64 m_fenceValues[FrameCount]{};
+  UINT64 m_frameResourcesFenceValue = 0;  // reached when the GPU is done with the current frame's resources
+  HANDLE m_frameLatencyWaitableObject = nullptr;
+
+  // Presentation.
+  bool m_allowTearing = false;  // the swap chain was created with DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING
+  FramePacingStats m_framePacingStats;
+
+  // Loading.
+  LARGE_INTEGER m_initStart{};
+  LARGE_INTEGER m_startupPhaseStart{};
+  bool m_firstFramePresented = false;
+  bool m_sceneLoaded = false;
 
   // Scene rendering resources.
   std::unique_ptr<PBSScene> m_scene;
 
   StepTimer m_timer;
+
+  // Headless runs only.
+  std::unique_ptr<HeadlessBenchmark> m_headlessBenchmark;
+  LARGE_INTEGER m_lastFrameStart{};
 };
\ No newline at end of file
@@ -1,57 +1,119 @@
 #include "PBS_scene.h"
 
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
 #include <DirectXTex.h>
 
+#include "asset_pack.h"
 #include "core/DXSampleHelper.h"
 #include "core/DXSample.h"
+#include "cpu_profiler.h"
 #include "frame_resource.h"
+#include "render_graph.h"
 #include "sample_assets.h"
 #include "util/DXHelper.h"
 
 namespace {
 
-float clamp(float value, float low, float high) {
-  if (value < low)
-    value = low;
+// The vertex and index buffers of the meshes, baked into meshes.pack.
+enum MeshBufferIndex : UINT {
+  kCubeVertices,
+  kQuadVertices,
+  kSphereVertices,
+  kSphereIndices,
+  kMeshBufferCount
+};
 
-  if (value > high)
-    value = high;
+constexpr const char* kMeshBufferNames[kMeshBufferCount] = {
+  "cube.vertices",
+  "quad.vertices",
+  "sphere.vertices",
+  "sphere.indices",
+};
 
-  return value;
-}
+constexpr char kEnvironmentEntryName[] = "environment";
 
-struct SphereInstance {
-  float translation[3]{};
-  float pbrProperties[3]{};  // r: metallic, g: roughness, b: ao
+struct MeshBuffer {
+  const void* pData = nullptr;
+  size_t size = 0;
+  UINT elementSize = 0;
 };
 
-std::unique_ptr<SphereInstance[]> GetSphereInstanceData(UINT& instanceCount) {
-  const int nrRows = 7;
-  const int nrColumns = 7;
-  const float spacing = 2.5f;
-  instanceCount = static_cast<UINT>(nrRows * nrColumns);
-
-  std::vector<SphereInstance> instances;
-
-  for (int row = 0; row < nrRows; ++row) {
-    float metallic = (float)row / (float)nrRows;
-    for (int col = 0; col < nrColumns; ++col) {
-      float roughness = clamp((float)col / (float)nrColumns, 0.05f, 1.0f);
-      SphereInstance instance;
-      instance.translation[0] = (col - (nrColumns / 2)) * spacing;
-      instance.translation[1] = (row - (nrRows / 2)) * spacing;
-      instance.translation[2] = 0.0f;
-      instance.pbrProperties[0] = metallic;
-      instance.pbrProperties[1] = roughness;
-      instances.emplace_back(instance);
+// Returns false if the pack lacks one of the buffers.
+bool ReadMeshBuffers(const AssetPack& pack, MeshBuffer* pBuffers) {
+  for (UINT i = 0; i < kMeshBufferCount; ++i) {
+    const AssetPackEntry* pEntry = pack.Find(kMeshBufferNames[i], AssetPackEntryType::kBuffer);
+    if (pEntry == nullptr) {
+      return false;
+    }
+    pBuffers[i] = { pack.GetData(*pEntry), static_cast<size_t>(pEntry->size), pEntry->elementSize };
+  }
+  return true;
+}
+
+// Spreads the lights evenly (R2 low discrepancy sequence) in front of the sphere grid.
+void AddBenchmarkLights(UINT numLights, LightManager& lightManager) {
+  lightManager.RemoveAllLights();
+  for (UINT i = 0; i < numLights; ++i) {
+    float u = std::fmod(0.5f + 0.7548776662f * i, 1.0f);
+    float v = std::fmod(0.5f + 0.5698402910f * i, 1.0f);
+    lightManager.AddLight(LightState(-9.0f + 18.0f * u, -9.0f + 18.0f * v, 1.5f, 2.0f, 2.0f, 2.0f));
+  }
+}
+
+// Records a batch of render graph barriers; resources maps the graph's resource handles.
+void RecordRenderGraphBarriers(ID3D12GraphicsCommandList* pCommandList, const std::vector<RenderGraph::Barrier>& barriers,
+  const std::vector<ID3D12Resource*>& resources) {
+  if (barriers.empty()) {
+    return;
+  }
+
+  std::vector<D3D12_RESOURCE_BARRIER> resourceBarriers;
+  resourceBarriers.reserve(barriers.size());
+  for (const RenderGraph::Barrier& barrier : barriers) {
+    ID3D12Resource* pResource = resources[barrier.resource];
+    switch (barrier.type) {
+    case RenderGraph::BarrierType::kTransition: {
+      D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+      if (barrier.split == RenderGraph::BarrierSplit::kBegin) {
+        flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+      } else if (barrier.split == RenderGraph::BarrierSplit::kEnd) {
+        flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+      }
+      resourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource,
+        static_cast<D3D12_RESOURCE_STATES>(barrier.stateBefore), static_cast<D3D12_RESOURCE_STATES>(barrier.stateAfter),
+        D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, flags));
+      break;
+    }
+    case RenderGraph::BarrierType::kAliasing:
+      resourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, pResource));
+      break;
+    case RenderGraph::BarrierType::kUnorderedAccess:
+      resourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(pResource));
+      break;
     }
   }
+  pCommandList->ResourceBarrier(static_cast<UINT>(resourceBarriers.size()), resourceBarriers.data());
+}
 
-  instanceCount = static_cast<UINT>(instances.size());
-  std::unique_ptr<SphereInstance[]> instances_ptr = std::make_unique<SphereInstance[]>(instances.size());
-  memcpy(instances_ptr.get(), instances.data(), sizeof(SphereInstance) * instances.size());
+// Records what has to precede a pass of a compiled render graph. Returns false if the pass is to be skipped.
+bool BeginRenderGraphPass(ID3D12GraphicsCommandList* pCommandList, const RenderGraph& renderGraph,
+  const std::vector<ID3D12Resource*>& resources, RenderGraph::PassHandle pass) {
+  if (pass == RenderGraph::kInvalidHandle || renderGraph.IsPassCulled(pass)) {
+    return false;
+  }
 
-  return instances_ptr;
+  RecordRenderGraphBarriers(pCommandList, renderGraph.GetBarriersBefore(pass), resources);
+  for (RenderGraph::ResourceHandle resource : renderGraph.GetDiscardsBefore(pass)) {
+    pCommandList->DiscardResource(resources[resource], nullptr);
+  }
+  return true;
 }
 
 }  // namespace
@@ -60,10 +122,16 @@ std::unique_ptr<SphereInstance[]> GetSphereInstanceData(UINT& instanceCount) {
 
 PBSScene::PBSScene(UINT frameCount, DXSample* pSample) :
   m_frameCount(frameCount),
-  m_pSample(pSample) {
+  m_lightManager(frameCount, kLightLuminanceThreshold),
+  m_pSample(pSample),
+  m_shaderCache(pSample->GetAssetFullPath(L""), pSample->IsShaderHotReloadEnabled()),
+  m_shadowCache(kShadowUpdateBudget),
+  m_workerPool(WorkerPool::GetDefaultThreadCount(kMaxRecordingThreads)) {
   m_frameResources.resize(frameCount);
   m_renderTargets.resize(frameCount);
 
+  QueryPerformanceFrequency(&m_qpcFrequency);
+
   InitializeCameraAndLights();
 }
 
@@ -75,14 +143,32 @@ void PBSScene::SetFrameIndex(UINT frameIndex) {
   m_pCurrentFrameResource = m_frameResources[m_frameIndex].get();
 }
 
-void PBSScene::Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pDirectCommandQueue, ID3D12GraphicsCommandList* pCommandList, UINT frameIndex) {
+void PBSScene::Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pDirectCommandQueue, UINT frameIndex) {
+  if (m_pSample->IsBindlessRequested()) {
+    m_shaderFeatures.bindless = util::IsBindlessSupported(pDevice) ? 1 : 0;
+    if (!m_shaderFeatures.bindless) {
+      OutputDebugStringA("Bindless needs shader model 6.6 and resource binding tier 3, using descriptor tables instead.\n");
+    }
+  }
   CreateDescriptorHeaps(pDevice);
   CreateRootSignatures(pDevice);
   CreatePipelineStates(pDevice);
   CreateFrameResources(pDevice, pDirectCommandQueue);
   CreateCommandLists(pDevice);
 
-  CreateAssetResources(pDevice, pCommandList);
+  m_resourceAllocator = std::make_unique<ResourceAllocator>(pDevice, kResourceHeapSize);
+  m_environmentAllocator = std::make_unique<ResourceAllocator>(pDevice, kEnvironmentHeapSize);
+  CreateAssetResources(pDevice);
+
+  m_gpuProfiler = std::make_unique<GpuProfiler>(pDevice, pDirectCommandQueue, m_frameCount, kMaxGpuProfilerScopes);
+  m_residencyManager = std::make_unique<ResidencyManager>(pDevice, kResidencyBudgetQueryInterval);
+  m_environmentSet = m_residencyManager->AddSet(ResidencyManager::Category::kIBL, m_environmentAllocator->GetPageables(), true);
+  m_shadowMapsSet = m_residencyManager->AddSet(ResidencyManager::Category::kRenderTargets,
+    { m_shadowCache.GetCascadeShadowMaps(), m_shadowCache.GetPointShadowMaps() }, false);
+  m_stagingSet = m_residencyManager->AddSet(ResidencyManager::Category::kStaging, 0);
+
+  m_assetLoader = std::make_unique<AssetLoader>(pDevice, kAssetDecodeThreads, kStagingRingSize);
+  LoadAssets();
 
   SetFrameIndex(frameIndex);
 }
@@ -98,48 +184,151 @@ void PBSScene::LoadSizeDependentResources(ID3D12Device* pDevice, ComPtr<ID3D12Re
   m_scissorRect.right = static_cast<LONG>(width);
   m_scissorRect.bottom = static_cast<LONG>(height);
 
+  // The views of the size dependent resources are recreated in place.
+  if (!m_backBufferRtvs.IsValid()) {
+    m_backBufferRtvs = m_rtvHeap->Allocate(m_frameCount);
+    m_depthDsvAllocation = m_dsvHeap->Allocate(1);
+    m_gbufferRtvs = m_rtvHeap->Allocate(2);
+    m_gbufferSrvs = m_stagingHeap->Allocate(3);
+    m_tiledShadingOutputUav = m_stagingHeap->Allocate(1);
+  }
+
   // Create render target views (RTVs).
   {
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvCpuHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
     for (UINT i = 0; i < m_frameCount; i++)
     {
       m_renderTargets[i] = ppRenderTargets[i];
-      pDevice->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvCpuHandle);
-      rtvCpuHandle.Offset(1, m_rtvDescriptorSize);
+      pDevice->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, m_rtvHeap->GetCpuHandle(m_backBufferRtvs, i));
       NAME_D3D12_OBJECT_INDEXED(m_renderTargets, i);
     }
   }
 
   // Create the depth stencil view.
   {
-    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvCpuHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-    m_depthDsv = dsvCpuHandle;
-    ThrowIfFailed(util::CreateDepthStencilTexture2D(pDevice, width, height, DXGI_FORMAT_R32_TYPELESS, DXGI_FORMAT_D32_FLOAT, &m_depthTexture, dsvCpuHandle));
+    m_depthDsv = m_dsvHeap->GetCpuHandle(m_depthDsvAllocation);
+    ThrowIfFailed(util::CreateDepthStencilTexture2D(pDevice, width, height, DXGI_FORMAT_R32_TYPELESS, DXGI_FORMAT_D32_FLOAT, &m_depthTexture, m_depthDsv));
     NAME_D3D12_OBJECT(m_depthTexture);
   }
+
+  // Create the G-buffer and the tiled shading output. They are transients of the frame graph, placed
+  // where it allocated them. None of them share memory with these passes: the G-buffer is alive until
+  // tiled shading reads it, which is where the output starts, and the two are in different heaps
+  // anyway. Aliasing (and its barriers and discards) is only exercised by render_graph_test.
+  {
+    const CD3DX12_RESOURCE_DESC gbufferNormalDesc = CD3DX12_RESOURCE_DESC::Tex2D(kGBufferNormalFormat, width, height, 1, 1, 1, 0,
+      D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+    const CD3DX12_RESOURCE_DESC gbufferMaterialDesc = CD3DX12_RESOURCE_DESC::Tex2D(kGBufferMaterialFormat, width, height, 1, 1, 1, 0,
+      D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+    const CD3DX12_RESOURCE_DESC tiledShadingOutputDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1, 1, 0,
+      D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    m_gbufferNormalAllocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &gbufferNormalDesc);
+    m_gbufferMaterialAllocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &gbufferMaterialDesc);
+    m_tiledShadingOutputAllocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &tiledShadingOutputDesc);
+
+    // The placement only depends on which transients are alive at the same time. The shadow pass
+    // uses none, so this holds for every frame graph of the tiled deferred path.
+    BuildFrameGraph(ShadingMode::kTiledDeferred, false);
+
+    for (UINT i = 0; i < kNumTransientHeaps; ++i) {
+      // Resource heap tier 1 can't mix render targets with other textures.
+      const D3D12_HEAP_FLAGS heapFlags = i == kRenderTargetHeap ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+      const CD3DX12_HEAP_DESC heapDesc(m_frameGraph.GetHeapSize(i), D3D12_HEAP_TYPE_DEFAULT, 0, heapFlags);
+      ThrowIfFailed(pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_transientHeaps[i])));
+      NAME_D3D12_OBJECT_INDEXED(m_transientHeaps, i);
+    }
+
+    auto createPlacedResource = [&](RenderGraph::ResourceHandle handle, const D3D12_RESOURCE_DESC& desc,
+      D3D12_RESOURCE_STATES restState, ComPtr<ID3D12Resource>* pResource) {
+      const RenderGraph::TransientPlacement& placement = m_frameGraph.GetTransientPlacement(handle);
+      ThrowIfFailed(pDevice->CreatePlacedResource(m_transientHeaps[placement.heapIndex].Get(), placement.offset,
+        &desc, restState, nullptr, IID_PPV_ARGS(pResource->ReleaseAndGetAddressOf())));
+    };
+    createPlacedResource(m_frameGraphHandles.gbufferNormal, gbufferNormalDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &m_gbufferNormal);
+    NAME_D3D12_OBJECT(m_gbufferNormal);
+    createPlacedResource(m_frameGraphHandles.gbufferMaterial, gbufferMaterialDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &m_gbufferMaterial);
+    NAME_D3D12_OBJECT(m_gbufferMaterial);
+    createPlacedResource(m_frameGraphHandles.tiledShadingOutput, tiledShadingOutputDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, &m_tiledShadingOutput);
+    NAME_D3D12_OBJECT(m_tiledShadingOutput);
+
+    // *** G-buffer normal ***
+    pDevice->CreateRenderTargetView(m_gbufferNormal.Get(), nullptr, m_rtvHeap->GetCpuHandle(m_gbufferRtvs, 0));
+    pDevice->CreateShaderResourceView(m_gbufferNormal.Get(), nullptr, m_stagingHeap->GetCpuHandle(m_gbufferSrvs, 0));
+
+    // *** G-buffer material ***
+    pDevice->CreateRenderTargetView(m_gbufferMaterial.Get(), nullptr, m_rtvHeap->GetCpuHandle(m_gbufferRtvs, 1));
+    pDevice->CreateShaderResourceView(m_gbufferMaterial.Get(), nullptr, m_stagingHeap->GetCpuHandle(m_gbufferSrvs, 1));
+
+    // *** G-buffer depth, read from the depth buffer ***
+    D3D12_SHADER_RESOURCE_VIEW_DESC depthSrvDesc = {};
+    depthSrvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    depthSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    depthSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    depthSrvDesc.Texture2D.MipLevels = 1;
+    pDevice->CreateShaderResourceView(m_depthTexture.Get(), &depthSrvDesc, m_stagingHeap->GetCpuHandle(m_gbufferSrvs, 2));
+
+    // *** tiled shading output, copied to the back buffer ***
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+    pDevice->CreateUnorderedAccessView(m_tiledShadingOutput.Get(), nullptr, &uavDesc, m_stagingHeap->GetCpuHandle(m_tiledShadingOutputUav));
+  }
+
+  // Accounted as render targets, in place of those of the previous size.
+  {
+    std::vector<ID3D12Pageable*> sizeDependentObjects;
+    for (const ComPtr<ID3D12Resource>& renderTarget : m_renderTargets) {
+      sizeDependentObjects.push_back(renderTarget.Get());
+    }
+    sizeDependentObjects.push_back(m_depthTexture.Get());
+    for (const ComPtr<ID3D12Heap>& heap : m_transientHeaps) {
+      sizeDependentObjects.push_back(heap.Get());
+    }
+    m_residencyManager->RemoveSet(m_sizeDependentSet);
+    m_sizeDependentSet = m_residencyManager->AddSet(ResidencyManager::Category::kRenderTargets, sizeDependentObjects, false);
+  }
+
+  if (m_shaderFeatures.bindless) {
+    m_bindlessIndices.gbuffer = CopyBindlessDescriptors(m_gbufferSrvs, &m_bindlessDescriptors.gbuffer);
+    m_bindlessIndices.tiledShadingOutput = CopyBindlessDescriptors(m_tiledShadingOutputUav, &m_bindlessDescriptors.tiledShadingOutput);
+  }
 }
 
-void PBSScene::Update(double elapsedTime) {
-  const float moveDistance = 5.0f * static_cast<float>(elapsedTime);
-  if (m_keyboardInput.wKeyPressed || m_keyboardInput.sKeyPressed || m_keyboardInput.aKeyPressed || m_keyboardInput.dKeyPressed) {
-    m_camera.Move(m_keyboardInput.wKeyPressed, m_keyboardInput.sKeyPressed, m_keyboardInput.aKeyPressed, m_keyboardInput.dKeyPressed, moveDistance);
+void PBSScene::Update(double elapsedTime, UINT64 completedFenceValue) {
+  CPU_PROFILE_SCOPE("PBSScene::Update");
+  if (m_shadingBenchmark.Tick(elapsedTime)) {
+    if (!m_shadingBenchmark.IsRunning()) {
+      m_shadingBenchmark.WriteResults(m_pSample->GetAssetFullPath(L"shading_benchmark.csv"));
+    }
+    ApplyBenchmarkConfiguration();
+  }
+
+  // The sample has waited for the GPU to finish with the frame resource.
+  m_pCurrentFrameResource->m_uploadArena.Reset();
+  m_shaderVisibleHeap->Reclaim(completedFenceValue);
+  const UINT64 releasedSize = m_resourceAllocator->Reclaim(completedFenceValue);
+  if (releasedSize > 0) {
+    char message[128];
+    sprintf_s(message, "released %.1f MB of bake-only resources\n", releasedSize / (1024.0 * 1024.0));
+    OutputDebugStringA(message);
+    m_resourceAllocator->LogStatistics();
   }
-  
-  const float angleChange = 2.0f * static_cast<float>(elapsedTime);
-  if (m_keyboardInput.leftArrowPressed)
-    m_camera.RotateAroundYAxis(-angleChange);
-  if (m_keyboardInput.rightArrowPressed)
-    m_camera.RotateAroundYAxis(angleChange);
-  if (m_keyboardInput.upArrowPressed)
-    m_camera.RotatePitch(-angleChange);
-  if (m_keyboardInput.downArrowPressed)
-    m_camera.RotatePitch(angleChange);  
+
+  PublishLoadedAssets();
+  UpdateResidency(completedFenceValue);
+
+  // Culling and the shadow cascades use the camera as of now; Render latches it once more before submitting.
+  LatchCamera();
 
   UpdateConstantBuffers();
   CommitConstantBuffers();
 }
 
+void PBSScene::ReloadShaders(ID3D12Device* pDevice) {
+  CreatePipelineStates(pDevice);
+}
+
 void PBSScene::KeyDown(UINT8 key) {
+  RecordInputEvent();
   switch (key) {
   case VK_LEFT:
     m_keyboardInput.leftArrowPressed = true;
@@ -171,6 +360,7 @@ void PBSScene::KeyDown(UINT8 key) {
 }
 
 void PBSScene::KeyUp(UINT8 key) {
+  RecordInputEvent();
   switch (key) {
   case VK_LEFT:
     m_keyboardInput.leftArrowPressed = false;
@@ -196,46 +386,264 @@ void PBSScene::KeyUp(UINT8 key) {
   case 'D':
     m_keyboardInput.dKeyPressed = false;
     break;
+  case 'G':
+    // Toggle between forward and tiled deferred shading.
+    if (!m_shadingBenchmark.IsRunning()) {
+      m_shadingMode = m_shadingMode == ShadingMode::kForward ? ShadingMode::kTiledDeferred : ShadingMode::kForward;
+    }
+    break;
+  case 'B':
+    if (!m_shadingBenchmark.IsRunning()) {
+      m_shadingBenchmark.Start();
+      ApplyBenchmarkConfiguration();
+    }
+    break;
+  case 'H':
+    // Toggle the shadows, by switching to the variant of the shaders without them.
+    if (!m_shadingBenchmark.IsRunning()) {
+      m_shaderFeatures.shadows = m_shaderFeatures.shadows ? 0 : 1;
+    }
+    break;
+  case 'T':
+    // Cycle through the tonemap operators.
+    if (!m_shadingBenchmark.IsRunning()) {
+      m_shaderFeatures.tonemapOperator = (m_shaderFeatures.tonemapOperator + 1) % 2;
+    }
+    break;
+  case 'M':
+    m_residencyManager->LogTelemetry();
+    break;
+  case 'P':
+    ExportProfiles();
+    break;
   default:
     break;
   }
 }
 
-void PBSScene::Render(ID3D12CommandQueue* pCommandQueue) {
-  BeginFrame();
+void PBSScene::Render(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue) {
+  CPU_PROFILE_SCOPE("PBSScene::Render");
+  // The frame resource is free again, and so are the timestamps of the frame that last used it.
+  m_gpuProfiler->BeginFrame(m_frameIndex);
+  if (!m_meshesLoaded) {
+    RenderLoadingFrame(pCommandQueue, fenceValue);
+    return;
+  }
+  if (!m_sceneRendered) {
+    // Nothing has drawn into the shadow maps before the first frame of the scene, whether the assets
+    // were loaded in the background or with -syncLoading: a view that counts as rendered would be
+    // sampled uninitialized.
+    if (m_shadowCache.HasRenderedViews()) {
+      OutputDebugStringA("shadow views count as rendered before the first frame of the scene\n");
+      ThrowIfFailed(E_FAIL);
+    }
+    m_sceneRendered = true;
+  }
 
-  ScenePass();
+  // The shadow maps aren't sampled without shadows. The shadow pass is culled then, and since views
+  // only count as rendered once it records them, the stale ones are scheduled again when shadows are back.
+  BuildFrameGraph(m_shadingMode, m_shaderFeatures.shadows && !m_shadowCache.GetPendingViews().empty());
+  // Before the workers start, they bind the tables.
+  BuildDescriptorTables();
 
-  SkyboxPass();
+  // The sphere draws are recorded by the workers while this thread records the passes around them.
+  m_workerPool.Dispatch([this](UINT workerIndex) { RecordSceneChunk(workerIndex); });
 
-  EndFrame();
+  // The skybox and the lighting sample the IBL maps every frame, as does the bake.
+  m_residencyManager->Use(m_environmentSet, fenceValue);
 
+  BeginFrame();
+  // The frame and the scene pass scopes end in m_postCommandList.
+  const GpuProfiler::ScopeId frameScope = m_gpuProfiler->BeginScope(m_commandList.Get(), "frame");
+  if (m_environmentLoaded && !m_environmentBaked) {
+    // The frames in flight are done with the placeholder IBL maps before the queue gets to the bake.
+    GpuProfileScope bakeScope(m_gpuProfiler.get(), m_commandList.Get(), "bake environment");
+    BakeEnvironment();
+    m_environmentBaked = true;
+    ReleaseBakeResources(fenceValue);
+  }
+  if (BeginRenderGraphPass(m_commandList.Get(), m_frameGraph, m_frameGraphResources, m_frameGraphHandles.shadowPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), m_commandList.Get(), "shadow pass");
+    ShadowPass(m_commandList.Get());
+    // The views are recorded, so this frame shades with them: its shadow constants aren't submitted yet.
+    m_shadowCache.MarkRendered();
+    m_shadowCache.FillConstantBuffer(m_shadowConstantBuffer);
+    memcpy(m_shadowConstants.pCpu, &m_shadowConstantBuffer, sizeof(m_shadowConstantBuffer));
+  }
+  // The scene pass continues in the worker command lists.
+  BeginRenderGraphPass(m_commandList.Get(), m_frameGraph, m_frameGraphResources, m_frameGraphHandles.scenePass);
+  const GpuProfiler::ScopeId scenePassScope = m_gpuProfiler->BeginScope(m_commandList.Get(), "scene pass");
+  ClearSceneTargets(m_commandList.Get());
   ThrowIfFailed(m_commandList->Close());
-  ID3D12CommandList* command_lists[] = { m_commandList.Get() };
-  pCommandQueue->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+  // Same allocator as m_commandList, which is closed by now.
+  ID3D12GraphicsCommandList* pPostCommandList = m_postCommandList.Get();
+  ThrowIfFailed(pPostCommandList->Reset(m_pCurrentFrameResource->m_commandAllocator.Get(), nullptr));
+  m_gpuProfiler->EndScope(pPostCommandList, scenePassScope);
+  if (BeginRenderGraphPass(pPostCommandList, m_frameGraph, m_frameGraphResources, m_frameGraphHandles.tiledShadingPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pPostCommandList, "tiled shading pass");
+    TiledShadingPass(pPostCommandList);
+  }
+  if (BeginRenderGraphPass(pPostCommandList, m_frameGraph, m_frameGraphResources, m_frameGraphHandles.resolvePass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pPostCommandList, "resolve pass");
+    ResolvePass(pPostCommandList);
+  }
+  if (BeginRenderGraphPass(pPostCommandList, m_frameGraph, m_frameGraphResources, m_frameGraphHandles.skyboxPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pPostCommandList, "skybox pass");
+    SkyboxPass(pPostCommandList);
+  }
+  RecordRenderGraphBarriers(pPostCommandList, m_frameGraph.GetFinalBarriers(), m_frameGraphResources);
+  m_gpuProfiler->EndScope(pPostCommandList, frameScope);
+  m_gpuProfiler->EndFrame(pPostCommandList);
+  ThrowIfFailed(pPostCommandList->Close());
+
+  {
+    CPU_PROFILE_SCOPE("wait for workers");
+    m_workerPool.Wait();
+  }
+
+  // Late latch: the command lists only reference the camera constants by address, so they can
+  // still take the input that arrived while the frame was being recorded.
+  LatchCamera();
+  UpdateCameraConstants();
+  memcpy(m_sceneConstants.pCpu, &m_sceneConstantBuffer, sizeof(m_sceneConstantBuffer));
+  memcpy(m_tiledShadingConstants.pCpu, &m_tiledShadingConstantBuffer, sizeof(m_tiledShadingConstantBuffer));
+  if (m_firstUnlatchedInputTicks != 0) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_lastInputLatency = static_cast<double>(now.QuadPart - m_firstUnlatchedInputTicks) / m_qpcFrequency.QuadPart;
+    m_hasInputLatency = true;
+    m_firstUnlatchedInputTicks = 0;
+  }
+
+  // Submit in recording order with a single call.
+  std::vector<ID3D12CommandList*> commandLists;
+  commandLists.reserve(m_workerPool.GetThreadCount() + 2);
+  commandLists.push_back(m_commandList.Get());
+  for (const ComPtr<ID3D12GraphicsCommandList>& workerCommandList : m_pCurrentFrameResource->m_workerCommandLists) {
+    commandLists.push_back(workerCommandList.Get());
+  }
+  commandLists.push_back(m_postCommandList.Get());
+  pCommandQueue->ExecuteCommandLists(static_cast<UINT>(commandLists.size()), commandLists.data());
+  m_shaderVisibleHeap->EndFrame(fenceValue);
+}
+
+void PBSScene::BuildDescriptorTables() {
+  // The bake binds tables in bindless mode too.
+  const bool bakeEnvironment = m_environmentLoaded && !m_environmentBaked;
+  if (bakeEnvironment) {
+    m_descriptorTables.HDRTexture = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap, { m_HDRTextureSrv });
+  }
+  if (bakeEnvironment || !m_shaderFeatures.bindless) {
+    m_descriptorTables.cubeMap = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap, { m_cubeMapSrv });
+  }
+
+  // The bindless passes index the persistent views instead.
+  if (m_shaderFeatures.bindless) {
+    return;
+  }
+  m_descriptorTables.imageBasedLighting = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap, { m_irradianceMapSrv, m_prefilterMapSrvs, m_BRDFLutSrv });
+  m_descriptorTables.shadowMaps = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap, { m_shadowMapSrvs });
+  if (m_shadingMode == ShadingMode::kTiledDeferred) {
+    // t0 - t9 of tiled_deferred.hlsl
+    m_descriptorTables.tiledShadingInputs = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap,
+      { m_irradianceMapSrv, m_prefilterMapSrvs, m_BRDFLutSrv, m_gbufferSrvs });
+    m_descriptorTables.tiledShadingOutput = m_shaderVisibleHeap->CopyToRing(*m_stagingHeap, { m_tiledShadingOutputUav });
+  }
 }
 
+// Fills the IBL maps with a uniform environment until the environment map is loaded and baked, and
+// moves them to the states the shading passes read them in.
 void PBSScene::GPUWorkForInitialization(ID3D12CommandQueue* pCommandQueue) {
-  EquirectangularToCubemap();
-  ConvolveIrradianceMap();
-  PrefilterEnvironmentMap();
-  PrecomputeBRDFLut();
+  m_pCurrentFrameResource->m_commandAllocator->Reset();
+  ThrowIfFailed(m_commandList->Reset(m_pCurrentFrameResource->m_commandAllocator.Get(), nullptr));
+
+  auto clearRenderTargets = [this](const DescriptorAllocation& rtvs, const float color[4]) {
+    for (UINT i = 0; i < rtvs.count; ++i) {
+      m_commandList->ClearRenderTargetView(m_rtvHeap->GetCpuHandle(rtvs, i), color, 0, nullptr);
+    }
+  };
+  clearRenderTargets(m_cubeMapRtvs, kPlaceholderEnvironmentColor);
+  clearRenderTargets(m_irradianceMapRtvs, kPlaceholderEnvironmentColor);
+  clearRenderTargets(m_prefilterMapRtvs, kPlaceholderEnvironmentColor);
+  clearRenderTargets(m_BRDFLutRtv, kPlaceholderBRDFLutValue);
+
+  // The tiled shading compute shader samples the IBL maps too.
+  const D3D12_RESOURCE_STATES shaderResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+  std::vector<D3D12_RESOURCE_BARRIER> barriers;
+  barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_cubeMap.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+  barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_irradianceMap.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, shaderResourceState));
+  for (const ComPtr<ID3D12Resource>& prefilterMapMip : m_prefilterMap) {
+    barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(prefilterMapMip.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, shaderResourceState));
+  }
+  barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_BRDFLut.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, shaderResourceState));
+  m_commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 
   ThrowIfFailed(m_commandList->Close());
   ID3D12CommandList* command_lists[] = { m_commandList.Get() };
   pCommandQueue->ExecuteCommandLists(_countof(command_lists), command_lists);
 }
 
-void PBSScene::EquirectangularToCubemap() {
-  m_pCurrentFrameResource->m_commandAllocator->Reset();
-  ThrowIfFailed(m_commandList->Reset(m_pCurrentFrameResource->m_commandAllocator.Get(), m_pipelineStateEquirectangularToCubemap.Get()));
+void PBSScene::BakeEnvironment() {
+  // The bake passes only declare what they render and sample; the graph moves each map back to its
+  // shader resource state once it's done.
+  const D3D12_RESOURCE_STATES shaderResourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+  RenderGraph bakeGraph;
+  std::vector<ID3D12Resource*> bakeGraphResources;
+  auto importResource = [&](ID3D12Resource* pResource, const std::string& name, D3D12_RESOURCE_STATES state) {
+    bakeGraphResources.push_back(pResource);
+    return bakeGraph.ImportResource(name, state, state);
+  };
+  const RenderGraph::ResourceHandle cubeMap = importResource(m_cubeMap.Get(), "cube map", D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+  const RenderGraph::ResourceHandle irradianceMap = importResource(m_irradianceMap.Get(), "irradiance map", shaderResourceState);
+  std::vector<RenderGraph::ResourceHandle> prefilterMap;
+  for (UINT mip = 0; mip < kPrefilterMapMipLevels; ++mip) {
+    prefilterMap.push_back(importResource(m_prefilterMap[mip].Get(), "prefilter map " + std::to_string(mip), shaderResourceState));
+  }
+  const RenderGraph::ResourceHandle BRDFLut = importResource(m_BRDFLut.Get(), "BRDF LUT", shaderResourceState);
+
+  const RenderGraph::PassHandle equirectangularToCubemapPass = bakeGraph.AddPass("equirectangular to cubemap");
+  bakeGraph.Write(equirectangularToCubemapPass, cubeMap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  const RenderGraph::PassHandle irradianceConvolutionPass = bakeGraph.AddPass("irradiance convolution");
+  bakeGraph.Read(irradianceConvolutionPass, cubeMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+  bakeGraph.Write(irradianceConvolutionPass, irradianceMap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  const RenderGraph::PassHandle prefilterPass = bakeGraph.AddPass("prefilter");
+  bakeGraph.Read(prefilterPass, cubeMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+  for (RenderGraph::ResourceHandle prefilterMapMip : prefilterMap) {
+    bakeGraph.Write(prefilterPass, prefilterMapMip, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  }
+  const RenderGraph::PassHandle BRDFLutPass = bakeGraph.AddPass("BRDF LUT");
+  bakeGraph.Write(BRDFLutPass, BRDFLut, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  bakeGraph.Compile();
+
+  ID3D12GraphicsCommandList* pCommandList = m_commandList.Get();
+  if (BeginRenderGraphPass(pCommandList, bakeGraph, bakeGraphResources, equirectangularToCubemapPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pCommandList, "equirectangular to cubemap");
+    EquirectangularToCubemap();
+  }
+  if (BeginRenderGraphPass(pCommandList, bakeGraph, bakeGraphResources, irradianceConvolutionPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pCommandList, "irradiance convolution");
+    ConvolveIrradianceMap();
+  }
+  if (BeginRenderGraphPass(pCommandList, bakeGraph, bakeGraphResources, prefilterPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pCommandList, "prefilter environment map");
+    PrefilterEnvironmentMap();
+  }
+  if (BeginRenderGraphPass(pCommandList, bakeGraph, bakeGraphResources, BRDFLutPass)) {
+    GpuProfileScope scope(m_gpuProfiler.get(), pCommandList, "BRDF LUT");
+    PrecomputeBRDFLut();
+  }
+  RecordRenderGraphBarriers(pCommandList, bakeGraph.GetFinalBarriers(), bakeGraphResources);
+}
 
+void PBSScene::EquirectangularToCubemap() {
   // Set descriptor heaps.
-  ID3D12DescriptorHeap* ppHeaps[] = { m_cbvSrvHeap.Get() };
+  ID3D12DescriptorHeap* ppHeaps[] = { m_shaderVisibleHeap->GetHeap() };
   m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
   m_commandList->SetGraphicsRootSignature(m_rootSignatureEquirectangularToCubemap.Get());
-  m_commandList->SetGraphicsRootDescriptorTable(1, m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
+  m_commandList->SetPipelineState(m_pipelineStateEquirectangularToCubemap.Get());
+  m_commandList->SetGraphicsRootDescriptorTable(1, m_descriptorTables.HDRTexture);
 
   m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferViewCube);
   m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -263,41 +671,31 @@ void PBSScene::EquirectangularToCubemap() {
     0.0f, -1.0f,  0.0f,
     0.0f, -1.0f,  0.0f
   };
-  std::vector<ViewProjectionConstantBuffer> constantBuffers(kCubeMapArraySize);
   for (UINT16 i = 0; i < kCubeMapArraySize; ++i) {
     XMVECTOR at = XMVectorSet(cameraTargets[3 * i], cameraTargets[3 * i + 1], cameraTargets[3 * i + 2], 0.0f);
     XMVECTOR up = XMVectorSet(cameraUps[3 * i], cameraUps[3 * i + 1], cameraUps[3 * i + 2], 1.0f);
     camera.Set(eye, at, up);
-    camera.Get3DViewProjMatrices(&constantBuffers[i].view, &constantBuffers[i].projection,
+    XMFLOAT4X4 view;
+    XMFLOAT4X4 projection;
+    camera.Get3DViewProjMatrices(&view, &projection,
       90.0f, static_cast<float>(kCubeMapWidth), static_cast<float>(kCubeMapHeight), 0.1f, 10.0f);
+    // Both are transposed, so this is the transposed view * projection.
+    XMStoreFloat4x4(&m_cubeFaceViewProjections[i], XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view)));
   }
-  size_t constantBufferSize = sizeof(ViewProjectionConstantBuffer);
-  memcpy(m_pCurrentFrameResource->m_pConstantBufferEquirectangularToCubemapWO, constantBuffers.data(), constantBufferSize * kCubeMapArraySize);
-  CD3DX12_CPU_DESCRIPTOR_HANDLE cubeMapRTVHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount, m_rtvDescriptorSize);
   for (UINT16 i = 0; i < kCubeMapArraySize; ++i) {
+    const D3D12_CPU_DESCRIPTOR_HANDLE cubeMapRTVHandle = m_rtvHeap->GetCpuHandle(m_cubeMapRtvs, i);
     m_commandList->OMSetRenderTargets(1, &cubeMapRTVHandle, false, nullptr);
-    cubeMapRTVHandle.Offset(1, m_rtvDescriptorSize);
 
-    m_commandList->SetGraphicsRootConstantBufferView(0, 
-      m_pCurrentFrameResource->m_constantBufferEquirectangularToCubemap->GetGPUVirtualAddress() + i * constantBufferSize);
+    m_commandList->SetGraphicsRoot32BitConstants(0, 16, &m_cubeFaceViewProjections[i], 0);
 
     m_commandList->DrawInstanced(36, 1, 0, 0);
   }
-
-  D3D12_RESOURCE_BARRIER cubeMapBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_cubeMap.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  m_commandList->ResourceBarrier(1, &cubeMapBarrier);
-
-  //ThrowIfFailed(m_commandList->Close());
-  //ID3D12CommandList* command_lists[] = { m_commandList.Get() };
-  //pCommandQueue->ExecuteCommandLists(_countof(command_lists), command_lists);
 }
 
 void PBSScene::ConvolveIrradianceMap() {
   m_commandList->SetPipelineState(m_pipelineStateIrradianceConvolution.Get());
 
-  CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxGpuHandle(m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
-  skyboxGpuHandle.Offset(m_cbvSrvDescriptorSize);
-  m_commandList->SetGraphicsRootDescriptorTable(1, skyboxGpuHandle);
+  m_commandList->SetGraphicsRootDescriptorTable(1, m_descriptorTables.cubeMap);
 
   // Some states are the same as equirectangular to cubemap's, so omit api calls such as IASetVertexBuffers
   CD3DX12_VIEWPORT viewport{ 0.f, 0.f, static_cast<float>(kIrradianceMapWidth), static_cast<float>(kIrradianceMapHeight) };
@@ -305,41 +703,24 @@ void PBSScene::ConvolveIrradianceMap() {
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  size_t constantBufferSize = sizeof(ViewProjectionConstantBuffer);
-  CD3DX12_CPU_DESCRIPTOR_HANDLE irradianceMapRTVHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize, m_rtvDescriptorSize);
   for (UINT16 i = 0; i < kCubeMapArraySize; ++i) {
+    const D3D12_CPU_DESCRIPTOR_HANDLE irradianceMapRTVHandle = m_rtvHeap->GetCpuHandle(m_irradianceMapRtvs, i);
     m_commandList->OMSetRenderTargets(1, &irradianceMapRTVHandle, false, nullptr);
-    irradianceMapRTVHandle.Offset(1, m_rtvDescriptorSize);
     
-    m_commandList->SetGraphicsRootConstantBufferView(0,
-      m_pCurrentFrameResource->m_constantBufferEquirectangularToCubemap->GetGPUVirtualAddress() + i * constantBufferSize);
+    m_commandList->SetGraphicsRoot32BitConstants(0, 16, &m_cubeFaceViewProjections[i], 0);
 
     m_commandList->DrawInstanced(36, 1, 0, 0);
   }
-
-  D3D12_RESOURCE_BARRIER irradianceMapBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_irradianceMap.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  m_commandList->ResourceBarrier(1, &irradianceMapBarrier);
 }
 
 void PBSScene::PrefilterEnvironmentMap() {  
   m_commandList->SetGraphicsRootSignature(m_rootSignaturePrefilter.Get());
   m_commandList->SetPipelineState(m_pipelineStatePrefilter.Get());
 
-  CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxGpuHandle(m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
-  skyboxGpuHandle.Offset(m_cbvSrvDescriptorSize);
-  m_commandList->SetGraphicsRootDescriptorTable(2, skyboxGpuHandle);
+  m_commandList->SetGraphicsRootDescriptorTable(2, m_descriptorTables.cubeMap);
 
-  std::vector<PrefilterConstantBuffer> prefilterConstantBuffers(kPrefilterMapMipLevels);
-  for (UINT mip = 0; mip < kPrefilterMapMipLevels; ++mip) {
-    float roughness = (float)mip / (float)(kPrefilterMapMipLevels - 1);
-    prefilterConstantBuffers[mip].roughness = roughness;
-  }
-  size_t prefilterConstantBufferSize = sizeof(PrefilterConstantBuffer);
-  memcpy(m_pCurrentFrameResource->m_pConstantBufferPrefilterWO, prefilterConstantBuffers.data(), prefilterConstantBufferSize * kPrefilterMapMipLevels);
-  size_t viewProjectionConstantBufferSize = sizeof(ViewProjectionConstantBuffer);
   UINT width = kPrefilterMapWidth;
   UINT height = kPrefilterMapHeight;
-  CD3DX12_CPU_DESCRIPTOR_HANDLE prefilterMapRTVHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize + kCubeMapArraySize, m_rtvDescriptorSize);
   for (UINT mip = 0; mip < kPrefilterMapMipLevels; ++mip) {
     if (mip != 0) {
       width /= 2; height /= 2;
@@ -348,23 +729,17 @@ void PBSScene::PrefilterEnvironmentMap() {
     CD3DX12_RECT scissorRect{ 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
     m_commandList->RSSetViewports(1, &viewport);
     m_commandList->RSSetScissorRects(1, &scissorRect);
-    m_commandList->SetGraphicsRootConstantBufferView(1, m_pCurrentFrameResource->m_constantBufferPrefilter->GetGPUVirtualAddress() + mip * prefilterConstantBufferSize);
+    const float roughness = (float)mip / (float)(kPrefilterMapMipLevels - 1);
+    m_commandList->SetGraphicsRoot32BitConstants(1, 1, &roughness, 0);
     for (UINT16 i = 0; i < kCubeMapArraySize; ++i) {
+      const D3D12_CPU_DESCRIPTOR_HANDLE prefilterMapRTVHandle = m_rtvHeap->GetCpuHandle(m_prefilterMapRtvs, mip * kCubeMapArraySize + i);
       m_commandList->OMSetRenderTargets(1, &prefilterMapRTVHandle, false, nullptr);
-      prefilterMapRTVHandle.Offset(1, m_rtvDescriptorSize);
 
-      m_commandList->SetGraphicsRootConstantBufferView(0,
-        m_pCurrentFrameResource->m_constantBufferEquirectangularToCubemap->GetGPUVirtualAddress() + i * viewProjectionConstantBufferSize);
+      m_commandList->SetGraphicsRoot32BitConstants(0, 16, &m_cubeFaceViewProjections[i], 0);
 
       m_commandList->DrawInstanced(36, 1, 0, 0);
     }
   }
-
-  D3D12_RESOURCE_BARRIER prefilterMapBarriers[kPrefilterMapMipLevels]{};
-  for (UINT mip = 0; mip < kPrefilterMapMipLevels; ++mip) {
-    prefilterMapBarriers[mip] = CD3DX12_RESOURCE_BARRIER::Transition(m_prefilterMap[mip].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  }
-  m_commandList->ResourceBarrier(_countof(prefilterMapBarriers), prefilterMapBarriers);
 }
 
 void PBSScene::PrecomputeBRDFLut() {
@@ -379,13 +754,10 @@ void PBSScene::PrecomputeBRDFLut() {
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE BRDFLutRTVHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize + kCubeMapArraySize + kCubeMapArraySize * kPrefilterMapMipLevels, m_rtvDescriptorSize);
+  const D3D12_CPU_DESCRIPTOR_HANDLE BRDFLutRTVHandle = m_rtvHeap->GetCpuHandle(m_BRDFLutRtv);
   m_commandList->OMSetRenderTargets(1, &BRDFLutRTVHandle, false, nullptr);
 
   m_commandList->DrawInstanced(4, 1, 0, 0);
-
-  D3D12_RESOURCE_BARRIER BRDFLutResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_BRDFLut.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  m_commandList->ResourceBarrier(1, &BRDFLutResourceBarrier);
 }
 
 void PBSScene::InitializeCameraAndLights() {
@@ -394,59 +766,60 @@ void PBSScene::InitializeCameraAndLights() {
   XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f);
   m_camera.Set(eye, at, up);
 
-  std::vector<LightState> lightStates;
-  lightStates.emplace_back(-10.0f,  10.0f, 10.0f, 300.0f, 300.0f, 300.0f);
-  lightStates.emplace_back( 10.0f,  10.0f, 10.0f, 300.0f, 300.0f, 300.0f);
-  lightStates.emplace_back(-10.0f, -10.0f, 10.0f, 300.0f, 300.0f, 300.0f);
-  lightStates.emplace_back( 10.0f, -10.0f, 10.0f, 300.0f, 300.0f, 300.0f);
+  InitializeLights();
+}
 
-  memcpy(&m_lights.lights[0], lightStates.data(), sizeof(LightState) * kNumLights);
+void PBSScene::InitializeLights() {
+  LightState lights[] = {
+    LightState(-10.0f,  10.0f, 10.0f, 300.0f, 300.0f, 300.0f),
+    LightState( 10.0f,  10.0f, 10.0f, 300.0f, 300.0f, 300.0f),
+    LightState(-10.0f, -10.0f, 10.0f, 300.0f, 300.0f, 300.0f),
+    LightState( 10.0f, -10.0f, 10.0f, 300.0f, 300.0f, 300.0f),
+  };
+
+  // Every light of the regular scene casts shadows.
+  m_lightManager.RemoveAllLights();
+  m_shadowedLights.clear();
+  for (LightState& light : lights) {
+    light.shadowIndex = static_cast<INT>(m_shadowedLights.size());
+    m_shadowedLights.emplace_back(m_lightManager.AddLight(light));
+  }
 }
 
 void PBSScene::CreateDescriptorHeaps(ID3D12Device* pDevice) {
-  // Describe and create a render target view (RTV) descriptor heap.
-  D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-  rtvHeapDesc.NumDescriptors = GetNumRtvDescriptors();
-  rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-  rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-  ThrowIfFailed(pDevice->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
-  NAME_D3D12_OBJECT(m_rtvHeap);
-
-  // Describe and create a depth stencil view (DSV) descriptor heap.
-  D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-  dsvHeapDesc.NumDescriptors = 1;
-  dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-  dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-  ThrowIfFailed(pDevice->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
-  NAME_D3D12_OBJECT(m_dsvHeap);
-
-  // Describe and create a shader resource view (SRV) and constant 
-  // buffer view (CBV) descriptor heap.  
-  D3D12_DESCRIPTOR_HEAP_DESC cbvSrvHeapDesc = {};
-  cbvSrvHeapDesc.NumDescriptors = GetNumCbvSrvUavDescriptors();
-  cbvSrvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-  cbvSrvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-  ThrowIfFailed(pDevice->CreateDescriptorHeap(&cbvSrvHeapDesc, IID_PPV_ARGS(&m_cbvSrvHeap)));
-  NAME_D3D12_OBJECT(m_cbvSrvHeap);
-
-  // Get descriptor sizes for the current device.
-  m_rtvDescriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-  m_cbvSrvDescriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  // Render target view (RTV) and depth stencil view (DSV) descriptor heaps.
+  m_rtvHeap = std::make_unique<DescriptorHeap>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, false, kRtvHeapCapacity, 0, L"m_rtvHeap");
+  m_dsvHeap = std::make_unique<DescriptorHeap>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, false, kDsvHeapCapacity, 0, L"m_dsvHeap");
+
+  // Shader resource views (SRVs) and unordered access views (UAVs) are created in a heap the shaders
+  // can't see, and copied to the shader visible one as tables.
+  m_stagingHeap = std::make_unique<DescriptorHeap>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, false, kStagingHeapCapacity, 0, L"m_stagingHeap");
+  m_shaderVisibleHeap = std::make_unique<DescriptorHeap>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true,
+    m_shaderFeatures.bindless ? kBindlessDescriptorCapacity : 0, kDescriptorRingCapacity, L"m_shaderVisibleHeap");
 }
 
 void PBSScene::CreateRootSignatures(ID3D12Device* pDevice) {
   std::vector<util::SamplerDesc> samplerDescs;
   samplerDescs.emplace_back(util::SamplerDesc());
 
-  // Create the root signature for the equirectangular to cubemap.
+  // Create the root signature for the equirectangular to cubemap, the cube face's view projection matrix is a root constant.
   {
     std::vector<util::DescriptorDesc> descriptorDescs;
-    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_VERTEX, 1, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootConstants, D3D12_SHADER_VISIBILITY_VERTEX, 16, 0);
     descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1, 0);
 
     util::CreateRootSignature(pDevice, descriptorDescs, samplerDescs, &m_rootSignatureEquirectangularToCubemap, L"m_rootSignatureEquirectangularToCubemap");
   }
 
+  // Create the root signature for the skybox. The scene constants are late latched, the cubemap doesn't change after the bake.
+  {
+    std::vector<util::DescriptorDesc> descriptorDescs;
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_VERTEX, 1, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1, 0, util::DataVolatility::kStatic);
+
+    util::CreateRootSignature(pDevice, descriptorDescs, samplerDescs, &m_rootSignatureSkybox, L"m_rootSignatureSkybox");
+  }
+
   // Create the root signature for generating BRDF LUT.
   {
     std::vector<util::DescriptorDesc> nullDescriptorDescs;
@@ -457,24 +830,84 @@ void PBSScene::CreateRootSignatures(ID3D12Device* pDevice) {
   // Create the root signature for prefilter.
   {
     std::vector<util::DescriptorDesc> descriptorDescs;
-    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 0);
-    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_PIXEL, 1, 1);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootConstants, D3D12_SHADER_VISIBILITY_VERTEX, 16, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootConstants, D3D12_SHADER_VISIBILITY_PIXEL, 1, 1);  // roughness
     descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1, 0);
 
     util::CreateRootSignature(pDevice, descriptorDescs, samplerDescs, &m_rootSignaturePrefilter, L"m_rootSignaturePrefilter");
   }
 
   // Create the root signature for scene pass.
+  // The scene constants are late latched, the lights and shadow constants are written before recording, and the IBL
+  // maps don't change after the bake. The shadow maps are rendered by the frame itself.
+  {
+    std::vector<util::DescriptorDesc> descriptorDescs;
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1, kLightStatesShaderRegister,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1, kVisibleLightIndicesShaderRegister,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1 + kPrefilterMapMipLevels + 1, 0,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_PIXEL, 1, 1, util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 2, kShadowMapsShaderRegister);
+    std::vector<util::SamplerDesc> sceneSamplerDescs(samplerDescs);
+    sceneSamplerDescs.emplace_back(D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 1,
+      D3D12_SHADER_VISIBILITY_PIXEL, D3D12_COMPARISON_FUNC_LESS_EQUAL);
+    util::CreateRootSignature(pDevice, descriptorDescs, sceneSamplerDescs, &m_rootSignatureScenePass, L"m_rootSignatureScenePass");
+  }
+
+  // Create the root signature for tiled deferred shading, with the same promises as the scene pass.
+  {
+    std::vector<util::DescriptorDesc> descriptorDescs;
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 1, kLightStatesShaderRegister,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 1, kVisibleLightIndicesShaderRegister,
+      util::DataVolatility::kStatic);
+    // IBL maps followed by G-buffer normal, material and depth, which the frame renders
+    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 1 + kPrefilterMapMipLevels + 1 + 3, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kUnorderedAccessView, D3D12_SHADER_VISIBILITY_ALL, 1, 0);
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 1, util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 2, kShadowMapsShaderRegister);
+    std::vector<util::SamplerDesc> computeSamplerDescs;
+    computeSamplerDescs.emplace_back(D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, D3D12_SHADER_VISIBILITY_ALL);
+    computeSamplerDescs.emplace_back(D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 1,
+      D3D12_SHADER_VISIBILITY_ALL, D3D12_COMPARISON_FUNC_LESS_EQUAL);
+    util::CreateRootSignature(pDevice, descriptorDescs, computeSamplerDescs, &m_rootSignatureTiledShading, L"m_rootSignatureTiledShading");
+  }
+
+  // Create the root signature for the shadow maps, the view projection matrix is a root constant.
   {
     std::vector<util::DescriptorDesc> descriptorDescs;
+    descriptorDescs.emplace_back(util::DescriptorType::kRootConstants, D3D12_SHADER_VISIBILITY_VERTEX, 16, 0);
+    std::vector<util::SamplerDesc> nullSamplerDescs;
+    util::CreateRootSignature(pDevice, descriptorDescs, nullSamplerDescs, &m_rootSignatureShadow, L"m_rootSignatureShadow");
+  }
+
+  // Create the root signature of the shading passes in bindless mode, graphics and compute alike. The BindlessIndices
+  // root constants locate the views in the descriptor heap, the rest are the root descriptors of the other signatures.
+  if (m_shaderFeatures.bindless) {
+    std::vector<util::DescriptorDesc> descriptorDescs;
+    descriptorDescs.emplace_back(util::DescriptorType::kRootConstants, D3D12_SHADER_VISIBILITY_ALL, sizeof(BindlessIndices) / sizeof(UINT),
+      kBindlessIndicesShaderRegister);
     descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 0);
-    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_PIXEL, 1, 1);
-    descriptorDescs.emplace_back(util::DescriptorType::kShaderResourceView, D3D12_SHADER_VISIBILITY_PIXEL, 1 + kPrefilterMapMipLevels + 1, 0);
-    util::CreateRootSignature(pDevice, descriptorDescs, samplerDescs, &m_rootSignatureScenePass, L"m_rootSignatureScenePass");
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 1, kLightStatesShaderRegister,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kRootShaderResourceView, D3D12_SHADER_VISIBILITY_ALL, 1, kVisibleLightIndicesShaderRegister,
+      util::DataVolatility::kStatic);
+    descriptorDescs.emplace_back(util::DescriptorType::kConstantBuffer, D3D12_SHADER_VISIBILITY_ALL, 1, 1, util::DataVolatility::kStatic);
+    std::vector<util::SamplerDesc> bindlessSamplerDescs;
+    bindlessSamplerDescs.emplace_back(D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0, D3D12_SHADER_VISIBILITY_ALL);
+    bindlessSamplerDescs.emplace_back(D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 1,
+      D3D12_SHADER_VISIBILITY_ALL, D3D12_COMPARISON_FUNC_LESS_EQUAL);
+    util::CreateRootSignature(pDevice, descriptorDescs, bindlessSamplerDescs, &m_rootSignatureBindless, L"m_rootSignatureBindless",
+      D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED);
   }
 }
 
 void PBSScene::CreatePipelineStates(ID3D12Device* pDevice) {
+  CPU_PROFILE_SCOPE("PBSScene::CreatePipelineStates");
   const D3D12_INPUT_ELEMENT_DESC standardVertexAttributeDesc[] = {
     {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
     {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -504,63 +937,132 @@ void PBSScene::CreatePipelineStates(ID3D12Device* pDevice) {
 
   std::vector<DXGI_FORMAT> lutRtvFormats(1);
   lutRtvFormats[0] = DXGI_FORMAT_R16G16_FLOAT;
+
+  if (!m_pipelineLibrary) {
+    m_pipelineLibrary = std::make_unique<PipelineLibrary>(pDevice, m_pSample->GetAssetFullPath(L"pipelines.cache"));
+  }
+  const UINT compiledCount = m_pipelineLibrary->GetCompiledCount();
+
+  // The passes that don't depend on the shader features use the defaults. The other shading passes only follow the
+  // bindless mode, and have a root signature of their own without it.
+  const ShaderFeatureKey defaultFeatures;
+  ShaderFeatureKey shadingFeatures;
+  shadingFeatures.bindless = m_shaderFeatures.bindless;
+  const bool bindless = m_shaderFeatures.bindless != 0;
+
+  // The pipeline states are created on the worker threads, one per task.
+  std::vector<std::function<void()>> tasks;
+
   // Create the equirectangular to cubemap pipeline state.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/equirectangular_to_cubemap.hlsl", standardInputElementDescs,
+  tasks.emplace_back([&] {
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/equirectangular_to_cubemap.hlsl", defaultFeatures,
+      standardInputElementDescs,
       m_rootSignatureEquirectangularToCubemap.Get(), floatRtvFormats,
       false, D3D12_COMPARISON_FUNC_LESS,
       &m_pipelineStateEquirectangularToCubemap, L"m_pipelineStateEquirectangularToCubemap");
-  }
+  });
 
   // Create the skybox pipeline state for rendering the skybox cubemap derived from equirectangular map.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/skybox.hlsl", standardInputElementDescs,
-      m_rootSignatureEquirectangularToCubemap.Get(), unormRtvFormats,
+  tasks.emplace_back([&] {
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/skybox.hlsl", shadingFeatures,
+      standardInputElementDescs,
+      bindless ? m_rootSignatureBindless.Get() : m_rootSignatureSkybox.Get(), unormRtvFormats,
       true, D3D12_COMPARISON_FUNC_LESS_EQUAL,
-      &m_pipelineStateSkybox, L"m_pipelineStateSkybox");
-  }
+      &m_pipelineStateSkybox, bindless ? L"m_pipelineStateSkybox bindless" : L"m_pipelineStateSkybox");
+  });
 
   // Create the pipeline state for generating irradiance map.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/irradiance_convolution.hlsl", standardInputElementDescs,
+  tasks.emplace_back([&] {
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/irradiance_convolution.hlsl", defaultFeatures,
+      standardInputElementDescs,
       m_rootSignatureEquirectangularToCubemap.Get(), floatRtvFormats,
       false, D3D12_COMPARISON_FUNC_LESS,
       &m_pipelineStateIrradianceConvolution, L"m_pipelineIrradianceConvolution");
-  }
+  });
 
   // Create the pipeline state for generating prefilter map.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/prefilter.hlsl", standardInputElementDescs,
+  tasks.emplace_back([&] {
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/prefilter.hlsl", defaultFeatures,
+      standardInputElementDescs,
       m_rootSignaturePrefilter.Get(), floatRtvFormats,
       false, D3D12_COMPARISON_FUNC_LESS,
       &m_pipelineStatePrefilter, L"m_pipelineStatePrefilter");
-  }
+  });
 
   // Create the pipeline state for generating BRDF LUT.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/brdf.hlsl", standardInputElementDescs,
+  tasks.emplace_back([&] {
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/brdf.hlsl", defaultFeatures,
+      standardInputElementDescs,
       m_rootSignatureBRDFLut.Get(), lutRtvFormats,
       false, D3D12_COMPARISON_FUNC_LESS,
       &m_pipelineStateBRDFLut, L"m_pipelineStateBRDFLut",
       true);
-  }
-
-  // Create the scene pass pipeline.
-  {
-    util::CreatePipelineState(pDevice, m_pSample, L"assets/pbr.hlsl", instanceInputElementDescs,
-      m_rootSignatureScenePass.Get(), unormRtvFormats,
+  });
+
+  // Create the G-buffer pass pipeline.
+  tasks.emplace_back([&] {
+    std::vector<DXGI_FORMAT> gbufferRtvFormats(2);
+    gbufferRtvFormats[0] = kGBufferNormalFormat;
+    gbufferRtvFormats[1] = kGBufferMaterialFormat;
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/gbuffer.hlsl", shadingFeatures,
+      instanceInputElementDescs,
+      bindless ? m_rootSignatureBindless.Get() : m_rootSignatureScenePass.Get(), gbufferRtvFormats,
       true, D3D12_COMPARISON_FUNC_LESS,
-      &m_pipelineStateScenePass, L"m_pipelineStateScenePass",
+      &m_pipelineStateGBuffer, bindless ? L"m_pipelineStateGBuffer bindless" : L"m_pipelineStateGBuffer",
       true);
+  });
+
+  // Create the shadow map pipeline.
+  tasks.emplace_back([&] {
+    // The shadow views use left handed matrices, which flips the winding of the spheres.
+    std::vector<DXGI_FORMAT> nullRtvFormats;
+    util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/shadow.hlsl", defaultFeatures,
+      instanceInputElementDescs,
+      m_rootSignatureShadow.Get(), nullRtvFormats,
+      true, D3D12_COMPARISON_FUNC_LESS,
+      &m_pipelineStateShadow, L"m_pipelineStateShadow");
+  });
+
+  // Create the pipelines of the shading passes, one per variant of the shaders in the current bindless mode.
+  for (UINT i = 0; i < ShaderFeatureKey::kCount; ++i) {
+    const ShaderFeatureKey key = ShaderFeatureKey::FromIndex(i);
+    if (key.bindless != m_shaderFeatures.bindless) {
+      continue;
+    }
+
+    // Create the scene pass pipeline.
+    tasks.emplace_back([&, i, key] {
+      const std::wstring name = L"m_pipelineStateScenePass " + key.GetName();
+      util::CreatePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/pbr.hlsl", key,
+        instanceInputElementDescs,
+        bindless ? m_rootSignatureBindless.Get() : m_rootSignatureScenePass.Get(), unormRtvFormats,
+        true, D3D12_COMPARISON_FUNC_LESS,
+        &m_shadingPipelineStates[i].scenePass, name.c_str(),
+        true);
+    });
+
+    // Create the tiled deferred shading pipeline.
+    tasks.emplace_back([&, i, key] {
+      const std::wstring name = L"m_pipelineStateTiledShading " + key.GetName();
+      util::CreateComputePipelineState(m_pipelineLibrary.get(), &m_shaderCache, L"assets/tiled_deferred.hlsl", key,
+        bindless ? m_rootSignatureBindless.Get() : m_rootSignatureTiledShading.Get(), &m_shadingPipelineStates[i].tiledShading, name.c_str());
+    });
   }
+
+  m_workerPool.ForEach(static_cast<UINT>(tasks.size()), [&](UINT i) { tasks[i](); });
+  m_pipelineLibrary->Save();
+
+  char message[128];
+  sprintf_s(message, "pipeline states: %zu created, %u of them compiled\n", tasks.size(), m_pipelineLibrary->GetCompiledCount() - compiledCount);
+  OutputDebugStringA(message);
 }
 
 void PBSScene::CreateFrameResources(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue) {
   for (UINT i = 0; i < m_frameCount; i++) {
-    m_frameResources[i] = std::make_unique<FrameResource>(pDevice, pCommandQueue);
-
-    memcpy(m_frameResources[i]->m_pConstantBufferLightStatesWO, &m_lights, sizeof(m_lights));
+    m_frameResources[i] = std::make_unique<FrameResource>(pDevice, pCommandQueue, m_workerPool.GetThreadCount());
   }
+
+  m_lightManager.CreateResources(pDevice);
 }
 
 void PBSScene::CreateCommandLists(ID3D12Device* pDevice) {
@@ -569,66 +1071,49 @@ void PBSScene::CreateCommandLists(ID3D12Device* pDevice) {
   ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocator, nullptr, IID_PPV_ARGS(&m_commandList)));
   ThrowIfFailed(m_commandList->Close());
   NAME_D3D12_OBJECT(m_commandList);
+
+  ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocator, nullptr, IID_PPV_ARGS(&m_postCommandList)));
+  ThrowIfFailed(m_postCommandList->Close());
+  NAME_D3D12_OBJECT(m_postCommandList);
 }
 
-void PBSScene::CreateAssetResources(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList) {
-  // Create the cube vertex buffer
+void PBSScene::CreateAssetResources(ID3D12Device* pDevice) {
+  // Create the cubemap, irradiance map, prefilter map, and BRDF LUT resource. They are rendered on the GPU,
+  // so they don't wait for the loader.
   {
-    CubeModel cubeModel;
-    size_t vertexDataSize = cubeModel.GetVertexDataSize();
-    std::unique_ptr<Model::Vertex[]> vertices = cubeModel.GetVertexData();
-
-    util::CreateVertexBufferResource(pDevice, pCommandList,
-      vertexDataSize, &m_vertexBufferCube, L"m_vertexBufferCube", &m_vertexBufferCubeUpload, vertices.get(),
-      m_vertexBufferViewCube, static_cast<UINT>(Model::GetVertexStride()));
-  }
+    const UINT rtvDescriptorSize = m_rtvHeap->GetDescriptorSize();
 
-  // Create HDR texture, cubemap, irradiance map, prefilter map, and BRDF LUT resource.
-  {
-    // Get a handle to the start of the descriptor heap.
-    CD3DX12_CPU_DESCRIPTOR_HANDLE cbvSrvCpuHandle(m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart());
-    CD3DX12_GPU_DESCRIPTOR_HANDLE cbvSrvGpuHandle(m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
-
-    // Load HDR image file.
-    TexMetadata metaData;
-    ScratchImage image;
-    DirectX::LoadFromHDRFile(m_pSample->GetAssetFullPath(L"assets/Newport_Loft_Ref.hdr").c_str(), &metaData, image);
-
-    // *** HRD texture ***
-    util::Create2DTextureResource(pDevice, pCommandList,
-      metaData.width, static_cast<UINT>(metaData.height), static_cast<UINT16>(metaData.mipLevels), metaData.format, D3D12_RESOURCE_FLAG_NONE,
-      &m_HDRTexture, L"m_HDRTexture", D3D12_RESOURCE_STATE_COPY_DEST,
-      true, &m_HDRTextureUpload, image.GetPixels(), image.GetImages()->rowPitch, image.GetImages()->slicePitch,
-      true, &cbvSrvCpuHandle,
-      false, nullptr);
-    cbvSrvCpuHandle.Offset(m_cbvSrvDescriptorSize);
-    cbvSrvGpuHandle.Offset(m_cbvSrvDescriptorSize);
+    // *** HRD texture, created by the loader ***
+    m_HDRTextureSrv = m_stagingHeap->Allocate(1);
 
     // *** cubemap(skybox) ***
-    CD3DX12_CPU_DESCRIPTOR_HANDLE cubemapStartRtvCpuHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount, m_rtvDescriptorSize);
-    util::CreateCubeTextureResource(pDevice, pCommandList,
-      kCubeMapWidth, kCubeMapHeight, 1, metaData.format, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
+    m_cubeMapSrv = m_stagingHeap->Allocate(1);
+    m_cubeMapRtvs = m_rtvHeap->Allocate(kCubeMapArraySize);
+    const D3D12_CPU_DESCRIPTOR_HANDLE cubeMapSrvCpuHandle = m_stagingHeap->GetCpuHandle(m_cubeMapSrv);
+    const D3D12_CPU_DESCRIPTOR_HANDLE cubemapStartRtvCpuHandle = m_rtvHeap->GetCpuHandle(m_cubeMapRtvs);
+    util::CreateCubeTextureResource(pDevice, m_environmentAllocator.get(), nullptr,
+      kCubeMapWidth, kCubeMapHeight, 1, kEnvironmentFormat, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
       &m_cubeMap, L"m_cubeMap", D3D12_RESOURCE_STATE_RENDER_TARGET,
-      false, nullptr, nullptr, 0, 0,
-      true, &cbvSrvCpuHandle,
-      true, &cubemapStartRtvCpuHandle, m_rtvDescriptorSize);
-    cbvSrvCpuHandle.Offset(m_cbvSrvDescriptorSize);
-    cbvSrvGpuHandle.Offset(m_cbvSrvDescriptorSize);
+      false, nullptr, 0, 0,
+      true, &cubeMapSrvCpuHandle,
+      true, &cubemapStartRtvCpuHandle, rtvDescriptorSize);
 
     // *** irradiance map ***
-    CD3DX12_CPU_DESCRIPTOR_HANDLE irradianceMapStartRtvCpuHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize, m_rtvDescriptorSize);
-    util::CreateCubeTextureResource(pDevice, pCommandList,
-      kIrradianceMapWidth, kIrradianceMapHeight, 1, metaData.format, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
+    m_irradianceMapSrv = m_stagingHeap->Allocate(1);
+    m_irradianceMapRtvs = m_rtvHeap->Allocate(kCubeMapArraySize);
+    const D3D12_CPU_DESCRIPTOR_HANDLE irradianceMapSrvCpuHandle = m_stagingHeap->GetCpuHandle(m_irradianceMapSrv);
+    const D3D12_CPU_DESCRIPTOR_HANDLE irradianceMapStartRtvCpuHandle = m_rtvHeap->GetCpuHandle(m_irradianceMapRtvs);
+    util::CreateCubeTextureResource(pDevice, m_environmentAllocator.get(), nullptr,
+      kIrradianceMapWidth, kIrradianceMapHeight, 1, kEnvironmentFormat, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
       &m_irradianceMap, L"m_irradianceMap", D3D12_RESOURCE_STATE_RENDER_TARGET,
-      false, nullptr, nullptr, 0, 0,
-      true, &cbvSrvCpuHandle,
-      true, &irradianceMapStartRtvCpuHandle, m_rtvDescriptorSize);
-    cbvSrvCpuHandle.Offset(m_cbvSrvDescriptorSize);
-    cbvSrvGpuHandle.Offset(m_cbvSrvDescriptorSize);
+      false, nullptr, 0, 0,
+      true, &irradianceMapSrvCpuHandle,
+      true, &irradianceMapStartRtvCpuHandle, rtvDescriptorSize);
 
     // *** prefilter map ***
     m_prefilterMap.resize(kPrefilterMapMipLevels);
-    CD3DX12_CPU_DESCRIPTOR_HANDLE prefilterMapStartRtvCpuHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize + kCubeMapArraySize, m_rtvDescriptorSize);
+    m_prefilterMapSrvs = m_stagingHeap->Allocate(kPrefilterMapMipLevels);
+    m_prefilterMapRtvs = m_rtvHeap->Allocate(kCubeMapArraySize * kPrefilterMapMipLevels);
     size_t prefilterMapMipWidth = kPrefilterMapWidth;
     UINT prefilterMapMipHeight = kPrefilterMapHeight;
     for (UINT i = 0; i < kPrefilterMapMipLevels; ++i) {
@@ -638,142 +1123,719 @@ void PBSScene::CreateAssetResources(ID3D12Device* pDevice, ID3D12GraphicsCommand
         prefilterMapMipWidth /= 2;
         prefilterMapMipHeight /= 2;
       }
-      util::CreateCubeTextureResource(pDevice, pCommandList,
-        prefilterMapMipWidth, prefilterMapMipHeight, 1, metaData.format, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
+      const D3D12_CPU_DESCRIPTOR_HANDLE prefilterMapSrvCpuHandle = m_stagingHeap->GetCpuHandle(m_prefilterMapSrvs, i);
+      const D3D12_CPU_DESCRIPTOR_HANDLE prefilterMapStartRtvCpuHandle = m_rtvHeap->GetCpuHandle(m_prefilterMapRtvs, i * kCubeMapArraySize);
+      util::CreateCubeTextureResource(pDevice, m_environmentAllocator.get(), nullptr,
+        prefilterMapMipWidth, prefilterMapMipHeight, 1, kEnvironmentFormat, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
         &m_prefilterMap[i], resourceName.c_str(), D3D12_RESOURCE_STATE_RENDER_TARGET,
-        false, nullptr, nullptr, 0, 0,
-        true, &cbvSrvCpuHandle,
-        true, &prefilterMapStartRtvCpuHandle, m_rtvDescriptorSize);
-      cbvSrvCpuHandle.Offset(m_cbvSrvDescriptorSize);
-      cbvSrvGpuHandle.Offset(m_cbvSrvDescriptorSize);
-      prefilterMapStartRtvCpuHandle.Offset(kCubeMapArraySize, m_rtvDescriptorSize);
+        false, nullptr, 0, 0,
+        true, &prefilterMapSrvCpuHandle,
+        true, &prefilterMapStartRtvCpuHandle, rtvDescriptorSize);
     }
 
     // *** BRDF LUT ***
-    CD3DX12_CPU_DESCRIPTOR_HANDLE BRDFLutRtvCpuHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameCount + kCubeMapArraySize + kCubeMapArraySize + kCubeMapArraySize * kPrefilterMapMipLevels, m_rtvDescriptorSize);
-    util::Create2DTextureResource(pDevice, pCommandList,
+    m_BRDFLutSrv = m_stagingHeap->Allocate(1);
+    m_BRDFLutRtv = m_rtvHeap->Allocate(1);
+    const D3D12_CPU_DESCRIPTOR_HANDLE BRDFLutSrvCpuHandle = m_stagingHeap->GetCpuHandle(m_BRDFLutSrv);
+    const D3D12_CPU_DESCRIPTOR_HANDLE BRDFLutRtvCpuHandle = m_rtvHeap->GetCpuHandle(m_BRDFLutRtv);
+    util::Create2DTextureResource(pDevice, m_environmentAllocator.get(), nullptr,
       kBRDFLutWidth, kBRDFLutHeight, 1, DXGI_FORMAT_R16G16_FLOAT, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET,
       &m_BRDFLut, L"m_BRDFLut", D3D12_RESOURCE_STATE_RENDER_TARGET,
-      false, nullptr, nullptr, 0, 0,
-      true, &cbvSrvCpuHandle,
+      false, nullptr, 0, 0,
+      true, &BRDFLutSrvCpuHandle,
       true, &BRDFLutRtvCpuHandle);
-    cbvSrvCpuHandle.Offset(m_cbvSrvDescriptorSize);
-    cbvSrvGpuHandle.Offset(m_cbvSrvDescriptorSize);
   }
 
-  // Create the quad vertex buffer.
+  // Create the shadow maps.
   {
-    QuadModel quadModel;
-    std::unique_ptr<Model::Vertex[]> vertices = quadModel.GetVertexData();
-    size_t vertexDataSize = quadModel.GetVertexDataSize();
-    util::CreateVertexBufferResource(pDevice, pCommandList,
-      vertexDataSize, &m_vertexBufferQuad, L"m_vertexBufferQuad", &m_vertexBufferQuadUpload, vertices.get(),
-      m_vertexBufferViewQuad, static_cast<UINT>(Model::GetVertexStride()));
+    m_shadowMapSrvs = m_stagingHeap->Allocate(2);
+    m_shadowCache.CreateResources(pDevice, m_stagingHeap->GetCpuHandle(m_shadowMapSrvs), m_stagingHeap->GetDescriptorSize());
   }
 
-  // Create the sphere vertex, index, and instance buffer.
+  if (m_shaderFeatures.bindless) {
+    m_bindlessIndices.irradianceMap = CopyBindlessDescriptors(m_irradianceMapSrv, &m_bindlessDescriptors.irradianceMap);
+    m_bindlessIndices.prefilterMap = CopyBindlessDescriptors(m_prefilterMapSrvs, &m_bindlessDescriptors.prefilterMap);
+    m_bindlessIndices.BRDFLut = CopyBindlessDescriptors(m_BRDFLutSrv, &m_bindlessDescriptors.BRDFLut);
+    m_bindlessIndices.cubeMap = CopyBindlessDescriptors(m_cubeMapSrv, &m_bindlessDescriptors.cubeMap);
+    m_bindlessIndices.cascadeShadowMaps = CopyBindlessDescriptors(m_shadowMapSrvs, &m_bindlessDescriptors.shadowMaps);
+    m_bindlessIndices.pointShadowMaps = m_bindlessIndices.cascadeShadowMaps + 1;
+  }
+}
+
+void PBSScene::LoadAssets() {
+  CPU_PROFILE_SCOPE("PBSScene::LoadAssets");
+  // The meshes. The loader threads write the buffers and their views, which nothing reads before
+  // m_meshesLoaded is set.
   {
-    SphereModel sphereModel(64, 64);
+    struct Meshes {
+      AssetPack pack;
+      MeshBuffer buffers[kMeshBufferCount];  // in the pack, or in the arrays below
+      std::unique_ptr<Model::Vertex[]> cubeVertices;
+      std::unique_ptr<Model::Vertex[]> quadVertices;
+      std::unique_ptr<Model::Vertex[]> sphereVertices;
+      std::unique_ptr<uint32_t[]> sphereIndices;
+      std::unique_ptr<SphereInstance[]> sphereInstances;
+    };
+    auto meshes = std::make_shared<Meshes>();
+
+    // The instances are needed right away, by the light culling and the shadow cache.
+    meshes->sphereInstances = GetSphereInstanceData(kMaxSphereInstanceLayers, m_instanceCountSphere);
+    m_instanceCountSpherePerLayer = m_instanceCountSphere / kMaxSphereInstanceLayers;
+
+    // Bounds of each layer, the sphere model has a radius of 1.
+    m_sphereLayerBounds.resize(kMaxSphereInstanceLayers);
+    m_sphereLayerDirty.assign(kMaxSphereInstanceLayers, false);
+    for (UINT layer = 0; layer < kMaxSphereInstanceLayers; ++layer) {
+      LightReceiverBounds& bounds = m_sphereLayerBounds[layer];
+      bounds.min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+      bounds.max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+      for (UINT i = layer * m_instanceCountSpherePerLayer; i < (layer + 1) * m_instanceCountSpherePerLayer; ++i) {
+        const float* translation = meshes->sphereInstances[i].translation;
+        bounds.min = XMFLOAT3((std::min)(bounds.min.x, translation[0] - 1.0f), (std::min)(bounds.min.y, translation[1] - 1.0f), (std::min)(bounds.min.z, translation[2] - 1.0f));
+        bounds.max = XMFLOAT3((std::max)(bounds.max.x, translation[0] + 1.0f), (std::max)(bounds.max.y, translation[1] + 1.0f), (std::max)(bounds.max.z, translation[2] + 1.0f));
+      }
+    }
+    const size_t instanceDataSize = sizeof(SphereInstance) * m_instanceCountSphere;
+
+    const AssetPackPath meshesPackPath = m_pSample->GetAssetFullPath(L"meshes.pack");
+    m_meshesTicket = m_assetLoader->Load([meshes, meshesPackPath] {
+      if (meshes->pack.Open(meshesPackPath, kMeshesPackVersion) && ReadMeshBuffers(meshes->pack, meshes->buffers)) {
+        return;
+      }
+      meshes->pack.Close();
+
+      const UINT vertexStride = static_cast<UINT>(Model::GetVertexStride());
+      CubeModel cubeModel;
+      meshes->cubeVertices = cubeModel.GetVertexData();
+      meshes->buffers[kCubeVertices] = { meshes->cubeVertices.get(), cubeModel.GetVertexDataSize(), vertexStride };
+
+      QuadModel quadModel;
+      meshes->quadVertices = quadModel.GetVertexData();
+      meshes->buffers[kQuadVertices] = { meshes->quadVertices.get(), quadModel.GetVertexDataSize(), vertexStride };
+
+      SphereModel sphereModel(64, 64);
+      meshes->sphereVertices = sphereModel.GetVertexData();
+      meshes->buffers[kSphereVertices] = { meshes->sphereVertices.get(), sphereModel.GetVertexDataSize(), vertexStride };
+      meshes->sphereIndices = sphereModel.GetIndexData();
+      meshes->buffers[kSphereIndices] = { meshes->sphereIndices.get(), sphereModel.GetIndexDataSize(), sizeof(uint32_t) };
+
+      // Baked for the next start. A pack that can't be written only costs that start the generation.
+      AssetPackWriter writer(meshesPackPath, kMeshesPackVersion);
+      for (UINT i = 0; i < kMeshBufferCount; ++i) {
+        const MeshBuffer& buffer = meshes->buffers[i];
+        writer.AddBuffer(kMeshBufferNames[i], buffer.pData, buffer.size, buffer.elementSize);
+      }
+      writer.Finish();
+    }, [this, meshes, instanceDataSize](ID3D12Device* pDevice, StagingUploader* pUploader) {
+      // Copies straight from the pack's mapping into the staging ring.
+      const MeshBuffer* buffers = meshes->buffers;
+      util::CreateVertexBufferResource(pDevice, m_resourceAllocator.get(), pUploader,
+        buffers[kCubeVertices].size, &m_vertexBufferCube, L"m_vertexBufferCube", buffers[kCubeVertices].pData,
+        m_vertexBufferViewCube, buffers[kCubeVertices].elementSize);
+      util::CreateVertexBufferResource(pDevice, m_resourceAllocator.get(), pUploader,
+        buffers[kQuadVertices].size, &m_vertexBufferQuad, L"m_vertexBufferQuad", buffers[kQuadVertices].pData,
+        m_vertexBufferViewQuad, buffers[kQuadVertices].elementSize);
+      util::CreateVertexBufferResource(pDevice, m_resourceAllocator.get(), pUploader,
+        buffers[kSphereVertices].size, &m_vertexBufferSphere, L"m_vertexBufferSphere", buffers[kSphereVertices].pData,
+        m_vertexBufferViewSphere, buffers[kSphereVertices].elementSize);
+      util::CreateIndexBufferResource(pDevice, m_resourceAllocator.get(), pUploader,
+        buffers[kSphereIndices].size, &m_indexBufferSphere, L"m_indexBufferSphere", buffers[kSphereIndices].pData,
+        m_indexBufferViewSphere, DXGI_FORMAT_R32_UINT);
+      util::CreateVertexBufferResource(pDevice, m_resourceAllocator.get(), pUploader,
+        instanceDataSize, &m_instanceBufferSphere, L"m_instanceBufferSphere", meshes->sphereInstances.get(),
+        m_instanceBufferViewSphere, static_cast<UINT>(sizeof(SphereInstance)));
+    });
+  }
 
-    // *** vertex buffer ***
-    std::unique_ptr<Model::Vertex[]> vertices = sphereModel.GetVertexData();
-    size_t vertexDataSize = sphereModel.GetVertexDataSize();
-    util::CreateVertexBufferResource(pDevice, pCommandList,
-      vertexDataSize, &m_vertexBufferSphere, L"m_vertexBufferSphere", &m_vertexBufferSphereUpload, vertices.get(),
-      m_vertexBufferViewSphere, static_cast<UINT>(Model::GetVertexStride()));
+  // The environment map, baked into the IBL maps once it's loaded. Decoded from the HDR file on the
+  // first start only, the pack keeps it in the layout the copy queue reads.
+  {
+    struct Environment {
+      AssetPack pack;
+      ScratchImage image;  // when decoded from the HDR file
+      AssetPackTextureDesc desc{};
+      const void* pData = nullptr;
+      size_t rowPitch = 0;
+      size_t slicePitch = 0;
+    };
+    auto environment = std::make_shared<Environment>();
+    const std::wstring path = m_pSample->GetAssetFullPath(L"assets/Newport_Loft_Ref.hdr");
+    const AssetPackPath environmentPackPath = m_pSample->GetAssetFullPath(L"environment.pack");
+    const D3D12_CPU_DESCRIPTOR_HANDLE HDRTextureSrvCpuHandle = m_stagingHeap->GetCpuHandle(m_HDRTextureSrv);
+    m_environmentTicket = m_assetLoader->Load([environment, path, environmentPackPath] {
+      if (environment->pack.Open(environmentPackPath, kEnvironmentPackVersion)) {
+        const AssetPackEntry* pEntry = environment->pack.Find(kEnvironmentEntryName, AssetPackEntryType::kTexture);
+        if (pEntry != nullptr && pEntry->arraySize == 1 && pEntry->mipLevels == 1) {
+          const AssetPackSubresource& subresource = environment->pack.GetSubresources(*pEntry)[0];
+          environment->desc = { pEntry->format, pEntry->width, pEntry->height, 1, 1 };
+          environment->pData = environment->pack.GetData(*pEntry) + subresource.offset;
+          environment->rowPitch = subresource.rowPitch;
+          environment->slicePitch = static_cast<size_t>(pEntry->size - subresource.offset);
+          return;
+        }
+        environment->pack.Close();
+      }
 
-    // *** index buffer ***
-    std::unique_ptr<DWORD[]> indices = sphereModel.GetIndexData();
-    size_t indexDataSize = sphereModel.GetIndexDataSize();
-    util::CreateIndexBufferResource(pDevice, pCommandList,
-      indexDataSize, &m_indexBufferSphere, L"m_indexBufferSphere", &m_indexBufferSphereUpload, indices.get(),
-      m_indexBufferViewSphere, DXGI_FORMAT_R32_UINT);
+      ThrowIfFailed(DirectX::LoadFromHDRFile(path.c_str(), nullptr, environment->image));
+      const TexMetadata& metaData = environment->image.GetMetadata();
+      const Image* pImage = environment->image.GetImages();
+      environment->desc = { static_cast<uint32_t>(metaData.format), static_cast<uint32_t>(metaData.width), static_cast<uint32_t>(metaData.height), 1, 1 };
+      environment->pData = pImage->pixels;
+      environment->rowPitch = pImage->rowPitch;
+      environment->slicePitch = pImage->slicePitch;
+
+      // DirectXTex images are packed, so the pitch is the size of a row.
+      const AssetPackSourceSubresource source = { pImage->pixels, pImage->rowPitch, pImage->rowPitch, static_cast<uint32_t>(pImage->height) };
+      AssetPackWriter writer(environmentPackPath, kEnvironmentPackVersion);
+      writer.AddTexture(kEnvironmentEntryName, environment->desc, &source);
+      writer.Finish();
+    }, [this, environment, HDRTextureSrvCpuHandle](ID3D12Device* pDevice, StagingUploader* pUploader) {
+      const AssetPackTextureDesc& desc = environment->desc;
+      util::Create2DTextureResource(pDevice, m_resourceAllocator.get(), pUploader,
+        desc.width, desc.height, 1, static_cast<DXGI_FORMAT>(desc.format), D3D12_RESOURCE_FLAG_NONE,
+        &m_HDRTexture, L"m_HDRTexture", D3D12_RESOURCE_STATE_COPY_DEST,
+        true, environment->pData, environment->rowPitch, environment->slicePitch,
+        true, &HDRTextureSrvCpuHandle,
+        false, nullptr);
+    });
+  }
+}
+
+void PBSScene::WaitForAssets() {
+  while (m_assetLoader) {
+    PublishLoadedAssets();
+    if (m_assetLoader) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void PBSScene::PublishLoadedAssets() {
+  if (!m_meshesLoaded && m_assetLoader->IsLoaded(m_meshesTicket)) {
+    m_meshesLoaded = true;
+    m_meshesSet = m_residencyManager->AddSet(ResidencyManager::Category::kMeshes, { m_vertexBufferCube.Get(), m_vertexBufferQuad.Get(),
+      m_vertexBufferSphere.Get(), m_indexBufferSphere.Get(), m_instanceBufferSphere.Get() }, false);
+  }
+  if (!m_environmentLoaded && m_assetLoader->IsLoaded(m_environmentTicket)) {
+    m_environmentLoaded = true;
+  }
+  if (m_meshesLoaded && m_environmentLoaded && m_assetLoader) {
+    m_resourceAllocator->LogStatistics();
+    // Nothing else is loaded: its staging ring, copy queue and threads go.
+    m_assetLoader.reset();
+    char message[128];
+    sprintf_s(message, "released the asset loader's %.1f MB staging ring\n", kStagingRingSize / (1024.0 * 1024.0));
+    OutputDebugStringA(message);
+  }
+}
+
+void PBSScene::UpdateResidency(UINT64 completedFenceValue) {
+  UINT64 stagingSize = m_assetLoader ? kStagingRingSize : 0;
+  for (const std::unique_ptr<FrameResource>& frameResource : m_frameResources) {
+    stagingSize += frameResource->m_uploadArena.GetCapacity();
+  }
+  m_residencyManager->SetSize(m_stagingSet, stagingSize);
+
+  m_residencyManager->Update(completedFenceValue);
+  if (m_residencyManager->GetTelemetry().overBudget != m_overBudget) {
+    m_overBudget = m_residencyManager->GetTelemetry().overBudget;
+    m_residencyManager->LogTelemetry();
+  }
+}
+
+void PBSScene::ExportProfiles() {
+  std::ofstream csvFile(m_pSample->GetAssetFullPath(L"gpu_profile.csv"));
+  m_gpuProfiler->WriteCsv(csvFile);
+
+  // The CPU threads and the GPU queue on one timeline.
+  std::vector<TraceEvent> events;
+  std::vector<std::pair<uint32_t, std::string>> threadNames;
+  CpuProfiler::Get().GetTraceEvents(&events, &threadNames);
+  m_gpuProfiler->GetTraceEvents(&events, &threadNames);
+  std::ofstream traceFile(m_pSample->GetAssetFullPath(L"trace.json"));
+  WriteChromeTrace(traceFile, events, threadNames);
+
+  m_gpuProfiler->LogStatistics();
+}
+
+void PBSScene::ReleaseBakeResources(UINT64 fenceValue) {
+  // The equirectangular environment map is only sampled by the bake; the allocator keeps it until the
+  // frame's fence, and its memory is given back on the Reclaim in Update after that.
+  m_resourceAllocator->RetireResource(m_HDRTexture.Get(), fenceValue);
+  m_HDRTexture.Reset();
+  // The view was copied into the ring and the render targets were bound while recording, so the
+  // descriptors can go right away.
+  m_stagingHeap->Free(&m_HDRTextureSrv);
+  m_rtvHeap->Free(&m_cubeMapRtvs);
+  m_rtvHeap->Free(&m_irradianceMapRtvs);
+  m_rtvHeap->Free(&m_prefilterMapRtvs);
+  m_rtvHeap->Free(&m_BRDFLutRtv);
+}
+
+UINT PBSScene::CopyBindlessDescriptors(const DescriptorAllocation& source, DescriptorAllocation* pDestination) {
+  if (!pDestination->IsValid()) {
+    *pDestination = m_shaderVisibleHeap->Allocate(source.count);
+  }
+  m_shaderVisibleHeap->Copy(*m_stagingHeap, source, *pDestination);
+  return pDestination->offset;
+}
+
+void PBSScene::RecordInputEvent() {
+  if (m_firstUnlatchedInputTicks == 0) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_firstUnlatchedInputTicks = now.QuadPart;
+  }
+}
+
+void PBSScene::PollCameraKeys() {
+  // Key messages are only handled between frames, so read the keyboard directly to catch the ones
+  // that are still queued.
+  // Headless runs have no window, and ignore the keyboard.
+  if (Win32Application::GetHwnd() == nullptr || GetForegroundWindow() != Win32Application::GetHwnd()) {
+    return;
+  }
+
+  struct CameraKey {
+    int virtualKey;
+    bool* pPressed;
+  };
+  const CameraKey cameraKeys[] = {
+    { VK_LEFT, &m_keyboardInput.leftArrowPressed },
+    { VK_RIGHT, &m_keyboardInput.rightArrowPressed },
+    { VK_UP, &m_keyboardInput.upArrowPressed },
+    { VK_DOWN, &m_keyboardInput.downArrowPressed },
+    { 'W', &m_keyboardInput.wKeyPressed },
+    { 'S', &m_keyboardInput.sKeyPressed },
+    { 'A', &m_keyboardInput.aKeyPressed },
+    { 'D', &m_keyboardInput.dKeyPressed },
+  };
+  for (const CameraKey& cameraKey : cameraKeys) {
+    const bool pressed = (GetAsyncKeyState(cameraKey.virtualKey) & 0x8000) != 0;
+    if (pressed != *cameraKey.pPressed) {
+      *cameraKey.pPressed = pressed;
+      RecordInputEvent();
+    }
+  }
+}
+
+void PBSScene::LatchCamera() {
+  PollCameraKeys();
+
+  // Move by the time since the previous latch, so that latching twice per frame doesn't speed the camera up.
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  const float elapsedTime = m_lastCameraLatchTicks == 0 ? 0.0f :
+    static_cast<float>(static_cast<double>(now.QuadPart - m_lastCameraLatchTicks) / m_qpcFrequency.QuadPart);
+  m_lastCameraLatchTicks = now.QuadPart;
+
+  const float moveDistance = 5.0f * elapsedTime;
+  if (m_keyboardInput.wKeyPressed || m_keyboardInput.sKeyPressed || m_keyboardInput.aKeyPressed || m_keyboardInput.dKeyPressed) {
+    m_camera.Move(m_keyboardInput.wKeyPressed, m_keyboardInput.sKeyPressed, m_keyboardInput.aKeyPressed, m_keyboardInput.dKeyPressed, moveDistance);
+  }
+
+  const float angleChange = 2.0f * elapsedTime;
+  if (m_keyboardInput.leftArrowPressed)
+    m_camera.RotateAroundYAxis(-angleChange);
+  if (m_keyboardInput.rightArrowPressed)
+    m_camera.RotateAroundYAxis(angleChange);
+  if (m_keyboardInput.upArrowPressed)
+    m_camera.RotatePitch(-angleChange);
+  if (m_keyboardInput.downArrowPressed)
+    m_camera.RotatePitch(angleChange);
+}
 
-    // *** instance buffer ***
-    std::unique_ptr<SphereInstance[]> instances = GetSphereInstanceData(m_instanceCountSphere);
-    size_t instanceDataSize = sizeof(SphereInstance) * m_instanceCountSphere;
-    util::CreateVertexBufferResource(pDevice, pCommandList,
-      instanceDataSize, &m_instanceBufferSphere, L"m_instanceBufferSphere", &m_instanceBufferSphereUpload, instances.get(),
-      m_instanceBufferViewSphere, static_cast<UINT>(sizeof(SphereInstance)));
+bool PBSScene::ConsumeInputLatency(double* pSeconds) {
+  if (!m_hasInputLatency) {
+    return false;
   }
+  *pSeconds = m_lastInputLatency;
+  m_hasInputLatency = false;
+  return true;
+}
+
+void PBSScene::UpdateCameraConstants() {
+  m_camera.Get3DViewProjMatrices(&m_sceneConstantBuffer.view, &m_sceneConstantBuffer.projection, kCameraFov, m_viewport.Width, m_viewport.Height, kCameraNearZ, kCameraFarZ);
+  XMStoreFloat3(&m_sceneConstantBuffer.camPos, m_camera.mEye);
+
+  // The scene matrices are stored transposed for HLSL, undo that before inverting.
+  const XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&m_sceneConstantBuffer.view));
+  const XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&m_sceneConstantBuffer.projection));
+  m_tiledShadingConstantBuffer.view = m_sceneConstantBuffer.view;
+  XMStoreFloat4x4(&m_tiledShadingConstantBuffer.invProjection, XMMatrixTranspose(XMMatrixInverse(nullptr, projection)));
+  XMStoreFloat4x4(&m_tiledShadingConstantBuffer.invView, XMMatrixTranspose(XMMatrixInverse(nullptr, view)));
+  XMStoreFloat3(&m_tiledShadingConstantBuffer.camPos, m_camera.mEye);
 }
 
 void PBSScene::UpdateConstantBuffers() {
   const XMMATRIX identityMatrix = XMMatrixIdentity();
   XMStoreFloat4x4(&m_sceneConstantBuffer.model, identityMatrix);
 
-  m_camera.Get3DViewProjMatrices(&m_sceneConstantBuffer.view, &m_sceneConstantBuffer.projection, 60.0f, m_viewport.Width, m_viewport.Height, 0.1f, 100.0f);
-
-  XMStoreFloat4(&m_sceneConstantBuffer.camPos, m_camera.mEye);
+  UpdateCameraConstants();
+  const XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&m_sceneConstantBuffer.view));
+  const XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&m_sceneConstantBuffer.projection));
+  m_lightManager.CullLights(XMMatrixMultiply(view, projection), m_sphereLayerBounds.data(), m_instanceLayersSphere);
+
+  m_sceneConstantBuffer.numLights = m_lightManager.GetVisibleLightCount();
+  m_tiledShadingConstantBuffer.screenWidth = static_cast<UINT>(m_viewport.Width);
+  m_tiledShadingConstantBuffer.screenHeight = static_cast<UINT>(m_viewport.Height);
+  m_tiledShadingConstantBuffer.numLights = m_lightManager.GetVisibleLightCount();
+
+  // Shadow maps are only re-rendered for the casters and lights that changed.
+  for (UINT layer = 0; layer < kMaxSphereInstanceLayers; ++layer) {
+    if (m_sphereLayerDirty[layer]) {
+      m_shadowCache.MarkCastersDirty(m_sphereLayerBounds[layer]);
+      m_sphereLayerDirty[layer] = false;
+    }
+  }
+  m_shadowCache.SetDirectionalLight(XMFLOAT3(-0.4f, -1.0f, -0.6f), XMFLOAT3(2.0f, 2.0f, 2.0f));
+  for (UINT i = 0; i < ShadowCache::kMaxPointShadows; ++i) {
+    if (i < m_shadowedLights.size()) {
+      const LightState& light = m_lightManager.GetLight(m_shadowedLights[i]);
+      m_shadowCache.SetPointLight(i, light.position, light.radius);
+    } else {
+      m_shadowCache.ClearPointLight(i);
+    }
+  }
+  // Loading frames don't record the shadow pass, there is nothing to draw in it yet.
+  if (m_meshesLoaded) {
+    m_shadowCache.Update(m_camera, kCameraFov, m_viewport.Width / m_viewport.Height, kCameraNearZ);
+  }
+  m_shadowCache.FillConstantBuffer(m_shadowConstantBuffer);
 }
 
 void PBSScene::CommitConstantBuffers() {
-  memcpy(m_pCurrentFrameResource->m_pConstantBufferMVPWO, &m_sceneConstantBuffer, sizeof(m_sceneConstantBuffer));  
+  UploadArena& uploadArena = m_pCurrentFrameResource->m_uploadArena;
+  m_sceneConstants = uploadArena.AllocateConstants(m_sceneConstantBuffer);
+  m_tiledShadingConstants = uploadArena.AllocateConstants(m_tiledShadingConstantBuffer);
+  m_shadowConstants = uploadArena.AllocateConstants(m_shadowConstantBuffer);
+
+  // The current frame resource is no longer used by the GPU, so it can take the changed lights.
+  m_lightManager.Commit(m_frameIndex);
 }
 
-void PBSScene::ScenePass() {
-  m_commandList->SetGraphicsRootSignature(m_rootSignatureScenePass.Get());
-  m_commandList->SetPipelineState(m_pipelineStateScenePass.Get());
+void PBSScene::ShadowPass(ID3D12GraphicsCommandList* pCommandList) {
+  const std::vector<ShadowCache::ShadowView>& shadowViews = m_shadowCache.GetPendingViews();
 
-  // Set descriptor heaps.
-  ID3D12DescriptorHeap* ppHeaps[] = { m_cbvSrvHeap.Get() };
-  m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+  pCommandList->SetGraphicsRootSignature(m_rootSignatureShadow.Get());
+  pCommandList->SetPipelineState(m_pipelineStateShadow.Get());
+
+  pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+  D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[2] = { m_vertexBufferViewSphere , m_instanceBufferViewSphere };
+  pCommandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
+  pCommandList->IASetIndexBuffer(&m_indexBufferViewSphere);
+
+  UINT indexCount = m_indexBufferViewSphere.SizeInBytes / sizeof(uint32_t);
+  for (const ShadowCache::ShadowView& shadowView : shadowViews) {
+    CD3DX12_VIEWPORT viewport{ 0.f, 0.f, static_cast<float>(shadowView.resolution), static_cast<float>(shadowView.resolution) };
+    CD3DX12_RECT scissorRect{ 0, 0, static_cast<LONG>(shadowView.resolution), static_cast<LONG>(shadowView.resolution) };
+    pCommandList->RSSetViewports(1, &viewport);
+    pCommandList->RSSetScissorRects(1, &scissorRect);
+    pCommandList->OMSetRenderTargets(0, nullptr, FALSE, &shadowView.dsv);
+    pCommandList->ClearDepthStencilView(shadowView.dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+    pCommandList->SetGraphicsRoot32BitConstants(0, 16, &shadowView.viewProjection, 0);
+    pCommandList->DrawIndexedInstanced(indexCount, m_instanceCountSpherePerLayer * m_instanceLayersSphere, 0, 0, 0);
+  }
+}
 
-  m_commandList->SetGraphicsRootConstantBufferView(0, m_pCurrentFrameResource->m_constantBufferMVP->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootConstantBufferView(1, m_pCurrentFrameResource->m_constantBufferLightStates->GetGPUVirtualAddress());
-  CD3DX12_GPU_DESCRIPTOR_HANDLE irradianceMapGpuHandle(m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart(), 2, m_cbvSrvDescriptorSize);
-  m_commandList->SetGraphicsRootDescriptorTable(2, irradianceMapGpuHandle);
+void PBSScene::ScenePass(ID3D12GraphicsCommandList* pCommandList, UINT firstInstance, UINT instanceCount) {
+  if (m_shaderFeatures.bindless) {
+    SetBindlessRootArguments(pCommandList, false, m_sceneConstants.gpuAddress);
+  } else {
+    pCommandList->SetGraphicsRootSignature(m_rootSignatureScenePass.Get());
+
+    // Set descriptor heaps.
+    ID3D12DescriptorHeap* ppHeaps[] = { m_shaderVisibleHeap->GetHeap() };
+    pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+    pCommandList->SetGraphicsRootConstantBufferView(0, m_sceneConstants.gpuAddress);
+    pCommandList->SetGraphicsRootShaderResourceView(1, m_lightManager.GetGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetGraphicsRootShaderResourceView(2, m_lightManager.GetVisibleLightIndicesGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetGraphicsRootDescriptorTable(3, m_descriptorTables.imageBasedLighting);
+    pCommandList->SetGraphicsRootConstantBufferView(4, m_shadowConstants.gpuAddress);
+    pCommandList->SetGraphicsRootDescriptorTable(5, m_descriptorTables.shadowMaps);
+  }
+  pCommandList->SetPipelineState(m_shadingPipelineStates[m_shaderFeatures.GetIndex()].scenePass.Get());
 
-  m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+  pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
   D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[2] = { m_vertexBufferViewSphere , m_instanceBufferViewSphere };
-  m_commandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
-  m_commandList->IASetIndexBuffer(&m_indexBufferViewSphere);
-  m_commandList->RSSetViewports(1, &m_viewport);
-  m_commandList->RSSetScissorRects(1, &m_scissorRect);
+  pCommandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
+  pCommandList->IASetIndexBuffer(&m_indexBufferViewSphere);
+  pCommandList->RSSetViewports(1, &m_viewport);
+  pCommandList->RSSetScissorRects(1, &m_scissorRect);
   CD3DX12_CPU_DESCRIPTOR_HANDLE renderTargetCpuHandle(GetCurrentBackBufferRtvCpuHandle());
-  m_commandList->OMSetRenderTargets(1, &renderTargetCpuHandle, FALSE, &m_depthDsv);
+  pCommandList->OMSetRenderTargets(1, &renderTargetCpuHandle, FALSE, &m_depthDsv);
 
-  UINT indexCount = m_indexBufferViewSphere.SizeInBytes / sizeof(DWORD);
-  m_commandList->DrawIndexedInstanced(indexCount, m_instanceCountSphere, 0, 0, 0);
+  UINT indexCount = m_indexBufferViewSphere.SizeInBytes / sizeof(uint32_t);
+  pCommandList->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, firstInstance);
 }
 
-void PBSScene::SkyboxPass() {
-  m_commandList->SetGraphicsRootSignature(m_rootSignatureEquirectangularToCubemap.Get());
-  m_commandList->SetPipelineState(m_pipelineStateSkybox.Get());
+void PBSScene::GBufferPass(ID3D12GraphicsCommandList* pCommandList, UINT firstInstance, UINT instanceCount) {
+  if (m_shaderFeatures.bindless) {
+    SetBindlessRootArguments(pCommandList, false, m_sceneConstants.gpuAddress);
+  } else {
+    pCommandList->SetGraphicsRootSignature(m_rootSignatureScenePass.Get());
+    pCommandList->SetGraphicsRootConstantBufferView(0, m_sceneConstants.gpuAddress);
+  }
+  pCommandList->SetPipelineState(m_pipelineStateGBuffer.Get());
 
-  // Set descriptor heaps.
-  ID3D12DescriptorHeap* ppHeaps[] = { m_cbvSrvHeap.Get() };
-  m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+  pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+  D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[2] = { m_vertexBufferViewSphere , m_instanceBufferViewSphere };
+  pCommandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
+  pCommandList->IASetIndexBuffer(&m_indexBufferViewSphere);
+  pCommandList->RSSetViewports(1, &m_viewport);
+  pCommandList->RSSetScissorRects(1, &m_scissorRect);
+  // No need to clear the G-buffer: the tiled shading pass only reads pixels covered by geometry.
+  const D3D12_CPU_DESCRIPTOR_HANDLE gbufferRtvCpuHandle = m_rtvHeap->GetCpuHandle(m_gbufferRtvs);
+  pCommandList->OMSetRenderTargets(2, &gbufferRtvCpuHandle, TRUE, &m_depthDsv);
+
+  UINT indexCount = m_indexBufferViewSphere.SizeInBytes / sizeof(uint32_t);
+  pCommandList->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, firstInstance);
+}
 
-  m_commandList->SetGraphicsRootConstantBufferView(0, m_pCurrentFrameResource->m_constantBufferMVP->GetGPUVirtualAddress());
-  CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxGpuHandle(m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
-  skyboxGpuHandle.Offset(m_cbvSrvDescriptorSize);
-  m_commandList->SetGraphicsRootDescriptorTable(1, skyboxGpuHandle);
+void PBSScene::TiledShadingPass(ID3D12GraphicsCommandList* pCommandList) {
+  if (m_shaderFeatures.bindless) {
+    SetBindlessRootArguments(pCommandList, true, m_tiledShadingConstants.gpuAddress);
+  } else {
+    pCommandList->SetComputeRootSignature(m_rootSignatureTiledShading.Get());
+
+    // Set descriptor heaps.
+    ID3D12DescriptorHeap* ppHeaps[] = { m_shaderVisibleHeap->GetHeap() };
+    pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+    pCommandList->SetComputeRootConstantBufferView(0, m_tiledShadingConstants.gpuAddress);
+    pCommandList->SetComputeRootShaderResourceView(1, m_lightManager.GetGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetComputeRootShaderResourceView(2, m_lightManager.GetVisibleLightIndicesGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetComputeRootDescriptorTable(3, m_descriptorTables.tiledShadingInputs);
+    pCommandList->SetComputeRootDescriptorTable(4, m_descriptorTables.tiledShadingOutput);
+    pCommandList->SetComputeRootConstantBufferView(5, m_shadowConstants.gpuAddress);
+    pCommandList->SetComputeRootDescriptorTable(6, m_descriptorTables.shadowMaps);
+  }
+  pCommandList->SetPipelineState(m_shadingPipelineStates[m_shaderFeatures.GetIndex()].tiledShading.Get());
 
-  m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferViewCube);
-  m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-  m_commandList->RSSetViewports(1, &m_viewport);
-  m_commandList->RSSetScissorRects(1, &m_scissorRect);
+  const UINT width = static_cast<UINT>(m_viewport.Width);
+  const UINT height = static_cast<UINT>(m_viewport.Height);
+  pCommandList->Dispatch((width + kTiledShadingTileSize - 1) / kTiledShadingTileSize, (height + kTiledShadingTileSize - 1) / kTiledShadingTileSize, 1);
+}
+
+// The heap has to be set before a root signature that indexes it directly. Setting the signature again in the next
+// pass of the command list changes nothing, so the passes keep their bindings.
+void PBSScene::SetBindlessRootArguments(ID3D12GraphicsCommandList* pCommandList, bool compute, D3D12_GPU_VIRTUAL_ADDRESS constants) {
+  ID3D12DescriptorHeap* ppHeaps[] = { m_shaderVisibleHeap->GetHeap() };
+  pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+  const UINT bindlessIndicesCount = sizeof(BindlessIndices) / sizeof(UINT);
+  if (compute) {
+    pCommandList->SetComputeRootSignature(m_rootSignatureBindless.Get());
+    pCommandList->SetComputeRoot32BitConstants(0, bindlessIndicesCount, &m_bindlessIndices, 0);
+    pCommandList->SetComputeRootConstantBufferView(1, constants);
+    pCommandList->SetComputeRootShaderResourceView(2, m_lightManager.GetGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetComputeRootShaderResourceView(3, m_lightManager.GetVisibleLightIndicesGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetComputeRootConstantBufferView(4, m_shadowConstants.gpuAddress);
+  } else {
+    pCommandList->SetGraphicsRootSignature(m_rootSignatureBindless.Get());
+    pCommandList->SetGraphicsRoot32BitConstants(0, bindlessIndicesCount, &m_bindlessIndices, 0);
+    pCommandList->SetGraphicsRootConstantBufferView(1, constants);
+    pCommandList->SetGraphicsRootShaderResourceView(2, m_lightManager.GetGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetGraphicsRootShaderResourceView(3, m_lightManager.GetVisibleLightIndicesGPUVirtualAddress(m_frameIndex));
+    pCommandList->SetGraphicsRootConstantBufferView(4, m_shadowConstants.gpuAddress);
+  }
+}
+
+// Copies the shaded image to the back buffer, the skybox pass then draws behind the spheres as usual.
+void PBSScene::ResolvePass(ID3D12GraphicsCommandList* pCommandList) {
+  pCommandList->CopyResource(m_renderTargets[m_frameIndex].Get(), m_tiledShadingOutput.Get());
+}
+
+void PBSScene::SkyboxPass(ID3D12GraphicsCommandList* pCommandList) {
+  if (m_shaderFeatures.bindless) {
+    SetBindlessRootArguments(pCommandList, false, m_sceneConstants.gpuAddress);
+  } else {
+    pCommandList->SetGraphicsRootSignature(m_rootSignatureSkybox.Get());
+
+    // Set descriptor heaps.
+    ID3D12DescriptorHeap* ppHeaps[] = { m_shaderVisibleHeap->GetHeap() };
+    pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+    pCommandList->SetGraphicsRootConstantBufferView(0, m_sceneConstants.gpuAddress);
+    pCommandList->SetGraphicsRootDescriptorTable(1, m_descriptorTables.cubeMap);
+  }
+  pCommandList->SetPipelineState(m_pipelineStateSkybox.Get());
+
+  pCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferViewCube);
+  pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  pCommandList->RSSetViewports(1, &m_viewport);
+  pCommandList->RSSetScissorRects(1, &m_scissorRect);
   CD3DX12_CPU_DESCRIPTOR_HANDLE renderTargetCpuHandle(GetCurrentBackBufferRtvCpuHandle());
-  m_commandList->OMSetRenderTargets(1, &renderTargetCpuHandle, FALSE, &m_depthDsv);
+  pCommandList->OMSetRenderTargets(1, &renderTargetCpuHandle, FALSE, &m_depthDsv);
 
-  m_commandList->DrawInstanced(36, 1, 0, 0);
+  pCommandList->DrawInstanced(36, 1, 0, 0);
+}
+
+// Runs on a worker thread. Every worker draws a contiguous range of the sphere instances into its own
+// command list, so the lists have to set all of their state themselves.
+void PBSScene::RecordSceneChunk(UINT workerIndex) {
+  CPU_PROFILE_SCOPE("record scene chunk");
+  ID3D12CommandAllocator* pCommandAllocator = m_pCurrentFrameResource->m_workerCommandAllocators[workerIndex].Get();
+  ID3D12GraphicsCommandList* pCommandList = m_pCurrentFrameResource->m_workerCommandLists[workerIndex].Get();
+  ThrowIfFailed(pCommandAllocator->Reset());
+  ThrowIfFailed(pCommandList->Reset(pCommandAllocator, nullptr));
+
+  const UINT numWorkers = m_workerPool.GetThreadCount();
+  const UINT instanceCount = m_instanceCountSpherePerLayer * m_instanceLayersSphere;
+  const UINT firstInstance = instanceCount * workerIndex / numWorkers;
+  const UINT lastInstance = instanceCount * (workerIndex + 1) / numWorkers;
+  if (lastInstance > firstInstance) {
+    if (m_shadingMode == ShadingMode::kTiledDeferred) {
+      GBufferPass(pCommandList, firstInstance, lastInstance - firstInstance);
+    } else {
+      ScenePass(pCommandList, firstInstance, lastInstance - firstInstance);
+    }
+  }
+
+  ThrowIfFailed(pCommandList->Close());
+}
+
+void PBSScene::SetConfiguration(ShadingMode shadingMode, UINT numLights, UINT numInstanceLayers) {
+  m_shadingMode = shadingMode;
+  SetInstanceLayersSphere(numInstanceLayers);
+  if (numLights > 0) {
+    AddBenchmarkLights(numLights, m_lightManager);
+    m_shadowedLights.clear();
+  } else {
+    InitializeLights();
+  }
+}
+
+void PBSScene::SetCamera(FXMVECTOR eye, FXMVECTOR at) {
+  m_camera.Set(eye, at, XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
+}
+
+void PBSScene::ApplyBenchmarkConfiguration() {
+  if (m_shadingBenchmark.IsRunning()) {
+    const ShadingBenchmark::Configuration& configuration = m_shadingBenchmark.GetCurrentConfiguration();
+    SetConfiguration(configuration.mode, configuration.numLights, configuration.numInstanceLayers);
+  } else {
+    // Restore the regular scene.
+    SetConfiguration(ShadingMode::kForward, 0, 1);
+  }
+}
+
+void PBSScene::SetInstanceLayersSphere(UINT numLayers) {
+  // Layers that appear or disappear change the shadow casters.
+  for (UINT layer = (std::min)(numLayers, m_instanceLayersSphere); layer < (std::max)(numLayers, m_instanceLayersSphere); ++layer) {
+    m_sphereLayerDirty[layer] = true;
+  }
+  m_instanceLayersSphere = numLayers;
 }
 
 void PBSScene::BeginFrame() {
   m_pCurrentFrameResource->m_commandAllocator->Reset();
   // Reset the command list.
   ThrowIfFailed(m_commandList->Reset(m_pCurrentFrameResource->m_commandAllocator.Get(), nullptr));
-  // Transition back-buffer to a writable state for rendering.
-  D3D12_RESOURCE_BARRIER backBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-  m_commandList->ResourceBarrier(1, &backBufferBarrier);
-  const FLOAT clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-  m_commandList->ClearRenderTargetView(GetCurrentBackBufferRtvCpuHandle(), clearColor, 0, nullptr);
-  m_commandList->ClearDepthStencilView(m_depthDsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-}
-
-void PBSScene::EndFrame() {
-  // Transition back-buffer to a writable state for rendering.
-  D3D12_RESOURCE_BARRIER backBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-  m_commandList->ResourceBarrier(1, &backBufferBarrier);
+}
+
+void PBSScene::RenderLoadingFrame(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue) {
+  BeginFrame();
+  {
+    GpuProfileScope frameScope(m_gpuProfiler.get(), m_commandList.Get(), "loading frame");
+    ID3D12Resource* pBackBuffer = m_renderTargets[m_frameIndex].Get();
+    const D3D12_RESOURCE_BARRIER toRenderTarget = CD3DX12_RESOURCE_BARRIER::Transition(pBackBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_commandList->ResourceBarrier(1, &toRenderTarget);
+    m_commandList->ClearRenderTargetView(GetCurrentBackBufferRtvCpuHandle(), s_clearColor, 0, nullptr);
+    const D3D12_RESOURCE_BARRIER toPresent = CD3DX12_RESOURCE_BARRIER::Transition(pBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    m_commandList->ResourceBarrier(1, &toPresent);
+  }
+  m_gpuProfiler->EndFrame(m_commandList.Get());
+  ThrowIfFailed(m_commandList->Close());
+
+  ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+  pCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+  m_shaderVisibleHeap->EndFrame(fenceValue);
+}
+
+void PBSScene::ClearSceneTargets(ID3D12GraphicsCommandList* pCommandList) {
+  // The tiled deferred path overwrites the whole back buffer when it resolves.
+  if (m_shadingMode == ShadingMode::kForward) {
+    pCommandList->ClearRenderTargetView(GetCurrentBackBufferRtvCpuHandle(), s_clearColor, 0, nullptr);
+  }
+  pCommandList->ClearDepthStencilView(m_depthDsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+}
+
+void PBSScene::BuildFrameGraph(ShadingMode shadingMode, bool updateShadowMaps) {
+  m_frameGraph = RenderGraph();
+  m_frameGraphResources.clear();
+  m_frameGraphHandles = FrameGraphHandles();
+
+  auto importResource = [this](ID3D12Resource* pResource, const std::string& name,
+    D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState) {
+    m_frameGraphResources.push_back(pResource);
+    return m_frameGraph.ImportResource(name, initialState, finalState);
+  };
+  auto createTransientResource = [this](ID3D12Resource* pResource, const std::string& name,
+    const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo, UINT heapIndex, D3D12_RESOURCE_STATES restState) {
+    m_frameGraphResources.push_back(pResource);
+    return m_frameGraph.CreateTransientResource(name, allocationInfo.SizeInBytes, allocationInfo.Alignment, heapIndex, restState);
+  };
+
+  const D3D12_RESOURCE_STATES shadowMapState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+  const RenderGraph::ResourceHandle backBuffer = importResource(m_renderTargets[m_frameIndex].Get(), "back buffer",
+    D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+  const RenderGraph::ResourceHandle depth = importResource(m_depthTexture.Get(), "depth",
+    D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+  const RenderGraph::ResourceHandle cascadeShadowMaps = importResource(m_shadowCache.GetCascadeShadowMaps(), "cascade shadow maps",
+    shadowMapState, shadowMapState);
+  const RenderGraph::ResourceHandle pointShadowMaps = importResource(m_shadowCache.GetPointShadowMaps(), "point shadow maps",
+    shadowMapState, shadowMapState);
+
+  if (updateShadowMaps) {
+    m_frameGraphHandles.shadowPass = m_frameGraph.AddPass("shadow");
+    m_frameGraph.Write(m_frameGraphHandles.shadowPass, cascadeShadowMaps, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    m_frameGraph.Write(m_frameGraphHandles.shadowPass, pointShadowMaps, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+  }
+
+  if (shadingMode == ShadingMode::kTiledDeferred) {
+    m_frameGraphHandles.gbufferNormal = createTransientResource(m_gbufferNormal.Get(), "G-buffer normal",
+      m_gbufferNormalAllocationInfo, kRenderTargetHeap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_frameGraphHandles.gbufferMaterial = createTransientResource(m_gbufferMaterial.Get(), "G-buffer material",
+      m_gbufferMaterialAllocationInfo, kRenderTargetHeap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_frameGraphHandles.tiledShadingOutput = createTransientResource(m_tiledShadingOutput.Get(), "tiled shading output",
+      m_tiledShadingOutputAllocationInfo, kTextureHeap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    const RenderGraph::PassHandle gbufferPass = m_frameGraph.AddPass("G-buffer");
+    m_frameGraph.Write(gbufferPass, m_frameGraphHandles.gbufferNormal, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_frameGraph.Write(gbufferPass, m_frameGraphHandles.gbufferMaterial, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_frameGraph.Write(gbufferPass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    m_frameGraphHandles.scenePass = gbufferPass;
+
+    const RenderGraph::PassHandle tiledShadingPass = m_frameGraph.AddPass("tiled shading");
+    for (RenderGraph::ResourceHandle input : { m_frameGraphHandles.gbufferNormal, m_frameGraphHandles.gbufferMaterial, depth, cascadeShadowMaps, pointShadowMaps }) {
+      m_frameGraph.Read(tiledShadingPass, input, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+    m_frameGraph.Write(tiledShadingPass, m_frameGraphHandles.tiledShadingOutput, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_frameGraph.SetCommandList(tiledShadingPass, kPostCommandList);
+    m_frameGraphHandles.tiledShadingPass = tiledShadingPass;
+
+    const RenderGraph::PassHandle resolvePass = m_frameGraph.AddPass("resolve");
+    m_frameGraph.Read(resolvePass, m_frameGraphHandles.tiledShadingOutput, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    m_frameGraph.Write(resolvePass, backBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+    m_frameGraph.SetCommandList(resolvePass, kPostCommandList);
+    m_frameGraphHandles.resolvePass = resolvePass;
+  } else {
+    const RenderGraph::PassHandle scenePass = m_frameGraph.AddPass("scene");
+    m_frameGraph.Read(scenePass, cascadeShadowMaps, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    m_frameGraph.Read(scenePass, pointShadowMaps, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    m_frameGraph.Write(scenePass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_frameGraph.Write(scenePass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    m_frameGraphHandles.scenePass = scenePass;
+  }
+
+  m_frameGraphHandles.skyboxPass = m_frameGraph.AddPass("skybox");
+  m_frameGraph.SetCommandList(m_frameGraphHandles.skyboxPass, kPostCommandList);
+  m_frameGraph.Write(m_frameGraphHandles.skyboxPass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  m_frameGraph.Read(m_frameGraphHandles.skyboxPass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+  m_frameGraph.Write(m_frameGraphHandles.skyboxPass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+  m_frameGraph.Compile();
 }
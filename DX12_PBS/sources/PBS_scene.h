@@ -1,8 +1,22 @@
 #pragma once
 
+#include "asset_loader.h"
 #include "core/stdafx.h"
+#include "descriptor_heap.h"
+#include "gpu_profiler.h"
+#include "light_manager.h"
+#include "pipeline_library.h"
+#include "render_graph.h"
+#include "residency_manager.h"
+#include "resource_allocator.h"
 #include "sample_assets.h"
+#include "shader_cache.h"
+#include "shader_features.h"
+#include "shading_benchmark.h"
+#include "shadow_cache.h"
+#include "upload_arena.h"
 #include "util/Camera.h"
+#include "worker_pool.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -30,56 +44,112 @@ public:
 
   void SetFrameIndex(UINT frameIndex);
 
-  void Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pDirectCommandQueue, ID3D12GraphicsCommandList* pCommandList, UINT frameIndex);
+  // Starts loading the assets in the background, see IsLoading.
+  void Initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pDirectCommandQueue, UINT frameIndex);
   void LoadSizeDependentResources(ID3D12Device* pDevice, ComPtr<ID3D12Resource>* ppRenderTargets, UINT width, UINT height);
 
-  void Update(double elapsedTime);
+  // completedFenceValue: the GPU has finished every frame that signals a value up to it.
+  void Update(double elapsedTime, UINT64 completedFenceValue);
   void KeyDown(UINT8 key);
   void KeyUp(UINT8 key);
 
-  void Render(ID3D12CommandQueue* pCommandQueue);
+  // fenceValue: what the queue signals once the frame is done.
+  void Render(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue);
 
   void GPUWorkForInitialization(ID3D12CommandQueue* pCommandQueue);
 
+  // True until the environment map is loaded and baked. Frames are rendered meanwhile, with a
+  // uniform environment, or only cleared while the meshes aren't loaded either.
+  bool IsLoading() const {
+    return !m_environmentBaked;
+  }
+
+  // Blocks until the assets have arrived, so that the next frame bakes the environment and draws the whole scene.
+  void WaitForAssets();
+
+  // Recreates the pipeline states from the current shader sources. The GPU must be idle.
+  void ReloadShaders(ID3D12Device* pDevice);
+
+  bool IsBenchmarkRunning() const {
+    return m_shadingBenchmark.IsRunning();
+  }
+
+  // For the scenarios of the headless benchmark: numLights unshadowed lights, or the regular scene's
+  // shadowed ones if 0, and numInstanceLayers layers of spheres.
+  void SetConfiguration(ShadingMode shadingMode, UINT numLights, UINT numInstanceLayers);
+  // Places the camera, e.g. along the headless benchmark's path. Input moves it from there.
+  void SetCamera(FXMVECTOR eye, FXMVECTOR at);
+
+  GpuProfiler* GetGpuProfiler() const {
+    return m_gpuProfiler.get();
+  }
+
+  // Time from the first input event that the last submitted frame took into account to its
+  // submission. Returns false if no input arrived since the previous call.
+  bool ConsumeInputLatency(double* pSeconds);
+
 private:
   void InitializeCameraAndLights();
+  void InitializeLights();
 
+  // Renders the IBL maps from the loaded environment map, into m_commandList.
+  void BakeEnvironment();
   void EquirectangularToCubemap();
   void ConvolveIrradianceMap();
   void PrefilterEnvironmentMap();
   void PrecomputeBRDFLut();
+  // Retires what only the bake uses, once the frame with fenceValue is done with it.
+  void ReleaseBakeResources(UINT64 fenceValue);
 
   void CreateDescriptorHeaps(ID3D12Device* pDevice);
   void CreateRootSignatures(ID3D12Device* pDevice);
   void CreatePipelineStates(ID3D12Device* pDevice);
   void CreateFrameResources(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue);
   void CreateCommandLists(ID3D12Device* pDevice);
-  void CreateAssetResources(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList);
+  void CreateAssetResources(ID3D12Device* pDevice);
+  // Starts loading the meshes and the environment map with m_assetLoader.
+  void LoadAssets();
+  void PublishLoadedAssets();
+  // Accounts the staging memory, and keeps the rest within the budget with m_residencyManager.
+  void UpdateResidency(UINT64 completedFenceValue);
+  // Writes the GPU pass timings as CSV, and a Chrome trace of the CPU threads and the GPU, next to the assets.
+  void ExportProfiles();
 
+  void RecordInputEvent();
+  void PollCameraKeys();
+  // Moves the camera by the input since the previous latch.
+  void LatchCamera();
+  void UpdateCameraConstants();
   void UpdateConstantBuffers();
   void CommitConstantBuffers();
 
-  void ScenePass();
-  void SkyboxPass();
+  void ShadowPass(ID3D12GraphicsCommandList* pCommandList);
+  void ScenePass(ID3D12GraphicsCommandList* pCommandList, UINT firstInstance, UINT instanceCount);
+  void GBufferPass(ID3D12GraphicsCommandList* pCommandList, UINT firstInstance, UINT instanceCount);
+  void TiledShadingPass(ID3D12GraphicsCommandList* pCommandList);
+  void ResolvePass(ID3D12GraphicsCommandList* pCommandList);
+  void SkyboxPass(ID3D12GraphicsCommandList* pCommandList);
+  void RecordSceneChunk(UINT workerIndex);
 
-  void BeginFrame();
-  void EndFrame();
-
-  UINT GetNumRtvDescriptors() const {
-    // 1st kCubeMapArraySize: 6 faces of skybox cubemap
-    // 2nd kCubeMapArraySize: 6 faces of irradiance cubemap
-    // kCubeMapArraySize * kPrefilterMapMipLevels: 6 * kPrefilterMapMipLevels of prefilter map
-    // 1: BRDF LUT
-    return m_frameCount + kCubeMapArraySize + kCubeMapArraySize + kCubeMapArraySize * kPrefilterMapMipLevels + 1;
-  }
+  void ApplyBenchmarkConfiguration();
+  void SetInstanceLayersSphere(UINT numLayers);
 
-  UINT GetNumCbvSrvUavDescriptors() const {
-    // 1 hdr texture + 1 skybox cubemap + 1 irradiance map + kPrefilterMapMipLevels prefilter map + 1 BRDF LUT
-    return 1 + 1 + 1 + kPrefilterMapMipLevels + 1;
-  }
+  void BeginFrame();
+  // Only clears the back buffer, for the frames before the meshes are loaded.
+  void RenderLoadingFrame(ID3D12CommandQueue* pCommandQueue, UINT64 fenceValue);
+  void ClearSceneTargets(ID3D12GraphicsCommandList* pCommandList);
+  // Declares this frame's passes in m_frameGraph and compiles it.
+  void BuildFrameGraph(ShadingMode shadingMode, bool updateShadowMaps);
+  // Copies the views the frame's passes bind into m_descriptorTables.
+  void BuildDescriptorTables();
+  // Copies views into their persistent place in m_shaderVisibleHeap, and returns the heap index the
+  // BINDLESS shaders read them at.
+  UINT CopyBindlessDescriptors(const DescriptorAllocation& source, DescriptorAllocation* pDestination);
+  // Sets m_rootSignatureBindless and its arguments; constants are the scene or tiled shading constants.
+  void SetBindlessRootArguments(ID3D12GraphicsCommandList* pCommandList, bool compute, D3D12_GPU_VIRTUAL_ADDRESS constants);
 
   inline CD3DX12_CPU_DESCRIPTOR_HANDLE GetCurrentBackBufferRtvCpuHandle() const {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_rtvHeap->GetCpuHandle(m_backBufferRtvs, m_frameIndex));
   }
 
   static constexpr float s_clearColor[4] {0.0f, 0.0f, 0.0f, 1.0f};
@@ -90,9 +160,45 @@ private:
   static constexpr UINT kIrradianceMapHeight = 32;
   static constexpr UINT kPrefilterMapWidth = 128;
   static constexpr UINT kPrefilterMapHeight = 128;
-  static constexpr UINT kPrefilterMapMipLevels = 5;
+  static constexpr UINT kPrefilterMapMipLevels = shader_constants::kPrefilterMapMipLevels;
+  static constexpr DXGI_FORMAT kEnvironmentFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;  // what LoadFromHDRFile decodes to
+  static constexpr float kPlaceholderEnvironmentColor[4] {0.1f, 0.1f, 0.1f, 1.0f};  // until the environment map is baked
+  static constexpr float kPlaceholderBRDFLutValue[4] {1.0f, 0.0f, 0.0f, 0.0f};  // specular = F0
   static constexpr UINT kBRDFLutWidth = 512;
   static constexpr UINT kBRDFLutHeight = 512;
+  static constexpr DXGI_FORMAT kGBufferNormalFormat = DXGI_FORMAT_R16G16_SNORM;  // octahedral encoded
+  static constexpr DXGI_FORMAT kGBufferMaterialFormat = DXGI_FORMAT_R8G8B8A8_UNORM;  // metallic, roughness, ao
+  static constexpr UINT kTiledShadingTileSize = shader_constants::kTiledShadingTileSize;
+  static constexpr float kLightLuminanceThreshold = 0.05f;  // luminance at which a light's influence ends
+  static constexpr UINT kMaxSphereInstanceLayers = 16;
+  static constexpr UINT kLightStatesShaderRegister = 10;  // t10, the lights StructuredBuffer in pbr_common.hlsli
+  static constexpr UINT kVisibleLightIndicesShaderRegister = 11;  // t11, visibleLightIndices in pbr_common.hlsli
+  static constexpr UINT kShadowMapsShaderRegister = 12;  // t12, first shadow map in shadows.hlsli
+  static constexpr UINT kBindlessIndicesShaderRegister = 2;  // b2, BindlessIndices in bindless.hlsli
+  static constexpr UINT kShadowUpdateBudget = 8;  // shadow views (cascades or cube faces) rendered per frame at most
+  static constexpr UINT kRenderTargetHeap = 0;  // transient heaps of the frame graph
+  static constexpr UINT kTextureHeap = 1;
+  static constexpr UINT kNumTransientHeaps = 2;
+  static constexpr UINT kMainCommandList = 0;  // command lists the frame graph passes are recorded in
+  static constexpr UINT kPostCommandList = 1;
+  static constexpr UINT kMaxRecordingThreads = 8;  // worker threads recording the sphere draws
+  static constexpr UINT kAssetDecodeThreads = 2;
+  static constexpr UINT64 kStagingRingSize = 32 * 1024 * 1024;  // larger uploads are copied in parts
+  static constexpr UINT64 kResourceHeapSize = 64 * 1024 * 1024;  // resources above half of it stay committed
+  static constexpr UINT64 kEnvironmentHeapSize = 8 * 1024 * 1024;  // fits the IBL maps but the cube map
+  static constexpr UINT kResidencyBudgetQueryInterval = 30;  // frames
+  static constexpr UINT kMaxGpuProfilerScopes = 32;  // per frame
+  // Bump when the data baked into meshes.pack or environment.pack changes, so old packs are baked again.
+  static constexpr uint32_t kMeshesPackVersion = 1;
+  static constexpr uint32_t kEnvironmentPackVersion = 1;
+  static constexpr UINT kRtvHeapCapacity = 64;
+  static constexpr UINT kDsvHeapCapacity = 4;
+  static constexpr UINT kStagingHeapCapacity = 64;
+  static constexpr UINT kDescriptorRingCapacity = 256;  // tables of all the frames in flight
+  static constexpr UINT kBindlessDescriptorCapacity = 16;  // views the BINDLESS shaders index
+  static constexpr float kCameraFov = 60.0f;
+  static constexpr float kCameraNearZ = 0.1f;
+  static constexpr float kCameraFarZ = 100.0f;
 
   UINT m_frameCount = 0;
 
@@ -101,18 +207,74 @@ private:
   std::vector<std::unique_ptr<FrameResource>> m_frameResources;
   FrameResource* m_pCurrentFrameResource = nullptr;
   SceneConstantBuffer m_sceneConstantBuffer;
-  LightStatesConstantBuffer m_lights;
+  LightManager m_lightManager;
+  TiledShadingConstantBuffer m_tiledShadingConstantBuffer;
+  ShadowConstantBuffer m_shadowConstantBuffer;
+  // Where the constant buffers are in the current frame's upload arena.
+  UploadArena::Allocation m_sceneConstants;
+  UploadArena::Allocation m_tiledShadingConstants;
+  UploadArena::Allocation m_shadowConstants;
+  // The transposed view-projection of every cube face, used by all the IBL bake passes as root constants.
+  XMFLOAT4X4 m_cubeFaceViewProjections[kCubeMapArraySize];
 
   // Heap objects.
-  ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-  ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
-  ComPtr<ID3D12DescriptorHeap> m_cbvSrvHeap;
-  UINT m_rtvDescriptorSize = 0;
-  UINT m_cbvSrvDescriptorSize = 0;
+  std::unique_ptr<DescriptorHeap> m_rtvHeap;
+  std::unique_ptr<DescriptorHeap> m_dsvHeap;
+  std::unique_ptr<DescriptorHeap> m_stagingHeap;  // where the SRVs and UAVs are created
+  std::unique_ptr<DescriptorHeap> m_shaderVisibleHeap;  // tables copied from m_stagingHeap, and the bindless views
+
+  // Descriptors.
+  DescriptorAllocation m_backBufferRtvs;
+  DescriptorAllocation m_cubeMapRtvs;  // one per face
+  DescriptorAllocation m_irradianceMapRtvs;  // one per face
+  DescriptorAllocation m_prefilterMapRtvs;  // one per face of each mip
+  DescriptorAllocation m_BRDFLutRtv;
+  DescriptorAllocation m_gbufferRtvs;  // normal and material
+  DescriptorAllocation m_depthDsvAllocation;
+  DescriptorAllocation m_HDRTextureSrv;  // freed after the bake, like the RTVs of the IBL maps
+  DescriptorAllocation m_cubeMapSrv;
+  DescriptorAllocation m_irradianceMapSrv;
+  DescriptorAllocation m_prefilterMapSrvs;  // one per mip
+  DescriptorAllocation m_BRDFLutSrv;
+  DescriptorAllocation m_gbufferSrvs;  // normal, material and depth
+  DescriptorAllocation m_tiledShadingOutputUav;
+  DescriptorAllocation m_shadowMapSrvs;  // cascaded and point shadow maps
+
+  // Tables in the ring of m_shaderVisibleHeap, rebuilt every frame.
+  struct DescriptorTables {
+    D3D12_GPU_DESCRIPTOR_HANDLE HDRTexture{};  // only for the bake
+    D3D12_GPU_DESCRIPTOR_HANDLE cubeMap{};
+    D3D12_GPU_DESCRIPTOR_HANDLE imageBasedLighting{};  // irradiance map, prefilter map mips and BRDF LUT
+    D3D12_GPU_DESCRIPTOR_HANDLE tiledShadingInputs{};  // the same, followed by the G-buffer
+    D3D12_GPU_DESCRIPTOR_HANDLE tiledShadingOutput{};
+    D3D12_GPU_DESCRIPTOR_HANDLE shadowMaps{};
+  };
+  DescriptorTables m_descriptorTables;
+
+  // Persistent copies of the views in m_shaderVisibleHeap, in bindless mode only.
+  struct BindlessDescriptors {
+    DescriptorAllocation irradianceMap;
+    DescriptorAllocation prefilterMap;
+    DescriptorAllocation BRDFLut;
+    DescriptorAllocation cubeMap;
+    DescriptorAllocation shadowMaps;
+    DescriptorAllocation gbuffer;
+    DescriptorAllocation tiledShadingOutput;
+  };
+  BindlessDescriptors m_bindlessDescriptors;
+  BindlessIndices m_bindlessIndices;
+
+  // Declared before the pipeline states loaded from it, so it outlives them.
+  std::unique_ptr<PipelineLibrary> m_pipelineLibrary;
+  // Likewise for the resources placed in its heaps: the IBL maps, the environment map and the meshes.
+  std::unique_ptr<ResourceAllocator> m_resourceAllocator;
+  // The IBL maps, apart from the rest so that their heaps can be evicted together.
+  std::unique_ptr<ResourceAllocator> m_environmentAllocator;
 
   // D3D objects.
   ComPtr<ID3D12RootSignature> m_rootSignatureEquirectangularToCubemap;
   ComPtr<ID3D12PipelineState> m_pipelineStateEquirectangularToCubemap;
+  ComPtr<ID3D12RootSignature> m_rootSignatureSkybox;
   ComPtr<ID3D12PipelineState> m_pipelineStateSkybox;
   ComPtr<ID3D12PipelineState> m_pipelineStateIrradianceConvolution;
   ComPtr<ID3D12RootSignature> m_rootSignaturePrefilter;
@@ -120,38 +282,105 @@ private:
   ComPtr<ID3D12RootSignature> m_rootSignatureBRDFLut;
   ComPtr<ID3D12PipelineState> m_pipelineStateBRDFLut;
   ComPtr<ID3D12RootSignature> m_rootSignatureScenePass;
-  ComPtr<ID3D12PipelineState> m_pipelineStateScenePass;
+  ComPtr<ID3D12PipelineState> m_pipelineStateGBuffer;
+  ComPtr<ID3D12RootSignature> m_rootSignatureTiledShading;
+  // The pipelines running the shaders that have variants, indexed by ShaderFeatureKey::GetIndex. Only the
+  // variants of the current bindless mode are created.
+  struct ShadingPipelineStates {
+    ComPtr<ID3D12PipelineState> scenePass;
+    ComPtr<ID3D12PipelineState> tiledShading;
+  };
+  ShadingPipelineStates m_shadingPipelineStates[ShaderFeatureKey::kCount];
+  ComPtr<ID3D12RootSignature> m_rootSignatureShadow;
+  ComPtr<ID3D12RootSignature> m_rootSignatureBindless;  // shared by the shading passes in bindless mode
+  ComPtr<ID3D12PipelineState> m_pipelineStateShadow;
   ComPtr<ID3D12Resource> m_vertexBufferCube;
-  ComPtr<ID3D12Resource> m_vertexBufferCubeUpload;
   D3D12_VERTEX_BUFFER_VIEW m_vertexBufferViewCube{};
-  ComPtr<ID3D12Resource> m_HDRTexture;
-  ComPtr<ID3D12Resource> m_HDRTextureUpload;
+  ComPtr<ID3D12Resource> m_HDRTexture;  // retired after the bake
   ComPtr<ID3D12Resource> m_cubeMap;
   ComPtr<ID3D12Resource> m_irradianceMap;
   std::vector<ComPtr<ID3D12Resource>> m_prefilterMap;  // mipmap
   ComPtr<ID3D12Resource> m_BRDFLut;
   ComPtr<ID3D12Resource> m_vertexBufferQuad;
-  ComPtr<ID3D12Resource> m_vertexBufferQuadUpload;
   D3D12_VERTEX_BUFFER_VIEW m_vertexBufferViewQuad{};
   ComPtr<ID3D12Resource> m_vertexBufferSphere;
-  ComPtr<ID3D12Resource> m_vertexBufferSphereUpload;
   D3D12_VERTEX_BUFFER_VIEW m_vertexBufferViewSphere{};
   ComPtr<ID3D12Resource> m_indexBufferSphere;
-  ComPtr<ID3D12Resource> m_indexBufferSphereUpload;
   D3D12_INDEX_BUFFER_VIEW m_indexBufferViewSphere{};
   ComPtr<ID3D12Resource> m_instanceBufferSphere;
-  ComPtr<ID3D12Resource> m_instanceBufferSphereUpload;
   D3D12_VERTEX_BUFFER_VIEW m_instanceBufferViewSphere;
   std::vector<ComPtr<ID3D12Resource>> m_renderTargets;
   ComPtr<ID3D12Resource> m_depthTexture;
   D3D12_CPU_DESCRIPTOR_HANDLE m_depthDsv;
-  ComPtr<ID3D12GraphicsCommandList> m_commandList;
+  ComPtr<ID3D12Resource> m_gbufferNormal;
+  ComPtr<ID3D12Resource> m_gbufferMaterial;
+  ComPtr<ID3D12Resource> m_tiledShadingOutput;
+  D3D12_RESOURCE_ALLOCATION_INFO m_gbufferNormalAllocationInfo{};
+  D3D12_RESOURCE_ALLOCATION_INFO m_gbufferMaterialAllocationInfo{};
+  D3D12_RESOURCE_ALLOCATION_INFO m_tiledShadingOutputAllocationInfo{};
+  ComPtr<ID3D12Heap> m_transientHeaps[kNumTransientHeaps];
+  ComPtr<ID3D12GraphicsCommandList> m_commandList;  // initialization work, and the passes before the sphere draws
+  ComPtr<ID3D12GraphicsCommandList> m_postCommandList;  // the passes after the sphere draws
 
   CD3DX12_VIEWPORT m_viewport{};
   CD3DX12_RECT m_scissorRect{};
 
   DXSample* m_pSample = nullptr;
+  ShaderCache m_shaderCache;
   Camera m_camera;
-  InputState m_keyboardInput;
-  UINT m_instanceCountSphere = 0;
+  InputState m_keyboardInput{};
+  LARGE_INTEGER m_qpcFrequency{};
+  LONGLONG m_lastCameraLatchTicks = 0;
+  LONGLONG m_firstUnlatchedInputTicks = 0;  // 0 when every input event has been latched
+  double m_lastInputLatency = 0.0;
+  bool m_hasInputLatency = false;
+  UINT m_instanceCountSphere = 0;  // instances of all kMaxSphereInstanceLayers layers
+  UINT m_instanceCountSpherePerLayer = 0;
+  UINT m_instanceLayersSphere = 1;  // layers actually drawn
+  std::vector<LightReceiverBounds> m_sphereLayerBounds;  // lights are culled against the drawn layers
+  std::vector<bool> m_sphereLayerDirty;  // layers whose instances changed since the shadow maps were updated
+
+  ShadowCache m_shadowCache;
+  std::vector<LightManager::LightId> m_shadowedLights;  // indexed by LightState::shadowIndex
+
+  ShadingMode m_shadingMode = ShadingMode::kForward;
+  ShaderFeatureKey m_shaderFeatures;
+  ShadingBenchmark m_shadingBenchmark;
+
+  WorkerPool m_workerPool;
+
+  std::unique_ptr<GpuProfiler> m_gpuProfiler;
+
+  // The environment set is evicted when over budget and unused; the others are only accounted.
+  std::unique_ptr<ResidencyManager> m_residencyManager;
+  ResidencyManager::SetId m_environmentSet = ResidencyTracker::kInvalidSet;
+  ResidencyManager::SetId m_meshesSet = ResidencyTracker::kInvalidSet;
+  ResidencyManager::SetId m_shadowMapsSet = ResidencyTracker::kInvalidSet;
+  ResidencyManager::SetId m_sizeDependentSet = ResidencyTracker::kInvalidSet;  // back buffers, depth and transient heaps
+  ResidencyManager::SetId m_stagingSet = ResidencyTracker::kInvalidSet;
+  bool m_overBudget = false;
+
+  // Declared after the resources its threads create, so it is destroyed, and they are stopped, first.
+  // Null once every asset is loaded.
+  std::unique_ptr<AssetLoader> m_assetLoader;
+  AssetLoader::Ticket m_meshesTicket = 0;
+  AssetLoader::Ticket m_environmentTicket = 0;
+  bool m_meshesLoaded = false;
+  bool m_environmentLoaded = false;
+  bool m_sceneRendered = false;  // a frame has rendered the scene, not just the loading screen
+  bool m_environmentBaked = false;
+
+  struct FrameGraphHandles {
+    RenderGraph::PassHandle shadowPass = RenderGraph::kInvalidHandle;
+    RenderGraph::PassHandle scenePass = RenderGraph::kInvalidHandle;  // forward or G-buffer, drawn by the workers
+    RenderGraph::PassHandle tiledShadingPass = RenderGraph::kInvalidHandle;
+    RenderGraph::PassHandle resolvePass = RenderGraph::kInvalidHandle;
+    RenderGraph::PassHandle skyboxPass = RenderGraph::kInvalidHandle;
+    RenderGraph::ResourceHandle gbufferNormal = RenderGraph::kInvalidHandle;
+    RenderGraph::ResourceHandle gbufferMaterial = RenderGraph::kInvalidHandle;
+    RenderGraph::ResourceHandle tiledShadingOutput = RenderGraph::kInvalidHandle;
+  };
+  RenderGraph m_frameGraph;
+  std::vector<ID3D12Resource*> m_frameGraphResources;  // indexed by RenderGraph::ResourceHandle
+  FrameGraphHandles m_frameGraphHandles;
 };
\ No newline at end of file
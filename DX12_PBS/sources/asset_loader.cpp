@@ -0,0 +1,196 @@
+#include "asset_loader.h"
+
+#include "core/DXSampleHelper.h"
+#include "cpu_profiler.h"
+
+AssetLoader::AssetLoader(ID3D12Device* pDevice, UINT numDecodeThreads, UINT64 stagingRingSize) :
+  m_device(pDevice),
+  m_stagingRing(pDevice, stagingRingSize) {
+  D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+  queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+  ThrowIfFailed(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue)));
+  NAME_D3D12_OBJECT(m_copyQueue);
+
+  ThrowIfFailed(pDevice->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+  NAME_D3D12_OBJECT(m_fence);
+  m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  if (m_fenceEvent == nullptr) {
+    ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+  }
+
+  for (UINT i = 0; i < kBatchCount; ++i) {
+    Batch& batch = m_batches[i];
+    ThrowIfFailed(pDevice->CreateCommandAllocator(queueDesc.Type, IID_PPV_ARGS(&batch.commandAllocator)));
+    SetNameIndexed(batch.commandAllocator.Get(), L"AssetLoader::m_batches.commandAllocator", i);
+    ThrowIfFailed(pDevice->CreateCommandList(0, queueDesc.Type, batch.commandAllocator.Get(), nullptr, IID_PPV_ARGS(&batch.commandList)));
+    ThrowIfFailed(batch.commandList->Close());
+    SetNameIndexed(batch.commandList.Get(), L"AssetLoader::m_batches.commandList", i);
+  }
+
+  m_decodeThreads.reserve(numDecodeThreads);
+  for (UINT i = 0; i < numDecodeThreads; ++i) {
+    m_decodeThreads.emplace_back(&AssetLoader::DecodeMain, this);
+  }
+  m_submitThread = std::thread(&AssetLoader::SubmitMain, this);
+}
+
+AssetLoader::~AssetLoader() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_decodeAvailable.notify_all();
+  m_recordAvailable.notify_all();
+  for (std::thread& thread : m_decodeThreads) {
+    thread.join();
+  }
+  m_submitThread.join();
+
+  // The batches still read from the staging ring.
+  WaitForFence(m_fenceValue);
+  CloseHandle(m_fenceEvent);
+}
+
+AssetLoader::Ticket AssetLoader::Load(DecodeFunction decode, RecordFunction record) {
+  Ticket ticket = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ticket = static_cast<Ticket>(m_tickets.size());
+    m_tickets.emplace_back();
+    Job job;
+    job.ticket = ticket;
+    job.decode = std::move(decode);
+    job.record = std::move(record);
+    m_decodeQueue.push_back(std::move(job));
+  }
+  m_decodeAvailable.notify_one();
+  return ticket;
+}
+
+bool AssetLoader::IsLoaded(Ticket ticket) {
+  UINT64 fenceValue = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const TicketState& state = m_tickets[ticket];
+    if (state.exception) {
+      std::rethrow_exception(state.exception);
+    }
+    fenceValue = state.fenceValue;
+  }
+  return fenceValue != 0 && m_fence->GetCompletedValue() >= fenceValue;
+}
+
+void AssetLoader::DecodeMain() {
+  CpuProfiler::Get().SetThreadName("asset decode");
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_decodeAvailable.wait(lock, [this] { return m_exit || !m_decodeQueue.empty(); });
+      if (m_exit) {
+        return;
+      }
+      job = std::move(m_decodeQueue.front());
+      m_decodeQueue.pop_front();
+    }
+
+    std::exception_ptr exception;
+    try {
+      if (job.decode) {
+        CPU_PROFILE_SCOPE("decode asset");
+        job.decode();
+      }
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (exception) {
+        m_tickets[job.ticket].exception = exception;
+        continue;
+      }
+      m_recordQueue.push_back(std::move(job));
+    }
+    m_recordAvailable.notify_one();
+  }
+}
+
+void AssetLoader::SubmitMain() {
+  CpuProfiler::Get().SetThreadName("asset submit");
+  for (;;) {
+    // Everything decoded since the previous batch goes into the next one.
+    std::vector<Job> jobs;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_recordAvailable.wait(lock, [this] { return m_exit || !m_recordQueue.empty(); });
+      if (m_exit) {
+        return;
+      }
+      jobs.swap(m_recordQueue);
+    }
+
+    std::vector<std::exception_ptr> exceptions(jobs.size());
+    UINT64 fenceValue = 0;
+    try {
+      fenceValue = SubmitBatch(jobs, &exceptions);
+    } catch (...) {
+      exceptions.assign(jobs.size(), std::current_exception());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      TicketState& state = m_tickets[jobs[i].ticket];
+      state.fenceValue = fenceValue;
+      state.exception = exceptions[i];
+    }
+  }
+}
+
+UINT64 AssetLoader::SubmitBatch(std::vector<Job>& jobs, std::vector<std::exception_ptr>* pExceptions) {
+  CPU_PROFILE_SCOPE("submit asset batch");
+  // The batch submitted kBatchCount batches ago has to be done before its allocator is reused.
+  Batch& batch = m_batches[m_nextBatch];
+  m_nextBatch = (m_nextBatch + 1) % kBatchCount;
+  WaitForFence(batch.fenceValue);
+  m_stagingRing.Reclaim(m_fence->GetCompletedValue());
+  ThrowIfFailed(batch.commandAllocator->Reset());
+  ThrowIfFailed(batch.commandList->Reset(batch.commandAllocator.Get(), nullptr));
+
+  // When the ring runs full, what is recorded so far is executed, and the batch goes on once the
+  // copy queue is done with the whole ring.
+  StagingUploader uploader(m_device.Get(), &m_stagingRing, batch.commandList.Get(), [&] {
+    ExecuteBatch(batch);
+    WaitForFence(batch.fenceValue);
+    m_stagingRing.Reclaim(batch.fenceValue);
+    ThrowIfFailed(batch.commandAllocator->Reset());
+    ThrowIfFailed(batch.commandList->Reset(batch.commandAllocator.Get(), nullptr));
+  });
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    try {
+      jobs[i].record(m_device.Get(), &uploader);
+    } catch (...) {
+      (*pExceptions)[i] = std::current_exception();
+    }
+  }
+
+  ExecuteBatch(batch);
+  return batch.fenceValue;
+}
+
+void AssetLoader::ExecuteBatch(Batch& batch) {
+  ThrowIfFailed(batch.commandList->Close());
+  ID3D12CommandList* ppCommandLists[] = { batch.commandList.Get() };
+  m_copyQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+  ThrowIfFailed(m_copyQueue->Signal(m_fence.Get(), m_fenceValue + 1));
+  batch.fenceValue = ++m_fenceValue;
+  m_stagingRing.EndBatch(batch.fenceValue);
+}
+
+void AssetLoader::WaitForFence(UINT64 fenceValue) {
+  if (m_fence->GetCompletedValue() < fenceValue) {
+    CPU_PROFILE_SCOPE("wait for copy queue");
+    ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+    WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+  }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "staging_ring.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Loads assets in the background, so the sample can render while they load.
+// An asset is decoded on one of a pool of threads, e.g. read from disk and decompressed, and then
+// records its uploads for a copy queue. The uploads of every asset decoded meanwhile are batched into
+// one command list, and a fence tells when a batch is done. All the data is staged in one StagingRing,
+// whose space a batch gives back once it's done. The resources of an asset may only be used
+// once IsLoaded returns true for it; they are in the COMMON state then, since resources used by a copy
+// queue decay to it.
+class AssetLoader {
+public:
+  using Ticket = UINT;
+  // Runs on a decode thread.
+  using DecodeFunction = std::function<void()>;
+  // Creates the resources of the asset and records their uploads. Runs on the thread that submits the
+  // batches, so never concurrently with another one.
+  using RecordFunction = std::function<void(ID3D12Device*, StagingUploader*)>;
+
+  AssetLoader(ID3D12Device* pDevice, UINT numDecodeThreads, UINT64 stagingRingSize);
+  // Drops the assets that haven't been submitted yet, and waits for the copy queue.
+  ~AssetLoader();
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+  Ticket Load(DecodeFunction decode, RecordFunction record);
+  // Doesn't block. Rethrows the exception the asset's functions threw, if any.
+  bool IsLoaded(Ticket ticket);
+
+private:
+  static constexpr UINT kBatchCount = 2;  // batches in flight on the copy queue
+
+  struct Job {
+    Ticket ticket = 0;
+    DecodeFunction decode;
+    RecordFunction record;
+  };
+
+  struct Batch {
+    ComPtr<ID3D12CommandAllocator> commandAllocator;
+    ComPtr<ID3D12GraphicsCommandList> commandList;
+    UINT64 fenceValue = 0;  // signaled once the batch is done
+  };
+
+  struct TicketState {
+    UINT64 fenceValue = 0;  // 0 until the asset's batch is submitted
+    std::exception_ptr exception;
+  };
+
+  void DecodeMain();
+  void SubmitMain();
+  // Records the jobs into the next batch and submits it. A job that throws gets the exception in
+  // pExceptions, at its index.
+  UINT64 SubmitBatch(std::vector<Job>& jobs, std::vector<std::exception_ptr>* pExceptions);
+  // Closes the batch's command list and executes it.
+  void ExecuteBatch(Batch& batch);
+  void WaitForFence(UINT64 fenceValue);
+
+  ComPtr<ID3D12Device> m_device;
+  // Performance tip: Copy command queues are optimized for transfer over PCIe.
+  ComPtr<ID3D12CommandQueue> m_copyQueue;
+  ComPtr<ID3D12Fence> m_fence;
+  HANDLE m_fenceEvent = nullptr;
+
+  // Only used by the submit thread.
+  StagingRing m_stagingRing;
+  Batch m_batches[kBatchCount];  // reused round robin
+  UINT m_nextBatch = 0;
+  UINT64 m_fenceValue = 0;  // last one signaled
+
+  std::mutex m_mutex;  // guards the members below
+  std::condition_variable m_decodeAvailable;
+  std::condition_variable m_recordAvailable;
+  std::deque<Job> m_decodeQueue;
+  std::vector<Job> m_recordQueue;  // decoded, waiting for the next batch
+  std::vector<TicketState> m_tickets;
+  bool m_exit = false;
+
+  std::vector<std::thread> m_decodeThreads;
+  std::thread m_submitThread;
+};
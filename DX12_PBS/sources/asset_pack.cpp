@@ -0,0 +1,263 @@
+#include "asset_pack.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The file layout is the in-memory layout of these.
+static_assert(sizeof(AssetPackHeader) == 24, "AssetPackHeader layout changed");
+static_assert(sizeof(AssetPackEntry) == 80, "AssetPackEntry layout changed");
+static_assert(sizeof(AssetPackSubresource) == 24, "AssetPackSubresource layout changed");
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+const char kPadding[kAssetPackBlobAlignment] = {};
+
+}  // namespace
+
+AssetPackWriter::AssetPackWriter(const AssetPackPath& path, uint32_t contentVersion) :
+  m_file(path, std::ios::binary | std::ios::trunc) {
+  memcpy(m_header.magic, kAssetPackMagic, sizeof(kAssetPackMagic));
+  m_header.formatVersion = kAssetPackFormatVersion;
+  m_header.contentVersion = contentVersion;
+  // Left zero until Finish, so a pack that isn't finished doesn't open.
+  const AssetPackHeader emptyHeader{};
+  m_file.write(reinterpret_cast<const char*>(&emptyHeader), sizeof(emptyHeader));
+  m_offset = sizeof(m_header);
+}
+
+bool AssetPackWriter::AddBuffer(const char* name, const void* pData, uint64_t size, uint32_t elementSize) {
+  AssetPackEntry entry{};
+  if (!BeginEntry(name, AssetPackEntryType::kBuffer, &entry)) {
+    return false;
+  }
+  entry.elementSize = elementSize;
+  entry.size = size;
+  m_file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+  m_offset += size;
+  m_entries.push_back(entry);
+  return static_cast<bool>(m_file);
+}
+
+bool AssetPackWriter::AddTexture(const char* name, const AssetPackTextureDesc& desc, const AssetPackSourceSubresource* pSubresources) {
+  AssetPackEntry entry{};
+  if (!BeginEntry(name, AssetPackEntryType::kTexture, &entry)) {
+    return false;
+  }
+  entry.format = desc.format;
+  entry.width = desc.width;
+  entry.height = desc.height;
+  entry.arraySize = desc.arraySize;
+  entry.mipLevels = desc.mipLevels;
+  entry.firstSubresource = static_cast<uint32_t>(m_subresources.size());
+
+  const uint32_t subresourceCount = static_cast<uint32_t>(desc.arraySize) * desc.mipLevels;
+  std::vector<char> row;
+  for (uint32_t i = 0; i < subresourceCount; ++i) {
+    const AssetPackSourceSubresource& source = pSubresources[i];
+    if (!Pad(kAssetPackPlacementAlignment)) {
+      return false;
+    }
+    AssetPackSubresource subresource{};
+    subresource.offset = m_offset - entry.offset;
+    subresource.rowSize = source.rowSize;
+    subresource.rowPitch = static_cast<uint32_t>(AlignUp(source.rowSize, kAssetPackRowPitchAlignment));
+    subresource.numRows = source.numRows;
+
+    // Every row padded to the pitch, except the last one, like in a placed footprint.
+    row.assign(subresource.rowPitch, 0);
+    for (uint32_t y = 0; y < source.numRows; ++y) {
+      memcpy(row.data(), static_cast<const uint8_t*>(source.pData) + y * source.rowPitch, static_cast<size_t>(source.rowSize));
+      const uint64_t size = y + 1 < source.numRows ? subresource.rowPitch : source.rowSize;
+      m_file.write(row.data(), static_cast<std::streamsize>(size));
+      m_offset += size;
+    }
+    m_subresources.push_back(subresource);
+  }
+  entry.size = m_offset - entry.offset;
+  m_entries.push_back(entry);
+  return static_cast<bool>(m_file);
+}
+
+bool AssetPackWriter::Finish() {
+  if (!Pad(sizeof(uint64_t))) {
+    return false;
+  }
+  m_header.entryCount = static_cast<uint32_t>(m_entries.size());
+  m_header.tocOffset = m_offset;
+  m_file.write(reinterpret_cast<const char*>(m_entries.data()), static_cast<std::streamsize>(m_entries.size() * sizeof(AssetPackEntry)));
+  m_file.write(reinterpret_cast<const char*>(m_subresources.data()),
+    static_cast<std::streamsize>(m_subresources.size() * sizeof(AssetPackSubresource)));
+  m_file.seekp(0);
+  m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+  m_file.close();
+  return !m_file.fail();
+}
+
+bool AssetPackWriter::BeginEntry(const char* name, AssetPackEntryType type, AssetPackEntry* pEntry) {
+  const size_t nameLength = strlen(name);
+  if (nameLength == 0 || nameLength > kAssetPackMaxNameLength || !Pad(kAssetPackBlobAlignment)) {
+    return false;
+  }
+  memcpy(pEntry->name, name, nameLength);
+  pEntry->type = type;
+  pEntry->offset = m_offset;
+  return true;
+}
+
+bool AssetPackWriter::Pad(uint64_t alignment) {
+  const uint64_t size = AlignUp(m_offset, alignment) - m_offset;
+  m_file.write(kPadding, static_cast<std::streamsize>(size));
+  m_offset += size;
+  return static_cast<bool>(m_file);
+}
+
+AssetPack::~AssetPack() {
+  Close();
+}
+
+bool AssetPack::Open(const AssetPackPath& path, uint32_t contentVersion) {
+  Close();
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  m_file = file;
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    Close();
+    return false;
+  }
+  m_size = static_cast<uint64_t>(size.QuadPart);
+  m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping == nullptr) {
+    Close();
+    return false;
+  }
+  m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+  m_file = open(path.c_str(), O_RDONLY);
+  if (m_file < 0) {
+    return false;
+  }
+  struct stat status {};
+  if (fstat(m_file, &status) != 0 || status.st_size == 0) {
+    Close();
+    return false;
+  }
+  m_size = static_cast<uint64_t>(status.st_size);
+  void* pData = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+  m_pData = pData == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(pData);
+#endif
+  if (m_pData == nullptr || !Validate(contentVersion)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void AssetPack::Close() {
+#ifdef _WIN32
+  if (m_pData != nullptr) {
+    UnmapViewOfFile(m_pData);
+  }
+  if (m_mapping != nullptr) {
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+  }
+  if (m_file != nullptr) {
+    CloseHandle(m_file);
+    m_file = nullptr;
+  }
+#else
+  if (m_pData != nullptr) {
+    munmap(const_cast<uint8_t*>(m_pData), static_cast<size_t>(m_size));
+  }
+  if (m_file >= 0) {
+    close(m_file);
+    m_file = -1;
+  }
+#endif
+  m_pData = nullptr;
+  m_size = 0;
+  m_pEntries = nullptr;
+  m_entryCount = 0;
+  m_pSubresources = nullptr;
+}
+
+const AssetPackEntry* AssetPack::Find(const char* name, AssetPackEntryType type) const {
+  for (uint32_t i = 0; i < m_entryCount; ++i) {
+    if (m_pEntries[i].type == type && strcmp(m_pEntries[i].name, name) == 0) {
+      return &m_pEntries[i];
+    }
+  }
+  return nullptr;
+}
+
+bool AssetPack::Validate(uint32_t contentVersion) {
+  AssetPackHeader header{};
+  if (m_size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, m_pData, sizeof(header));
+  if (memcmp(header.magic, kAssetPackMagic, sizeof(kAssetPackMagic)) != 0 || header.formatVersion != kAssetPackFormatVersion ||
+    header.contentVersion != contentVersion || header.tocOffset % sizeof(uint64_t) != 0 || header.tocOffset > m_size ||
+    header.entryCount > (m_size - header.tocOffset) / sizeof(AssetPackEntry)) {
+    return false;
+  }
+  m_pEntries = reinterpret_cast<const AssetPackEntry*>(m_pData + header.tocOffset);
+  m_entryCount = header.entryCount;
+
+  // Sizes are compared against what is left of the file, so nothing overflows.
+  uint64_t subresourceCount = 0;
+  for (uint32_t i = 0; i < m_entryCount; ++i) {
+    const AssetPackEntry& entry = m_pEntries[i];
+    if (entry.name[kAssetPackMaxNameLength] != '\0' || entry.offset > header.tocOffset || entry.size > header.tocOffset - entry.offset) {
+      return false;
+    }
+    if (entry.type == AssetPackEntryType::kTexture) {
+      if (entry.firstSubresource != subresourceCount) {
+        return false;
+      }
+      subresourceCount += static_cast<uint64_t>(entry.arraySize) * entry.mipLevels;
+    } else if (entry.type != AssetPackEntryType::kBuffer) {
+      return false;
+    }
+  }
+  const uint64_t subresourcesOffset = header.tocOffset + static_cast<uint64_t>(m_entryCount) * sizeof(AssetPackEntry);
+  if (subresourceCount > (m_size - subresourcesOffset) / sizeof(AssetPackSubresource)) {
+    return false;
+  }
+  m_pSubresources = reinterpret_cast<const AssetPackSubresource*>(m_pData + subresourcesOffset);
+
+  for (uint32_t i = 0; i < m_entryCount; ++i) {
+    const AssetPackEntry& entry = m_pEntries[i];
+    if (entry.type != AssetPackEntryType::kTexture) {
+      continue;
+    }
+    const uint32_t count = static_cast<uint32_t>(entry.arraySize) * entry.mipLevels;
+    for (uint32_t j = 0; j < count; ++j) {
+      const AssetPackSubresource& subresource = m_pSubresources[entry.firstSubresource + j];
+      if (subresource.numRows == 0 || subresource.rowSize > subresource.rowPitch || subresource.offset > entry.size ||
+        (subresource.numRows - 1) * static_cast<uint64_t>(subresource.rowPitch) + subresource.rowSize > entry.size - subresource.offset) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
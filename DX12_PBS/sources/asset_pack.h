@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A container of baked assets, read through a memory mapping so their data can be copied straight
+// into upload memory. Plain C++ apart from the mapping, so packs can be written and checked on any
+// platform.
+//
+// File layout, little endian, every struct below as is:
+//   AssetPackHeader,
+//   the blob of every entry, each aligned to kAssetPackBlobAlignment,
+//   the table of contents at tocOffset: entryCount AssetPackEntry, followed by the
+//   AssetPackSubresource of every texture, in the order of the entries.
+// Texture blobs are laid out like the placed footprints GetCopyableFootprints returns for a
+// buffer offset of 0: rows kAssetPackRowPitchAlignment apart, subresources aligned to
+// kAssetPackPlacementAlignment.
+
+constexpr char kAssetPackMagic[4] = {'P', 'B', 'S', 'A'};
+constexpr uint32_t kAssetPackFormatVersion = 1;
+constexpr uint64_t kAssetPackBlobAlignment = 4096;  // a page, so a blob never shares one with the TOC
+constexpr uint64_t kAssetPackRowPitchAlignment = 256;  // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+constexpr uint64_t kAssetPackPlacementAlignment = 512;  // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+constexpr size_t kAssetPackMaxNameLength = 31;
+
+#ifdef _WIN32
+using AssetPackPath = std::wstring;
+#else
+using AssetPackPath = std::string;
+#endif
+
+enum class AssetPackEntryType : uint32_t {
+  kBuffer,  // vertices, indices, instance tables
+  kTexture,
+};
+
+struct AssetPackHeader {
+  char magic[4];
+  uint32_t formatVersion;
+  // Chosen by whoever writes the pack, e.g. bumped when the baked data changes; a pack of another
+  // content version doesn't open.
+  uint32_t contentVersion;
+  uint32_t entryCount;
+  uint64_t tocOffset;
+};
+
+struct AssetPackEntry {
+  char name[kAssetPackMaxNameLength + 1];  // null terminated
+  AssetPackEntryType type;
+  uint32_t elementSize;  // buffers: the stride of an element, e.g. a vertex
+  uint64_t offset;  // of the blob, from the start of the file
+  uint64_t size;
+  // Textures only.
+  uint32_t format;  // a DXGI_FORMAT
+  uint32_t width;
+  uint32_t height;
+  uint16_t arraySize;
+  uint16_t mipLevels;
+  uint32_t firstSubresource;  // into the AssetPackSubresource after the entries
+  uint32_t reserved;
+};
+
+struct AssetPackSubresource {
+  uint64_t offset;  // from the start of the blob
+  uint64_t rowSize;  // bytes of a row without the padding
+  uint32_t rowPitch;
+  uint32_t numRows;  // rows of blocks, for block compressed formats
+};
+
+// Source data of a subresource handed to the writer, packed or not.
+struct AssetPackSourceSubresource {
+  const void* pData;
+  uint64_t rowPitch;
+  uint64_t rowSize;
+  uint32_t numRows;
+};
+
+struct AssetPackTextureDesc {
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint16_t arraySize;
+  uint16_t mipLevels;  // subresources are ordered like D3D12 subresource indices, mip first
+};
+
+// Streams the blobs to the file as they are added; the pack is only valid once Finish succeeded.
+// Returns false on I/O errors and invalid names.
+class AssetPackWriter {
+public:
+  AssetPackWriter(const AssetPackPath& path, uint32_t contentVersion);
+
+  AssetPackWriter(const AssetPackWriter&) = delete;
+  AssetPackWriter& operator=(const AssetPackWriter&) = delete;
+
+  bool AddBuffer(const char* name, const void* pData, uint64_t size, uint32_t elementSize);
+  // arraySize * mipLevels subresources.
+  bool AddTexture(const char* name, const AssetPackTextureDesc& desc, const AssetPackSourceSubresource* pSubresources);
+  bool Finish();
+
+private:
+  bool BeginEntry(const char* name, AssetPackEntryType type, AssetPackEntry* pEntry);
+  bool Pad(uint64_t alignment);
+
+  std::ofstream m_file;
+  uint64_t m_offset = 0;  // of the end of the file
+  AssetPackHeader m_header{};
+  std::vector<AssetPackEntry> m_entries;
+  std::vector<AssetPackSubresource> m_subresources;
+};
+
+// A pack mapped read only. Open validates the header and the table of contents, so the data of every
+// entry it returns lies within the file. Entries stay valid until the pack is closed or destroyed.
+class AssetPack {
+public:
+  AssetPack() = default;
+  ~AssetPack();
+
+  AssetPack(const AssetPack&) = delete;
+  AssetPack& operator=(const AssetPack&) = delete;
+
+  // Returns false if the file is missing, of another format or content version, or damaged.
+  bool Open(const AssetPackPath& path, uint32_t contentVersion);
+  void Close();
+
+  bool IsOpen() const {
+    return m_pData != nullptr;
+  }
+
+  // Null if the pack has no entry of that name and type.
+  const AssetPackEntry* Find(const char* name, AssetPackEntryType type) const;
+
+  const uint8_t* GetData(const AssetPackEntry& entry) const {
+    return m_pData + entry.offset;
+  }
+
+  // arraySize * mipLevels of them.
+  const AssetPackSubresource* GetSubresources(const AssetPackEntry& entry) const {
+    return m_pSubresources + entry.firstSubresource;
+  }
+
+private:
+  bool Validate(uint32_t contentVersion);
+
+  const uint8_t* m_pData = nullptr;
+  uint64_t m_size = 0;
+  const AssetPackEntry* m_pEntries = nullptr;
+  uint32_t m_entryCount = 0;
+  const AssetPackSubresource* m_pSubresources = nullptr;
+#ifdef _WIN32
+  void* m_file = nullptr;  // HANDLE
+  void* m_mapping = nullptr;  // HANDLE
+#else
+  int m_file = -1;
+#endif
+};
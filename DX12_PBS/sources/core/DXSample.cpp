@@ -22,7 +22,16 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name) :
     m_title(name),
     m_aspectRatio(0.0f),
     m_useWarpDevice(false),
-    m_enableUI(true)
+    m_enableUI(true),
+    m_uncappedPresent(false),
+    m_maxFrameLatency(1),
+    m_shaderHotReload(false),
+    m_bindless(false),
+    m_headless(false),
+    m_headlessWarmupFrames(60),
+    m_headlessMeasuredFrames(600),
+    m_cpuBenchmark(false),
+    m_syncLoading(false)
 {
     WCHAR assetsPath[512];
     GetAssetsPath(assetsPath, _countof(assetsPath));
@@ -141,6 +150,52 @@ void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
         {
             m_enableUI = false;
         }
+        else if (_wcsnicmp(argv[i], L"-uncapped", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/uncapped", wcslen(argv[i])) == 0)
+        {
+            m_uncappedPresent = true;
+        }
+        else if ((_wcsnicmp(argv[i], L"-maxFrameLatency", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/maxFrameLatency", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_maxFrameLatency = max(1u, static_cast<UINT>(_wtoi(argv[++i])));
+        }
+        else if (_wcsnicmp(argv[i], L"-shaderHotReload", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/shaderHotReload", wcslen(argv[i])) == 0)
+        {
+            m_shaderHotReload = true;
+        }
+        else if (_wcsnicmp(argv[i], L"-bindless", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/bindless", wcslen(argv[i])) == 0)
+        {
+            m_bindless = true;
+        }
+        else if (_wcsnicmp(argv[i], L"-headless", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/headless", wcslen(argv[i])) == 0)
+        {
+            m_headless = true;
+        }
+        else if ((_wcsnicmp(argv[i], L"-warmupFrames", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/warmupFrames", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_headlessWarmupFrames = static_cast<UINT>(_wtoi(argv[++i]));
+        }
+        else if ((_wcsnicmp(argv[i], L"-measuredFrames", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/measuredFrames", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_headlessMeasuredFrames = max(1u, static_cast<UINT>(_wtoi(argv[++i])));
+        }
+        else if (_wcsnicmp(argv[i], L"-cpuBenchmark", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/cpuBenchmark", wcslen(argv[i])) == 0)
+        {
+            m_cpuBenchmark = true;
+            m_headless = true;
+        }
+        else if (_wcsnicmp(argv[i], L"-syncLoading", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/syncLoading", wcslen(argv[i])) == 0)
+        {
+            m_syncLoading = true;
+        }
     }
 }
 
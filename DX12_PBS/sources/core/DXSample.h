@@ -41,6 +41,9 @@ public:
     const WCHAR* GetTitle() const   { return m_title.c_str(); }
     bool GetTearingSupport() const  { return m_tearingSupport; }
     RECT GetWindowsBounds() const   { return m_windowBounds; }
+    bool IsShaderHotReloadEnabled() const { return m_shaderHotReload; }
+    bool IsBindlessRequested() const { return m_bindless; }
+    bool IsHeadless() const         { return m_headless; }
     virtual IDXGISwapChain* GetSwapchain() { return nullptr; }
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
@@ -74,6 +77,30 @@ protected:
     // Override to be able to start without Dx11on12 UI for PIX. PIX doesn't support 11 on 12. 
     bool m_enableUI;
 
+    // Presentation: present without vsync (and with tearing when available), and the number of
+    // frames the CPU may queue ahead of the display.
+    bool m_uncappedPresent;
+    UINT m_maxFrameLatency;
+
+    // Compile shaders that changed since the build at runtime, and reload them on F5.
+    bool m_shaderHotReload;
+
+    // Address the resources of the shading passes by descriptor heap index, if the device supports it.
+    bool m_bindless;
+
+    // Run the benchmark scenarios without a window, into offscreen render targets, and quit. Frames
+    // rendered per scenario before measuring, and measured.
+    bool m_headless;
+    UINT m_headlessWarmupFrames;
+    UINT m_headlessMeasuredFrames;
+
+    // Run the microbenchmarks of the CPU side instead, headless too, and quit with EXIT_FAILURE if one regressed.
+    bool m_cpuBenchmark;
+
+    // Wait for every asset before the first frame, as the sample did before it loaded them in the
+    // background, to measure what that saves.
+    bool m_syncLoading;
+
 private:
     // Root assets path.
     std::wstring m_assetsPath;
@@ -28,6 +28,11 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
         pSample->ParseCommandLineArgs(argv, argc);
         LocalFree(argv);
 
+        if (pSample->IsHeadless())
+        {
+            return RunHeadless(pSample);
+        }
+
         // Initialize the window class.
         WNDCLASSEX windowClass = { 0 };
         windowClass.cbSize = sizeof(WNDCLASSEX);
@@ -181,6 +186,33 @@ void Win32Application::SetWindowZorderToTopMost(bool setToTopMost)
         SWP_FRAMECHANGED | SWP_NOACTIVATE);
 }
 
+int Win32Application::RunHeadless(DXSample* pSample)
+{
+    // Exceptions are handled by Run.
+    pSample->OnInit();
+
+    // Without a window there is no WM_PAINT, so the loop drives the frames itself. The sample
+    // posts WM_QUIT to the thread's message queue when it is done.
+    MSG msg = {};
+    while (msg.message != WM_QUIT)
+    {
+        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        else
+        {
+            pSample->OnUpdate();
+            pSample->OnRender();
+        }
+    }
+
+    pSample->OnDestroy();
+
+    return static_cast<char>(msg.wParam);
+}
+
 // Main message handler for the sample.
 LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
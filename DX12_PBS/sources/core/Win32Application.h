@@ -25,6 +25,8 @@ public:
     static bool IsFullscreen() { return m_fullscreenMode; }
 
 protected:
+    // Renders frames as fast as possible until the sample posts WM_QUIT, without creating a window.
+    static int RunHeadless(DXSample* pSample);
     static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
 private:
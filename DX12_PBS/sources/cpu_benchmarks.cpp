@@ -0,0 +1,127 @@
+#include "cpu_benchmarks.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <DirectXTex.h>
+
+#include "core/DXSampleHelper.h"
+#include "light_manager.h"
+#include "microbenchmark.h"
+#include "sample_assets.h"
+#include "upload_arena.h"
+
+namespace {
+
+constexpr size_t kSampleCount = 20;
+constexpr int64_t kMinSampleNanoseconds = 10 * 1000 * 1000;
+constexpr UINT kFrameCount = 3;  // frame resources the light commits cycle through
+constexpr float kLightLuminanceThreshold = 0.05f;
+
+// An equirectangular HDR image like the environment map, encoded as a Radiance file in memory so that
+// the decode doesn't depend on the assets or the disk.
+void EncodeEnvironmentMap(size_t width, size_t height, Blob* pHDRFile) {
+  ScratchImage image;
+  ThrowIfFailed(image.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, width, height, 1, 1));
+  const Image* pImage = image.GetImage(0, 0, 0);
+  for (size_t y = 0; y < height; ++y) {
+    float* pRow = reinterpret_cast<float*>(pImage->pixels + y * pImage->rowPitch);
+    for (size_t x = 0; x < width; ++x) {
+      // A smooth sky with a bright sun, so that the run length encoding sees varied values.
+      const float u = static_cast<float>(x) / width;
+      const float v = static_cast<float>(y) / height;
+      const float sun = (std::abs(u - 0.3f) < 0.01f && std::abs(v - 0.2f) < 0.01f) ? 1000.0f : 0.0f;
+      pRow[x * 4 + 0] = 0.2f + 0.8f * v + sun;
+      pRow[x * 4 + 1] = 0.4f + 0.5f * v + sun;
+      pRow[x * 4 + 2] = 1.0f - 0.3f * u + sun;
+      pRow[x * 4 + 3] = 1.0f;
+    }
+  }
+  ThrowIfFailed(SaveToHDRMemory(*pImage, *pHDRFile));
+}
+
+void LogResults(const MicroBenchmark& benchmark) {
+  for (const MicroBenchmark::Result& result : benchmark.GetResults()) {
+    char message[256];
+    sprintf_s(message, "cpu benchmark: %s: %.1f ns median, %.1f mean +- %.1f, %.3g items/s\n",
+      result.name.c_str(), result.median, result.mean, result.standardDeviation, result.GetItemsPerSecond());
+    OutputDebugStringA(message);
+  }
+}
+
+}  // namespace
+
+bool RunCpuBenchmarks(ID3D12Device* pDevice, const std::wstring& resultsPath, const std::wstring& baselinePath) {
+  MicroBenchmark benchmark(kSampleCount, kMinSampleNanoseconds);
+
+  // The environment map is 2048x1024.
+  for (size_t height : { 128u, 1024u }) {
+    const size_t width = height * 2;
+    Blob HDRFile;
+    EncodeEnvironmentMap(width, height, &HDRFile);
+    benchmark.Run("hdr_decode/" + std::to_string(width) + "x" + std::to_string(height), width * height, [&HDRFile] {
+      ScratchImage image;
+      ThrowIfFailed(LoadFromHDRMemory(HDRFile.GetBufferPointer(), HDRFile.GetBufferSize(), nullptr, image));
+      MicroBenchmark::KeepAlive(image.GetPixels());
+    });
+  }
+
+  // What PBSScene commits every frame: its three constant buffers, and the lights, which all move here.
+  UploadArena uploadArena(pDevice, 64 * 1024);
+  for (UINT numLights : { 4u, 256u, 1024u }) {
+    LightManager lightManager(kFrameCount, kLightLuminanceThreshold);
+    std::vector<LightManager::LightId> lights;
+    for (UINT i = 0; i < numLights; ++i) {
+      lights.push_back(lightManager.AddLight(LightState(static_cast<float>(i % 32), static_cast<float>(i / 32), 1.5f, 2.0f, 2.0f, 2.0f)));
+    }
+    lightManager.CreateResources(pDevice);
+
+    SceneConstantBuffer sceneConstantBuffer{};
+    TiledShadingConstantBuffer tiledShadingConstantBuffer{};
+    ShadowConstantBuffer shadowConstantBuffer{};
+    UINT frameIndex = 0;
+    float offset = 0.0f;
+    benchmark.Run("constant_buffer_commit/" + std::to_string(numLights), numLights, [&] {
+      uploadArena.Reset();
+      MicroBenchmark::KeepAlive(uploadArena.AllocateConstants(sceneConstantBuffer).pCpu);
+      MicroBenchmark::KeepAlive(uploadArena.AllocateConstants(tiledShadingConstantBuffer).pCpu);
+      MicroBenchmark::KeepAlive(uploadArena.AllocateConstants(shadowConstantBuffer).pCpu);
+
+      offset = offset < 1.0f ? offset + 0.001f : 0.0f;
+      for (UINT i = 0; i < numLights; ++i) {
+        lightManager.SetLightPosition(lights[i], static_cast<float>(i % 32) + offset, static_cast<float>(i / 32), 1.5f);
+      }
+      lightManager.Commit(frameIndex);
+      frameIndex = (frameIndex + 1) % kFrameCount;
+    });
+  }
+
+  LogResults(benchmark);
+  {
+    std::ofstream resultsFile(resultsPath);
+    benchmark.WriteCsv(resultsFile);
+  }
+
+  std::vector<MicroBenchmark::Result> baseline;
+  std::ifstream baselineFile(baselinePath);
+  if (!baselineFile || !MicroBenchmark::ReadCsv(baselineFile, &baseline)) {
+    // The first run sets the baseline; delete the file to take a new one.
+    baselineFile.close();
+    std::ofstream newBaselineFile(baselinePath);
+    benchmark.WriteCsv(newBaselineFile);
+    OutputDebugStringA("cpu benchmark: no baseline, the results are the new one\n");
+    return true;
+  }
+
+  bool passed = true;
+  for (const MicroBenchmark::Comparison& comparison : benchmark.Compare(baseline)) {
+    char message[256];
+    sprintf_s(message, "cpu benchmark: %s: %+.1f%% against the baseline (t = %.1f)%s\n", comparison.name.c_str(),
+      100.0 * comparison.change, comparison.tStatistic, comparison.regression ? ", REGRESSION" : "");
+    OutputDebugStringA(message);
+    passed = passed && !comparison.regression;
+  }
+  return passed;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "core/stdafx.h"
+
+// Runs the microbenchmarks of the CPU side of the sample that need D3D12 or DirectXTex with
+// MicroBenchmark, at several sizes each: the HDR decode of the environment map and the constant buffer
+// and light commits. pDevice: for the upload buffers of the commits. The other kernels are in
+// tests/portable_benchmarks.cpp, which also builds on Linux.
+// Writes the results to resultsPath, and compares them with baselinePath, which the first run creates.
+// Returns false if a kernel regressed.
+bool RunCpuBenchmarks(ID3D12Device* pDevice, const std::wstring& resultsPath, const std::wstring& baselinePath);
@@ -0,0 +1,83 @@
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+CpuProfiler& CpuProfiler::Get() {
+  static CpuProfiler profiler;
+  return profiler;
+}
+
+int64_t CpuProfiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CpuProfiler::CpuProfiler() :
+  m_enabled(true) {
+}
+
+void CpuProfiler::SetThreadName(const char* name) {
+  GetThreadBuffer()->name.store(name, std::memory_order_relaxed);
+}
+
+void CpuProfiler::Record(const char* name, int64_t startNanoseconds, int64_t endNanoseconds) {
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  const uint64_t head = pBuffer->head.load(std::memory_order_relaxed);
+  // Pairs with the fence in GetTraceEvents: a reader that sees any of the stores below also sees head
+  // at this value, so it knows the oldest event is being overwritten.
+  std::atomic_thread_fence(std::memory_order_release);
+  Event& event = pBuffer->events[head % kEventsPerThread];
+  event.name.store(name, std::memory_order_relaxed);
+  event.startNanoseconds.store(startNanoseconds, std::memory_order_relaxed);
+  event.endNanoseconds.store(endNanoseconds, std::memory_order_relaxed);
+  pBuffer->head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::GetTraceEvents(std::vector<TraceEvent>* pEvents, std::vector<std::pair<uint32_t, std::string>>* pThreadNames) {
+  std::vector<ThreadBuffer*> buffers;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : m_threadBuffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+
+  for (ThreadBuffer* pBuffer : buffers) {
+    const uint64_t head = pBuffer->head.load(std::memory_order_acquire);
+    const uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+    std::vector<TraceEvent> events;
+    events.reserve(static_cast<size_t>(head - first));
+    for (uint64_t i = first; i < head; ++i) {
+      const Event& event = pBuffer->events[i % kEventsPerThread];
+      const int64_t startNanoseconds = event.startNanoseconds.load(std::memory_order_relaxed);
+      const int64_t endNanoseconds = event.endNanoseconds.load(std::memory_order_relaxed);
+      events.push_back({ event.name.load(std::memory_order_relaxed), "cpu", pBuffer->threadId,
+        startNanoseconds / 1000.0, (endNanoseconds - startNanoseconds) / 1000.0 });
+    }
+    // The thread may have written over the oldest events while they were read, including the one at
+    // the head it hasn't published yet.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t headAfter = pBuffer->head.load(std::memory_order_relaxed);
+    const uint64_t firstValid = headAfter + 1 > kEventsPerThread ? headAfter + 1 - kEventsPerThread : 0;
+    const size_t skipped = static_cast<size_t>((std::min)(head, (std::max)(first, firstValid)) - first);
+    pEvents->insert(pEvents->end(), events.begin() + skipped, events.end());
+
+    const char* name = pBuffer->name.load(std::memory_order_relaxed);
+    pThreadNames->emplace_back(pBuffer->threadId, name != nullptr ? name : "thread " + std::to_string(pBuffer->threadId));
+  }
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::GetThreadBuffer() {
+  thread_local ThreadBuffer* pThreadBuffer = nullptr;
+  if (pThreadBuffer == nullptr) {
+    std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+    buffer->name.store(nullptr, std::memory_order_relaxed);
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->events = std::make_unique<Event[]>(kEventsPerThread);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->threadId = static_cast<uint32_t>(m_threadBuffers.size()) + 1;  // 0 is the GPU queue's
+    pThreadBuffer = buffer.get();
+    m_threadBuffers.push_back(std::move(buffer));
+  }
+  return pThreadBuffer;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "profiler_output.h"
+
+// Records scopes of the CPU work of every thread, for a Chrome trace. Portable, so the CPU side of the
+// subsystems can be profiled on any platform.
+// Every thread writes into a ring buffer of its own, created the first time it records, so recording
+// takes no lock: a scope costs two clock reads and a store. A full ring overwrites its oldest events.
+// The trace can be taken while threads record; it has the events not overwritten meanwhile.
+class CpuProfiler {
+public:
+  static constexpr size_t kEventsPerThread = 16384;
+
+  // The profiler of the process.
+  static CpuProfiler& Get();
+
+  // Steady clock, in nanoseconds. On Windows it is QueryPerformanceCounter, like the GPU profiler's timeline.
+  static int64_t Now();
+
+  void SetEnabled(bool enabled) {
+    m_enabled.store(enabled, std::memory_order_relaxed);
+  }
+  bool IsEnabled() const {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Names the calling thread in the trace. name: a literal.
+  void SetThreadName(const char* name);
+  // name: a literal.
+  void Record(const char* name, int64_t startNanoseconds, int64_t endNanoseconds);
+
+  // Appends the events of all the threads, and their names.
+  void GetTraceEvents(std::vector<TraceEvent>* pEvents, std::vector<std::pair<uint32_t, std::string>>* pThreadNames);
+
+private:
+  // Single producer ring: only the owning thread writes the events and publishes them by advancing
+  // head; the fields are atomics so that a concurrent reader is well defined.
+  struct Event {
+    std::atomic<const char*> name;
+    std::atomic<int64_t> startNanoseconds;
+    std::atomic<int64_t> endNanoseconds;
+  };
+
+  struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> head;  // events ever written
+    std::unique_ptr<Event[]> events;
+  };
+
+  CpuProfiler();
+
+  ThreadBuffer* GetThreadBuffer();
+
+  std::atomic<bool> m_enabled;
+  std::mutex m_mutex;  // guards m_threadBuffers, which threads only add to
+  // Never released, so that a thread can exit while its events are still to be traced.
+  std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+};
+
+// Records the rest of the C++ scope.
+class CpuProfileScope {
+public:
+  explicit CpuProfileScope(const char* name) :
+    m_name(name),
+    m_startNanoseconds(CpuProfiler::Get().IsEnabled() ? CpuProfiler::Now() : -1) {
+  }
+  ~CpuProfileScope() {
+    if (m_startNanoseconds >= 0) {
+      CpuProfiler::Get().Record(m_name, m_startNanoseconds, CpuProfiler::Now());
+    }
+  }
+
+  CpuProfileScope(const CpuProfileScope&) = delete;
+  CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+  const char* m_name;
+  int64_t m_startNanoseconds;
+};
+
+#define CPU_PROFILE_CONCATENATE_INNER(a, b) a##b
+#define CPU_PROFILE_CONCATENATE(a, b) CPU_PROFILE_CONCATENATE_INNER(a, b)
+// name: a literal.
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCATENATE(cpuProfileScope, __LINE__)(name)
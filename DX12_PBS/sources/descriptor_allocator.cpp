@@ -0,0 +1,97 @@
+#include "descriptor_allocator.h"
+
+DescriptorFreeList::DescriptorFreeList(uint32_t capacity) :
+  m_capacity(capacity),
+  m_freeCount(capacity) {
+  if (capacity > 0) {
+    m_freeRanges.push_back({ 0, capacity });
+  }
+}
+
+uint32_t DescriptorFreeList::Allocate(uint32_t count) {
+  if (count == 0) {
+    return kInvalidOffset;
+  }
+  for (size_t i = 0; i < m_freeRanges.size(); ++i) {
+    Range& range = m_freeRanges[i];
+    if (range.count < count) {
+      continue;
+    }
+    const uint32_t offset = range.offset;
+    range.offset += count;
+    range.count -= count;
+    if (range.count == 0) {
+      m_freeRanges.erase(m_freeRanges.begin() + i);
+    }
+    m_freeCount -= count;
+    return offset;
+  }
+  return kInvalidOffset;
+}
+
+void DescriptorFreeList::Free(uint32_t offset, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  // The first free range after the freed one.
+  size_t next = 0;
+  while (next < m_freeRanges.size() && m_freeRanges[next].offset < offset) {
+    ++next;
+  }
+
+  const bool mergePrevious = next > 0 && m_freeRanges[next - 1].offset + m_freeRanges[next - 1].count == offset;
+  const bool mergeNext = next < m_freeRanges.size() && offset + count == m_freeRanges[next].offset;
+  if (mergePrevious && mergeNext) {
+    m_freeRanges[next - 1].count += count + m_freeRanges[next].count;
+    m_freeRanges.erase(m_freeRanges.begin() + next);
+  } else if (mergePrevious) {
+    m_freeRanges[next - 1].count += count;
+  } else if (mergeNext) {
+    m_freeRanges[next].offset = offset;
+    m_freeRanges[next].count += count;
+  } else {
+    m_freeRanges.insert(m_freeRanges.begin() + next, { offset, count });
+  }
+  m_freeCount += count;
+}
+
+DescriptorRing::DescriptorRing(uint32_t capacity) :
+  m_capacity(capacity) {
+}
+
+uint32_t DescriptorRing::Allocate(uint32_t count) {
+  if (count == 0 || count > m_capacity) {
+    return kInvalidOffset;
+  }
+
+  // Nothing in use: start over at 0, so that no slots are skipped.
+  if (m_usedCount == 0) {
+    m_head = 0;
+  }
+
+  const uint32_t skipped = m_head + count > m_capacity ? m_capacity - m_head : 0;
+  if (m_usedCount + skipped + count > m_capacity) {
+    return kInvalidOffset;
+  }
+
+  const uint32_t offset = skipped > 0 ? 0 : m_head;
+  m_head = (offset + count) % m_capacity;
+  m_usedCount += skipped + count;
+  m_currentFrameCount += skipped + count;
+  return offset;
+}
+
+void DescriptorRing::EndFrame(uint64_t fenceValue) {
+  if (m_currentFrameCount > 0) {
+    m_frames.push_back({ fenceValue, m_currentFrameCount });
+    m_currentFrameCount = 0;
+  }
+}
+
+void DescriptorRing::Reclaim(uint64_t completedFenceValue) {
+  while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue) {
+    m_usedCount -= m_frames.front().count;
+    m_frames.pop_front();
+  }
+}
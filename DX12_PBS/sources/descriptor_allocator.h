@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Bookkeeping of descriptor heap slots. Like the render graph, these only deal with indices and
+// don't know about D3D12 objects; DescriptorHeap puts them on top of a heap.
+
+// Contiguous ranges of [0, capacity) that stay allocated until they are freed, for views that live
+// as long as their resource. Free ranges are kept sorted and merged with their neighbours, and an
+// allocation takes the first one that is large enough.
+class DescriptorFreeList {
+public:
+  static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+  explicit DescriptorFreeList(uint32_t capacity);
+
+  // Returns kInvalidOffset if no free range is large enough.
+  uint32_t Allocate(uint32_t count);
+  void Free(uint32_t offset, uint32_t count);
+
+  uint32_t GetCapacity() const {
+    return m_capacity;
+  }
+
+  uint32_t GetFreeCount() const {
+    return m_freeCount;
+  }
+
+private:
+  struct Range {
+    uint32_t offset;
+    uint32_t count;
+  };
+
+  std::vector<Range> m_freeRanges;  // sorted by offset, never adjacent
+  uint32_t m_capacity = 0;
+  uint32_t m_freeCount = 0;
+};
+
+// Contiguous ranges of [0, capacity) for the frame being recorded, handed out in a ring. A range is
+// never freed on its own: EndFrame tags everything allocated during the frame with the fence value
+// the frame signals, and Reclaim frees whole frames once the fence has reached their value.
+// A range that doesn't fit before the end of the ring starts over at 0; the skipped slots are
+// reclaimed with the frame.
+class DescriptorRing {
+public:
+  static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+  explicit DescriptorRing(uint32_t capacity);
+
+  // Returns kInvalidOffset if the frames in flight leave no room.
+  uint32_t Allocate(uint32_t count);
+  void EndFrame(uint64_t fenceValue);
+  void Reclaim(uint64_t completedFenceValue);
+
+  uint32_t GetCapacity() const {
+    return m_capacity;
+  }
+
+  // Slots of the frames in flight and of the frame being recorded.
+  uint32_t GetUsedCount() const {
+    return m_usedCount;
+  }
+
+private:
+  struct Frame {
+    uint64_t fenceValue;
+    uint32_t count;  // including skipped slots
+  };
+
+  std::deque<Frame> m_frames;  // in flight, oldest first
+  uint32_t m_capacity = 0;
+  uint32_t m_head = 0;  // where the next range starts
+  uint32_t m_usedCount = 0;
+  uint32_t m_currentFrameCount = 0;
+};
@@ -0,0 +1,76 @@
+#include "descriptor_heap.h"
+
+#include "core/DXSampleHelper.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible,
+  UINT persistentCapacity, UINT ringCapacity, LPCWSTR name) :
+  m_device(pDevice),
+  m_type(type),
+  m_freeList(persistentCapacity),
+  m_ring(ringCapacity) {
+  D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+  heapDesc.NumDescriptors = persistentCapacity + ringCapacity;
+  heapDesc.Type = type;
+  heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+  ThrowIfFailed(pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_heap)));
+  m_heap->SetName(name);
+
+  m_descriptorSize = pDevice->GetDescriptorHandleIncrementSize(type);
+}
+
+DescriptorHeap::~DescriptorHeap() {
+}
+
+DescriptorAllocation DescriptorHeap::Allocate(UINT count) {
+  DescriptorAllocation allocation;
+  allocation.offset = m_freeList.Allocate(count);
+  if (!allocation.IsValid()) {
+    ThrowIfFailed(E_OUTOFMEMORY);
+  }
+  allocation.count = count;
+  return allocation;
+}
+
+void DescriptorHeap::Free(DescriptorAllocation* pAllocation) {
+  if (pAllocation->IsValid()) {
+    m_freeList.Free(pAllocation->offset, pAllocation->count);
+    *pAllocation = DescriptorAllocation();
+  }
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::CopyToRing(const DescriptorHeap& sourceHeap, std::initializer_list<DescriptorAllocation> sourceAllocations) {
+  UINT count = 0;
+  for (const DescriptorAllocation& sourceAllocation : sourceAllocations) {
+    count += sourceAllocation.count;
+  }
+
+  DescriptorAllocation table;
+  const UINT ringOffset = m_ring.Allocate(count);
+  if (ringOffset == DescriptorRing::kInvalidOffset) {
+    ThrowIfFailed(E_OUTOFMEMORY);
+  }
+  table.offset = m_freeList.GetCapacity() + ringOffset;
+  table.count = count;
+
+  UINT index = 0;
+  for (const DescriptorAllocation& sourceAllocation : sourceAllocations) {
+    m_device->CopyDescriptorsSimple(sourceAllocation.count, GetCpuHandle(table, index), sourceHeap.GetCpuHandle(sourceAllocation), m_type);
+    index += sourceAllocation.count;
+  }
+  return GetGpuHandle(table);
+}
+
+void DescriptorHeap::Copy(const DescriptorHeap& sourceHeap, const DescriptorAllocation& sourceAllocation, const DescriptorAllocation& destination) {
+  if (sourceAllocation.count > destination.count) {
+    ThrowIfFailed(E_INVALIDARG);
+  }
+  m_device->CopyDescriptorsSimple(sourceAllocation.count, GetCpuHandle(destination), sourceHeap.GetCpuHandle(sourceAllocation), m_type);
+}
+
+void DescriptorHeap::EndFrame(UINT64 fenceValue) {
+  m_ring.EndFrame(fenceValue);
+}
+
+void DescriptorHeap::Reclaim(UINT64 completedFenceValue) {
+  m_ring.Reclaim(completedFenceValue);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <initializer_list>
+
+#include "core/stdafx.h"
+#include "descriptor_allocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Contiguous descriptors of a DescriptorHeap.
+struct DescriptorAllocation {
+  UINT offset = DescriptorFreeList::kInvalidOffset;
+  UINT count = 0;
+
+  bool IsValid() const {
+    return offset != DescriptorFreeList::kInvalidOffset;
+  }
+};
+
+// A descriptor heap whose first persistentCapacity slots are handed out by a free list, and whose
+// last ringCapacity slots form a ring of descriptor tables that only live for one frame.
+// Views are created in heaps that aren't shader visible, and the tables a frame binds are copied
+// from them into the ring of the shader visible heap, so a table can combine any views and no heap
+// offsets have to be laid out by hand. Not thread safe.
+class DescriptorHeap {
+public:
+  DescriptorHeap(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible,
+    UINT persistentCapacity, UINT ringCapacity, LPCWSTR name);
+  ~DescriptorHeap();
+
+  DescriptorHeap(const DescriptorHeap&) = delete;
+  DescriptorHeap& operator=(const DescriptorHeap&) = delete;
+
+  DescriptorAllocation Allocate(UINT count);
+  // The GPU must be done with the descriptors.
+  void Free(DescriptorAllocation* pAllocation);
+
+  // Copies the descriptors of the allocations, in order, into one range of the ring, and returns it
+  // as a table to bind. The allocations belong to a heap that isn't shader visible.
+  D3D12_GPU_DESCRIPTOR_HANDLE CopyToRing(const DescriptorHeap& sourceHeap, std::initializer_list<DescriptorAllocation> sourceAllocations);
+  // Copies the descriptors of sourceAllocation into destination, an allocation of this heap that
+  // the GPU isn't using, e.g. for shaders that index the heap directly.
+  void Copy(const DescriptorHeap& sourceHeap, const DescriptorAllocation& sourceAllocation, const DescriptorAllocation& destination);
+  // The tables copied since the previous call stay valid until the fence reaches fenceValue.
+  void EndFrame(UINT64 fenceValue);
+  void Reclaim(UINT64 completedFenceValue);
+
+  D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(const DescriptorAllocation& allocation, UINT index = 0) const {
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_heap->GetCPUDescriptorHandleForHeapStart(), allocation.offset + index, m_descriptorSize);
+  }
+
+  D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(const DescriptorAllocation& allocation, UINT index = 0) const {
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_heap->GetGPUDescriptorHandleForHeapStart(), allocation.offset + index, m_descriptorSize);
+  }
+
+  ID3D12DescriptorHeap* GetHeap() const {
+    return m_heap.Get();
+  }
+
+  UINT GetDescriptorSize() const {
+    return m_descriptorSize;
+  }
+
+private:
+  ComPtr<ID3D12Device> m_device;
+  ComPtr<ID3D12DescriptorHeap> m_heap;
+  D3D12_DESCRIPTOR_HEAP_TYPE m_type;
+  UINT m_descriptorSize = 0;
+  DescriptorFreeList m_freeList;
+  DescriptorRing m_ring;
+};
@@ -0,0 +1,80 @@
+#include "frame_pacing.h"
+
+#include <cstdio>
+
+FramePacingStats::FramePacingStats() {
+  QueryPerformanceFrequency(&m_frequency);
+  QueryPerformanceCounter(&m_windowStart);
+  Reset();
+}
+
+void FramePacingStats::BeginFrame(double waitSeconds) {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+
+  if (m_hasLastFrame) {
+    const double interval = static_cast<double>(now.QuadPart - m_lastFrameStart.QuadPart) / m_frequency.QuadPart;
+    m_minInterval = m_frames == 0 ? interval : (std::min)(m_minInterval, interval);
+    m_maxInterval = (std::max)(m_maxInterval, interval);
+    m_intervalSum += interval;
+    m_waitSum += waitSeconds;
+    ++m_frames;
+  }
+  m_lastFrameStart = now;
+  m_hasLastFrame = true;
+
+  const double windowSeconds = static_cast<double>(now.QuadPart - m_windowStart.QuadPart) / m_frequency.QuadPart;
+  if (windowSeconds >= 1.0 && m_frames > 0) {
+    char inputLatency[96] = "";
+    if (m_inputEvents > 0) {
+      sprintf_s(inputLatency, ", input to submit %.2f ms (max %.2f)",
+        1000.0 * m_inputLatencySum / m_inputEvents, 1000.0 * m_maxInputLatency);
+    }
+    char line[320];
+    sprintf_s(line, "frame pacing: %u frames, interval %.2f ms (min %.2f, max %.2f), latency wait %.2f ms, missed refreshes %u%s\n",
+      m_frames, 1000.0 * m_intervalSum / m_frames, 1000.0 * m_minInterval, 1000.0 * m_maxInterval,
+      1000.0 * m_waitSum / m_frames, m_missedRefreshes, inputLatency);
+    OutputDebugStringA(line);
+
+    m_windowStart = now;
+    Reset();
+  }
+}
+
+void FramePacingStats::EndFrame(IDXGISwapChain* pSwapChain) {
+  // Fails while windowed on some systems, and after display mode changes; then there is nothing to count.
+  DXGI_FRAME_STATISTICS statistics;
+  if (FAILED(pSwapChain->GetFrameStatistics(&statistics))) {
+    m_hasPresentStatistics = false;
+    return;
+  }
+
+  if (m_hasPresentStatistics && statistics.PresentCount > m_lastPresentCount) {
+    const UINT presents = statistics.PresentCount - m_lastPresentCount;
+    const UINT refreshes = statistics.PresentRefreshCount - m_lastPresentRefreshCount;
+    if (refreshes > presents) {
+      m_missedRefreshes += refreshes - presents;
+    }
+  }
+  m_lastPresentCount = statistics.PresentCount;
+  m_lastPresentRefreshCount = statistics.PresentRefreshCount;
+  m_hasPresentStatistics = true;
+}
+
+void FramePacingStats::AddInputLatency(double seconds) {
+  ++m_inputEvents;
+  m_inputLatencySum += seconds;
+  m_maxInputLatency = (std::max)(m_maxInputLatency, seconds);
+}
+
+void FramePacingStats::Reset() {
+  m_frames = 0;
+  m_intervalSum = 0.0;
+  m_minInterval = 0.0;
+  m_maxInterval = 0.0;
+  m_waitSum = 0.0;
+  m_missedRefreshes = 0;
+  m_inputEvents = 0;
+  m_inputLatencySum = 0.0;
+  m_maxInputLatency = 0.0;
+}
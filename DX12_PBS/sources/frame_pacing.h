@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/stdafx.h"
+
+// Collects frame pacing statistics and logs a summary to the debugger output once per second:
+// the CPU frame interval, how long the CPU waited for the swap chain each frame, how many
+// presents missed their vblank according to DXGI, and the input to submission latency.
+class FramePacingStats {
+public:
+  FramePacingStats();
+
+  FramePacingStats(const FramePacingStats&) = delete;
+  FramePacingStats& operator=(const FramePacingStats&) = delete;
+
+  // Call when the frame starts, after waiting waitSeconds for the frame latency waitable object.
+  void BeginFrame(double waitSeconds);
+  // Call after presenting the frame.
+  void EndFrame(IDXGISwapChain* pSwapChain);
+  // Time from an input event to the submission of the first frame that took it into account.
+  void AddInputLatency(double seconds);
+
+private:
+  void Reset();
+
+  LARGE_INTEGER m_frequency{};
+  LARGE_INTEGER m_lastFrameStart{};
+  LARGE_INTEGER m_windowStart{};
+  bool m_hasLastFrame = false;
+
+  UINT m_frames = 0;
+  double m_intervalSum = 0.0;
+  double m_minInterval = 0.0;
+  double m_maxInterval = 0.0;
+  double m_waitSum = 0.0;
+  UINT m_inputEvents = 0;
+  double m_inputLatencySum = 0.0;
+  double m_maxInputLatency = 0.0;
+
+  // Last DXGI_FRAME_STATISTICS sample, to count presents that took more than one refresh.
+  bool m_hasPresentStatistics = false;
+  UINT m_lastPresentCount = 0;
+  UINT m_lastPresentRefreshCount = 0;
+  UINT m_missedRefreshes = 0;
+};
@@ -1,48 +1,30 @@
 #include "frame_resource.h"
 
-#include "sample_assets.h"
 #include "util/DXHelper.h"
 
-FrameResource::FrameResource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue) {
-  ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
-  NAME_D3D12_OBJECT(m_commandAllocator);
-
-  // Create constant buffers.
-  {
-    // A cube has 6 faces.
-    constexpr UINT8 kCubeMapArraySize = 6;
-    
-    ThrowIfFailed(util::CreateConstantBuffer(pDevice, sizeof(ViewProjectionConstantBuffer) * kCubeMapArraySize, &m_constantBufferEquirectangularToCubemap,
-      nullptr, D3D12_RESOURCE_STATE_GENERIC_READ));
-    NAME_D3D12_OBJECT(m_constantBufferEquirectangularToCubemap);
+namespace {
 
-    ThrowIfFailed(util::CreateConstantBuffer(pDevice, sizeof(SceneConstantBuffer), &m_constantBufferMVP,
-      nullptr, D3D12_RESOURCE_STATE_GENERIC_READ));
-    NAME_D3D12_OBJECT(m_constantBufferMVP);
+// Enough for the constants of a frame; the arena grows if a frame needs more.
+constexpr UINT64 kInitialUploadArenaSize = 64 * 1024;
 
-    // 6: A cube has 6 faces.
-    ThrowIfFailed(util::CreateConstantBuffer(pDevice, sizeof(ViewProjectionConstantBuffer) * kCubeMapArraySize, &m_constantBufferIrradianceConvolution,
-      nullptr, D3D12_RESOURCE_STATE_GENERIC_READ));
-    NAME_D3D12_OBJECT(m_constantBufferIrradianceConvolution);
+}  // namespace
 
-    constexpr UINT8 kPrefilterMapMipLevels = 5;
-    ThrowIfFailed(util::CreateConstantBuffer(pDevice, sizeof(PrefilterConstantBuffer) * kPrefilterMapMipLevels, &m_constantBufferPrefilter,
-      nullptr, D3D12_RESOURCE_STATE_GENERIC_READ));
-    NAME_D3D12_OBJECT(m_constantBufferPrefilter);
-
-    // constant buffer for light states
-    ThrowIfFailed(util::CreateConstantBuffer(pDevice, sizeof(LightStatesConstantBuffer), &m_constantBufferLightStates,
-      nullptr, D3D12_RESOURCE_STATE_GENERIC_READ));
-    NAME_D3D12_OBJECT(m_constantBufferLightStates);
+FrameResource::FrameResource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT numWorkerThreads) :
+  m_uploadArena(pDevice, kInitialUploadArenaSize) {
+  ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+  NAME_D3D12_OBJECT(m_commandAllocator);
 
-    // Map the constant buffers and cache their heap pointers.
-    // We don't unmap this until the app closes. Keeping buffer mapped for the lifetime of the resource is okay.
-    const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-    ThrowIfFailed(m_constantBufferEquirectangularToCubemap->Map(0, &readRange, &m_pConstantBufferEquirectangularToCubemapWO));
-    ThrowIfFailed(m_constantBufferMVP->Map(0, &readRange, &m_pConstantBufferMVPWO));
-    ThrowIfFailed(m_constantBufferIrradianceConvolution->Map(0, &readRange, &m_pConstantBufferIrradianceConvolutionWO));
-    ThrowIfFailed(m_constantBufferPrefilter->Map(0, &readRange, &m_pConstantBufferPrefilterWO));
-    ThrowIfFailed(m_constantBufferLightStates->Map(0, &readRange, &m_pConstantBufferLightStatesWO));
+  // Create the command allocators and command lists of the recording threads.
+  {
+    m_workerCommandAllocators.resize(numWorkerThreads);
+    m_workerCommandLists.resize(numWorkerThreads);
+    for (UINT i = 0; i < numWorkerThreads; ++i) {
+      ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_workerCommandAllocators[i])));
+      NAME_D3D12_OBJECT_INDEXED(m_workerCommandAllocators, i);
+      ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_workerCommandAllocators[i].Get(), nullptr, IID_PPV_ARGS(&m_workerCommandLists[i])));
+      ThrowIfFailed(m_workerCommandLists[i]->Close());
+      NAME_D3D12_OBJECT_INDEXED(m_workerCommandLists, i);
+    }
   }
 }
 
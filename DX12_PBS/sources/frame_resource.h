@@ -1,6 +1,9 @@
 #pragma once
 
+#include <vector>
+
 #include "core/DXSampleHelper.h"
+#include "upload_arena.h"
 
 using namespace Microsoft::WRL;
 
@@ -8,23 +11,15 @@ class FrameResource {
 public:
   ComPtr<ID3D12CommandAllocator> m_commandAllocator;
 
-  ComPtr<ID3D12Resource> m_constantBufferEquirectangularToCubemap;
-  void* m_pConstantBufferEquirectangularToCubemapWO = nullptr;
-
-  ComPtr<ID3D12Resource> m_constantBufferMVP;
-  void* m_pConstantBufferMVPWO = nullptr;
-
-  ComPtr<ID3D12Resource> m_constantBufferIrradianceConvolution;
-  void* m_pConstantBufferIrradianceConvolutionWO = nullptr;
-
-  ComPtr<ID3D12Resource> m_constantBufferPrefilter;
-  void* m_pConstantBufferPrefilterWO = nullptr;
+  // One allocator and command list per recording thread.
+  std::vector<ComPtr<ID3D12CommandAllocator>> m_workerCommandAllocators;
+  std::vector<ComPtr<ID3D12GraphicsCommandList>> m_workerCommandLists;
 
-  ComPtr<ID3D12Resource> m_constantBufferLightStates;
-  void* m_pConstantBufferLightStatesWO = nullptr;
+  // Constants and dynamic data of the frame, reset once the GPU is done with it.
+  UploadArena m_uploadArena;
 
 public:
-  FrameResource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue);
+  FrameResource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT numWorkerThreads);
   ~FrameResource();
 
   FrameResource(const FrameResource&) = delete;
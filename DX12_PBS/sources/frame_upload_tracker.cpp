@@ -0,0 +1,80 @@
+#include "frame_upload_tracker.h"
+
+#include <algorithm>
+
+FrameUploadTracker::FrameUploadTracker(uint32_t frameCount) :
+  m_frames(frameCount) {
+}
+
+void FrameUploadTracker::MarkDirty(uint32_t index) {
+  for (Frame& frame : m_frames) {
+    // Consecutive edits usually touch neighbouring elements, so try to extend the last range first.
+    if (!frame.dirtyRanges.empty()) {
+      Range& last = frame.dirtyRanges.back();
+      if (index >= last.begin && index <= last.end) {
+        last.end = (std::max)(last.end, index + 1);
+        continue;
+      }
+    }
+    frame.dirtyRanges.push_back({ index, index + 1 });
+  }
+}
+
+void FrameUploadTracker::Reset() {
+  for (Frame& frame : m_frames) {
+    frame.dirtyRanges.clear();
+  }
+}
+
+bool FrameUploadTracker::FitCapacity(uint32_t frameIndex, uint32_t count) {
+  Frame& frame = m_frames[frameIndex];
+  const uint32_t capacity = GetCapacityForCount(count);
+  if (capacity <= frame.capacity && capacity * 4 > frame.capacity) {
+    return false;
+  }
+  frame.capacity = capacity;
+  frame.dirtyRanges.clear();
+  if (count > 0) {
+    frame.dirtyRanges.push_back({ 0, count });
+  }
+  return true;
+}
+
+void FrameUploadTracker::TakeDirtyRanges(uint32_t frameIndex, uint32_t count, std::vector<Range>* pRanges) {
+  std::vector<Range>& dirtyRanges = m_frames[frameIndex].dirtyRanges;
+  pRanges->clear();
+  if (dirtyRanges.empty()) {
+    return;
+  }
+
+  std::sort(dirtyRanges.begin(), dirtyRanges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+  // Merge overlapping and adjacent ranges, and drop what lies past the removed tail.
+  Range pending = dirtyRanges.front();
+  auto add = [count, pRanges](const Range& range) {
+    const uint32_t end = (std::min)(range.end, count);
+    if (range.begin < end) {
+      pRanges->push_back({ range.begin, end });
+    }
+  };
+  for (size_t i = 1; i < dirtyRanges.size(); ++i) {
+    const Range& range = dirtyRanges[i];
+    if (range.begin <= pending.end) {
+      pending.end = (std::max)(pending.end, range.end);
+    } else {
+      add(pending);
+      pending = range;
+    }
+  }
+  add(pending);
+
+  dirtyRanges.clear();
+}
+
+uint32_t FrameUploadTracker::GetCapacityForCount(uint32_t count) {
+  uint32_t capacity = kMinCapacity;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
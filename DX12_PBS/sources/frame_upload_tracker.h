@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Bookkeeping of the per-frame copies of a densely packed array, e.g. the light buffers of
+// LightManager. Like ShadowSchedule, it doesn't know about D3D12 objects; it only tracks, for each
+// frame resource, the capacity of its copy and the elements changed since it was last uploaded.
+class FrameUploadTracker {
+public:
+  static constexpr uint32_t kMinCapacity = 16;
+
+  // Elements [begin, end).
+  struct Range {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+  };
+
+  explicit FrameUploadTracker(uint32_t frameCount);
+
+  // The element changed, or another one was moved into its slot; every frame has to upload it.
+  void MarkDirty(uint32_t index);
+  // Forgets the changes, for when the array was emptied.
+  void Reset();
+
+  // Fits the frame's capacity to count elements: it doubles to grow, and shrinks once the elements
+  // fit in a quarter of it. Returns true if the capacity changed, so the frame's copy has to be
+  // created again; all its elements are dirty then.
+  bool FitCapacity(uint32_t frameIndex, uint32_t count);
+
+  uint32_t GetCapacity(uint32_t frameIndex) const {
+    return m_frames[frameIndex].capacity;
+  }
+
+  // The ranges of the frame to upload, sorted, with the overlapping and adjacent ones merged and
+  // nothing past count, the current size of the array. Forgets them.
+  void TakeDirtyRanges(uint32_t frameIndex, uint32_t count, std::vector<Range>* pRanges);
+
+  static uint32_t GetCapacityForCount(uint32_t count);
+
+private:
+  struct Frame {
+    uint32_t capacity = 0;
+    std::vector<Range> dirtyRanges;
+  };
+
+  std::vector<Frame> m_frames;
+};
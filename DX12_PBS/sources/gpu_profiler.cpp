@@ -0,0 +1,134 @@
+#include "gpu_profiler.h"
+
+#include <cstdio>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+constexpr uint32_t kTraceThreadId = 0;  // the CPU profiler's threads start at 1
+
+}  // namespace
+
+GpuProfiler::GpuProfiler(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT frameCount, UINT maxScopesPerFrame) :
+  m_maxScopesPerFrame(maxScopesPerFrame),
+  m_frames(frameCount),
+  m_statistics(kStatisticsWindow) {
+  const UINT queryCount = frameCount * maxScopesPerFrame * 2;
+  D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+  queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  queryHeapDesc.Count = queryCount;
+  ThrowIfFailed(pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)));
+  NAME_D3D12_OBJECT(m_queryHeap);
+
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+  const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT64) * queryCount);
+  ThrowIfFailed(pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+    D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readbackBuffer)));
+  NAME_D3D12_OBJECT(m_readbackBuffer);
+
+  UINT64 frequency = 0;
+  ThrowIfFailed(pCommandQueue->GetTimestampFrequency(&frequency));
+  m_ticksPerMicrosecond = frequency / 1000000.0;
+
+  UINT64 cpuCalibration = 0;
+  ThrowIfFailed(pCommandQueue->GetClockCalibration(&m_gpuCalibration, &cpuCalibration));
+  LARGE_INTEGER qpcFrequency;
+  QueryPerformanceFrequency(&qpcFrequency);
+  m_cpuCalibrationMicroseconds = cpuCalibration * 1000000.0 / qpcFrequency.QuadPart;
+}
+
+GpuProfiler::~GpuProfiler() {
+}
+
+void GpuProfiler::BeginFrame(UINT frameIndex) {
+  m_frameIndex = frameIndex;
+  Frame& frame = m_frames[frameIndex];
+  if (frame.resolved) {
+    ReadBack(frameIndex);
+  }
+  frame.scopeNames.clear();
+  frame.resolved = false;
+}
+
+GpuProfiler::ScopeId GpuProfiler::BeginScope(ID3D12GraphicsCommandList* pCommandList, const char* name) {
+  Frame& frame = m_frames[m_frameIndex];
+  if (frame.scopeNames.size() == m_maxScopesPerFrame) {
+    return kInvalidScope;
+  }
+  const ScopeId scope = static_cast<ScopeId>(frame.scopeNames.size());
+  frame.scopeNames.push_back(name);
+  pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetFirstQuery(m_frameIndex) + scope * 2);
+  return scope;
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* pCommandList, ScopeId scope) {
+  if (scope == kInvalidScope) {
+    return;
+  }
+  pCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetFirstQuery(m_frameIndex) + scope * 2 + 1);
+}
+
+void GpuProfiler::EndFrame(ID3D12GraphicsCommandList* pCommandList) {
+  Frame& frame = m_frames[m_frameIndex];
+  if (frame.scopeNames.empty()) {
+    return;
+  }
+  const UINT firstQuery = GetFirstQuery(m_frameIndex);
+  pCommandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery,
+    static_cast<UINT>(frame.scopeNames.size()) * 2, m_readbackBuffer.Get(), sizeof(UINT64) * firstQuery);
+  frame.resolved = true;
+}
+
+void GpuProfiler::ResetStatistics(size_t windowSize) {
+  m_statistics = TimingStatistics(windowSize);
+}
+
+void GpuProfiler::WriteCsv(std::ostream& stream) const {
+  m_statistics.WriteCsv(stream);
+}
+
+void GpuProfiler::GetTraceEvents(std::vector<TraceEvent>* pEvents, std::vector<std::pair<uint32_t, std::string>>* pThreadNames) const {
+  for (const std::vector<TraceEvent>& frameEvents : m_traceFrames) {
+    pEvents->insert(pEvents->end(), frameEvents.begin(), frameEvents.end());
+  }
+  pThreadNames->emplace_back(kTraceThreadId, "GPU direct queue");
+}
+
+void GpuProfiler::LogStatistics() const {
+  for (const TimingStatistics::Entry& entry : m_statistics.GetEntries()) {
+    char message[256];
+    sprintf_s(message, "gpu: %s: %.3f ms avg, %.3f min, %.3f max over %zu frames\n",
+      entry.name.c_str(), entry.average, entry.minimum, entry.maximum, entry.sampleCount);
+    OutputDebugStringA(message);
+  }
+}
+
+void GpuProfiler::ReadBack(UINT frameIndex) {
+  const Frame& frame = m_frames[frameIndex];
+  const SIZE_T firstByte = sizeof(UINT64) * GetFirstQuery(frameIndex);
+  const CD3DX12_RANGE readRange(firstByte, firstByte + sizeof(UINT64) * frame.scopeNames.size() * 2);
+  UINT8* pData = nullptr;
+  ThrowIfFailed(m_readbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+  const UINT64* pTimestamps = reinterpret_cast<const UINT64*>(pData + firstByte);
+
+  std::vector<TraceEvent> events;
+  events.reserve(frame.scopeNames.size());
+  for (size_t i = 0; i < frame.scopeNames.size(); ++i) {
+    const UINT64 begin = pTimestamps[i * 2];
+    const UINT64 end = pTimestamps[i * 2 + 1];
+    const double durationMicroseconds = end > begin ? (end - begin) / m_ticksPerMicrosecond : 0.0;
+    m_statistics.Add(frame.scopeNames[i], durationMicroseconds / 1000.0);
+    const double startMicroseconds = m_cpuCalibrationMicroseconds +
+      (static_cast<double>(begin) - static_cast<double>(m_gpuCalibration)) / m_ticksPerMicrosecond;
+    events.push_back({ frame.scopeNames[i], "gpu", kTraceThreadId, startMicroseconds, durationMicroseconds });
+  }
+
+  const CD3DX12_RANGE writeRange(0, 0);
+  m_readbackBuffer->Unmap(0, &writeRange);
+
+  m_traceFrames.push_back(std::move(events));
+  if (m_traceFrames.size() > kTraceFrames) {
+    m_traceFrames.pop_front();
+  }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "profiler_output.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Times scopes of the GPU work with timestamp queries, cheap enough to stay on.
+// Every frame in flight has its own range of a query heap and of a readback buffer. EndFrame resolves
+// the frame's timestamps into its range of the readback buffer, and BeginFrame reads them back once the
+// frame resource is reused, so the GPU is done with them and nothing stalls. The times go into rolling
+// statistics, and the last kTraceFrames frames are kept for a Chrome trace on the CPU timeline.
+// A scope may start and end in different command lists of the same queue. Not thread safe: scopes are
+// recorded by the thread that records the frame.
+class GpuProfiler {
+public:
+  using ScopeId = UINT;
+  static constexpr ScopeId kInvalidScope = UINT_MAX;
+
+  // pCommandQueue: the direct queue the timed command lists are executed on.
+  GpuProfiler(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT frameCount, UINT maxScopesPerFrame);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  // Once the GPU is done with the frame that last used frameIndex.
+  void BeginFrame(UINT frameIndex);
+  // name: a literal. Returns kInvalidScope, and times nothing, once the frame has maxScopesPerFrame.
+  ScopeId BeginScope(ID3D12GraphicsCommandList* pCommandList, const char* name);
+  void EndScope(ID3D12GraphicsCommandList* pCommandList, ScopeId scope);
+  // Into the last command list of the frame.
+  void EndFrame(ID3D12GraphicsCommandList* pCommandList);
+
+  const TimingStatistics& GetStatistics() const {
+    return m_statistics;
+  }
+  // Drops the samples so far; the statistics are over the last windowSize frames from now on.
+  void ResetStatistics(size_t windowSize);
+  void WriteCsv(std::ostream& stream) const;
+  // Appends the events of the last kTraceFrames frames, and the name of the queue's thread.
+  void GetTraceEvents(std::vector<TraceEvent>* pEvents, std::vector<std::pair<uint32_t, std::string>>* pThreadNames) const;
+  // Logs the statistics to the debugger.
+  void LogStatistics() const;
+
+private:
+  static constexpr size_t kStatisticsWindow = 120;  // frames
+  static constexpr size_t kTraceFrames = 300;
+
+  struct Frame {
+    std::vector<const char*> scopeNames;  // scope i has the queries 2 * i and 2 * i + 1 of the frame's range
+    bool resolved = false;
+  };
+
+  UINT GetFirstQuery(UINT frameIndex) const {
+    return frameIndex * m_maxScopesPerFrame * 2;
+  }
+  void ReadBack(UINT frameIndex);
+
+  ComPtr<ID3D12QueryHeap> m_queryHeap;
+  ComPtr<ID3D12Resource> m_readbackBuffer;
+  UINT m_maxScopesPerFrame = 0;
+  double m_ticksPerMicrosecond = 0.0;
+  // A GPU timestamp and the QueryPerformanceCounter of the same moment, to put the GPU scopes on the CPU timeline.
+  UINT64 m_gpuCalibration = 0;
+  double m_cpuCalibrationMicroseconds = 0.0;
+
+  std::vector<Frame> m_frames;
+  UINT m_frameIndex = 0;
+  TimingStatistics m_statistics;
+  std::deque<std::vector<TraceEvent>> m_traceFrames;
+};
+
+// Times the GPU work recorded into pCommandList until the end of the C++ scope.
+class GpuProfileScope {
+public:
+  GpuProfileScope(GpuProfiler* pProfiler, ID3D12GraphicsCommandList* pCommandList, const char* name) :
+    m_pProfiler(pProfiler),
+    m_pCommandList(pCommandList),
+    m_scope(pProfiler->BeginScope(pCommandList, name)) {
+  }
+  ~GpuProfileScope() {
+    m_pProfiler->EndScope(m_pCommandList, m_scope);
+  }
+
+  GpuProfileScope(const GpuProfileScope&) = delete;
+  GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+  GpuProfiler* m_pProfiler;
+  ID3D12GraphicsCommandList* m_pCommandList;
+  GpuProfiler::ScopeId m_scope;
+};
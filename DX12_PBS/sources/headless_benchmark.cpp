@@ -0,0 +1,144 @@
+#include "headless_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Nearest rank: the smallest sample that at least fraction of the samples are not above.
+double Percentile(const std::vector<double>& sortedSamples, double fraction) {
+  const size_t rank = static_cast<size_t>(std::ceil(fraction * sortedSamples.size()));
+  return sortedSamples[(std::max)(rank, static_cast<size_t>(1)) - 1];
+}
+
+void WriteMilliseconds(std::ostream& stream, const char* name, double milliseconds) {
+  char value[64];
+  snprintf(value, sizeof(value), "%.4f", milliseconds);
+  WriteJsonString(stream, name);
+  stream << ':' << value;
+}
+
+}  // namespace
+
+HeadlessBenchmark::HeadlessBenchmark(std::vector<std::string> scenarioNames, uint32_t warmupFrames, uint32_t measuredFrames, uint32_t gpuLatencyFrames) :
+  m_warmupFrames(warmupFrames),
+  m_measuredFrames((std::max)(measuredFrames, 1u)),
+  // At least one, so that the GPU measurement doesn't start in the scenario's first frame.
+  m_gpuLatencyFrames((std::max)(gpuLatencyFrames, 1u)) {
+  for (std::string& name : scenarioNames) {
+    Scenario scenario;
+    scenario.name = std::move(name);
+    scenario.frameTimes.reserve(m_measuredFrames);
+    m_scenarios.push_back(std::move(scenario));
+  }
+}
+
+HeadlessBenchmark::Step HeadlessBenchmark::Tick(double elapsedSeconds) {
+  if (m_currentScenario == m_scenarios.size()) {
+    return Step::kFinished;
+  }
+  if (!m_started) {
+    m_started = true;
+    return Step::kStartScenario;
+  }
+
+  // elapsedSeconds is the duration of the previous frame.
+  const uint32_t previousFrame = m_frameInScenario;
+  if (previousFrame >= m_warmupFrames && previousFrame < m_warmupFrames + m_measuredFrames) {
+    m_scenarios[m_currentScenario].frameTimes.push_back(elapsedSeconds * 1000.0);
+  }
+
+  ++m_frameInScenario;
+  if (m_frameInScenario == GetFramesPerScenario()) {
+    m_frameInScenario = 0;
+    ++m_currentScenario;
+    return m_currentScenario == m_scenarios.size() ? Step::kFinished : Step::kStartScenario;
+  }
+  if (m_frameInScenario == m_warmupFrames + m_gpuLatencyFrames) {
+    return Step::kStartGpuMeasurement;
+  }
+  if (m_frameInScenario == m_warmupFrames + m_measuredFrames + m_gpuLatencyFrames) {
+    return Step::kEndGpuMeasurement;
+  }
+  return Step::kFrame;
+}
+
+void HeadlessBenchmark::AddStartupPhase(const std::string& name, double milliseconds) {
+  m_startupPhases.emplace_back(name, milliseconds);
+}
+
+void HeadlessBenchmark::SetGpuPassTimes(std::vector<TimingStatistics::Entry> entries) {
+  m_scenarios[m_currentScenario].gpuPassTimes = std::move(entries);
+}
+
+void HeadlessBenchmark::WriteJson(std::ostream& stream) const {
+  stream << "{\n\"warmup_frames\":" << m_warmupFrames << ",\n\"measured_frames\":" << m_measuredFrames;
+
+  stream << ",\n\"startup_ms\":{";
+  for (size_t i = 0; i < m_startupPhases.size(); ++i) {
+    stream << (i == 0 ? "" : ",");
+    WriteMilliseconds(stream, m_startupPhases[i].first.c_str(), m_startupPhases[i].second);
+  }
+  stream << '}';
+
+  stream << ",\n\"scenarios\":[";
+  for (size_t i = 0; i < m_scenarios.size(); ++i) {
+    const Scenario& scenario = m_scenarios[i];
+    stream << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    WriteJsonString(stream, scenario.name.c_str());
+
+    const FrameTimeSummary summary = Summarize(scenario.frameTimes);
+    stream << ",\"frame_ms\":{";
+    WriteMilliseconds(stream, "avg", summary.average);
+    stream << ',';
+    WriteMilliseconds(stream, "min", summary.minimum);
+    stream << ',';
+    WriteMilliseconds(stream, "p50", summary.median);
+    stream << ',';
+    WriteMilliseconds(stream, "p90", summary.percentile90);
+    stream << ',';
+    WriteMilliseconds(stream, "p95", summary.percentile95);
+    stream << ',';
+    WriteMilliseconds(stream, "p99", summary.percentile99);
+    stream << ',';
+    WriteMilliseconds(stream, "max", summary.maximum);
+    stream << '}';
+
+    stream << ",\"gpu_ms\":{";
+    for (size_t j = 0; j < scenario.gpuPassTimes.size(); ++j) {
+      const TimingStatistics::Entry& entry = scenario.gpuPassTimes[j];
+      stream << (j == 0 ? "" : ",");
+      WriteJsonString(stream, entry.name.c_str());
+      stream << ":{";
+      WriteMilliseconds(stream, "avg", entry.average);
+      stream << ',';
+      WriteMilliseconds(stream, "min", entry.minimum);
+      stream << ',';
+      WriteMilliseconds(stream, "max", entry.maximum);
+      stream << ",\"samples\":" << entry.sampleCount << '}';
+    }
+    stream << "}}";
+  }
+  stream << "\n]\n}\n";
+}
+
+HeadlessBenchmark::FrameTimeSummary HeadlessBenchmark::Summarize(std::vector<double> frameTimes) {
+  FrameTimeSummary summary;
+  if (frameTimes.empty()) {
+    return summary;
+  }
+  std::sort(frameTimes.begin(), frameTimes.end());
+  double sum = 0.0;
+  for (double frameTime : frameTimes) {
+    sum += frameTime;
+  }
+  summary.average = sum / frameTimes.size();
+  summary.minimum = frameTimes.front();
+  summary.median = Percentile(frameTimes, 0.5);
+  summary.percentile90 = Percentile(frameTimes, 0.9);
+  summary.percentile95 = Percentile(frameTimes, 0.95);
+  summary.percentile99 = Percentile(frameTimes, 0.99);
+  summary.maximum = frameTimes.back();
+  return summary;
+}
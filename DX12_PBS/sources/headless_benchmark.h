@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "profiler_output.h"
+
+// Schedules the frames of a headless benchmark run and collects its results. Portable, like
+// TimingStatistics: the sample renders the frames and measures them, this decides what they are for.
+// Every scenario renders warmupFrames, then measuredFrames whose CPU frame times are kept, then the
+// frames it takes the GPU profiler to read the measured frames back. The GPU pass times are taken over
+// exactly the measured frames: the caller restarts the GPU statistics on kStartGpuMeasurement and hands
+// them over on kEndGpuMeasurement.
+class HeadlessBenchmark {
+public:
+  enum class Step {
+    kStartScenario,  // apply GetCurrentScenario before rendering the frame
+    kFrame,
+    kStartGpuMeasurement,  // the GPU profiler reads back the first measured frame in this frame
+    kEndGpuMeasurement,  // the GPU profiler has read back the last measured frame
+    kFinished,  // nothing left to render
+  };
+
+  // gpuLatencyFrames: how many frames after its own the GPU profiler reads a frame back.
+  HeadlessBenchmark(std::vector<std::string> scenarioNames, uint32_t warmupFrames, uint32_t measuredFrames, uint32_t gpuLatencyFrames);
+
+  HeadlessBenchmark(const HeadlessBenchmark&) = delete;
+  HeadlessBenchmark& operator=(const HeadlessBenchmark&) = delete;
+
+  // Call at the start of every frame once the scene is loaded, with the time since the previous frame started.
+  Step Tick(double elapsedSeconds);
+
+  size_t GetCurrentScenario() const {
+    return m_currentScenario;
+  }
+  // Frames rendered in the current scenario before this one, for the camera path.
+  uint32_t GetFrameInScenario() const {
+    return m_frameInScenario;
+  }
+  uint32_t GetFramesPerScenario() const {
+    return m_warmupFrames + m_measuredFrames + m_gpuLatencyFrames + 1;
+  }
+  uint32_t GetMeasuredFrames() const {
+    return m_measuredFrames;
+  }
+
+  void AddStartupPhase(const std::string& name, double milliseconds);
+  // On kEndGpuMeasurement.
+  void SetGpuPassTimes(std::vector<TimingStatistics::Entry> entries);
+
+  // The startup phases, and the frame time percentiles and GPU pass times of every scenario.
+  void WriteJson(std::ostream& stream) const;
+
+private:
+  struct FrameTimeSummary {
+    double average = 0.0;  // in milliseconds
+    double minimum = 0.0;
+    double median = 0.0;
+    double percentile90 = 0.0;
+    double percentile95 = 0.0;
+    double percentile99 = 0.0;
+    double maximum = 0.0;
+  };
+
+  struct Scenario {
+    std::string name;
+    std::vector<double> frameTimes;  // in milliseconds
+    std::vector<TimingStatistics::Entry> gpuPassTimes;
+  };
+
+  static FrameTimeSummary Summarize(std::vector<double> frameTimes);
+
+  uint32_t m_warmupFrames = 0;
+  uint32_t m_measuredFrames = 0;
+  uint32_t m_gpuLatencyFrames = 0;
+  std::vector<Scenario> m_scenarios;
+  std::vector<std::pair<std::string, double>> m_startupPhases;  // in milliseconds
+  size_t m_currentScenario = 0;
+  uint32_t m_frameInScenario = 0;
+  bool m_started = false;
+};
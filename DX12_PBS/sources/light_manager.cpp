@@ -0,0 +1,199 @@
+#include "light_manager.h"
+
+#include <algorithm>
+
+#include "core/DXSampleHelper.h"
+
+LightManager::LightManager(UINT frameCount, float luminanceThreshold) :
+  m_luminanceThreshold(luminanceThreshold),
+  m_frameBuffers(frameCount),
+  m_uploads(frameCount) {
+}
+
+LightManager::~LightManager() {
+  for (auto& frameBuffer : m_frameBuffers) {
+    if (frameBuffer.buffer) {
+      frameBuffer.buffer->Unmap(0, nullptr);
+      frameBuffer.visibleLightIndexBuffer->Unmap(0, nullptr);
+    }
+  }
+}
+
+void LightManager::CreateResources(ID3D12Device* pDevice) {
+  m_device = pDevice;
+  for (UINT i = 0; i < m_frameBuffers.size(); ++i) {
+    m_uploads.FitCapacity(i, GetLightCount());
+    CreateFrameBuffer(m_frameBuffers[i], m_uploads.GetCapacity(i));
+  }
+}
+
+LightManager::LightId LightManager::AddLight(const LightState& light) {
+  LightId lightId = kInvalidLightId;
+  if (!m_freeLightIds.empty()) {
+    lightId = m_freeLightIds.back();
+    m_freeLightIds.pop_back();
+  } else {
+    lightId = static_cast<LightId>(m_lightIndices.size());
+    m_lightIndices.emplace_back(kInvalidIndex);
+  }
+
+  const UINT index = GetLightCount();
+  m_lights.emplace_back(light);
+  m_lights.back().radius = ComputeLightRadius(light.color, m_luminanceThreshold);
+  m_lightIds.emplace_back(lightId);
+  m_lightIndices[lightId] = index;
+  m_uploads.MarkDirty(index);
+
+  return lightId;
+}
+
+void LightManager::RemoveLight(LightId lightId) {
+  const UINT index = m_lightIndices[lightId];
+  const UINT lastIndex = GetLightCount() - 1;
+
+  // Move the last light into the hole to keep the array dense.
+  if (index != lastIndex) {
+    m_lights[index] = m_lights[lastIndex];
+    m_lightIds[index] = m_lightIds[lastIndex];
+    m_lightIndices[m_lightIds[index]] = index;
+    m_uploads.MarkDirty(index);
+  }
+  m_lights.pop_back();
+  m_lightIds.pop_back();
+  m_lightIndices[lightId] = kInvalidIndex;
+  m_freeLightIds.emplace_back(lightId);
+}
+
+void LightManager::RemoveAllLights() {
+  m_lights.clear();
+  m_lightIds.clear();
+  m_lightIndices.clear();
+  m_freeLightIds.clear();
+  m_visibleLightIndices.clear();
+  m_uploads.Reset();
+}
+
+void LightManager::SetLightPosition(LightId lightId, float posX, float posY, float posZ) {
+  const UINT index = m_lightIndices[lightId];
+  LightState& light = m_lights[index];
+  light.position[0] = posX, light.position[1] = posY, light.position[2] = posZ;
+  m_uploads.MarkDirty(index);
+}
+
+void LightManager::SetLightColor(LightId lightId, float colorR, float colorG, float colorB) {
+  const UINT index = m_lightIndices[lightId];
+  LightState& light = m_lights[index];
+  light.color[0] = colorR, light.color[1] = colorG, light.color[2] = colorB;
+  light.radius = ComputeLightRadius(light.color, m_luminanceThreshold);
+  m_uploads.MarkDirty(index);
+}
+
+const LightState& LightManager::GetLight(LightId lightId) const {
+  return m_lights[m_lightIndices[lightId]];
+}
+
+void LightManager::CullLights(FXMMATRIX viewProjection, const LightReceiverBounds* pReceivers, UINT numReceivers) {
+  // Frustum planes of a row-vector view projection matrix, pointing inwards (Gribb/Hartmann).
+  // The depth range is [0, 1], so the near plane is the third column alone.
+  const XMMATRIX columns = XMMatrixTranspose(viewProjection);
+  const XMVECTOR planes[6] = {
+    XMPlaneNormalize(XMVectorAdd(columns.r[3], columns.r[0])),
+    XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[0])),
+    XMPlaneNormalize(XMVectorAdd(columns.r[3], columns.r[1])),
+    XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[1])),
+    XMPlaneNormalize(columns.r[2]),
+    XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[2])),
+  };
+
+  m_visibleLightIndices.clear();
+  for (UINT i = 0; i < GetLightCount(); ++i) {
+    const LightState& light = m_lights[i];
+    const XMVECTOR center = XMVectorSet(light.position[0], light.position[1], light.position[2], 1.0f);
+
+    bool visible = true;
+    for (const XMVECTOR& plane : planes) {
+      if (XMVectorGetX(XMPlaneDotCoord(plane, center)) < -light.radius) {
+        visible = false;
+        break;
+      }
+    }
+    if (!visible) {
+      continue;
+    }
+
+    visible = false;
+    for (UINT j = 0; j < numReceivers; ++j) {
+      if (pReceivers[j].IntersectsSphere(light.position, light.radius)) {
+        visible = true;
+        break;
+      }
+    }
+    if (visible) {
+      m_visibleLightIndices.emplace_back(i);
+    }
+  }
+}
+
+float LightManager::ComputeLightRadius(const float color[3], float luminanceThreshold) {
+  const float luminance = 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+  return std::sqrt((std::max)(luminance, 0.0f) / luminanceThreshold);
+}
+
+void LightManager::Commit(UINT frameIndex) {
+  FrameLightBuffer& frameBuffer = m_frameBuffers[frameIndex];
+  const UINT lightCount = GetLightCount();
+  m_lastCommitSize = 0;
+
+  // Grow to fit, or shrink once the buffer is mostly unused; both need a full upload.
+  if (m_uploads.FitCapacity(frameIndex, lightCount)) {
+    CreateFrameBuffer(frameBuffer, m_uploads.GetCapacity(frameIndex));
+  }
+
+  // The visible set changes with the camera, and is small, so it is uploaded every frame.
+  if (!m_visibleLightIndices.empty()) {
+    const size_t size = sizeof(UINT) * m_visibleLightIndices.size();
+    memcpy(frameBuffer.pVisibleLightIndexBufferWO, m_visibleLightIndices.data(), size);
+    m_lastCommitSize += size;
+  }
+
+  m_uploads.TakeDirtyRanges(frameIndex, lightCount, &m_uploadRanges);
+  for (const FrameUploadTracker::Range& range : m_uploadRanges) {
+    const size_t size = sizeof(LightState) * (range.end - range.begin);
+    memcpy(frameBuffer.pBufferWO + range.begin, m_lights.data() + range.begin, size);
+    m_lastCommitSize += size;
+  }
+}
+
+void LightManager::CreateFrameBuffer(FrameLightBuffer& frameBuffer, UINT capacity) {
+  if (frameBuffer.buffer) {
+    frameBuffer.buffer->Unmap(0, nullptr);
+    frameBuffer.visibleLightIndexBuffer->Unmap(0, nullptr);
+  }
+
+  D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(LightState) * capacity);
+  ThrowIfFailed(m_device->CreateCommittedResource(
+    &heapProperty,
+    D3D12_HEAP_FLAG_NONE,
+    &resourceDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&frameBuffer.buffer)));
+  NAME_D3D12_OBJECT(frameBuffer.buffer);
+
+  // At most every light is visible, so the index buffer shares the capacity.
+  resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT) * capacity);
+  ThrowIfFailed(m_device->CreateCommittedResource(
+    &heapProperty,
+    D3D12_HEAP_FLAG_NONE,
+    &resourceDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&frameBuffer.visibleLightIndexBuffer)));
+  NAME_D3D12_OBJECT(frameBuffer.visibleLightIndexBuffer);
+
+  // We don't unmap these until the buffers are replaced. Keeping buffer mapped for the lifetime of the resource is okay.
+  const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+  ThrowIfFailed(frameBuffer.buffer->Map(0, &readRange, reinterpret_cast<void**>(&frameBuffer.pBufferWO)));
+  ThrowIfFailed(frameBuffer.visibleLightIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&frameBuffer.pVisibleLightIndexBufferWO)));
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "frame_upload_tracker.h"
+#include "sample_assets.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Axis aligned bounds of geometry that receives light.
+struct LightReceiverBounds {
+  XMFLOAT3 min;
+  XMFLOAT3 max;
+
+  bool IntersectsSphere(const float center[3], float radius) const {
+    const float dx = (std::max)((std::max)(min.x - center[0], 0.0f), center[0] - max.x);
+    const float dy = (std::max)((std::max)(min.y - center[1], 0.0f), center[1] - max.y);
+    const float dz = (std::max)((std::max)(min.z - center[2], 0.0f), center[2] - max.z);
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+  }
+};
+
+// Owns the scene lights and their per-frame GPU copies.
+// Lights are kept densely packed. Every change is recorded as a dirty range for each frame resource by
+// a FrameUploadTracker, and Commit only copies those ranges into the frame's structured buffer once the
+// GPU is done with it.
+// CullLights selects the lights the shaders loop over; their indices are uploaded next to the lights.
+class LightManager {
+public:
+  using LightId = UINT;
+  static constexpr LightId kInvalidLightId = UINT_MAX;
+
+  // Lights are cut off where their luminance drops below luminanceThreshold.
+  LightManager(UINT frameCount, float luminanceThreshold);
+  ~LightManager();
+
+  LightManager(const LightManager&) = delete;
+  LightManager& operator=(const LightManager&) = delete;
+
+  void CreateResources(ID3D12Device* pDevice);
+
+  LightId AddLight(const LightState& light);
+  void RemoveLight(LightId lightId);
+  void RemoveAllLights();
+  void SetLightPosition(LightId lightId, float posX, float posY, float posZ);
+  void SetLightColor(LightId lightId, float colorR, float colorG, float colorB);
+  const LightState& GetLight(LightId lightId) const;
+
+  UINT GetLightCount() const {
+    return static_cast<UINT>(m_lights.size());
+  }
+
+  // Keeps the lights whose sphere of influence intersects the view frustum and at least one of the receivers.
+  void CullLights(FXMMATRIX viewProjection, const LightReceiverBounds* pReceivers, UINT numReceivers);
+
+  UINT GetVisibleLightCount() const {
+    return static_cast<UINT>(m_visibleLightIndices.size());
+  }
+
+  // Distance at which the inverse-square falloff of color drops below luminanceThreshold.
+  static float ComputeLightRadius(const float color[3], float luminanceThreshold);
+
+  // Uploads the lights changed since the frame resource was last committed.
+  // Must only be called once the GPU has finished with the frame.
+  void Commit(UINT frameIndex);
+
+  D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress(UINT frameIndex) const {
+    return m_frameBuffers[frameIndex].buffer->GetGPUVirtualAddress();
+  }
+
+  D3D12_GPU_VIRTUAL_ADDRESS GetVisibleLightIndicesGPUVirtualAddress(UINT frameIndex) const {
+    return m_frameBuffers[frameIndex].visibleLightIndexBuffer->GetGPUVirtualAddress();
+  }
+
+  // Bytes written by the last Commit, for bandwidth statistics.
+  UINT64 GetLastCommitSize() const {
+    return m_lastCommitSize;
+  }
+
+private:
+  static constexpr UINT kInvalidIndex = UINT_MAX;
+
+  struct FrameLightBuffer {
+    ComPtr<ID3D12Resource> buffer;
+    LightState* pBufferWO = nullptr;
+    ComPtr<ID3D12Resource> visibleLightIndexBuffer;
+    UINT* pVisibleLightIndexBufferWO = nullptr;
+  };
+
+  void CreateFrameBuffer(FrameLightBuffer& frameBuffer, UINT capacity);
+
+  ComPtr<ID3D12Device> m_device;
+  float m_luminanceThreshold = 0.0f;
+
+  std::vector<LightState> m_lights;
+  std::vector<LightId> m_lightIds;      // index in m_lights -> id
+  std::vector<UINT> m_lightIndices;     // id -> index in m_lights
+  std::vector<LightId> m_freeLightIds;
+  std::vector<UINT> m_visibleLightIndices;
+
+  std::vector<FrameLightBuffer> m_frameBuffers;
+  FrameUploadTracker m_uploads;
+  std::vector<FrameUploadTracker::Range> m_uploadRanges;
+  UINT64 m_lastCommitSize = 0;
+};
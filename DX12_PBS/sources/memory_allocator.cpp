@@ -0,0 +1,78 @@
+#include "memory_allocator.h"
+
+#include <algorithm>
+
+BuddyAllocator::BuddyAllocator(uint64_t capacity, uint64_t minBlockSize) :
+  m_capacity(capacity),
+  m_minBlockSize(minBlockSize) {
+  uint32_t maxOrder = 0;
+  while (GetBlockSize(maxOrder) < capacity) {
+    ++maxOrder;
+  }
+  m_freeBlocks.resize(maxOrder + 1);
+  m_freeBlocks[maxOrder].insert(0);
+}
+
+uint64_t BuddyAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  const uint64_t minSize = (std::max)(size, alignment);
+  if (size == 0 || minSize > m_capacity) {
+    return kInvalidOffset;
+  }
+  uint32_t order = 0;
+  while (GetBlockSize(order) < minSize) {
+    ++order;
+  }
+
+  // The smallest free block that is large enough, split until it has the size needed. Taking the
+  // lowest offset keeps the allocations packed at the start, and the free memory at the end.
+  uint32_t freeOrder = order;
+  while (freeOrder < m_freeBlocks.size() && m_freeBlocks[freeOrder].empty()) {
+    ++freeOrder;
+  }
+  if (freeOrder == m_freeBlocks.size()) {
+    return kInvalidOffset;
+  }
+  const uint64_t offset = *m_freeBlocks[freeOrder].begin();
+  m_freeBlocks[freeOrder].erase(m_freeBlocks[freeOrder].begin());
+  while (freeOrder > order) {
+    --freeOrder;
+    m_freeBlocks[freeOrder].insert(offset + GetBlockSize(freeOrder));
+  }
+
+  m_allocations[offset] = { order, size };
+  m_usedSize += GetBlockSize(order);
+  m_requestedSize += size;
+  return offset;
+}
+
+void BuddyAllocator::Free(uint64_t offset) {
+  auto allocation = m_allocations.find(offset);
+  if (allocation == m_allocations.end()) {
+    return;
+  }
+  uint32_t order = allocation->second.order;
+  m_usedSize -= GetBlockSize(order);
+  m_requestedSize -= allocation->second.requestedSize;
+  m_allocations.erase(allocation);
+
+  while (order + 1 < m_freeBlocks.size()) {
+    const uint64_t buddy = offset ^ GetBlockSize(order);
+    auto freeBuddy = m_freeBlocks[order].find(buddy);
+    if (freeBuddy == m_freeBlocks[order].end()) {
+      break;
+    }
+    m_freeBlocks[order].erase(freeBuddy);
+    offset = (std::min)(offset, buddy);
+    ++order;
+  }
+  m_freeBlocks[order].insert(offset);
+}
+
+uint64_t BuddyAllocator::GetLargestFreeBlock() const {
+  for (size_t order = m_freeBlocks.size(); order > 0; --order) {
+    if (!m_freeBlocks[order - 1].empty()) {
+      return GetBlockSize(static_cast<uint32_t>(order - 1));
+    }
+  }
+  return 0;
+}
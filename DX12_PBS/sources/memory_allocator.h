@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Bookkeeping of the memory of a heap. Like DescriptorFreeList, it only deals with offsets and
+// doesn't know about D3D12 objects; ResourceAllocator puts it on top of ID3D12Heaps.
+
+// Buddy allocation of [0, capacity): a block is the minimum block size times a power of two and is
+// aligned to its size, so any alignment up to the block size comes for free. A freed block merges
+// with its buddy, the other half of the block it was split from, whenever that one is free too.
+// capacity must be the minimum block size times a power of two.
+class BuddyAllocator {
+public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  BuddyAllocator(uint64_t capacity, uint64_t minBlockSize);
+
+  // Returns kInvalidOffset if no free block is large enough.
+  uint64_t Allocate(uint64_t size, uint64_t alignment);
+  void Free(uint64_t offset);
+
+  uint64_t GetCapacity() const {
+    return m_capacity;
+  }
+
+  // Of the blocks, including what rounding the sizes up to one wasted.
+  uint64_t GetUsedSize() const {
+    return m_usedSize;
+  }
+
+  // What the allocations asked for.
+  uint64_t GetRequestedSize() const {
+    return m_requestedSize;
+  }
+
+  uint32_t GetAllocationCount() const {
+    return static_cast<uint32_t>(m_allocations.size());
+  }
+
+  // The largest allocation that would succeed; less than the free size when the free memory is fragmented.
+  uint64_t GetLargestFreeBlock() const;
+
+private:
+  struct Block {
+    uint32_t order;
+    uint64_t requestedSize;
+  };
+
+  uint64_t GetBlockSize(uint32_t order) const {
+    return m_minBlockSize << order;
+  }
+
+  uint64_t m_capacity = 0;
+  uint64_t m_minBlockSize = 0;
+  std::vector<std::set<uint64_t>> m_freeBlocks;  // offsets, by order
+  std::unordered_map<uint64_t, Block> m_allocations;  // by offset
+  uint64_t m_usedSize = 0;
+  uint64_t m_requestedSize = 0;
+};
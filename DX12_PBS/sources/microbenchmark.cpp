@@ -0,0 +1,136 @@
+#include "microbenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+#include "cpu_profiler.h"
+
+namespace {
+
+constexpr const char* kCsvHeader = "name,items_per_iteration,samples,mean_ns,stddev_ns,median_ns,min_ns,items_per_second";
+
+std::atomic<const void*> g_keepAlive;
+
+}  // namespace
+
+MicroBenchmark::MicroBenchmark(size_t sampleCount, int64_t minSampleNanoseconds) :
+  // Two samples at least, for a standard deviation.
+  m_sampleCount((std::max)(sampleCount, static_cast<size_t>(2))),
+  m_minSampleNanoseconds(minSampleNanoseconds) {
+}
+
+void MicroBenchmark::Run(const std::string& name, uint64_t itemsPerIteration, const std::function<void()>& kernel) {
+  const auto runBatch = [&kernel](uint64_t iterations) {
+    const int64_t start = CpuProfiler::Now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+      kernel();
+    }
+    return CpuProfiler::Now() - start;
+  };
+
+  // Doubling the batch until it is long enough also warms the caches and the allocator up.
+  uint64_t iterations = 1;
+  while (runBatch(iterations) < m_minSampleNanoseconds) {
+    iterations *= 2;
+  }
+
+  std::vector<double> samples;
+  samples.reserve(m_sampleCount);
+  for (size_t i = 0; i < m_sampleCount; ++i) {
+    samples.push_back(static_cast<double>(runBatch(iterations)) / iterations);
+  }
+
+  Result result;
+  result.name = name;
+  result.itemsPerIteration = itemsPerIteration;
+  result.sampleCount = samples.size();
+  double sum = 0.0;
+  for (double sample : samples) {
+    sum += sample;
+  }
+  result.mean = sum / samples.size();
+  double squaredDeviations = 0.0;
+  for (double sample : samples) {
+    squaredDeviations += (sample - result.mean) * (sample - result.mean);
+  }
+  result.standardDeviation = std::sqrt(squaredDeviations / (samples.size() - 1));
+  std::sort(samples.begin(), samples.end());
+  result.median = samples.size() % 2 == 1 ? samples[samples.size() / 2] :
+    (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0;
+  result.minimum = samples.front();
+  m_results.push_back(result);
+}
+
+void MicroBenchmark::WriteCsv(std::ostream& stream) const {
+  stream << kCsvHeader << '\n';
+  for (const Result& result : m_results) {
+    char row[256];
+    snprintf(row, sizeof(row), "%s,%llu,%zu,%.3f,%.3f,%.3f,%.3f,%.1f\n", result.name.c_str(),
+      static_cast<unsigned long long>(result.itemsPerIteration), result.sampleCount, result.mean,
+      result.standardDeviation, result.median, result.minimum, result.GetItemsPerSecond());
+    stream << row;
+  }
+}
+
+bool MicroBenchmark::ReadCsv(std::istream& stream, std::vector<Result>* pResults) {
+  std::string line;
+  if (!std::getline(stream, line) || line != kCsvHeader) {
+    return false;
+  }
+  while (std::getline(stream, line)) {
+    std::istringstream fields(line);
+    Result result;
+    std::string itemsPerIteration, sampleCount, mean, standardDeviation, median, minimum;
+    if (!std::getline(fields, result.name, ',') || !std::getline(fields, itemsPerIteration, ',') ||
+      !std::getline(fields, sampleCount, ',') || !std::getline(fields, mean, ',') ||
+      !std::getline(fields, standardDeviation, ',') || !std::getline(fields, median, ',') ||
+      !std::getline(fields, minimum, ',')) {
+      continue;
+    }
+    // The items per second are derived, so they aren't read back.
+    result.itemsPerIteration = std::strtoull(itemsPerIteration.c_str(), nullptr, 10);
+    result.sampleCount = static_cast<size_t>(std::strtoull(sampleCount.c_str(), nullptr, 10));
+    result.mean = std::strtod(mean.c_str(), nullptr);
+    result.standardDeviation = std::strtod(standardDeviation.c_str(), nullptr);
+    result.median = std::strtod(median.c_str(), nullptr);
+    result.minimum = std::strtod(minimum.c_str(), nullptr);
+    pResults->push_back(result);
+  }
+  return true;
+}
+
+std::vector<MicroBenchmark::Comparison> MicroBenchmark::Compare(const std::vector<Result>& baseline) const {
+  std::vector<Comparison> comparisons;
+  for (const Result& result : m_results) {
+    const auto baselineResult = std::find_if(baseline.begin(), baseline.end(),
+      [&result](const Result& candidate) { return candidate.name == result.name; });
+    if (baselineResult == baseline.end() || baselineResult->sampleCount < 2 || baselineResult->mean <= 0.0) {
+      continue;
+    }
+
+    Comparison comparison;
+    comparison.name = result.name;
+    comparison.baselineMean = baselineResult->mean;
+    comparison.mean = result.mean;
+    comparison.change = result.mean / baselineResult->mean - 1.0;
+    // Welch's t-test: the two sides may have different variances and sample counts.
+    const double standardError = std::sqrt(
+      result.standardDeviation * result.standardDeviation / result.sampleCount +
+      baselineResult->standardDeviation * baselineResult->standardDeviation / baselineResult->sampleCount);
+    const double difference = result.mean - baselineResult->mean;
+    comparison.tStatistic = standardError > 0.0 ? difference / standardError :
+      (difference > 0.0 ? std::numeric_limits<double>::infinity() : 0.0);
+    comparison.regression = comparison.change > kRegressionThreshold && comparison.tStatistic > kSignificantTStatistic;
+    comparisons.push_back(comparison);
+  }
+  return comparisons;
+}
+
+void MicroBenchmark::KeepAlive(const void* p) {
+  g_keepAlive.store(p, std::memory_order_relaxed);
+}
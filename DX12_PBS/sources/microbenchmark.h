@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Times CPU kernels and compares the results against a baseline. Portable, like TimingStatistics: the
+// kernels are plain functions, timed with CpuProfiler::Now.
+// A kernel is called in batches of as many iterations as take minSampleNanoseconds, which also warms
+// it up; every sample is the time per iteration of one batch. A kernel regressed when its mean is
+// kRegressionThreshold slower than the baseline's and Welch's t statistic of the two sets of samples
+// is above kSignificantTStatistic, so that noise alone rarely fails a run.
+class MicroBenchmark {
+public:
+  static constexpr double kRegressionThreshold = 0.05;
+  // About p < 0.005 one-sided for the 20 or more samples of both sides.
+  static constexpr double kSignificantTStatistic = 3.0;
+
+  struct Result {
+    std::string name;  // without commas
+    uint64_t itemsPerIteration = 0;
+    size_t sampleCount = 0;
+    double mean = 0.0;  // in nanoseconds per iteration
+    double standardDeviation = 0.0;  // of the samples
+    double median = 0.0;
+    double minimum = 0.0;
+
+    double GetItemsPerSecond() const {
+      return median > 0.0 ? itemsPerIteration * 1e9 / median : 0.0;
+    }
+  };
+
+  struct Comparison {
+    std::string name;
+    double baselineMean = 0.0;  // in nanoseconds per iteration
+    double mean = 0.0;
+    double change = 0.0;  // relative to the baseline, positive when slower
+    double tStatistic = 0.0;
+    bool regression = false;
+  };
+
+  MicroBenchmark(size_t sampleCount, int64_t minSampleNanoseconds);
+
+  MicroBenchmark(const MicroBenchmark&) = delete;
+  MicroBenchmark& operator=(const MicroBenchmark&) = delete;
+
+  // itemsPerIteration: what a call of kernel processes, e.g. vertices, for the throughput.
+  void Run(const std::string& name, uint64_t itemsPerIteration, const std::function<void()>& kernel);
+
+  const std::vector<Result>& GetResults() const {
+    return m_results;
+  }
+
+  // One row per kernel.
+  void WriteCsv(std::ostream& stream) const;
+  // Reads what WriteCsv wrote. Returns false if the stream has no valid header.
+  static bool ReadCsv(std::istream& stream, std::vector<Result>* pResults);
+
+  // The kernels that are in the baseline, in the order they were run.
+  std::vector<Comparison> Compare(const std::vector<Result>& baseline) const;
+
+  // Lets the compiler assume that p is read, so that the work that produced it isn't optimized away.
+  static void KeepAlive(const void* p);
+
+private:
+  size_t m_sampleCount = 0;
+  int64_t m_minSampleNanoseconds = 0;
+  std::vector<Result> m_results;
+};
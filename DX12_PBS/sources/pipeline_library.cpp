@@ -0,0 +1,218 @@
+#include "pipeline_library.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+constexpr char kFileMagic[4] = {'P', 'S', 'O', 'L'};
+constexpr UINT kFileVersion = 1;
+
+enum class Storage : UINT {
+  kPipelineLibrary,  // a serialized ID3D12PipelineLibrary
+  kCachedBlobs,  // the name and cached blob of every pipeline state
+};
+
+struct CachedBlobHeader {
+  UINT nameLength;  // in characters, followed by the name and the blob
+  UINT blobSize;
+};
+
+// Creation failed because nothing is cached under the name, or the cached data doesn't suit the
+// description, adapter or driver.
+bool IsCacheMismatch(HRESULT hr) {
+  return hr == E_INVALIDARG || hr == D3D12_ERROR_ADAPTER_NOT_FOUND || hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH;
+}
+
+// Followed by the AdapterIdentity that wrote the file, and the data of the storage.
+struct FileHeader {
+  char magic[4];
+  UINT version;
+  UINT storage;
+  UINT reserved;
+};
+
+}  // namespace
+
+PipelineLibrary::PipelineLibrary(ID3D12Device* pDevice, const std::wstring& path) :
+  m_device(pDevice),
+  m_path(path) {
+  ComPtr<IDXGIFactory4> factory;
+  ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(&factory)));
+  ComPtr<IDXGIAdapter1> adapter;
+  ThrowIfFailed(factory->EnumAdapterByLuid(pDevice->GetAdapterLuid(), IID_PPV_ARGS(&adapter)));
+  DXGI_ADAPTER_DESC1 adapterDesc{};
+  ThrowIfFailed(adapter->GetDesc1(&adapterDesc));
+  m_adapterIdentity.vendorId = adapterDesc.VendorId;
+  m_adapterIdentity.deviceId = adapterDesc.DeviceId;
+  m_adapterIdentity.subSysId = adapterDesc.SubSysId;
+  m_adapterIdentity.revision = adapterDesc.Revision;
+  // Reports the version of the user mode driver.
+  LARGE_INTEGER driverVersion{};
+  if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion))) {
+    m_adapterIdentity.driverVersion = static_cast<UINT64>(driverVersion.QuadPart);
+  }
+
+  // Fails with DXGI_ERROR_UNSUPPORTED on drivers without pipeline libraries.
+  if (SUCCEEDED(m_device.As(&m_device1)) && FAILED(m_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library)))) {
+    m_device1.Reset();
+  }
+
+  Load();
+}
+
+PipelineLibrary::~PipelineLibrary() {
+}
+
+void PipelineLibrary::CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, LPCWSTR name,
+  ID3D12PipelineState** ppPipelineState) {
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC cachedDesc = desc;
+  HRESULT hr = E_INVALIDARG;  // what the library reports for a name it doesn't have
+  if (m_library) {
+    hr = m_library->LoadGraphicsPipeline(name, &cachedDesc, IID_PPV_ARGS(ppPipelineState));
+  } else {
+    auto cachedBlob = m_cachedBlobs.find(name);
+    if (cachedBlob != m_cachedBlobs.end()) {
+      cachedDesc.CachedPSO = {cachedBlob->second.data(), cachedBlob->second.size()};
+      hr = m_device->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(ppPipelineState));
+    }
+  }
+  if (FAILED(hr) && !IsCacheMismatch(hr)) {
+    ThrowIfFailed(hr);
+  }
+
+  const bool compiled = FAILED(hr);
+  if (compiled) {
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(ppPipelineState)));
+  }
+  AddPipelineState(name, *ppPipelineState, compiled);
+}
+
+void PipelineLibrary::CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, LPCWSTR name,
+  ID3D12PipelineState** ppPipelineState) {
+  D3D12_COMPUTE_PIPELINE_STATE_DESC cachedDesc = desc;
+  HRESULT hr = E_INVALIDARG;  // what the library reports for a name it doesn't have
+  if (m_library) {
+    hr = m_library->LoadComputePipeline(name, &cachedDesc, IID_PPV_ARGS(ppPipelineState));
+  } else {
+    auto cachedBlob = m_cachedBlobs.find(name);
+    if (cachedBlob != m_cachedBlobs.end()) {
+      cachedDesc.CachedPSO = {cachedBlob->second.data(), cachedBlob->second.size()};
+      hr = m_device->CreateComputePipelineState(&cachedDesc, IID_PPV_ARGS(ppPipelineState));
+    }
+  }
+  if (FAILED(hr) && !IsCacheMismatch(hr)) {
+    ThrowIfFailed(hr);
+  }
+
+  const bool compiled = FAILED(hr);
+  if (compiled) {
+    ThrowIfFailed(m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(ppPipelineState)));
+  }
+  AddPipelineState(name, *ppPipelineState, compiled);
+}
+
+void PipelineLibrary::AddPipelineState(LPCWSTR name, ID3D12PipelineState* pPipelineState, bool compiled) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pipelineStates[name] = pPipelineState;
+  if (compiled) {
+    ++m_compiledCount;
+    m_dirty = true;
+  }
+}
+
+void PipelineLibrary::Save() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_dirty) {
+    return;
+  }
+
+  FileHeader header{};
+  memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.version = kFileVersion;
+  std::vector<char> data;
+  if (m_device1) {
+    // A new library, so the pipeline states that weren't created this time are left out.
+    header.storage = static_cast<UINT>(Storage::kPipelineLibrary);
+    ComPtr<ID3D12PipelineLibrary> library;
+    ThrowIfFailed(m_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library)));
+    for (const auto& pipelineState : m_pipelineStates) {
+      ThrowIfFailed(library->StorePipeline(pipelineState.first.c_str(), pipelineState.second.Get()));
+    }
+    data.resize(library->GetSerializedSize());
+    ThrowIfFailed(library->Serialize(data.data(), data.size()));
+  } else {
+    header.storage = static_cast<UINT>(Storage::kCachedBlobs);
+    for (const auto& pipelineState : m_pipelineStates) {
+      ComPtr<ID3DBlob> blob;
+      ThrowIfFailed(pipelineState.second->GetCachedBlob(&blob));
+      CachedBlobHeader blobHeader{};
+      blobHeader.nameLength = static_cast<UINT>(pipelineState.first.size());
+      blobHeader.blobSize = static_cast<UINT>(blob->GetBufferSize());
+      const char* pHeader = reinterpret_cast<const char*>(&blobHeader);
+      const char* pName = reinterpret_cast<const char*>(pipelineState.first.c_str());
+      const char* pBlob = static_cast<const char*>(blob->GetBufferPointer());
+      data.insert(data.end(), pHeader, pHeader + sizeof(blobHeader));
+      data.insert(data.end(), pName, pName + blobHeader.nameLength * sizeof(wchar_t));
+      data.insert(data.end(), pBlob, pBlob + blobHeader.blobSize);
+    }
+  }
+
+  std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(&m_adapterIdentity), sizeof(m_adapterIdentity));
+  file.write(data.data(), data.size());
+  m_dirty = !file;
+}
+
+void PipelineLibrary::Load() {
+  std::ifstream file(m_path, std::ios::binary);
+  if (!file) {
+    return;
+  }
+  std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  // A file of another adapter, driver or version of this code is ignored, like a missing one.
+  FileHeader header{};
+  AdapterIdentity adapterIdentity{};
+  const size_t dataOffset = sizeof(header) + sizeof(adapterIdentity);
+  if (contents.size() < dataOffset) {
+    return;
+  }
+  memcpy(&header, contents.data(), sizeof(header));
+  memcpy(&adapterIdentity, contents.data() + sizeof(header), sizeof(adapterIdentity));
+  if (memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header.version != kFileVersion ||
+    memcmp(&adapterIdentity, &m_adapterIdentity, sizeof(adapterIdentity)) != 0) {
+    return;
+  }
+
+  if (header.storage == static_cast<UINT>(Storage::kPipelineLibrary) && m_device1) {
+    std::vector<char> libraryData(contents.begin() + dataOffset, contents.end());
+    // Also validates the data against the adapter and driver.
+    ComPtr<ID3D12PipelineLibrary> library;
+    if (SUCCEEDED(m_device1->CreatePipelineLibrary(libraryData.data(), libraryData.size(), IID_PPV_ARGS(&library)))) {
+      m_library = library;
+      m_libraryData = std::move(libraryData);
+    }
+  } else if (header.storage == static_cast<UINT>(Storage::kCachedBlobs) && !m_device1) {
+    size_t offset = dataOffset;
+    while (contents.size() - offset >= sizeof(CachedBlobHeader)) {
+      CachedBlobHeader blobHeader{};
+      memcpy(&blobHeader, contents.data() + offset, sizeof(blobHeader));
+      offset += sizeof(blobHeader);
+      const size_t nameSize = blobHeader.nameLength * sizeof(wchar_t);
+      if (contents.size() - offset < nameSize + blobHeader.blobSize) {
+        m_cachedBlobs.clear();
+        return;
+      }
+      std::wstring name(blobHeader.nameLength, L'\0');
+      memcpy(&name[0], contents.data() + offset, nameSize);
+      offset += nameSize;
+      m_cachedBlobs[name].assign(contents.begin() + offset, contents.begin() + offset + blobHeader.blobSize);
+      offset += blobHeader.blobSize;
+    }
+  }
+}
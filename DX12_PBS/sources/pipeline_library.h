@@ -0,0 +1,65 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/stdafx.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Pipeline states kept on disk between runs, so a warm start doesn't compile any of them.
+// Uses an ID3D12PipelineLibrary where the driver supports it, and the cached blob of every pipeline
+// state otherwise. The file is only used on the adapter and driver version that wrote it.
+// A pipeline state is looked up by its name and must match the description it was stored with; one
+// that doesn't is compiled again. Save writes the pipeline states created since the file was loaded,
+// which drops the ones that aren't used anymore.
+// Pipeline states may be created from several threads at once, with different names.
+class PipelineLibrary {
+public:
+  PipelineLibrary(ID3D12Device* pDevice, const std::wstring& path);
+  ~PipelineLibrary();
+
+  PipelineLibrary(const PipelineLibrary&) = delete;
+  PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+  void CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, LPCWSTR name, ID3D12PipelineState** ppPipelineState);
+  void CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, LPCWSTR name, ID3D12PipelineState** ppPipelineState);
+
+  // Does nothing if every pipeline state came from the file.
+  void Save();
+
+  // Pipeline states compiled from scratch since the library was created. Not synchronized with the
+  // threads creating pipeline states.
+  UINT GetCompiledCount() const {
+    return m_compiledCount;
+  }
+
+private:
+  struct AdapterIdentity {
+    UINT vendorId = 0;
+    UINT deviceId = 0;
+    UINT subSysId = 0;
+    UINT revision = 0;
+    UINT64 driverVersion = 0;
+  };
+
+  void Load();
+  void AddPipelineState(LPCWSTR name, ID3D12PipelineState* pPipelineState, bool compiled);
+
+  ComPtr<ID3D12Device> m_device;
+  ComPtr<ID3D12Device1> m_device1;  // null if pipeline libraries aren't available
+  std::wstring m_path;
+  AdapterIdentity m_adapterIdentity;
+
+  std::vector<char> m_libraryData;  // must outlive m_library
+  ComPtr<ID3D12PipelineLibrary> m_library;
+  std::unordered_map<std::wstring, std::vector<char>> m_cachedBlobs;  // when there is no m_library
+
+  std::mutex m_mutex;  // guards the members below
+  std::map<std::wstring, ComPtr<ID3D12PipelineState>> m_pipelineStates;  // created since the file was loaded
+  UINT m_compiledCount = 0;
+  bool m_dirty = false;
+};
@@ -0,0 +1,94 @@
+#include "profiler_output.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void WriteJsonString(std::ostream& stream, const char* text) {
+  stream << '"';
+  for (const char* p = text; *p != '\0'; ++p) {
+    const char c = *p;
+    if (c == '"' || c == '\\') {
+      stream << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      stream << escaped;
+    } else {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+
+TimingStatistics::TimingStatistics(size_t windowSize) :
+  m_windowSize(windowSize) {
+}
+
+void TimingStatistics::Add(const std::string& name, double milliseconds) {
+  auto index = m_indices.find(name);
+  if (index == m_indices.end()) {
+    index = m_indices.emplace(name, m_samples.size()).first;
+    m_samples.emplace_back();
+    m_samples.back().name = name;
+  }
+  Samples& samples = m_samples[index->second];
+  samples.window.push_back(milliseconds);
+  samples.sum += milliseconds;
+  if (samples.window.size() > m_windowSize) {
+    samples.sum -= samples.window.front();
+    samples.window.pop_front();
+  }
+}
+
+std::vector<TimingStatistics::Entry> TimingStatistics::GetEntries() const {
+  std::vector<Entry> entries;
+  entries.reserve(m_samples.size());
+  for (const Samples& samples : m_samples) {
+    Entry entry;
+    entry.name = samples.name;
+    entry.sampleCount = samples.window.size();
+    if (entry.sampleCount > 0) {
+      entry.last = samples.window.back();
+      entry.average = samples.sum / entry.sampleCount;
+      const auto minMax = std::minmax_element(samples.window.begin(), samples.window.end());
+      entry.minimum = *minMax.first;
+      entry.maximum = *minMax.second;
+    }
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+void TimingStatistics::WriteCsv(std::ostream& stream) const {
+  stream << "name,samples,last_ms,avg_ms,min_ms,max_ms\n";
+  for (const Entry& entry : GetEntries()) {
+    char row[256];
+    snprintf(row, sizeof(row), "%s,%zu,%.4f,%.4f,%.4f,%.4f\n", entry.name.c_str(), entry.sampleCount,
+      entry.last, entry.average, entry.minimum, entry.maximum);
+    stream << row;
+  }
+}
+
+void WriteChromeTrace(std::ostream& stream, const std::vector<TraceEvent>& events,
+  const std::vector<std::pair<uint32_t, std::string>>& threadNames) {
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& threadName : threadNames) {
+    stream << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first
+      << ",\"args\":{\"name\":";
+    WriteJsonString(stream, threadName.second.c_str());
+    stream << "}}";
+    first = false;
+  }
+  for (const TraceEvent& event : events) {
+    char times[96];
+    snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.startMicroseconds, event.durationMicroseconds);
+    stream << (first ? "\n" : ",\n") << "{\"name\":";
+    WriteJsonString(stream, event.name);
+    stream << ",\"cat\":";
+    WriteJsonString(stream, event.category);
+    stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId << ',' << times << '}';
+    first = false;
+  }
+  stream << "\n]}\n";
+}
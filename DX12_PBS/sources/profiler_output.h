@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Statistics and export shared by the profilers. Portable, like BuddyAllocator: it only deals with
+// names and times, the profilers measure them.
+
+// Keeps the last windowSize samples of every named scope, for a rolling average, minimum and maximum.
+class TimingStatistics {
+public:
+  struct Entry {
+    std::string name;
+    double last = 0.0;  // in milliseconds
+    double average = 0.0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    size_t sampleCount = 0;  // in the window
+  };
+
+  explicit TimingStatistics(size_t windowSize);
+
+  void Add(const std::string& name, double milliseconds);
+  // In the order the names were first added.
+  std::vector<Entry> GetEntries() const;
+  // One row per name.
+  void WriteCsv(std::ostream& stream) const;
+
+private:
+  struct Samples {
+    std::string name;
+    std::deque<double> window;
+    double sum = 0.0;
+  };
+
+  size_t m_windowSize = 0;
+  std::vector<Samples> m_samples;
+  std::unordered_map<std::string, size_t> m_indices;  // into m_samples
+};
+
+// A complete event of the Chrome trace event format, which chrome://tracing and Perfetto open.
+struct TraceEvent {
+  const char* name;  // a literal, or a string that outlives the event
+  const char* category;
+  uint32_t threadId;
+  double startMicroseconds;
+  double durationMicroseconds;
+};
+
+// Writes text as a JSON string, quoted and escaped.
+void WriteJsonString(std::ostream& stream, const char* text);
+
+// Writes a JSON trace; threadNames label the threads, e.g. the GPU queue the GPU events are on.
+void WriteChromeTrace(std::ostream& stream, const std::vector<TraceEvent>& events,
+  const std::vector<std::pair<uint32_t, std::string>>& threadNames);
@@ -0,0 +1,305 @@
+#include "render_graph.h"
+
+#include <algorithm>
+
+namespace {
+
+// D3D12_RESOURCE_STATES bits that allow the GPU to write the resource.
+constexpr uint32_t kStateRenderTarget = 0x4;
+constexpr uint32_t kStateUnorderedAccess = 0x8;
+constexpr uint32_t kStateDepthWrite = 0x10;
+constexpr uint32_t kStateStreamOut = 0x100;
+constexpr uint32_t kStateCopyDest = 0x400;
+constexpr uint32_t kStateResolveDest = 0x1000;
+constexpr uint32_t kWriteStates = kStateRenderTarget | kStateUnorderedAccess | kStateDepthWrite | kStateStreamOut | kStateCopyDest | kStateResolveDest;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+}  // namespace
+
+RenderGraph::ResourceHandle RenderGraph::ImportResource(const std::string& name, ResourceStates initialState, ResourceStates finalState) {
+  Resource resource;
+  resource.name = name;
+  resource.initialState = initialState;
+  resource.finalState = finalState;
+  m_resources.push_back(resource);
+  return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateTransientResource(const std::string& name, uint64_t sizeInBytes, uint64_t alignment,
+  uint32_t heapIndex, ResourceStates restState) {
+  Resource resource;
+  resource.name = name;
+  resource.transient = true;
+  resource.initialState = restState;
+  resource.finalState = restState;
+  resource.sizeInBytes = sizeInBytes;
+  resource.alignment = alignment;
+  resource.placement.heapIndex = heapIndex;
+  m_resources.push_back(resource);
+  return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+RenderGraph::PassHandle RenderGraph::AddPass(const std::string& name, bool hasSideEffects) {
+  Pass pass;
+  pass.name = name;
+  pass.hasSideEffects = hasSideEffects;
+  m_passes.push_back(pass);
+  return static_cast<PassHandle>(m_passes.size() - 1);
+}
+
+void RenderGraph::SetCommandList(PassHandle pass, uint32_t commandList) {
+  m_passes[pass].commandList = commandList;
+}
+
+void RenderGraph::Read(PassHandle pass, ResourceHandle resource, ResourceStates state) {
+  AddAccess(pass, resource, state, true, false);
+}
+
+void RenderGraph::Write(PassHandle pass, ResourceHandle resource, ResourceStates state) {
+  AddAccess(pass, resource, state, false, true);
+}
+
+void RenderGraph::AddAccess(PassHandle pass, ResourceHandle resource, ResourceStates state, bool read, bool write) {
+  for (Access& access : m_passes[pass].accesses) {
+    if (access.resource == resource) {
+      access.state |= state;
+      access.read = access.read || read;
+      access.write = access.write || write;
+      return;
+    }
+  }
+  m_passes[pass].accesses.push_back({ resource, state, read, write });
+}
+
+bool RenderGraph::IsReadOnlyState(ResourceStates state) {
+  // COMMON (and PRESENT) is 0: a resource in it has to be transitioned before any use.
+  return state != 0 && (state & kWriteStates) == 0;
+}
+
+void RenderGraph::Compile() {
+  for (Pass& pass : m_passes) {
+    pass.culled = false;
+    pass.barriers.clear();
+    pass.discards.clear();
+  }
+  m_finalBarriers.clear();
+
+  CullPasses();
+
+  // Lifetimes in indices of the live passes.
+  for (Resource& resource : m_resources) {
+    resource.firstUse = kInvalidHandle;
+    resource.lastUse = kInvalidHandle;
+    resource.aliased = false;
+  }
+  for (uint32_t i = 0; i < m_livePasses.size(); ++i) {
+    for (const Access& access : m_passes[m_livePasses[i]].accesses) {
+      Resource& resource = m_resources[access.resource];
+      if (resource.firstUse == kInvalidHandle) {
+        resource.firstUse = i;
+      }
+      resource.lastUse = i;
+    }
+  }
+
+  PlaceTransients();
+  ComputeBarriers();
+}
+
+void RenderGraph::CullPasses() {
+  // Walk backwards: a pass is needed when it writes something that a needed pass after it reads.
+  std::vector<bool> readLater(m_resources.size(), false);
+  for (size_t i = m_passes.size(); i-- > 0;) {
+    Pass& pass = m_passes[i];
+    bool needed = pass.hasSideEffects;
+    for (const Access& access : pass.accesses) {
+      if (access.write && (!m_resources[access.resource].transient || readLater[access.resource])) {
+        needed = true;
+      }
+    }
+    pass.culled = !needed;
+    if (needed) {
+      for (const Access& access : pass.accesses) {
+        if (access.read) {
+          readLater[access.resource] = true;
+        }
+      }
+    }
+  }
+
+  m_livePasses.clear();
+  for (PassHandle i = 0; i < m_passes.size(); ++i) {
+    if (!m_passes[i].culled) {
+      m_livePasses.push_back(i);
+    }
+  }
+}
+
+void RenderGraph::PlaceTransients() {
+  uint32_t numHeaps = 0;
+  std::vector<ResourceHandle> transients;
+  for (ResourceHandle i = 0; i < m_resources.size(); ++i) {
+    if (m_resources[i].transient) {
+      transients.push_back(i);
+      numHeaps = (std::max)(numHeaps, m_resources[i].placement.heapIndex + 1);
+    }
+  }
+  m_heapSizes.assign(numHeaps, 0);
+
+  // Largest first, each at the lowest offset where it overlaps no resource that is alive at the same time.
+  std::stable_sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+    return m_resources[a].sizeInBytes > m_resources[b].sizeInBytes;
+  });
+
+  auto livesOverlap = [](const Resource& a, const Resource& b) {
+    // An unused transient is never made active, so it can share memory with anything.
+    if (a.firstUse == kInvalidHandle || b.firstUse == kInvalidHandle) {
+      return false;
+    }
+    return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+  };
+  auto memoryOverlaps = [](const Resource& a, const Resource& b) {
+    return a.placement.offset < b.placement.offset + b.sizeInBytes && b.placement.offset < a.placement.offset + a.sizeInBytes;
+  };
+
+  std::vector<ResourceHandle> placed;
+  for (ResourceHandle handle : transients) {
+    Resource& resource = m_resources[handle];
+    resource.placement.offset = 0;
+    for (bool moved = true; moved;) {
+      moved = false;
+      for (ResourceHandle other : placed) {
+        const Resource& otherResource = m_resources[other];
+        if (otherResource.placement.heapIndex == resource.placement.heapIndex &&
+            livesOverlap(resource, otherResource) && memoryOverlaps(resource, otherResource)) {
+          resource.placement.offset = AlignUp(otherResource.placement.offset + otherResource.sizeInBytes, resource.alignment);
+          moved = true;
+        }
+      }
+    }
+    placed.push_back(handle);
+
+    uint64_t& heapSize = m_heapSizes[resource.placement.heapIndex];
+    heapSize = (std::max)(heapSize, resource.placement.offset + resource.sizeInBytes);
+  }
+
+  for (size_t i = 0; i < transients.size(); ++i) {
+    for (size_t j = i + 1; j < transients.size(); ++j) {
+      Resource& a = m_resources[transients[i]];
+      Resource& b = m_resources[transients[j]];
+      if (a.placement.heapIndex == b.placement.heapIndex && a.firstUse != kInvalidHandle && b.firstUse != kInvalidHandle &&
+          memoryOverlaps(a, b)) {
+        a.aliased = true;
+        b.aliased = true;
+      }
+    }
+  }
+}
+
+void RenderGraph::ComputeBarriers() {
+  const uint32_t numLivePasses = static_cast<uint32_t>(m_livePasses.size());
+  auto barriersBefore = [this, numLivePasses](uint32_t livePass) -> std::vector<Barrier>& {
+    return livePass < numLivePasses ? m_passes[m_livePasses[livePass]].barriers : m_finalBarriers;
+  };
+  const uint32_t finalCommandList = m_passes.empty() ? 0 : m_passes.back().commandList;
+  auto commandListOf = [&](uint32_t livePass) {
+    return livePass < numLivePasses ? m_passes[m_livePasses[livePass]].commandList : finalCommandList;
+  };
+  auto addTransition = [&](ResourceHandle resource, ResourceStates before, ResourceStates after, uint32_t beginPass, uint32_t endPass) {
+    Barrier barrier;
+    barrier.resource = resource;
+    barrier.stateBefore = before;
+    barrier.stateAfter = after;
+    // The halves of a split barrier have to be in one command list, otherwise the whole transition
+    // is recorded where it has to be done by.
+    if (beginPass < endPass && commandListOf(beginPass) == commandListOf(endPass)) {
+      barrier.split = BarrierSplit::kBegin;
+      barriersBefore(beginPass).push_back(barrier);
+      barrier.split = BarrierSplit::kEnd;
+    }
+    barriersBefore(endPass).push_back(barrier);
+  };
+
+  std::vector<UseGroup> groups;
+  for (ResourceHandle handle = 0; handle < m_resources.size(); ++handle) {
+    const Resource& resource = m_resources[handle];
+    if (resource.firstUse == kInvalidHandle) {
+      if (!resource.transient && resource.initialState != resource.finalState) {
+        addTransition(handle, resource.initialState, resource.finalState, numLivePasses, numLivePasses);
+      }
+      continue;
+    }
+
+    // Merge consecutive reads into one use in the union of their states.
+    groups.clear();
+    for (uint32_t i = resource.firstUse; i <= resource.lastUse; ++i) {
+      for (const Access& access : m_passes[m_livePasses[i]].accesses) {
+        if (access.resource != handle) {
+          continue;
+        }
+        const bool readOnly = !access.write && IsReadOnlyState(access.state);
+        if (readOnly && !groups.empty() && !groups.back().write && IsReadOnlyState(groups.back().state)) {
+          groups.back().state |= access.state;
+          groups.back().last = i;
+        } else {
+          groups.push_back({ i, i, access.state, access.write });
+        }
+      }
+    }
+
+    // If the resource ends up being read anyway, its last reads can already use the final state.
+    UseGroup& lastGroup = groups.back();
+    if (!lastGroup.write && IsReadOnlyState(lastGroup.state) && IsReadOnlyState(resource.finalState)) {
+      lastGroup.state |= resource.finalState;
+    }
+
+    if (resource.aliased) {
+      Barrier barrier;
+      barrier.type = BarrierType::kAliasing;
+      barrier.resource = handle;
+      barriersBefore(resource.firstUse).push_back(barrier);
+      if (groups.front().write) {
+        m_passes[m_livePasses[resource.firstUse]].discards.push_back(handle);
+      }
+    }
+
+    ResourceStates state = resource.initialState;
+    // Transitions of a transient can't start before its first use: its memory may belong to another resource.
+    uint32_t idleSince = resource.transient ? resource.firstUse : 0;
+    for (size_t i = 0; i < groups.size(); ++i) {
+      UseGroup& group = groups[i];
+      const bool groupReadOnly = !group.write && IsReadOnlyState(group.state);
+      if (groupReadOnly && IsReadOnlyState(state) && (state & group.state) == group.state) {
+        // Already readable in the required way.
+        group.state = state;
+      } else if (state != group.state) {
+        addTransition(handle, state, group.state, idleSince, group.first);
+      } else if ((state & kStateUnorderedAccess) && i > 0 && (group.write || groups[i - 1].write)) {
+        Barrier barrier;
+        barrier.type = BarrierType::kUnorderedAccess;
+        barrier.resource = handle;
+        barriersBefore(group.first).push_back(barrier);
+      }
+      state = group.state;
+      idleSince = group.last + 1;
+    }
+
+    if (state != resource.finalState) {
+      if (resource.transient) {
+        // Right after the last use, and ahead of any aliasing barrier in the same batch, while the
+        // resource still owns its memory.
+        Barrier barrier;
+        barrier.resource = handle;
+        barrier.stateBefore = state;
+        barrier.stateAfter = resource.finalState;
+        std::vector<Barrier>& barriers = barriersBefore(idleSince);
+        barriers.insert(barriers.begin(), barrier);
+      } else {
+        addTransition(handle, state, resource.finalState, idleSince, numLivePasses);
+      }
+    }
+  }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Passes declare the resources they read and write, and Compile derives everything that used to be
+// written by hand around them:
+// - passes whose results nobody uses are culled,
+// - consecutive reads share one transition to the union of their states,
+// - a transition that has idle passes before it is split into a begin and an end half, when both
+//   halves are recorded in the same command list,
+// - transient resources get placed in heaps so that resources with disjoint lifetimes share memory.
+// The graph only deals with handles and state bits, it doesn't know about D3D12 objects; the caller
+// records the barriers of a pass before recording the pass itself.
+class RenderGraph {
+public:
+  using ResourceHandle = uint32_t;
+  using PassHandle = uint32_t;
+  using ResourceStates = uint32_t;  // D3D12_RESOURCE_STATES bits
+  static constexpr uint32_t kInvalidHandle = UINT32_MAX;
+
+  enum class BarrierType {
+    kTransition,
+    kAliasing,  // the resource's memory was used by another transient, which becomes inactive
+    kUnorderedAccess,
+  };
+
+  enum class BarrierSplit {
+    kNone,
+    kBegin,
+    kEnd,
+  };
+
+  struct Barrier {
+    BarrierType type = BarrierType::kTransition;
+    BarrierSplit split = BarrierSplit::kNone;
+    ResourceHandle resource = kInvalidHandle;
+    ResourceStates stateBefore = 0;
+    ResourceStates stateAfter = 0;
+  };
+
+  struct TransientPlacement {
+    uint32_t heapIndex = 0;
+    uint64_t offset = 0;
+  };
+
+  RenderGraph() = default;
+
+  // A resource that outlives the graph. It is in initialState before the first pass, and is
+  // returned to finalState after the last one.
+  ResourceHandle ImportResource(const std::string& name, ResourceStates initialState, ResourceStates finalState);
+  // A resource whose contents only live while the graph uses it. It is placed in heap heapIndex,
+  // so resources that can't share a heap go in different heaps. Outside its lifetime the resource
+  // is in restState, the state it was created in.
+  ResourceHandle CreateTransientResource(const std::string& name, uint64_t sizeInBytes, uint64_t alignment,
+    uint32_t heapIndex, ResourceStates restState);
+
+  // Passes run in the order they are added. A pass with side effects is never culled; neither is a
+  // pass that writes an imported resource.
+  PassHandle AddPass(const std::string& name, bool hasSideEffects = false);
+  // Passes are recorded in command list 0 unless told otherwise. A split barrier can't begin in one
+  // command list and end in another, so the graph only splits transitions within a list. The final
+  // barriers are recorded in the command list of the last pass.
+  void SetCommandList(PassHandle pass, uint32_t commandList);
+  // A pass uses a resource in a single state. Reading and writing the same resource is declared
+  // with both calls and the same state.
+  void Read(PassHandle pass, ResourceHandle resource, ResourceStates state);
+  void Write(PassHandle pass, ResourceHandle resource, ResourceStates state);
+
+  void Compile();
+
+  bool IsPassCulled(PassHandle pass) const {
+    return m_passes[pass].culled;
+  }
+
+  // To record, in one batch, before the pass.
+  const std::vector<Barrier>& GetBarriersBefore(PassHandle pass) const {
+    return m_passes[pass].barriers;
+  }
+
+  // Transients that the pass has to discard after its barriers: their memory was used by another
+  // resource, so their contents (and compression metadata) are undefined.
+  const std::vector<ResourceHandle>& GetDiscardsBefore(PassHandle pass) const {
+    return m_passes[pass].discards;
+  }
+
+  // To record after the last pass.
+  const std::vector<Barrier>& GetFinalBarriers() const {
+    return m_finalBarriers;
+  }
+
+  const TransientPlacement& GetTransientPlacement(ResourceHandle resource) const {
+    return m_resources[resource].placement;
+  }
+
+  uint32_t GetNumHeaps() const {
+    return static_cast<uint32_t>(m_heapSizes.size());
+  }
+
+  uint64_t GetHeapSize(uint32_t heapIndex) const {
+    return m_heapSizes[heapIndex];
+  }
+
+  const std::string& GetPassName(PassHandle pass) const {
+    return m_passes[pass].name;
+  }
+
+  const std::string& GetResourceName(ResourceHandle resource) const {
+    return m_resources[resource].name;
+  }
+
+  static bool IsReadOnlyState(ResourceStates state);
+
+private:
+  struct Access {
+    ResourceHandle resource;
+    ResourceStates state;
+    bool read;
+    bool write;
+  };
+
+  struct Pass {
+    std::string name;
+    bool hasSideEffects = false;
+    uint32_t commandList = 0;
+    std::vector<Access> accesses;
+    // Compile results.
+    bool culled = false;
+    std::vector<Barrier> barriers;
+    std::vector<ResourceHandle> discards;
+  };
+
+  struct Resource {
+    std::string name;
+    bool transient = false;
+    ResourceStates initialState = 0;
+    ResourceStates finalState = 0;
+    uint64_t sizeInBytes = 0;
+    uint64_t alignment = 0;
+    // Compile results, in indices of the passes that survived culling.
+    uint32_t firstUse = kInvalidHandle;
+    uint32_t lastUse = kInvalidHandle;
+    TransientPlacement placement;
+    bool aliased = false;  // shares memory with another transient
+  };
+
+  // Consecutive uses of a resource that need no barrier between them.
+  struct UseGroup {
+    uint32_t first;  // in indices of the passes that survived culling
+    uint32_t last;
+    ResourceStates state;
+    bool write;
+  };
+
+  void AddAccess(PassHandle pass, ResourceHandle resource, ResourceStates state, bool read, bool write);
+  void CullPasses();
+  void PlaceTransients();
+  void ComputeBarriers();
+
+  std::vector<Pass> m_passes;
+  std::vector<Resource> m_resources;
+  std::vector<PassHandle> m_livePasses;  // the passes that survived culling, in order
+  std::vector<Barrier> m_finalBarriers;
+  std::vector<uint64_t> m_heapSizes;
+};
@@ -0,0 +1,119 @@
+#include "residency_manager.h"
+
+#include <cstdio>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+constexpr const char* kCategoryNames[] = { "IBL", "meshes", "render targets", "staging" };
+
+UINT64 GetSize(ID3D12Device* pDevice, ID3D12Pageable* pObject) {
+  ComPtr<ID3D12Resource> resource;
+  if (SUCCEEDED(pObject->QueryInterface(IID_PPV_ARGS(&resource)))) {
+    const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+    return pDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+  }
+  ComPtr<ID3D12Heap> heap;
+  if (SUCCEEDED(pObject->QueryInterface(IID_PPV_ARGS(&heap)))) {
+    return heap->GetDesc().SizeInBytes;
+  }
+  return 0;
+}
+
+}  // namespace
+
+ResidencyManager::ResidencyManager(ID3D12Device* pDevice, UINT budgetQueryInterval) :
+  m_device(pDevice),
+  m_budgetQueryInterval(budgetQueryInterval) {
+  // The adapter the device was created on.
+  ComPtr<IDXGIFactory4> factory;
+  ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(&factory)));
+  ThrowIfFailed(factory->EnumAdapterByLuid(pDevice->GetAdapterLuid(), IID_PPV_ARGS(&m_adapter)));
+  QueryBudget(0);
+}
+
+ResidencyManager::~ResidencyManager() {
+}
+
+ResidencyManager::SetId ResidencyManager::AddSet(Category category, const std::vector<ID3D12Pageable*>& objects, bool evictable) {
+  UINT64 size = 0;
+  for (ID3D12Pageable* pObject : objects) {
+    size += GetSize(m_device.Get(), pObject);
+  }
+  const SetId set = m_tracker.AddSet(category, size, evictable);
+  if (evictable) {
+    m_objects[set].assign(objects.begin(), objects.end());
+  }
+  return set;
+}
+
+ResidencyManager::SetId ResidencyManager::AddSet(Category category, UINT64 size) {
+  return m_tracker.AddSet(category, size, false);
+}
+
+void ResidencyManager::SetSize(SetId set, UINT64 size) {
+  m_tracker.SetSize(set, size);
+}
+
+void ResidencyManager::RemoveSet(SetId set) {
+  m_tracker.RemoveSet(set);
+  m_objects.erase(set);
+}
+
+void ResidencyManager::Use(SetId set, UINT64 fenceValue) {
+  if (!m_tracker.Use(set, fenceValue)) {
+    return;
+  }
+  std::vector<ID3D12Pageable*> objects;
+  for (const ComPtr<ID3D12Pageable>& object : m_objects[set]) {
+    objects.push_back(object.Get());
+  }
+  HRESULT hr = m_device->MakeResident(static_cast<UINT>(objects.size()), objects.data());
+  if (hr == E_OUTOFMEMORY) {
+    // Whatever else the GPU is done with makes room, and is made resident again when it's used.
+    Evict(m_tracker.EvictAll(m_completedFenceValue));
+    hr = m_device->MakeResident(static_cast<UINT>(objects.size()), objects.data());
+  }
+  ThrowIfFailed(hr);
+}
+
+void ResidencyManager::Update(UINT64 completedFenceValue) {
+  m_completedFenceValue = completedFenceValue;
+  if (++m_updatesSinceQuery >= m_budgetQueryInterval) {
+    QueryBudget(completedFenceValue);
+  }
+}
+
+void ResidencyManager::LogTelemetry() const {
+  const ResidencyTracker::Telemetry& telemetry = m_tracker.GetTelemetry();
+  char message[256];
+  sprintf_s(message, "residency: %.1f of %.1f MB budget used%s, %u evictions, %u made resident again\n",
+    telemetry.usage / (1024.0 * 1024.0), telemetry.budget / (1024.0 * 1024.0), telemetry.overBudget ? " (over budget)" : "",
+    telemetry.evictionCount, telemetry.makeResidentCount);
+  OutputDebugStringA(message);
+  for (UINT category = 0; category < ResidencyTracker::kCategoryCount; ++category) {
+    sprintf_s(message, "residency: %s: %.1f MB resident, %.1f MB evicted\n", kCategoryNames[category],
+      telemetry.residentSize[category] / (1024.0 * 1024.0), telemetry.evictedSize[category] / (1024.0 * 1024.0));
+    OutputDebugStringA(message);
+  }
+}
+
+void ResidencyManager::QueryBudget(UINT64 completedFenceValue) {
+  m_updatesSinceQuery = 0;
+  DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
+  ThrowIfFailed(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo));
+  Evict(m_tracker.Update(memoryInfo.Budget, memoryInfo.CurrentUsage, completedFenceValue));
+}
+
+void ResidencyManager::Evict(const std::vector<SetId>& sets) {
+  std::vector<ID3D12Pageable*> objects;
+  for (SetId set : sets) {
+    for (const ComPtr<ID3D12Pageable>& object : m_objects[set]) {
+      objects.push_back(object.Get());
+    }
+  }
+  if (!objects.empty()) {
+    ThrowIfFailed(m_device->Evict(static_cast<UINT>(objects.size()), objects.data()));
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "residency_tracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Keeps the process within the video memory budget of its adapter, so that several processes sharing
+// a GPU degrade gracefully instead of running out of memory. Every budgetQueryInterval updates, the
+// budget of the local segment group is queried, and the evictable sets that don't fit are evicted
+// with a ResidencyTracker; Use makes a set resident again before work that needs it is submitted.
+// A set of placed resources is evicted through their heaps, so an evictable set is heaps and
+// committed resources only. Not thread safe.
+class ResidencyManager {
+public:
+  using SetId = ResidencyTracker::SetId;
+  using Category = ResidencyTracker::Category;
+
+  ResidencyManager(ID3D12Device* pDevice, UINT budgetQueryInterval);
+  ~ResidencyManager();
+
+  ResidencyManager(const ResidencyManager&) = delete;
+  ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+  // The size of the set is that of its resources and heaps.
+  SetId AddSet(Category category, const std::vector<ID3D12Pageable*>& objects, bool evictable);
+  // A set that is only accounted, e.g. upload memory whose size changes.
+  SetId AddSet(Category category, UINT64 size);
+  void SetSize(SetId set, UINT64 size);
+  // Drops the references to the set's objects.
+  void RemoveSet(SetId set);
+
+  // Before recording work that uses the set and signals fenceValue. Blocks while the set is made
+  // resident, if it was evicted.
+  void Use(SetId set, UINT64 fenceValue);
+  void Update(UINT64 completedFenceValue);
+
+  const ResidencyTracker::Telemetry& GetTelemetry() const {
+    return m_tracker.GetTelemetry();
+  }
+  // Logs the budget, the usage and the bytes by category to the debugger.
+  void LogTelemetry() const;
+
+private:
+  void QueryBudget(UINT64 completedFenceValue);
+  void Evict(const std::vector<SetId>& sets);
+
+  ComPtr<ID3D12Device> m_device;
+  ComPtr<IDXGIAdapter3> m_adapter;
+  UINT m_budgetQueryInterval = 1;
+  UINT m_updatesSinceQuery = 0;
+  UINT64 m_completedFenceValue = 0;
+  ResidencyTracker m_tracker;
+  std::unordered_map<SetId, std::vector<ComPtr<ID3D12Pageable>>> m_objects;  // of the evictable sets
+};
@@ -0,0 +1,108 @@
+#include "residency_tracker.h"
+
+#include <algorithm>
+
+ResidencyTracker::SetId ResidencyTracker::AddSet(Category category, uint64_t size, bool evictable) {
+  const SetId set = m_nextSet++;
+  m_sets[set] = { category, size, evictable, true, 0 };
+  m_telemetry.residentSize[static_cast<uint32_t>(category)] += size;
+  return set;
+}
+
+void ResidencyTracker::RemoveSet(SetId set) {
+  auto found = m_sets.find(set);
+  if (found == m_sets.end()) {
+    return;
+  }
+  const uint32_t category = static_cast<uint32_t>(found->second.category);
+  if (found->second.resident) {
+    m_telemetry.residentSize[category] -= found->second.size;
+  } else {
+    m_telemetry.evictedSize[category] -= found->second.size;
+  }
+  m_sets.erase(found);
+}
+
+void ResidencyTracker::SetSize(SetId set, uint64_t size) {
+  auto found = m_sets.find(set);
+  if (found == m_sets.end() || found->second.evictable) {
+    return;
+  }
+  const uint32_t category = static_cast<uint32_t>(found->second.category);
+  m_telemetry.residentSize[category] = m_telemetry.residentSize[category] - found->second.size + size;
+  found->second.size = size;
+}
+
+bool ResidencyTracker::Use(SetId set, uint64_t fenceValue) {
+  auto found = m_sets.find(set);
+  if (found == m_sets.end()) {
+    return false;
+  }
+  found->second.lastUseFenceValue = (std::max)(found->second.lastUseFenceValue, fenceValue);
+  if (found->second.resident) {
+    return false;
+  }
+  const uint32_t category = static_cast<uint32_t>(found->second.category);
+  found->second.resident = true;
+  m_telemetry.evictedSize[category] -= found->second.size;
+  m_telemetry.residentSize[category] += found->second.size;
+  m_telemetry.usage += found->second.size;
+  ++m_telemetry.makeResidentCount;
+  return true;
+}
+
+std::vector<ResidencyTracker::SetId> ResidencyTracker::Update(uint64_t budget, uint64_t usage, uint64_t completedFenceValue) {
+  m_telemetry.budget = budget;
+  m_telemetry.usage = usage;
+  std::vector<SetId> evicted;
+  if (usage > budget) {
+    for (SetId set : GetEvictionCandidates(completedFenceValue)) {
+      if (m_telemetry.usage <= budget) {
+        break;
+      }
+      Evict(set);
+      evicted.push_back(set);
+    }
+  }
+  m_telemetry.overBudget = m_telemetry.usage > budget;
+  return evicted;
+}
+
+std::vector<ResidencyTracker::SetId> ResidencyTracker::EvictAll(uint64_t completedFenceValue) {
+  std::vector<SetId> evicted = GetEvictionCandidates(completedFenceValue);
+  for (SetId set : evicted) {
+    Evict(set);
+  }
+  return evicted;
+}
+
+bool ResidencyTracker::IsResident(SetId set) const {
+  auto found = m_sets.find(set);
+  return found != m_sets.end() && found->second.resident;
+}
+
+std::vector<ResidencyTracker::SetId> ResidencyTracker::GetEvictionCandidates(uint64_t completedFenceValue) const {
+  std::vector<SetId> candidates;
+  for (const auto& set : m_sets) {
+    if (set.second.evictable && set.second.resident && set.second.lastUseFenceValue <= completedFenceValue) {
+      candidates.push_back(set.first);
+    }
+  }
+  // Ties, e.g. sets never used, in the order they were added.
+  std::sort(candidates.begin(), candidates.end(), [this](SetId a, SetId b) {
+    const uint64_t aFenceValue = m_sets.at(a).lastUseFenceValue;
+    const uint64_t bFenceValue = m_sets.at(b).lastUseFenceValue;
+    return aFenceValue != bFenceValue ? aFenceValue < bFenceValue : a < b;
+  });
+  return candidates;
+}
+
+void ResidencyTracker::Evict(SetId set) {
+  Set& evicted = m_sets.at(set);
+  const uint32_t category = static_cast<uint32_t>(evicted.category);
+  evicted.resident = false;
+  m_telemetry.residentSize[category] -= evicted.size;
+  m_telemetry.evictedSize[category] += evicted.size;
+  m_telemetry.usage -= (std::min)(m_telemetry.usage, evicted.size);
+  ++m_telemetry.evictionCount;
+}
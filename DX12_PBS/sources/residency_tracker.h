@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Bookkeeping of what is resident in video memory. Like BuddyAllocator, it doesn't know about D3D12
+// objects; ResidencyManager puts it on top of the adapter's budget and MakeResident/Evict, and it can
+// be driven with a simulated budget instead.
+
+// Tracks sets of objects that are made resident or evicted together, and the bytes resident by
+// category. A set used by the GPU is tagged with the fence value of that work. When the usage goes
+// over the budget, the evictable sets the GPU is done with are evicted, least recently used first,
+// until it fits; a set evicted is made resident again the next time it's used. Sets that aren't
+// evictable are only accounted.
+class ResidencyTracker {
+public:
+  using SetId = uint32_t;
+  static constexpr SetId kInvalidSet = UINT32_MAX;
+
+  enum class Category {
+    kIBL,  // the environment sets
+    kMeshes,
+    kRenderTargets,
+    kStaging,  // upload memory
+    kCount
+  };
+  static constexpr uint32_t kCategoryCount = static_cast<uint32_t>(Category::kCount);
+
+  struct Telemetry {
+    uint64_t budget = 0;  // as last reported
+    uint64_t usage = 0;  // as last reported, less what was evicted and plus what was made resident since
+    uint64_t residentSize[kCategoryCount] = {};
+    uint64_t evictedSize[kCategoryCount] = {};
+    uint32_t evictionCount = 0;  // since the tracker was created
+    uint32_t makeResidentCount = 0;
+    bool overBudget = false;  // even after evicting every set it could
+  };
+
+  SetId AddSet(Category category, uint64_t size, bool evictable);
+  void RemoveSet(SetId set);
+  // For sets that grow, e.g. upload memory. Only for sets that aren't evictable.
+  void SetSize(SetId set, uint64_t size);
+
+  // The set is used by the work that signals fenceValue. Returns true if it is evicted, and has to be
+  // made resident before that work runs; it counts as resident once this returns.
+  bool Use(SetId set, uint64_t fenceValue);
+  // Takes the budget and usage the adapter reports, and returns the sets to evict to fit, least
+  // recently used first. They count as evicted once this returns.
+  std::vector<SetId> Update(uint64_t budget, uint64_t usage, uint64_t completedFenceValue);
+  // Returns the resident evictable sets the GPU is done with, whatever the budget, e.g. to retry
+  // making a set resident after running out of memory.
+  std::vector<SetId> EvictAll(uint64_t completedFenceValue);
+
+  bool IsResident(SetId set) const;
+  const Telemetry& GetTelemetry() const {
+    return m_telemetry;
+  }
+
+private:
+  struct Set {
+    Category category;
+    uint64_t size;
+    bool evictable;
+    bool resident;
+    uint64_t lastUseFenceValue;  // 0 if never used
+  };
+
+  // The resident evictable sets the GPU is done with, least recently used first.
+  std::vector<SetId> GetEvictionCandidates(uint64_t completedFenceValue) const;
+  void Evict(SetId set);
+
+  std::unordered_map<SetId, Set> m_sets;
+  SetId m_nextSet = 0;
+  Telemetry m_telemetry;
+};
@@ -0,0 +1,220 @@
+#include "resource_allocator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+constexpr const char* kHeapTypeNames[] = { "default", "upload" };
+constexpr const char* kCategoryNames[] = { "buffers", "textures", "render targets" };
+
+ResourceAllocator::Category GetCategory(const D3D12_RESOURCE_DESC& desc) {
+  if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+    return ResourceAllocator::Category::kBuffer;
+  }
+  if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+    return ResourceAllocator::Category::kRenderTarget;
+  }
+  return ResourceAllocator::Category::kTexture;
+}
+
+D3D12_HEAP_FLAGS GetHeapFlags(ResourceAllocator::Category category) {
+  switch (category) {
+  case ResourceAllocator::Category::kBuffer:
+    return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+  case ResourceAllocator::Category::kRenderTarget:
+    return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+  default:
+    return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+  }
+}
+
+}  // namespace
+
+ResourceAllocator::ResourceAllocator(ID3D12Device* pDevice, UINT64 heapSize) :
+  m_device(pDevice),
+  m_heapSize(heapSize) {
+}
+
+ResourceAllocator::~ResourceAllocator() {
+}
+
+void ResourceAllocator::CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+  const D3D12_CLEAR_VALUE* pClearValue, ID3D12Resource** ppResource) {
+  const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &desc);
+  const Category category = GetCategory(desc);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Pool& pool = GetPool(heapType, category);
+  Allocation allocation = { &pool, nullptr, 0, allocationInfo.SizeInBytes };
+  if (allocationInfo.SizeInBytes > m_heapSize / 2) {
+    const CD3DX12_HEAP_PROPERTIES heapProperties(heapType);
+    ThrowIfFailed(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, initialState, pClearValue,
+      IID_PPV_ARGS(ppResource)));
+    ++pool.committedCount;
+    pool.committedSize += allocationInfo.SizeInBytes;
+  } else {
+    Heap* pHeap = nullptr;
+    UINT64 offset = BuddyAllocator::kInvalidOffset;
+    for (Heap& heap : pool.heaps) {
+      offset = heap.allocator->Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+      if (offset != BuddyAllocator::kInvalidOffset) {
+        pHeap = &heap;
+        break;
+      }
+    }
+    if (pHeap == nullptr) {
+      Heap heap;
+      // Aligned for multisampled render targets too.
+      const UINT64 heapAlignment = category == Category::kRenderTarget ?
+        D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+      const CD3DX12_HEAP_DESC heapDesc(m_heapSize, heapType, heapAlignment, GetHeapFlags(category));
+      ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap)));
+      SetNameIndexed(heap.heap.Get(), L"ResourceAllocator heap", static_cast<UINT>(pool.heaps.size()));
+      heap.allocator = std::make_unique<BuddyAllocator>(m_heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+      pool.heaps.push_back(std::move(heap));
+      pHeap = &pool.heaps.back();
+      offset = pHeap->allocator->Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+    }
+
+    const HRESULT hr = m_device->CreatePlacedResource(pHeap->heap.Get(), offset, &desc, initialState, pClearValue, IID_PPV_ARGS(ppResource));
+    if (FAILED(hr)) {
+      pHeap->allocator->Free(offset);
+      ThrowIfFailed(hr);
+    }
+    allocation.pHeap = pHeap->heap.Get();
+    allocation.offset = offset;
+  }
+  m_allocations[*ppResource] = allocation;
+}
+
+void ResourceAllocator::ReleaseResource(ID3D12Resource* pResource) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ReleaseResourceLocked(pResource);
+}
+
+void ResourceAllocator::RetireResource(ID3D12Resource* pResource, UINT64 fenceValue) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_retiredResources.push_back({ pResource, fenceValue });
+}
+
+UINT64 ResourceAllocator::Reclaim(UINT64 completedFenceValue) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  UINT64 releasedSize = 0;
+  while (!m_retiredResources.empty() && m_retiredResources.front().fenceValue <= completedFenceValue) {
+    releasedSize += ReleaseResourceLocked(m_retiredResources.front().resource.Get());
+    m_retiredResources.pop_front();
+  }
+  return releasedSize;
+}
+
+std::vector<ID3D12Pageable*> ResourceAllocator::GetPageables() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<ID3D12Pageable*> pageables;
+  for (auto& pools : m_pools) {
+    for (Pool& pool : pools) {
+      for (Heap& heap : pool.heaps) {
+        pageables.push_back(heap.heap.Get());
+      }
+    }
+  }
+  for (const auto& allocation : m_allocations) {
+    if (allocation.second.pHeap == nullptr) {
+      pageables.push_back(allocation.first);
+    }
+  }
+  return pageables;
+}
+
+ResourceAllocator::Statistics ResourceAllocator::GetStatistics(D3D12_HEAP_TYPE heapType, Category category) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return GetStatistics(GetPool(heapType, category));
+}
+
+void ResourceAllocator::LogStatistics() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (UINT heapType = 0; heapType < kNumHeapTypes; ++heapType) {
+    for (UINT category = 0; category < static_cast<UINT>(Category::kCount); ++category) {
+      const Statistics statistics = GetStatistics(m_pools[heapType][category]);
+      if (statistics.heapCount == 0 && statistics.committedCount == 0 && statistics.releasedCount == 0) {
+        continue;
+      }
+      // Internal: rounding up to blocks. External: free memory that no allocation can use at once.
+      const UINT64 freeSize = statistics.heapSize - statistics.usedSize;
+      const double internalFragmentation = statistics.usedSize > 0 ?
+        100.0 * (statistics.usedSize - statistics.requestedSize) / statistics.usedSize : 0.0;
+      const double externalFragmentation = freeSize > 0 ?
+        100.0 * (freeSize - statistics.largestFreeBlock) / freeSize : 0.0;
+      char message[256];
+      sprintf_s(message, "resource allocator: %s %s: %u heaps, %.1f of %.1f MB used by %u resources, "
+        "fragmentation %.0f%% internal %.0f%% external, %u committed (%.1f MB), %u released (%.1f MB)\n",
+        kHeapTypeNames[heapType], kCategoryNames[category], statistics.heapCount,
+        statistics.usedSize / (1024.0 * 1024.0), statistics.heapSize / (1024.0 * 1024.0), statistics.allocationCount,
+        internalFragmentation, externalFragmentation,
+        statistics.committedCount, statistics.committedSize / (1024.0 * 1024.0),
+        statistics.releasedCount, statistics.releasedSize / (1024.0 * 1024.0));
+      OutputDebugStringA(message);
+    }
+  }
+}
+
+UINT64 ResourceAllocator::ReleaseResourceLocked(ID3D12Resource* pResource) {
+  auto allocation = m_allocations.find(pResource);
+  if (allocation == m_allocations.end()) {
+    return 0;
+  }
+  const UINT64 size = allocation->second.size;
+  Pool& pool = *allocation->second.pPool;
+  if (allocation->second.pHeap == nullptr) {
+    --pool.committedCount;
+    pool.committedSize -= size;
+  } else {
+    for (auto heap = pool.heaps.begin(); heap != pool.heaps.end(); ++heap) {
+      if (heap->heap.Get() == allocation->second.pHeap) {
+        heap->allocator->Free(allocation->second.offset);
+        if (heap->allocator->GetAllocationCount() == 0) {
+          pool.heaps.erase(heap);
+        }
+        break;
+      }
+    }
+  }
+  ++pool.releasedCount;
+  pool.releasedSize += size;
+  m_allocations.erase(allocation);
+  return size;
+}
+
+ResourceAllocator::Pool& ResourceAllocator::GetPool(D3D12_HEAP_TYPE heapType, Category category) {
+  UINT heapTypeIndex = 0;
+  switch (heapType) {
+  case D3D12_HEAP_TYPE_DEFAULT:
+    heapTypeIndex = 0;
+    break;
+  case D3D12_HEAP_TYPE_UPLOAD:
+    heapTypeIndex = 1;
+    break;
+  default:
+    ThrowIfFailed(E_INVALIDARG);
+  }
+  return m_pools[heapTypeIndex][static_cast<UINT>(category)];
+}
+
+ResourceAllocator::Statistics ResourceAllocator::GetStatistics(const Pool& pool) const {
+  Statistics statistics;
+  statistics.heapCount = static_cast<UINT>(pool.heaps.size());
+  for (const Heap& heap : pool.heaps) {
+    statistics.heapSize += heap.allocator->GetCapacity();
+    statistics.allocationCount += heap.allocator->GetAllocationCount();
+    statistics.usedSize += heap.allocator->GetUsedSize();
+    statistics.requestedSize += heap.allocator->GetRequestedSize();
+    statistics.largestFreeBlock = (std::max)(statistics.largestFreeBlock, heap.allocator->GetLargestFreeBlock());
+  }
+  statistics.committedCount = pool.committedCount;
+  statistics.committedSize = pool.committedSize;
+  statistics.releasedCount = pool.releasedCount;
+  statistics.releasedSize = pool.releasedSize;
+  return statistics;
+}
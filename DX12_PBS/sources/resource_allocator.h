@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "memory_allocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Places resources in shared heaps instead of giving each one the implicit heap of a committed
+// resource. There is a pool of heaps for every heap type and category; the categories keep buffers,
+// render target and depth textures and other textures apart, as resource heap tier 1 requires.
+// A heap is split with a BuddyAllocator, a new heap is created when none has room, and a heap is
+// released once its last resource is. Resources larger than half a heap stay committed.
+// Resources only needed for a while, like the environment map the IBL maps are baked from, are
+// retired once the GPU has their last use queued: their memory goes to the resources placed after
+// them, or back to the system for a committed one or an emptied heap.
+// Thread safe.
+class ResourceAllocator {
+public:
+  enum class Category {
+    kBuffer,
+    kTexture,
+    kRenderTarget,  // render target or depth stencil textures
+    kCount
+  };
+
+  struct Statistics {
+    UINT heapCount = 0;
+    UINT64 heapSize = 0;  // of all the heaps
+    UINT allocationCount = 0;
+    UINT64 usedSize = 0;  // of the blocks
+    UINT64 requestedSize = 0;  // of the resources
+    UINT64 largestFreeBlock = 0;  // in any of the heaps
+    UINT committedCount = 0;  // too large to place
+    UINT64 committedSize = 0;
+    UINT releasedCount = 0;  // since the allocator was created
+    UINT64 releasedSize = 0;
+  };
+
+  ResourceAllocator(ID3D12Device* pDevice, UINT64 heapSize);
+  ~ResourceAllocator();
+
+  ResourceAllocator(const ResourceAllocator&) = delete;
+  ResourceAllocator& operator=(const ResourceAllocator&) = delete;
+
+  // heapType: D3D12_HEAP_TYPE_DEFAULT or D3D12_HEAP_TYPE_UPLOAD.
+  void CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* pClearValue, ID3D12Resource** ppResource);
+  // Gives the memory of a resource from CreateResource back. The GPU must be done with the resource;
+  // the memory may be reused right away, even while references to the resource are left.
+  void ReleaseResource(ID3D12Resource* pResource);
+  // Releases a resource from CreateResource once the fence reaches fenceValue, holding a reference
+  // to it until then, so the caller can drop its own right away.
+  void RetireResource(ID3D12Resource* pResource, UINT64 fenceValue);
+  // Releases the retired resources the GPU is done with. Returns the memory given back.
+  UINT64 Reclaim(UINT64 completedFenceValue);
+
+  // The heaps and the committed resources, which are made resident or evicted as a whole; placed
+  // resources can only be through their heaps.
+  std::vector<ID3D12Pageable*> GetPageables();
+
+  Statistics GetStatistics(D3D12_HEAP_TYPE heapType, Category category);
+  // Logs the statistics of every pool in use to the debugger.
+  void LogStatistics();
+
+private:
+  static constexpr UINT kNumHeapTypes = 2;  // default and upload
+
+  struct Heap {
+    ComPtr<ID3D12Heap> heap;
+    std::unique_ptr<BuddyAllocator> allocator;
+  };
+
+  struct Pool {
+    std::vector<Heap> heaps;
+    UINT committedCount = 0;
+    UINT64 committedSize = 0;
+    UINT releasedCount = 0;
+    UINT64 releasedSize = 0;
+  };
+
+  struct RetiredResource {
+    ComPtr<ID3D12Resource> resource;
+    UINT64 fenceValue;
+  };
+
+  struct Allocation {
+    Pool* pPool;
+    ID3D12Heap* pHeap;  // null if committed
+    UINT64 offset;
+    UINT64 size;
+  };
+
+  Pool& GetPool(D3D12_HEAP_TYPE heapType, Category category);
+  Statistics GetStatistics(const Pool& pool) const;
+  // Returns the size of the allocation, 0 if the resource isn't from CreateResource.
+  UINT64 ReleaseResourceLocked(ID3D12Resource* pResource);
+
+  ComPtr<ID3D12Device> m_device;
+  UINT64 m_heapSize = 0;
+
+  std::mutex m_mutex;  // guards the members below
+  Pool m_pools[kNumHeapTypes][static_cast<UINT>(Category::kCount)];
+  std::unordered_map<ID3D12Resource*, Allocation> m_allocations;
+  std::deque<RetiredResource> m_retiredResources;  // in fence order
+};
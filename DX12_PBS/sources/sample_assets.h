@@ -1,27 +1,21 @@
 #pragma once
 
 #include "core/stdafx.h"
+#include "sample_meshes.h"
+#include "shader_features.h"
 
 using namespace DirectX;
 
-struct ViewProjectionConstantBuffer {
-  XMFLOAT4X4 view;
-  XMFLOAT4X4 projection;
-  float padding[32];  // 256 bytes alignment
-};
-
-struct PrefilterConstantBuffer {
-  float roughness;
-  float padding[63];  // 256 bytes alignment
-};
-
 struct SceneConstantBuffer {
   XMFLOAT4X4 model;
   XMFLOAT4X4 view;
   XMFLOAT4X4 projection;
-  XMFLOAT4 camPos;
+  XMFLOAT3 camPos;
+  UINT numLights;
 };
 
+// Element of the lights StructuredBuffer in pbr_common.hlsli.
+// radius is derived from the color by LightManager, lights have no effect beyond it.
 struct LightState {
   LightState() = default;
   LightState(float posX, float posY, float posZ,
@@ -30,30 +24,49 @@ struct LightState {
     color[0] = colorR, color[1] = colorG, color[2] = colorB;
   }
 
-  float position[4]{};
-  float color[4]{};
+  float position[3]{};
+  float radius = 0.0f;
+  float color[3]{};
+  INT shadowIndex = -1;  // cube shadow map of the light, -1 for none
 };
-static constexpr UINT8 kNumLights = 4;
-struct LightStatesConstantBuffer {
-  LightState lights[kNumLights];
+
+struct TiledShadingConstantBuffer {
+  XMFLOAT4X4 view;
+  XMFLOAT4X4 invProjection;
+  XMFLOAT4X4 invView;
+  XMFLOAT3 camPos;
+  UINT numLights;
+  UINT screenWidth;
+  UINT screenHeight;
+};
+
+// Shadow maps of ShadowCache, read by shadows.hlsli.
+struct ShadowConstantBuffer {
+  XMFLOAT4X4 cascadeViewProjection[shader_constants::kNumCascades];
+  XMFLOAT4 cascadeParams[shader_constants::kNumCascades];  // x: world size of a texel, y: 1 once rendered
+  XMFLOAT4 pointShadowParams[shader_constants::kMaxPointShadows];  // x: near z, y: far z, z: 1 once rendered
+  XMFLOAT4 pointShadowPositions[shader_constants::kMaxPointShadows];  // xyz: light position the cube was rendered from
+  XMFLOAT3 lightDirection;  // direction the directional light travels in
+  float padding0;
+  XMFLOAT3 lightColor;
+  float padding1;
+};
+
+// Heap indices of the views the BINDLESS shader variants read, root constants of bindless.hlsli.
+struct BindlessIndices {
+  UINT irradianceMap = 0;
+  UINT prefilterMap = 0;  // first mip, the others follow
+  UINT BRDFLut = 0;
+  UINT cubeMap = 0;
+  UINT cascadeShadowMaps = 0;
+  UINT pointShadowMaps = 0;
+  UINT gbuffer = 0;  // normal, material and depth
+  UINT tiledShadingOutput = 0;
 };
 
 class Model {
 public:
-  struct Vertex {
-    Vertex() = default;
-    Vertex(float posX, float posY, float posZ,
-      float normalX, float normalY, float normalZ,
-      float u, float v) {
-      position[0] = posX; position[1] = posY; position[2] = posZ;
-      normal[0] = normalX; normal[1] = normalY; normal[2] = normalZ;
-      uv[0] = u; uv[1] = v;
-    }
-
-    float position[3]{};
-    float normal[3]{};
-    float uv[2]{};
-  };  // struct Vertex
+  using Vertex = MeshVertex;
 
   static size_t GetVertexStride() {
     return sizeof(Vertex);
@@ -165,92 +178,3 @@ public:
   }
 };
 
-class SphereModel {
-public:
-  SphereModel(UINT x_segments, UINT y_segments) 
-    : X_SEGMENTS(x_segments), Y_SEGMENTS(y_segments) {
-
-  }
-
-  std::unique_ptr<Model::Vertex[]> GetVertexData() {
-    std::vector<XMFLOAT3> positions;
-    std::vector<XMFLOAT2> uv;
-    std::vector<XMFLOAT3> normals;
-    for (UINT x = 0; x <= X_SEGMENTS; ++x) {
-      for (UINT y = 0; y <= Y_SEGMENTS; ++y) {
-        float xSegment = (float)x / (float)X_SEGMENTS;
-        float ySegment = (float)y / (float)Y_SEGMENTS;
-        float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-        float yPos = std::cos(ySegment * PI);
-        float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-
-        positions.push_back(XMFLOAT3(xPos, yPos, zPos));
-        uv.push_back(XMFLOAT2(xSegment, ySegment));
-        normals.push_back(XMFLOAT3(xPos, yPos, zPos));
-      }
-    }
-
-    const size_t vertexCount = positions.size();
-    std::unique_ptr<Model::Vertex[]> vertices_ptr = std::make_unique<Model::Vertex[]>(vertexCount);
-
-    for (size_t i = 0; i < vertexCount; ++i) {
-      vertices_ptr[i] = Model::Vertex(positions[i].x, positions[i].y, positions[i].z,
-        normals[i].x, normals[i].y, normals[i].z,
-        uv[i].x, uv[i].y);
-    }
-
-    m_vertexCount = vertexCount;
-
-    return vertices_ptr;
-  }
-
-  std::unique_ptr<DWORD[]> GetIndexData() {
-    std::vector<DWORD> indices;
-
-    bool oddRow = false;
-    for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
-    {
-      if (!oddRow) // even rows: y == 0, y == 2; and so on
-      {
-        for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
-        {
-          indices.push_back(y * (X_SEGMENTS + 1) + x);
-          indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-        }
-      }
-      else
-      {
-        for (int x = X_SEGMENTS; x >= 0; --x)
-        {
-          indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-          indices.push_back(y * (X_SEGMENTS + 1) + x);
-        }
-      }
-      oddRow = !oddRow;
-    }
-
-    size_t indexCount = indices.size();
-    m_indexCount = indexCount;
-    std::unique_ptr<DWORD[]> indices_ptr = std::make_unique<DWORD[]>(indexCount);
-    memcpy(indices_ptr.get(), indices.data(), indexCount * sizeof(DWORD));
-
-    return indices_ptr;
-  }
-
-  size_t GetVertexDataSize() const {
-    return Model::GetVertexStride() * m_vertexCount;
-  }
-
-  size_t GetIndexDataSize() const {
-    return sizeof(DWORD) * m_indexCount;
-  }
-
-private:
-  static constexpr float PI = 3.14159265359f;
-
-  const UINT X_SEGMENTS = 0;
-  const UINT Y_SEGMENTS = 0;
-
-  size_t m_vertexCount = 0;
-  size_t m_indexCount = 0;
-};
\ No newline at end of file
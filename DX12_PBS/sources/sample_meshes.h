@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// The procedural meshes and instances of the scene. Only the standard library, unlike sample_assets.h,
+// so that their microbenchmarks also build on Linux, see tests/portable_benchmarks.cpp.
+
+struct MeshVertex {
+  MeshVertex() = default;
+  MeshVertex(float posX, float posY, float posZ,
+    float normalX, float normalY, float normalZ,
+    float u, float v) {
+    position[0] = posX; position[1] = posY; position[2] = posZ;
+    normal[0] = normalX; normal[1] = normalY; normal[2] = normalZ;
+    uv[0] = u; uv[1] = v;
+  }
+
+  float position[3]{};
+  float normal[3]{};
+  float uv[2]{};
+};  // struct MeshVertex
+
+class SphereModel {
+public:
+  SphereModel(uint32_t x_segments, uint32_t y_segments) 
+    : X_SEGMENTS(x_segments), Y_SEGMENTS(y_segments) {
+
+  }
+
+  std::unique_ptr<MeshVertex[]> GetVertexData() {
+    const size_t vertexCount = static_cast<size_t>(X_SEGMENTS + 1) * (Y_SEGMENTS + 1);
+    std::unique_ptr<MeshVertex[]> vertices_ptr = std::make_unique<MeshVertex[]>(vertexCount);
+
+    size_t i = 0;
+    for (uint32_t x = 0; x <= X_SEGMENTS; ++x) {
+      for (uint32_t y = 0; y <= Y_SEGMENTS; ++y) {
+        float xSegment = (float)x / (float)X_SEGMENTS;
+        float ySegment = (float)y / (float)Y_SEGMENTS;
+        float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+        float yPos = std::cos(ySegment * PI);
+        float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+
+        // On the unit sphere, the normal is the position.
+        vertices_ptr[i++] = MeshVertex(xPos, yPos, zPos, xPos, yPos, zPos, xSegment, ySegment);
+      }
+    }
+
+    m_vertexCount = vertexCount;
+
+    return vertices_ptr;
+  }
+
+  std::unique_ptr<uint32_t[]> GetIndexData() {
+    std::vector<uint32_t> indices;
+
+    bool oddRow = false;
+    for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+    {
+      if (!oddRow) // even rows: y == 0, y == 2; and so on
+      {
+        for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+        {
+          indices.push_back(y * (X_SEGMENTS + 1) + x);
+          indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+        }
+      }
+      else
+      {
+        for (int x = X_SEGMENTS; x >= 0; --x)
+        {
+          indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+          indices.push_back(y * (X_SEGMENTS + 1) + x);
+        }
+      }
+      oddRow = !oddRow;
+    }
+
+    size_t indexCount = indices.size();
+    m_indexCount = indexCount;
+    std::unique_ptr<uint32_t[]> indices_ptr = std::make_unique<uint32_t[]>(indexCount);
+    memcpy(indices_ptr.get(), indices.data(), indexCount * sizeof(uint32_t));
+
+    return indices_ptr;
+  }
+
+  size_t GetVertexDataSize() const {
+    return sizeof(MeshVertex) * m_vertexCount;
+  }
+
+  size_t GetIndexDataSize() const {
+    return sizeof(uint32_t) * m_indexCount;
+  }
+
+private:
+  static constexpr float PI = 3.14159265359f;
+
+  const uint32_t X_SEGMENTS = 0;
+  const uint32_t Y_SEGMENTS = 0;
+
+  size_t m_vertexCount = 0;
+  size_t m_indexCount = 0;
+};
+
+struct SphereInstance {
+  float translation[3]{};
+  float pbrProperties[3]{};  // r: metallic, g: roughness, b: ao
+};
+
+// Layers after the first repeat the grid further away from the camera; they are only drawn by the
+// shading benchmark to add overdraw.
+inline std::unique_ptr<SphereInstance[]> GetSphereInstanceData(uint32_t numLayers, uint32_t& instanceCount) {
+  const int nrRows = 7;
+  const int nrColumns = 7;
+  const float spacing = 2.5f;
+  instanceCount = static_cast<uint32_t>(nrRows * nrColumns) * numLayers;
+
+  std::vector<SphereInstance> instances;
+
+  for (uint32_t layer = 0; layer < numLayers; ++layer) {
+    for (int row = 0; row < nrRows; ++row) {
+      float metallic = (float)row / (float)nrRows;
+      for (int col = 0; col < nrColumns; ++col) {
+        float roughness = (std::max)((float)col / (float)nrColumns, 0.05f);
+        SphereInstance instance;
+        instance.translation[0] = (col - (nrColumns / 2)) * spacing;
+        instance.translation[1] = (row - (nrRows / 2)) * spacing;
+        instance.translation[2] = -(float)layer * spacing;
+        instance.pbrProperties[0] = metallic;
+        instance.pbrProperties[1] = roughness;
+        instances.emplace_back(instance);
+      }
+    }
+  }
+
+  instanceCount = static_cast<uint32_t>(instances.size());
+  std::unique_ptr<SphereInstance[]> instances_ptr = std::make_unique<SphereInstance[]>(instances.size());
+  memcpy(instances_ptr.get(), instances.data(), sizeof(SphereInstance) * instances.size());
+
+  return instances_ptr;
+}
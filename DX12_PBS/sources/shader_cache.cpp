@@ -0,0 +1,209 @@
+#include "shader_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+constexpr char kArchiveMagic[4] = {'S', 'H', 'D', 'C'};
+constexpr uint32_t kArchiveVersion = 1;  // VERSION in tools/build_shader_cache.py
+
+struct ArchiveHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+};
+
+#pragma pack(push, 4)
+struct ArchiveEntry {
+  uint64_t key;
+  uint32_t size;
+};
+#pragma pack(pop)
+static_assert(sizeof(ArchiveEntry) == 12, "entries are packed in the archive");
+
+std::wstring ToWide(const std::string& string) {
+  const int length = MultiByteToWideChar(CP_UTF8, 0, string.c_str(), static_cast<int>(string.size()), nullptr, 0);
+  std::wstring wide(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, string.c_str(), static_cast<int>(string.size()), &wide[0], length);
+  return wide;
+}
+
+std::string ToUtf8(const std::wstring& wide) {
+  const int length = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), static_cast<int>(wide.size()), nullptr, 0, nullptr, nullptr);
+  std::string string(length, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), static_cast<int>(wide.size()), &string[0], length, nullptr, nullptr);
+  return string;
+}
+
+bool ReadShaderFile(const std::string& path, std::string* pContents) {
+  std::ifstream file(ToWide(path), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  pContents->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+}  // namespace
+
+ShaderCache::ShaderCache(const std::wstring& rootPath, bool hotReload) :
+  m_rootPath(rootPath),
+  m_hotReload(hotReload) {
+  LoadArchive(m_rootPath + L"assets/shaders.cache");
+  if (m_hotReload) {
+    CreateCompiler();
+  }
+}
+
+ShaderCache::~ShaderCache() {
+  // The compiler's objects must be gone before its module is.
+  m_compiledShaders.clear();
+  m_dxcIncludeHandler.Reset();
+  m_dxcCompiler.Reset();
+  m_dxcUtils.Reset();
+  if (m_compilerModule) {
+    FreeLibrary(m_compilerModule);
+  }
+}
+
+D3D12_SHADER_BYTECODE ShaderCache::GetShader(LPCWSTR shaderFile, const std::string& entryPoint, const std::string& target,
+  const std::vector<ShaderDefine>& defines) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const std::wstring shaderPath = m_rootPath + shaderFile;
+  std::string keyPath = ToUtf8(shaderPath);
+  for (char& c : keyPath) {
+    if (c == '\\') {
+      c = '/';
+    }
+  }
+  const uint64_t key = ComputeShaderKey(keyPath, entryPoint, target, defines, ReadShaderFile);
+
+  std::string identity = ToUtf8(shaderFile) + " " + entryPoint + " " + target;
+  for (const ShaderDefine& define : defines) {
+    identity += " " + define.name + "=" + define.value;
+  }
+
+  D3D12_SHADER_BYTECODE bytecode{};
+  auto archived = m_archiveShaders.find(key);
+  auto compiled = m_compiledShaders.find(key);
+  if (archived != m_archiveShaders.end()) {
+    bytecode = archived->second;
+  } else if (!m_hotReload) {
+    OutputDebugStringA(("shaders.cache has no " + identity + ", rebuild the project or run with -shaderHotReload.\n").c_str());
+    ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+  } else if (compiled != m_compiledShaders.end()) {
+    bytecode = {compiled->second->GetBufferPointer(), compiled->second->GetBufferSize()};
+  } else {
+    ComPtr<IDxcBlob> blob;
+    if (Compile(shaderPath, entryPoint, target, defines, &blob)) {
+      bytecode = {blob->GetBufferPointer(), blob->GetBufferSize()};
+      m_compiledShaders[key] = blob;
+    } else {
+      auto last = m_lastShaders.find(identity);
+      if (last == m_lastShaders.end()) {
+        ThrowIfFailed(E_FAIL);
+      }
+      OutputDebugStringA(("Keeping the previous version of " + identity + ".\n").c_str());
+      bytecode = last->second;
+    }
+  }
+
+  m_lastShaders[identity] = bytecode;
+  return bytecode;
+}
+
+void ShaderCache::LoadArchive(const std::wstring& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return;
+  }
+  m_archive.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+  // A damaged or outdated archive is ignored, like a missing one.
+  ArchiveHeader header{};
+  if (m_archive.size() < sizeof(header)) {
+    return;
+  }
+  memcpy(&header, m_archive.data(), sizeof(header));
+  const size_t entriesSize = static_cast<size_t>(header.count) * sizeof(ArchiveEntry);
+  if (memcmp(header.magic, kArchiveMagic, sizeof(kArchiveMagic)) != 0 || header.version != kArchiveVersion ||
+    m_archive.size() - sizeof(header) < entriesSize) {
+    OutputDebugStringA("Ignoring shaders.cache, it was written by another version of build_shader_cache.py.\n");
+    return;
+  }
+
+  size_t offset = sizeof(header) + entriesSize;
+  for (uint32_t i = 0; i < header.count; ++i) {
+    ArchiveEntry entry{};
+    memcpy(&entry, m_archive.data() + sizeof(header) + i * sizeof(ArchiveEntry), sizeof(entry));
+    if (m_archive.size() - offset < entry.size) {
+      m_archiveShaders.clear();
+      return;
+    }
+    m_archiveShaders[entry.key] = {m_archive.data() + offset, entry.size};
+    offset += entry.size;
+  }
+}
+
+void ShaderCache::CreateCompiler() {
+  m_compilerModule = LoadLibraryW(L"dxcompiler.dll");
+  if (!m_compilerModule) {
+    OutputDebugStringA("Shader hot reload needs dxcompiler.dll.\n");
+    ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  auto dxcCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(m_compilerModule, "DxcCreateInstance"));
+  if (!dxcCreateInstance) {
+    ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  ThrowIfFailed(dxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_dxcUtils)));
+  ThrowIfFailed(dxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_dxcCompiler)));
+  ThrowIfFailed(m_dxcUtils->CreateDefaultIncludeHandler(&m_dxcIncludeHandler));
+}
+
+bool ShaderCache::Compile(const std::wstring& shaderPath, const std::string& entryPoint, const std::string& target,
+  const std::vector<ShaderDefine>& defines, IDxcBlob** ppBytecode) {
+  ComPtr<IDxcBlobEncoding> source;
+  if (FAILED(m_dxcUtils->LoadFile(shaderPath.c_str(), nullptr, &source))) {
+    return false;
+  }
+  DxcBuffer sourceBuffer{};
+  sourceBuffer.Ptr = source->GetBufferPointer();
+  sourceBuffer.Size = source->GetBufferSize();
+  sourceBuffer.Encoding = DXC_CP_ACP;
+
+  // The same arguments as tools/build_shader_cache.py.
+  std::vector<std::wstring> arguments = {shaderPath, L"-E", ToWide(entryPoint), L"-T", ToWide(target), L"-Qstrip_reflect"};
+#if defined(_DEBUG)
+  arguments.insert(arguments.end(), {L"-Zi", L"-Qembed_debug", L"-Od"});
+#else
+  arguments.push_back(L"-O3");
+#endif
+  for (const ShaderDefine& define : defines) {
+    arguments.push_back(L"-D");
+    arguments.push_back(ToWide(define.name + "=" + define.value));
+  }
+  std::vector<LPCWSTR> argumentPointers;
+  for (const std::wstring& argument : arguments) {
+    argumentPointers.push_back(argument.c_str());
+  }
+
+  ComPtr<IDxcResult> result;
+  ThrowIfFailed(m_dxcCompiler->Compile(&sourceBuffer, argumentPointers.data(), static_cast<UINT32>(argumentPointers.size()),
+    m_dxcIncludeHandler.Get(), IID_PPV_ARGS(&result)));
+
+  ComPtr<IDxcBlobUtf8> errors;
+  if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) && errors && errors->GetStringLength() > 0) {
+    OutputDebugStringA(errors->GetStringPointer());
+  }
+  HRESULT status = S_OK;
+  ThrowIfFailed(result->GetStatus(&status));
+  if (FAILED(status)) {
+    return false;
+  }
+  ThrowIfFailed(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(ppBytecode), nullptr));
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/stdafx.h"
+#include <dxcapi.h>
+
+#include "shader_key.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Shader bytecode compiled at build time by tools/build_shader_cache.py into assets/shaders.cache.
+// Bytecode is looked up by ComputeShaderKey, so a shader whose source, includes or defines changed
+// since the build isn't found. That is an error, unless hot reload is enabled: shaders missing from
+// the archive are then compiled with dxcompiler.dll, which must be next to the executable or on the
+// PATH, and a shader that fails to compile falls back to its last successful version. Thread safe.
+class ShaderCache {
+public:
+  // rootPath: the directory shader files are relative to.
+  ShaderCache(const std::wstring& rootPath, bool hotReload);
+  ~ShaderCache();
+
+  ShaderCache(const ShaderCache&) = delete;
+  ShaderCache& operator=(const ShaderCache&) = delete;
+
+  // The bytecode stays valid as long as the cache.
+  D3D12_SHADER_BYTECODE GetShader(LPCWSTR shaderFile, const std::string& entryPoint, const std::string& target,
+    const std::vector<ShaderDefine>& defines = {});
+
+  bool IsHotReloadEnabled() const {
+    return m_hotReload;
+  }
+
+private:
+  void LoadArchive(const std::wstring& path);
+  void CreateCompiler();
+  // Returns false if the shader doesn't compile.
+  bool Compile(const std::wstring& shaderPath, const std::string& entryPoint, const std::string& target,
+    const std::vector<ShaderDefine>& defines, IDxcBlob** ppBytecode);
+
+  std::mutex m_mutex;
+  std::wstring m_rootPath;
+  bool m_hotReload = false;
+  std::vector<char> m_archive;
+  std::unordered_map<uint64_t, D3D12_SHADER_BYTECODE> m_archiveShaders;  // pointing into m_archive
+
+  HMODULE m_compilerModule = nullptr;
+  ComPtr<IDxcUtils> m_dxcUtils;
+  ComPtr<IDxcCompiler3> m_dxcCompiler;
+  ComPtr<IDxcIncludeHandler> m_dxcIncludeHandler;
+  std::unordered_map<uint64_t, ComPtr<IDxcBlob>> m_compiledShaders;
+  // The last bytecode returned for a file, entry point, target and defines.
+  std::unordered_map<std::string, D3D12_SHADER_BYTECODE> m_lastShaders;
+};
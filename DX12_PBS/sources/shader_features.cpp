@@ -0,0 +1,46 @@
+#include "shader_features.h"
+
+ShaderFeatureKey ShaderFeatureKey::FromIndex(UINT index) {
+  ShaderFeatureKey key;
+#define DECODE_SHADER_OPTION(name, hlslName, count, defaultValue) \
+  key.name = index % count; \
+  index /= count;
+  SHADER_OPTIONS(DECODE_SHADER_OPTION)
+#undef DECODE_SHADER_OPTION
+  return key;
+}
+
+UINT ShaderFeatureKey::GetIndex() const {
+  UINT index = 0;
+  UINT stride = 1;
+#define ENCODE_SHADER_OPTION(name, hlslName, count, defaultValue) \
+  index += name * stride; \
+  stride *= count;
+  SHADER_OPTIONS(ENCODE_SHADER_OPTION)
+#undef ENCODE_SHADER_OPTION
+  return index;
+}
+
+std::vector<ShaderDefine> ShaderFeatureKey::GetDefines() const {
+  std::vector<ShaderDefine> defines;
+#define ADD_SHADER_CONSTANT(name, hlslName, value) defines.push_back({#hlslName, std::to_string(value)});
+  SHADER_CONSTANTS(ADD_SHADER_CONSTANT)
+#undef ADD_SHADER_CONSTANT
+#define ADD_SHADER_OPTION(name, hlslName, count, defaultValue) defines.push_back({#hlslName, std::to_string(name)});
+  SHADER_OPTIONS(ADD_SHADER_OPTION)
+#undef ADD_SHADER_OPTION
+  return defines;
+}
+
+std::wstring ShaderFeatureKey::GetName() const {
+  std::wstring name;
+#define APPEND_SHADER_OPTION(option, hlslName, count, defaultValue) \
+  name += (name.empty() ? L"" : L" ") + std::wstring(L## #hlslName L"=") + std::to_wstring(option);
+  SHADER_OPTIONS(APPEND_SHADER_OPTION)
+#undef APPEND_SHADER_OPTION
+  return name;
+}
+
+const char* ShaderFeatureKey::GetShaderModel() const {
+  return bindless ? "6_6" : "6_0";
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/stdafx.h"
+#include "shader_key.h"
+
+// Values the C++ code and the shaders both depend on. They are listed once, here, and passed to
+// every shader as defines, so the two can't drift apart.
+// tools/build_shader_cache.py reads both lists to compile the shaders, so keep one entry per line.
+// X(C++ name, HLSL define, value)
+#define SHADER_CONSTANTS(X) \
+  X(kPrefilterMapMipLevels, PREFILTER_MIP_LEVELS, 5) \
+  X(kIBLSampleCount, IBL_SAMPLE_COUNT, 1024) \
+  X(kTiledShadingTileSize, TILE_SIZE, 16) \
+  X(kMaxLightsPerTile, MAX_LIGHTS_PER_TILE, 256) \
+  X(kNumCascades, NUM_CASCADES, 4) \
+  X(kMaxPointShadows, MAX_POINT_SHADOWS, 4)
+
+// Defines the shaders are compiled for every value of, below count. The branches of the other values
+// are compiled out of a variant.
+// X(ShaderFeatureKey member, HLSL define, count, default value)
+#define SHADER_OPTIONS(X) \
+  X(shadows, SHADOWS, 2, 1) \
+  X(tonemapOperator, TONEMAP_OPERATOR, 2, 0) \
+  X(bindless, BINDLESS, 2, 0)
+
+// Variants with this option set index ResourceDescriptorHeap, so they are compiled for shader model 6.6,
+// and the others for 6.0. Matches ShaderFeatureKey::GetShaderModel.
+#define SHADER_MODEL_6_6_OPTION BINDLESS
+
+namespace shader_constants {
+
+#define DECLARE_SHADER_CONSTANT(name, hlslName, value) constexpr UINT name = value;
+SHADER_CONSTANTS(DECLARE_SHADER_CONSTANT)
+#undef DECLARE_SHADER_CONSTANT
+
+}  // namespace shader_constants
+
+// Selects a variant of the shaders, by a value of every SHADER_OPTIONS entry.
+struct ShaderFeatureKey {
+#define DECLARE_SHADER_OPTION(name, hlslName, count, defaultValue) UINT name = defaultValue;
+  SHADER_OPTIONS(DECLARE_SHADER_OPTION)
+#undef DECLARE_SHADER_OPTION
+
+  // Number of variants, which GetIndex enumerates.
+  static constexpr UINT kCount = 1
+#define MULTIPLY_SHADER_OPTION_COUNT(name, hlslName, count, defaultValue) * count
+    SHADER_OPTIONS(MULTIPLY_SHADER_OPTION_COUNT);
+#undef MULTIPLY_SHADER_OPTION_COUNT
+
+  static ShaderFeatureKey FromIndex(UINT index);
+  UINT GetIndex() const;
+
+  // Every constant, then every option, in the order of the lists.
+  std::vector<ShaderDefine> GetDefines() const;
+  // The options as NAME=VALUE, to tell the pipeline states of the variants apart.
+  std::wstring GetName() const;
+  // The suffix of the shader targets, e.g. "6_0" for vs_6_0.
+  const char* GetShaderModel() const;
+};
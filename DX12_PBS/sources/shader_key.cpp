@@ -0,0 +1,121 @@
+#include "shader_key.h"
+
+#include <cctype>
+#include <set>
+
+namespace {
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+void HashBytes(const char* pData, size_t size, uint64_t* pHash) {
+  for (size_t i = 0; i < size; ++i) {
+    *pHash = (*pHash ^ static_cast<uint8_t>(pData[i])) * kFnvPrime;
+  }
+}
+
+void HashString(const std::string& string, uint64_t* pHash) {
+  HashBytes(string.c_str(), string.size() + 1, pHash);  // with the terminating 0
+}
+
+std::string GetDirectory(const std::string& path) {
+  const size_t separator = path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+// The file of an #include "..." line, or an empty string.
+std::string ParseInclude(const std::string& line) {
+  size_t i = 0;
+  auto skipSpaces = [&] {
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) {
+      ++i;
+    }
+  };
+  skipSpaces();
+  if (i == line.size() || line[i] != '#') {
+    return std::string();
+  }
+  ++i;
+  skipSpaces();
+  if (line.compare(i, 7, "include") != 0) {
+    return std::string();
+  }
+  i += 7;
+  skipSpaces();
+  if (i == line.size() || line[i] != '"') {
+    return std::string();
+  }
+  const size_t end = line.find('"', i + 1);
+  return end == std::string::npos ? std::string() : line.substr(i + 1, end - i - 1);
+}
+
+bool IsIdentifierChar(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool ContainsIdentifier(const std::string& text, const std::string& identifier) {
+  for (size_t i = text.find(identifier); i != std::string::npos; i = text.find(identifier, i + 1)) {
+    const size_t end = i + identifier.size();
+    if ((i == 0 || !IsIdentifierChar(text[i - 1])) && (end == text.size() || !IsIdentifierChar(text[end]))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Appends the normalized contents of the file and its includes to *pSources.
+void HashFile(const std::string& path, const ShaderFileReader& readFile, std::set<std::string>* pVisited, uint64_t* pHash,
+  std::string* pSources) {
+  if (!pVisited->insert(path).second) {
+    return;
+  }
+  std::string contents;
+  if (!readFile(path, &contents)) {
+    // Hashed like an empty file, the compiler reports it.
+    HashString(std::string(), pHash);
+    return;
+  }
+
+  std::string normalized;
+  normalized.reserve(contents.size());
+  for (char c : contents) {
+    if (c != '\r') {
+      normalized += c;
+    }
+  }
+  HashString(normalized, pHash);
+  *pSources += normalized;
+  *pSources += '\n';
+
+  const std::string directory = GetDirectory(path);
+  size_t lineStart = 0;
+  while (lineStart < normalized.size()) {
+    size_t lineEnd = normalized.find('\n', lineStart);
+    if (lineEnd == std::string::npos) {
+      lineEnd = normalized.size();
+    }
+    const std::string include = ParseInclude(normalized.substr(lineStart, lineEnd - lineStart));
+    if (!include.empty()) {
+      HashFile(directory + include, readFile, pVisited, pHash, pSources);
+    }
+    lineStart = lineEnd + 1;
+  }
+}
+
+}  // namespace
+
+uint64_t ComputeShaderKey(const std::string& shaderPath, const std::string& entryPoint, const std::string& target,
+  const std::vector<ShaderDefine>& defines, const ShaderFileReader& readFile) {
+  uint64_t hash = kFnvOffsetBasis;
+  std::set<std::string> visited;
+  std::string sources;
+  HashFile(shaderPath, readFile, &visited, &hash, &sources);
+  HashString(entryPoint, &hash);
+  HashString(target, &hash);
+  for (const ShaderDefine& define : defines) {
+    if (ContainsIdentifier(sources, define.name)) {
+      HashString(define.name + "=" + define.value, &hash);
+    }
+  }
+  return hash;
+}
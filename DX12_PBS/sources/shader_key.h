@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Identifies compiled shader bytecode by what it was compiled from. tools/build_shader_cache.py
+// computes the same key, so both sides have to change together.
+// The key is the 64-bit FNV-1a hash of, in order:
+// - the shader file, then every file it #include "..."s (depth first, each file once, paths
+//   relative to the including file), each with '\r' removed and followed by a 0 byte,
+// - the entry point and the target, each followed by a 0 byte,
+// - every define as NAME=VALUE followed by a 0 byte, leaving out the defines whose name doesn't
+//   appear in those files as an identifier, so a shader has one key for all the values of a
+//   define it doesn't use.
+// Doesn't know about D3D12 or the file system, files are read through the reader.
+
+struct ShaderDefine {
+  std::string name;
+  std::string value;
+};
+
+// Returns false if the file doesn't exist. Paths use '/' separators.
+using ShaderFileReader = std::function<bool(const std::string& path, std::string* pContents)>;
+
+uint64_t ComputeShaderKey(const std::string& shaderPath, const std::string& entryPoint, const std::string& target,
+  const std::vector<ShaderDefine>& defines, const ShaderFileReader& readFile);
@@ -0,0 +1,69 @@
+#include "shading_benchmark.h"
+
+#include <fstream>
+
+ShadingBenchmark::ShadingBenchmark() {
+  const UINT lightCounts[] = { 4, 16, 64, 256, 1024 };
+  const UINT instanceLayerCounts[] = { 1, 4, 16 };
+  const ShadingMode modes[] = { ShadingMode::kForward, ShadingMode::kTiledDeferred };
+  for (UINT numInstanceLayers : instanceLayerCounts) {
+    for (UINT numLights : lightCounts) {
+      for (ShadingMode mode : modes) {
+        Configuration configuration;
+        configuration.mode = mode;
+        configuration.numLights = numLights;
+        configuration.numInstanceLayers = numInstanceLayers;
+        m_configurations.emplace_back(configuration);
+      }
+    }
+  }
+  m_averageFrameTimes.resize(m_configurations.size());
+}
+
+void ShadingBenchmark::Start() {
+  m_running = true;
+  m_currentConfiguration = 0;
+  m_frameInConfiguration = 0;
+  m_accumulatedSeconds = 0.0;
+}
+
+bool ShadingBenchmark::Tick(double elapsedSeconds) {
+  if (!m_running) {
+    return false;
+  }
+
+  // The first frames after a switch still contain the previous configuration's frames in flight.
+  if (m_frameInConfiguration >= kWarmupFrames) {
+    m_accumulatedSeconds += elapsedSeconds;
+  }
+  ++m_frameInConfiguration;
+  if (m_frameInConfiguration < kWarmupFrames + kMeasuredFrames) {
+    return false;
+  }
+
+  m_averageFrameTimes[m_currentConfiguration] = m_accumulatedSeconds * 1000.0 / kMeasuredFrames;
+  m_frameInConfiguration = 0;
+  m_accumulatedSeconds = 0.0;
+  ++m_currentConfiguration;
+  if (m_currentConfiguration == m_configurations.size()) {
+    m_currentConfiguration = 0;
+    m_running = false;
+  }
+  return true;
+}
+
+void ShadingBenchmark::WriteResults(const std::wstring& csvFilePath) const {
+  std::ofstream csvFile(csvFilePath);
+  const char* header = "mode,lights,instance_layers,avg_frame_ms\n";
+  csvFile << header;
+  OutputDebugStringA(header);
+  for (size_t i = 0; i < m_configurations.size(); ++i) {
+    const Configuration& configuration = m_configurations[i];
+    char row[128] = {};
+    sprintf_s(row, "%s,%u,%u,%.3f\n",
+      configuration.mode == ShadingMode::kForward ? "forward" : "tiled_deferred",
+      configuration.numLights, configuration.numInstanceLayers, m_averageFrameTimes[i]);
+    csvFile << row;
+    OutputDebugStringA(row);
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/stdafx.h"
+
+enum class ShadingMode {
+  kForward,
+  kTiledDeferred,
+};
+
+// Sweeps the forward and the tiled deferred shading path over growing light and instance counts,
+// and records the average frame time of every configuration.
+class ShadingBenchmark {
+public:
+  struct Configuration {
+    ShadingMode mode = ShadingMode::kForward;
+    UINT numLights = 0;
+    UINT numInstanceLayers = 0;
+  };
+
+  ShadingBenchmark();
+
+  ShadingBenchmark(const ShadingBenchmark&) = delete;
+  ShadingBenchmark& operator=(const ShadingBenchmark&) = delete;
+
+  void Start();
+  bool IsRunning() const { return m_running; }
+
+  // Feeds the duration of the last frame. Returns true when the configuration to render has changed,
+  // including when the sweep has just finished.
+  bool Tick(double elapsedSeconds);
+
+  const Configuration& GetCurrentConfiguration() const {
+    return m_configurations[m_currentConfiguration];
+  }
+
+  // Writes one CSV row per configuration and echoes it to the debugger output.
+  void WriteResults(const std::wstring& csvFilePath) const;
+
+private:
+  static constexpr UINT kWarmupFrames = 30;
+  static constexpr UINT kMeasuredFrames = 120;
+
+  std::vector<Configuration> m_configurations;
+  std::vector<double> m_averageFrameTimes;  // in milliseconds
+  size_t m_currentConfiguration = 0;
+  UINT m_frameInConfiguration = 0;
+  double m_accumulatedSeconds = 0.0;
+  bool m_running = false;
+};
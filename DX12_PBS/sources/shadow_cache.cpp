@@ -0,0 +1,343 @@
+#include "shadow_cache.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "core/DXSampleHelper.h"
+#include "util/Camera.h"
+
+namespace {
+
+// D3D cube map face order and orientation, the faces are rendered with left handed matrices.
+const float kCubeFaceDirections[] = {
+   1.0f,  0.0f,  0.0f,
+  -1.0f,  0.0f,  0.0f,
+   0.0f,  1.0f,  0.0f,
+   0.0f, -1.0f,  0.0f,
+   0.0f,  0.0f,  1.0f,
+   0.0f,  0.0f, -1.0f,
+};
+const float kCubeFaceUps[] = {
+  0.0f, 1.0f,  0.0f,
+  0.0f, 1.0f,  0.0f,
+  0.0f, 0.0f, -1.0f,
+  0.0f, 0.0f,  1.0f,
+  0.0f, 1.0f,  0.0f,
+  0.0f, 1.0f,  0.0f,
+};
+
+}  // namespace
+
+ShadowCache::ShadowCache(UINT updateBudget) :
+  m_schedule(kNumCascades, kMaxPointShadows, updateBudget) {
+  if (updateBudget < kCubeFaces) {
+    // A cube could never be updated.
+    ThrowIfFailed(E_INVALIDARG);
+  }
+}
+
+ShadowCache::~ShadowCache() {
+}
+
+void ShadowCache::CreateResources(ID3D12Device* pDevice, D3D12_CPU_DESCRIPTOR_HANDLE srvCpuHandle, UINT srvDescriptorSize) {
+  // Describe and create the depth stencil view (DSV) descriptor heap of the shadow maps.
+  D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
+  dsvHeapDesc.NumDescriptors = kNumCascades + kMaxPointShadows * kCubeFaces;
+  dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+  dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+  ThrowIfFailed(pDevice->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
+  NAME_D3D12_OBJECT(m_dsvHeap);
+  m_dsvDescriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+
+  // Shadow maps stay readable by the pixel and compute shaders, and only become depth targets while they are updated.
+  const D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+  CD3DX12_HEAP_PROPERTIES defaultHeapProperty(D3D12_HEAP_TYPE_DEFAULT);
+  CD3DX12_CLEAR_VALUE clearValue(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+  CD3DX12_CPU_DESCRIPTOR_HANDLE dsvCpuHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+  CD3DX12_CPU_DESCRIPTOR_HANDLE cbvSrvCpuHandle(srvCpuHandle);
+
+  // *** cascaded shadow maps ***
+  {
+    CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS,
+      kCascadeResolution, kCascadeResolution, kNumCascades, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+    ThrowIfFailed(pDevice->CreateCommittedResource(
+      &defaultHeapProperty,
+      D3D12_HEAP_FLAG_NONE,
+      &textureDesc,
+      readState,
+      &clearValue,
+      IID_PPV_ARGS(&m_cascadeShadowMaps)));
+    NAME_D3D12_OBJECT(m_cascadeShadowMaps);
+
+    for (UINT i = 0; i < kNumCascades; ++i) {
+      D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+      dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+      dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+      dsvDesc.Texture2DArray.FirstArraySlice = i;
+      dsvDesc.Texture2DArray.ArraySize = 1;
+      pDevice->CreateDepthStencilView(m_cascadeShadowMaps.Get(), &dsvDesc, dsvCpuHandle);
+      dsvCpuHandle.Offset(m_dsvDescriptorSize);
+    }
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.ArraySize = kNumCascades;
+    pDevice->CreateShaderResourceView(m_cascadeShadowMaps.Get(), &srvDesc, cbvSrvCpuHandle);
+    cbvSrvCpuHandle.Offset(srvDescriptorSize);
+  }
+
+  // *** point light cube shadow maps ***
+  {
+    CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS,
+      kPointShadowResolution, kPointShadowResolution, kMaxPointShadows * kCubeFaces, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+    ThrowIfFailed(pDevice->CreateCommittedResource(
+      &defaultHeapProperty,
+      D3D12_HEAP_FLAG_NONE,
+      &textureDesc,
+      readState,
+      &clearValue,
+      IID_PPV_ARGS(&m_pointShadowMaps)));
+    NAME_D3D12_OBJECT(m_pointShadowMaps);
+
+    for (UINT i = 0; i < kMaxPointShadows * kCubeFaces; ++i) {
+      D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+      dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+      dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+      dsvDesc.Texture2DArray.FirstArraySlice = i;
+      dsvDesc.Texture2DArray.ArraySize = 1;
+      pDevice->CreateDepthStencilView(m_pointShadowMaps.Get(), &dsvDesc, dsvCpuHandle);
+      dsvCpuHandle.Offset(m_dsvDescriptorSize);
+    }
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.TextureCubeArray.MipLevels = 1;
+    srvDesc.TextureCubeArray.NumCubes = kMaxPointShadows;
+    pDevice->CreateShaderResourceView(m_pointShadowMaps.Get(), &srvDesc, cbvSrvCpuHandle);
+  }
+}
+
+void ShadowCache::SetDirectionalLight(const XMFLOAT3& direction, const XMFLOAT3& color) {
+  m_lightColor = color;
+  if (direction.x == m_lightDirection.x && direction.y == m_lightDirection.y && direction.z == m_lightDirection.z) {
+    return;
+  }
+
+  m_lightDirection = direction;
+  // The light space changed, so every cascade has to be refitted.
+  for (UINT i = 0; i < kNumCascades; ++i) {
+    m_cascades[i].fitted = false;
+    m_schedule.InvalidateCascade(i);
+  }
+}
+
+void ShadowCache::SetPointLight(UINT shadowIndex, const float position[3], float radius) {
+  PointShadow& pointShadow = m_pointShadows[shadowIndex];
+  if (pointShadow.enabled && pointShadow.radius == radius &&
+    pointShadow.position[0] == position[0] && pointShadow.position[1] == position[1] && pointShadow.position[2] == position[2]) {
+    return;
+  }
+
+  pointShadow.position[0] = position[0], pointShadow.position[1] = position[1], pointShadow.position[2] = position[2];
+  pointShadow.radius = radius;
+  pointShadow.enabled = true;
+  m_schedule.EnableCube(shadowIndex);
+  m_schedule.InvalidateCube(shadowIndex);
+}
+
+void ShadowCache::ClearPointLight(UINT shadowIndex) {
+  m_pointShadows[shadowIndex].enabled = false;
+  m_schedule.DisableCube(shadowIndex);
+}
+
+void ShadowCache::MarkCastersDirty(const LightReceiverBounds& bounds) {
+  // Light space bounds of the casters.
+  const XMMATRIX lightRotation = GetLightRotation();
+  XMVECTOR lightMin = XMVectorReplicate(FLT_MAX);
+  XMVECTOR lightMax = XMVectorReplicate(-FLT_MAX);
+  for (UINT corner = 0; corner < 8; ++corner) {
+    const XMVECTOR position = XMVectorSet(
+      (corner & 1) ? bounds.max.x : bounds.min.x,
+      (corner & 2) ? bounds.max.y : bounds.min.y,
+      (corner & 4) ? bounds.max.z : bounds.min.z, 1.0f);
+    const XMVECTOR lightPosition = XMVector3TransformCoord(position, lightRotation);
+    lightMin = XMVectorMin(lightMin, lightPosition);
+    lightMax = XMVectorMax(lightMax, lightPosition);
+  }
+
+  for (UINT i = 0; i < kNumCascades; ++i) {
+    const Cascade& cascade = m_cascades[i];
+    if (!cascade.fitted) {
+      continue;
+    }
+    const XMVECTOR center = XMLoadFloat3(&cascade.center);
+    const XMVECTOR cascadeMin = XMVectorSubtract(center, XMVectorSet(cascade.radius, cascade.radius, cascade.radius + kCasterDistance, 0.0f));
+    const XMVECTOR cascadeMax = XMVectorAdd(center, XMVectorReplicate(cascade.radius));
+    if (XMVector3LessOrEqual(lightMin, cascadeMax) && XMVector3LessOrEqual(cascadeMin, lightMax)) {
+      m_schedule.InvalidateCascade(i);
+    }
+  }
+
+  for (UINT i = 0; i < kMaxPointShadows; ++i) {
+    const PointShadow& pointShadow = m_pointShadows[i];
+    if (pointShadow.enabled && bounds.IntersectsSphere(pointShadow.position, pointShadow.radius)) {
+      m_schedule.InvalidateCube(i);
+    }
+  }
+}
+
+void ShadowCache::Update(const Camera& camera, float fovInDegrees, float aspectRatio, float nearZ) {
+  m_pendingViews.clear();
+
+  // Same field of view as Camera::Get3DViewProjMatrices.
+  float fovAngleY = fovInDegrees * XM_PI / 180.0f;
+  if (aspectRatio < 1.0f) {
+    fovAngleY /= aspectRatio;
+  }
+  const float tanHalfFovY = std::tan(fovAngleY * 0.5f);
+  // Ratio of the half diagonal of a frustum slice to its distance.
+  const float k = tanHalfFovY * std::sqrt(1.0f + aspectRatio * aspectRatio);
+  const XMVECTOR forward = XMVector3Normalize(XMVectorSubtract(camera.mAt, camera.mEye));
+
+  float sliceNear = nearZ;
+  for (UINT i = 0; i < kNumCascades; ++i) {
+    // Practical split scheme, see "Parallel-Split Shadow Maps".
+    const float fraction = static_cast<float>(i + 1) / kNumCascades;
+    const float logSplit = nearZ * std::pow(kShadowDistance / nearZ, fraction);
+    const float uniformSplit = nearZ + (kShadowDistance - nearZ) * fraction;
+    const float sliceFar = kCascadeSplitLambda * logSplit + (1.0f - kCascadeSplitLambda) * uniformSplit;
+
+    // Smallest sphere around the slice. Its radius does not change when the camera rotates,
+    // which keeps the texel size of a cascade constant.
+    float centerDistance = 0.5f * (sliceNear + sliceFar) * (1.0f + k * k);
+    float radius = 0.0f;
+    if (centerDistance >= sliceFar) {
+      centerDistance = sliceFar;
+      radius = sliceFar * k;
+    } else {
+      radius = std::sqrt((sliceFar - centerDistance) * (sliceFar - centerDistance) + sliceFar * k * sliceFar * k);
+    }
+    FitCascade(i, XMVectorAdd(camera.mEye, XMVectorScale(forward, centerDistance)), radius);
+
+    sliceNear = sliceFar;
+  }
+
+  m_schedule.Schedule();
+  for (UINT cascadeIndex : m_schedule.GetScheduledCascades()) {
+    AddCascadeViews(cascadeIndex);
+  }
+  for (UINT shadowIndex : m_schedule.GetScheduledCubes()) {
+    AddPointShadowViews(shadowIndex);
+  }
+}
+
+void ShadowCache::MarkRendered() {
+  for (UINT cascadeIndex : m_schedule.GetScheduledCascades()) {
+    Cascade& cascade = m_cascades[cascadeIndex];
+    cascade.renderedViewProjection = cascade.scheduledViewProjection;
+    cascade.renderedTexelSize = cascade.scheduledTexelSize;
+  }
+  for (UINT shadowIndex : m_schedule.GetScheduledCubes()) {
+    PointShadow& pointShadow = m_pointShadows[shadowIndex];
+    std::copy(std::begin(pointShadow.scheduledPosition), std::end(pointShadow.scheduledPosition), std::begin(pointShadow.renderedPosition));
+    pointShadow.renderedRadius = pointShadow.scheduledRadius;
+  }
+  m_schedule.MarkRendered();
+  m_pendingViews.clear();
+}
+
+bool ShadowCache::HasRenderedViews() const {
+  for (UINT i = 0; i < kNumCascades; ++i) {
+    if (m_schedule.IsCascadeRendered(i)) {
+      return true;
+    }
+  }
+  for (UINT i = 0; i < kMaxPointShadows; ++i) {
+    if (m_schedule.IsCubeRendered(i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ShadowCache::AddCascadeViews(UINT cascadeIndex) {
+  Cascade& cascade = m_cascades[cascadeIndex];
+  CD3DX12_CPU_DESCRIPTOR_HANDLE dsv(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), cascadeIndex, m_dsvDescriptorSize);
+  m_pendingViews.push_back({ dsv, kCascadeResolution, cascade.viewProjection });
+  cascade.scheduledViewProjection = cascade.viewProjection;
+  cascade.scheduledTexelSize = 2.0f * cascade.radius / kCascadeResolution;
+}
+
+void ShadowCache::AddPointShadowViews(UINT shadowIndex) {
+  PointShadow& pointShadow = m_pointShadows[shadowIndex];
+  const XMVECTOR position = XMVectorSet(pointShadow.position[0], pointShadow.position[1], pointShadow.position[2], 1.0f);
+  const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, kPointShadowNearZ, pointShadow.radius);
+  for (UINT face = 0; face < kCubeFaces; ++face) {
+    const XMVECTOR direction = XMVectorSet(kCubeFaceDirections[3 * face], kCubeFaceDirections[3 * face + 1], kCubeFaceDirections[3 * face + 2], 0.0f);
+    const XMVECTOR up = XMVectorSet(kCubeFaceUps[3 * face], kCubeFaceUps[3 * face + 1], kCubeFaceUps[3 * face + 2], 0.0f);
+    ShadowView view;
+    view.dsv = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), kNumCascades + shadowIndex * kCubeFaces + face, m_dsvDescriptorSize);
+    view.resolution = kPointShadowResolution;
+    XMStoreFloat4x4(&view.viewProjection, XMMatrixTranspose(XMMatrixMultiply(XMMatrixLookToLH(position, direction, up), projection)));
+    m_pendingViews.push_back(view);
+  }
+  std::copy(std::begin(pointShadow.position), std::end(pointShadow.position), std::begin(pointShadow.scheduledPosition));
+  pointShadow.scheduledRadius = pointShadow.radius;
+}
+
+void ShadowCache::FillConstantBuffer(ShadowConstantBuffer& constantBuffer) const {
+  for (UINT i = 0; i < kNumCascades; ++i) {
+    const Cascade& cascade = m_cascades[i];
+    constantBuffer.cascadeViewProjection[i] = cascade.renderedViewProjection;
+    constantBuffer.cascadeParams[i] = XMFLOAT4(cascade.renderedTexelSize, m_schedule.IsCascadeRendered(i) ? 1.0f : 0.0f, 0.0f, 0.0f);
+  }
+  for (UINT i = 0; i < kMaxPointShadows; ++i) {
+    const PointShadow& pointShadow = m_pointShadows[i];
+    constantBuffer.pointShadowParams[i] = XMFLOAT4(kPointShadowNearZ, pointShadow.renderedRadius, m_schedule.IsCubeRendered(i) ? 1.0f : 0.0f, 0.0f);
+    constantBuffer.pointShadowPositions[i] = XMFLOAT4(pointShadow.renderedPosition[0], pointShadow.renderedPosition[1], pointShadow.renderedPosition[2], 0.0f);
+  }
+  constantBuffer.lightDirection = m_lightDirection;
+  constantBuffer.lightColor = m_lightColor;
+}
+
+XMMATRIX ShadowCache::GetLightRotation() const {
+  const XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&m_lightDirection));
+  const XMVECTOR up = std::abs(m_lightDirection.y) > 0.99f * XMVectorGetX(XMVector3Length(XMLoadFloat3(&m_lightDirection))) ?
+    XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+  return XMMatrixLookToLH(XMVectorZero(), direction, up);
+}
+
+void ShadowCache::FitCascade(UINT cascadeIndex, FXMVECTOR sliceCenter, float sliceRadius) {
+  Cascade& cascade = m_cascades[cascadeIndex];
+  const XMMATRIX lightRotation = GetLightRotation();
+  const XMVECTOR lightCenter = XMVector3TransformCoord(sliceCenter, lightRotation);
+
+  // Keep the cached cascade as long as it still contains the whole slice.
+  if (cascade.fitted) {
+    const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(lightCenter, XMLoadFloat3(&cascade.center))));
+    if (distance + sliceRadius <= cascade.radius) {
+      return;
+    }
+  }
+
+  // Snap to whole texels so that the rasterized casters do not shimmer when the cascade moves.
+  const float radius = sliceRadius * kCascadePadding;
+  const float texelSize = 2.0f * radius / kCascadeResolution;
+  XMFLOAT3 center;
+  XMStoreFloat3(&center, lightCenter);
+  center.x = std::floor(center.x / texelSize) * texelSize;
+  center.y = std::floor(center.y / texelSize) * texelSize;
+
+  const XMMATRIX projection = XMMatrixOrthographicOffCenterLH(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+    center.z - radius - kCasterDistance, center.z + radius);
+  XMStoreFloat4x4(&cascade.viewProjection, XMMatrixTranspose(XMMatrixMultiply(lightRotation, projection)));
+  cascade.center = center;
+  cascade.radius = radius;
+  cascade.fitted = true;
+  m_schedule.InvalidateCascade(cascadeIndex);
+}
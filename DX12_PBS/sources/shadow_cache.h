@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+
+#include "core/stdafx.h"
+#include "light_manager.h"
+#include "sample_assets.h"
+#include "shader_features.h"
+#include "shadow_schedule.h"
+
+using Microsoft::WRL::ComPtr;
+
+class Camera;
+
+// Owns the cascaded shadow maps of the directional light and the cube shadow maps of selected point lights.
+// Shadow maps are cached: a map is only re-rendered when its light moves, when casters inside it are marked
+// dirty, or (cascades only) when the camera frustum leaves the padded area the cascade was fitted to.
+// ShadowSchedule decides which views are rendered in a frame, within updateBudget; the others keep their
+// previous contents and matrices until their turn comes. Update schedules the views, and MarkRendered,
+// once the frame recorded them, makes the shaders use them; the views of a frame that doesn't record
+// them stay stale.
+class ShadowCache {
+public:
+  static constexpr UINT kNumCascades = shader_constants::kNumCascades;
+  static constexpr UINT kMaxPointShadows = shader_constants::kMaxPointShadows;
+  static constexpr UINT kCascadeResolution = 1024;
+  static constexpr UINT kPointShadowResolution = 512;
+
+  // A shadow view to be rendered this frame.
+  struct ShadowView {
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+    UINT resolution;
+    XMFLOAT4X4 viewProjection;  // transposed for HLSL
+  };
+
+  explicit ShadowCache(UINT updateBudget);
+  ~ShadowCache();
+
+  ShadowCache(const ShadowCache&) = delete;
+  ShadowCache& operator=(const ShadowCache&) = delete;
+
+  // Creates the shadow maps, and their two SRVs (cascades, cubes) at srvCpuHandle.
+  void CreateResources(ID3D12Device* pDevice, D3D12_CPU_DESCRIPTOR_HANDLE srvCpuHandle, UINT srvDescriptorSize);
+
+  void SetDirectionalLight(const XMFLOAT3& direction, const XMFLOAT3& color);
+  // shadowIndex is the LightState::shadowIndex of the light.
+  void SetPointLight(UINT shadowIndex, const float position[3], float radius);
+  void ClearPointLight(UINT shadowIndex);
+  // Invalidates every shadow map that may contain a caster inside bounds.
+  void MarkCastersDirty(const LightReceiverBounds& bounds);
+
+  // Refits the cascades to the camera frustum and schedules the shadow views to render this frame.
+  void Update(const Camera& camera, float fovInDegrees, float aspectRatio, float nearZ);
+
+  const std::vector<ShadowView>& GetPendingViews() const {
+    return m_pendingViews;
+  }
+  // The pending views were recorded: the shadow maps contain them from now on.
+  void MarkRendered();
+  // Whether any shadow map has been rendered since the shadow cache was created.
+  bool HasRenderedViews() const;
+
+  // The matrices of what the shadow maps contain, once the recorded views have been marked rendered.
+  void FillConstantBuffer(ShadowConstantBuffer& constantBuffer) const;
+
+  ID3D12Resource* GetCascadeShadowMaps() const {
+    return m_cascadeShadowMaps.Get();
+  }
+
+  ID3D12Resource* GetPointShadowMaps() const {
+    return m_pointShadowMaps.Get();
+  }
+
+private:
+  static constexpr float kShadowDistance = 40.0f;  // the cascades cover the view frustum up to here
+  static constexpr float kCascadeSplitLambda = 0.75f;  // blend of logarithmic and uniform splits
+  static constexpr float kCascadePadding = 1.25f;  // cascades are fitted larger so small camera moves keep them valid
+  static constexpr float kCasterDistance = 50.0f;  // how far towards the light casters are captured
+  static constexpr float kPointShadowNearZ = 0.05f;
+  static constexpr UINT kCubeFaces = ShadowSchedule::kCubeFaces;
+
+  struct Cascade {
+    XMFLOAT3 center{};  // light space, snapped to texels
+    float radius = 0.0f;
+    XMFLOAT4X4 viewProjection{};  // transposed for HLSL
+    bool fitted = false;  // center and radius describe the cascade
+    // What the pending view renders.
+    XMFLOAT4X4 scheduledViewProjection{};
+    float scheduledTexelSize = 0.0f;
+    // What the shadow map contains, used for shading until the cascade is re-rendered.
+    XMFLOAT4X4 renderedViewProjection{};
+    float renderedTexelSize = 0.0f;
+  };
+
+  struct PointShadow {
+    float position[3]{};
+    float radius = 0.0f;
+    bool enabled = false;
+    // What the pending views render.
+    float scheduledPosition[3]{};
+    float scheduledRadius = 0.0f;
+    // What the cube map contains, used for shading until the cube is re-rendered.
+    float renderedPosition[3]{};
+    float renderedRadius = 0.0f;
+  };
+
+  XMMATRIX GetLightRotation() const;
+  // The pending views of the cascades and cubes ShadowSchedule picked.
+  void AddCascadeViews(UINT cascadeIndex);
+  void AddPointShadowViews(UINT shadowIndex);
+  void FitCascade(UINT cascadeIndex, FXMVECTOR sliceCenter, float sliceRadius);
+
+  ShadowSchedule m_schedule;
+
+  ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
+  UINT m_dsvDescriptorSize = 0;
+  ComPtr<ID3D12Resource> m_cascadeShadowMaps;
+  ComPtr<ID3D12Resource> m_pointShadowMaps;
+
+  XMFLOAT3 m_lightDirection{ 0.0f, -1.0f, 0.0f };
+  XMFLOAT3 m_lightColor{};
+  Cascade m_cascades[kNumCascades];
+  PointShadow m_pointShadows[kMaxPointShadows];
+
+  std::vector<ShadowView> m_pendingViews;
+};
@@ -0,0 +1,96 @@
+#include "shadow_schedule.h"
+
+ShadowSchedule::ShadowSchedule(uint32_t cascadeCount, uint32_t cubeCount, uint32_t updateBudget) :
+  m_updateBudget(updateBudget),
+  m_cascades(cascadeCount),
+  m_cubes(cubeCount) {
+  for (View& cube : m_cubes) {
+    cube.enabled = false;
+  }
+}
+
+void ShadowSchedule::InvalidateCascade(uint32_t cascade) {
+  m_cascades[cascade].valid = false;
+  m_cascades[cascade].scheduledCurrent = false;
+}
+
+void ShadowSchedule::InvalidateCube(uint32_t cube) {
+  m_cubes[cube].valid = false;
+  m_cubes[cube].scheduledCurrent = false;
+}
+
+void ShadowSchedule::EnableCube(uint32_t cube) {
+  m_cubes[cube].enabled = true;
+}
+
+void ShadowSchedule::DisableCube(uint32_t cube) {
+  m_cubes[cube] = View();
+  m_cubes[cube].enabled = false;
+}
+
+void ShadowSchedule::Schedule() {
+  m_scheduledCascades.clear();
+  m_scheduledCubes.clear();
+  for (View& view : m_cascades) {
+    view.scheduledCurrent = false;
+  }
+  for (View& view : m_cubes) {
+    view.scheduledCurrent = false;
+  }
+
+  uint32_t budget = m_updateBudget;
+  if (m_cubesDeferred) {
+    ScheduleCubes(budget);
+    ScheduleCascades(budget);
+  } else {
+    ScheduleCascades(budget);
+    ScheduleCubes(budget);
+  }
+}
+
+void ShadowSchedule::ScheduleCascades(uint32_t& budget) {
+  for (uint32_t i = 0; i < m_cascades.size() && budget > 0; ++i) {
+    if (m_cascades[i].valid) {
+      continue;
+    }
+    m_scheduledCascades.push_back(i);
+    m_cascades[i].scheduledCurrent = true;
+    --budget;
+  }
+}
+
+void ShadowSchedule::ScheduleCubes(uint32_t& budget) {
+  m_cubesDeferred = false;
+  for (uint32_t i = 0; i < m_cubes.size(); ++i) {
+    if (!m_cubes[i].enabled || m_cubes[i].valid) {
+      continue;
+    }
+    if (budget < kCubeFaces) {
+      m_cubesDeferred = true;
+      continue;
+    }
+    m_scheduledCubes.push_back(i);
+    m_cubes[i].scheduledCurrent = true;
+    budget -= kCubeFaces;
+  }
+}
+
+void ShadowSchedule::MarkRendered() {
+  // The shadow maps now have the contents the views were scheduled with, even those invalidated since,
+  // which stay stale.
+  for (uint32_t cascade : m_scheduledCascades) {
+    m_cascades[cascade].rendered = true;
+    m_cascades[cascade].valid = m_cascades[cascade].scheduledCurrent;
+    m_cascades[cascade].scheduledCurrent = false;
+  }
+  for (uint32_t cube : m_scheduledCubes) {
+    // A cube disabled since has no contents to shade with.
+    if (m_cubes[cube].enabled) {
+      m_cubes[cube].rendered = true;
+      m_cubes[cube].valid = m_cubes[cube].scheduledCurrent;
+    }
+    m_cubes[cube].scheduledCurrent = false;
+  }
+  m_scheduledCascades.clear();
+  m_scheduledCubes.clear();
+}
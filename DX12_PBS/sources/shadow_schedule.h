@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Bookkeeping of which shadow views are up to date, and of which to render in a frame. Like
+// ResidencyTracker, it doesn't know about D3D12 objects or matrices; ShadowCache puts the shadow maps
+// on top of it.
+
+// A view is a cascade, or a whole point light cube, whose six faces are always rendered together since
+// shading looks the cube up from a single position. Schedule picks the stale views for a frame, at most
+// updateBudget shadow map views (a cascade, or a cube face) of them. A view only counts as rendered once
+// MarkRendered says that the frame recorded the views it was given, so a frame that schedules views
+// without recording them, e.g. while the scene loads or with shadows off, leaves them stale and they are
+// scheduled again. updateBudget has to be at least kCubeFaces.
+class ShadowSchedule {
+public:
+  static constexpr uint32_t kCubeFaces = 6;
+
+  ShadowSchedule(uint32_t cascadeCount, uint32_t cubeCount, uint32_t updateBudget);
+
+  // The contents of the view no longer match what it should show. A view invalidated after it was
+  // scheduled is scheduled again once rendered.
+  void InvalidateCascade(uint32_t cascade);
+  void InvalidateCube(uint32_t cube);
+  // Cubes are disabled until enabled, and lose their contents when disabled.
+  void EnableCube(uint32_t cube);
+  void DisableCube(uint32_t cube);
+
+  // Replaces the views of the previous frame with the stale views to render in this one, in order:
+  // cascades first, since the near ones cover most of the screen, then cubes; unless a cube didn't fit
+  // in the budget the cascades left the frame before, so that a camera that keeps refitting cascades
+  // can't starve the cubes.
+  void Schedule();
+  const std::vector<uint32_t>& GetScheduledCascades() const {
+    return m_scheduledCascades;
+  }
+  const std::vector<uint32_t>& GetScheduledCubes() const {
+    return m_scheduledCubes;
+  }
+  // The views of the last Schedule were recorded. Call at most once per Schedule.
+  void MarkRendered();
+
+  // Whether the view has contents to shade with, if possibly out of date.
+  bool IsCascadeRendered(uint32_t cascade) const {
+    return m_cascades[cascade].rendered;
+  }
+  bool IsCubeRendered(uint32_t cube) const {
+    return m_cubes[cube].rendered;
+  }
+  // Whether the contents match what the view should show.
+  bool IsCascadeValid(uint32_t cascade) const {
+    return m_cascades[cascade].valid;
+  }
+  bool IsCubeValid(uint32_t cube) const {
+    return m_cubes[cube].valid;
+  }
+
+private:
+  struct View {
+    bool enabled = true;  // cascades always are
+    bool valid = false;
+    bool rendered = false;
+    bool scheduledCurrent = false;  // scheduled, and not invalidated since
+  };
+
+  void ScheduleCascades(uint32_t& budget);
+  void ScheduleCubes(uint32_t& budget);
+
+  const uint32_t m_updateBudget;
+  std::vector<View> m_cascades;
+  std::vector<View> m_cubes;
+  std::vector<uint32_t> m_scheduledCascades;
+  std::vector<uint32_t> m_scheduledCubes;
+  // A cube didn't fit in the budget left by the cascades last frame, so the cubes go first this frame.
+  bool m_cubesDeferred = false;
+};
@@ -0,0 +1,149 @@
+#include "staging_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+UINT64 AlignUp(UINT64 value, UINT64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+StagingRing::StagingRing(ID3D12Device* pDevice, UINT64 size) :
+  m_size(size) {
+  D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  ThrowIfFailed(pDevice->CreateCommittedResource(
+    &heapProperty,
+    D3D12_HEAP_FLAG_NONE,
+    &resourceDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&m_buffer)));
+  NAME_D3D12_OBJECT(m_buffer);
+
+  // Mapped for the lifetime of the buffer.
+  const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+  ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCpu)));
+}
+
+StagingRing::~StagingRing() {
+}
+
+bool StagingRing::Allocate(UINT64 size, UINT64 alignment, Allocation* pAllocation) {
+  if (size == 0 || size > m_size) {
+    return false;
+  }
+
+  // Nothing in use: start over at 0, so that nothing is skipped.
+  if (m_usedSize == 0) {
+    m_head = 0;
+  }
+
+  // An allocation that doesn't fit before the end of the ring starts over at 0, which is aligned.
+  UINT64 offset = AlignUp(m_head, alignment);
+  if (offset + size > m_size) {
+    offset = 0;
+  }
+  const UINT64 consumed = (offset >= m_head ? offset - m_head : m_size - m_head) + size;
+  if (m_usedSize + consumed > m_size) {
+    return false;
+  }
+
+  m_head = (offset + size) % m_size;
+  m_usedSize += consumed;
+  m_currentBatchSize += consumed;
+  pAllocation->pCpu = m_pCpu + offset;
+  pAllocation->offset = offset;
+  return true;
+}
+
+void StagingRing::EndBatch(UINT64 fenceValue) {
+  if (m_currentBatchSize > 0) {
+    m_batches.push_back({ fenceValue, m_currentBatchSize });
+    m_currentBatchSize = 0;
+  }
+}
+
+void StagingRing::Reclaim(UINT64 completedFenceValue) {
+  while (!m_batches.empty() && m_batches.front().fenceValue <= completedFenceValue) {
+    m_usedSize -= m_batches.front().size;
+    m_batches.pop_front();
+  }
+}
+
+StagingUploader::StagingUploader(ID3D12Device* pDevice, StagingRing* pRing, ID3D12GraphicsCommandList* pCommandList, FlushFunction flush) :
+  m_pDevice(pDevice),
+  m_pRing(pRing),
+  m_pCommandList(pCommandList),
+  m_flush(std::move(flush)) {
+}
+
+void StagingUploader::UploadBuffer(ID3D12Resource* pDestination, const void* pData, UINT64 size) {
+  const UINT8* pSource = static_cast<const UINT8*>(pData);
+  for (UINT64 offset = 0; offset < size;) {
+    const UINT64 partSize = (std::min)(size - offset, m_pRing->GetSize());
+    const StagingRing::Allocation allocation = Allocate(partSize, 1);
+    memcpy(allocation.pCpu, pSource + offset, static_cast<size_t>(partSize));
+    m_pCommandList->CopyBufferRegion(pDestination, offset, m_pRing->GetResource(), allocation.offset, partSize);
+    offset += partSize;
+  }
+}
+
+void StagingUploader::UploadTexture(ID3D12Resource* pDestination, UINT firstSubresource, UINT numSubresources,
+  const D3D12_SUBRESOURCE_DATA* pSubresourceData) {
+  const D3D12_RESOURCE_DESC desc = pDestination->GetDesc();
+  for (UINT i = 0; i < numSubresources; ++i) {
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+    UINT numRows = 0;
+    UINT64 rowSize = 0;
+    m_pDevice->GetCopyableFootprints(&desc, firstSubresource + i, 1, 0, &layout, &numRows, &rowSize, nullptr);
+
+    // A row of a block compressed format is a row of blocks, several texels high.
+    const UINT texelsPerRow = layout.Footprint.Height / numRows;
+    const UINT maxRowsPerPart = static_cast<UINT>(m_pRing->GetSize() / layout.Footprint.RowPitch);
+    if (maxRowsPerPart == 0) {
+      ThrowIfFailed(E_OUTOFMEMORY);
+    }
+
+    const D3D12_TEXTURE_COPY_LOCATION destination = CD3DX12_TEXTURE_COPY_LOCATION(pDestination, firstSubresource + i);
+    const UINT8* pSource = static_cast<const UINT8*>(pSubresourceData[i].pData);
+    for (UINT row = 0; row < numRows;) {
+      const UINT partRows = (std::min)(numRows - row, maxRowsPerPart);
+      const StagingRing::Allocation allocation = Allocate(static_cast<UINT64>(partRows) * layout.Footprint.RowPitch,
+        D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+      if (static_cast<UINT64>(pSubresourceData[i].RowPitch) == layout.Footprint.RowPitch) {
+        // Already laid out like the footprint, e.g. by an AssetPack: one copy for all the rows.
+        memcpy(allocation.pCpu, pSource + static_cast<UINT64>(row) * layout.Footprint.RowPitch,
+          static_cast<size_t>(static_cast<UINT64>(partRows - 1) * layout.Footprint.RowPitch + rowSize));
+      } else {
+        for (UINT partRow = 0; partRow < partRows; ++partRow) {
+          memcpy(allocation.pCpu + static_cast<UINT64>(partRow) * layout.Footprint.RowPitch,
+            pSource + static_cast<UINT64>(row + partRow) * pSubresourceData[i].RowPitch, static_cast<size_t>(rowSize));
+        }
+      }
+
+      D3D12_PLACED_SUBRESOURCE_FOOTPRINT partLayout = layout;
+      partLayout.Offset = allocation.offset;
+      partLayout.Footprint.Height = partRows * texelsPerRow;
+      const D3D12_TEXTURE_COPY_LOCATION source = CD3DX12_TEXTURE_COPY_LOCATION(m_pRing->GetResource(), partLayout);
+      m_pCommandList->CopyTextureRegion(&destination, 0, row * texelsPerRow, 0, &source, nullptr);
+      row += partRows;
+    }
+  }
+}
+
+StagingRing::Allocation StagingUploader::Allocate(UINT64 size, UINT64 alignment) {
+  StagingRing::Allocation allocation;
+  if (!m_pRing->Allocate(size, alignment, &allocation)) {
+    m_flush();
+    if (!m_pRing->Allocate(size, alignment, &allocation)) {
+      ThrowIfFailed(E_OUTOFMEMORY);
+    }
+  }
+  return allocation;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include "core/stdafx.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One persistently mapped upload buffer, which the source data of every copy to a default heap
+// resource is staged in. Like DescriptorRing, an allocation is never freed on its own: EndBatch tags
+// everything allocated since the previous call with the fence value the batch of copies signals, and
+// Reclaim frees whole batches once the fence has reached their value. Not thread safe.
+class StagingRing {
+public:
+  struct Allocation {
+    UINT8* pCpu = nullptr;  // write only
+    UINT64 offset = 0;  // in GetResource()
+  };
+
+  StagingRing(ID3D12Device* pDevice, UINT64 size);
+  ~StagingRing();
+
+  StagingRing(const StagingRing&) = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  // Returns false if the batches in flight leave no room.
+  bool Allocate(UINT64 size, UINT64 alignment, Allocation* pAllocation);
+  void EndBatch(UINT64 fenceValue);
+  void Reclaim(UINT64 completedFenceValue);
+
+  ID3D12Resource* GetResource() const {
+    return m_buffer.Get();
+  }
+
+  UINT64 GetSize() const {
+    return m_size;
+  }
+
+private:
+  struct Batch {
+    UINT64 fenceValue;
+    UINT64 size;  // including alignment and skipped bytes
+  };
+
+  ComPtr<ID3D12Resource> m_buffer;
+  UINT8* m_pCpu = nullptr;
+  UINT64 m_size = 0;
+  std::deque<Batch> m_batches;  // in flight, oldest first
+  UINT64 m_head = 0;  // where the next allocation starts
+  UINT64 m_usedSize = 0;
+  UINT64 m_currentBatchSize = 0;
+};
+
+// Records copies into a command list, with their source data staged in a StagingRing. Data that
+// doesn't fit into the ring at once is copied in parts. When the ring is full, flush is called to
+// submit the copies recorded so far; it must return with the ring empty and the command list open.
+class StagingUploader {
+public:
+  using FlushFunction = std::function<void()>;
+
+  StagingUploader(ID3D12Device* pDevice, StagingRing* pRing, ID3D12GraphicsCommandList* pCommandList, FlushFunction flush);
+
+  // Copies size bytes of data to the start of the buffer.
+  void UploadBuffer(ID3D12Resource* pDestination, const void* pData, UINT64 size);
+  // Like UpdateSubresources, for 2D textures and texture arrays.
+  void UploadTexture(ID3D12Resource* pDestination, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* pSubresourceData);
+
+  ID3D12GraphicsCommandList* GetCommandList() const {
+    return m_pCommandList;
+  }
+
+private:
+  StagingRing::Allocation Allocate(UINT64 size, UINT64 alignment);
+
+  ID3D12Device* m_pDevice = nullptr;
+  StagingRing* m_pRing = nullptr;
+  ID3D12GraphicsCommandList* m_pCommandList = nullptr;
+  FlushFunction m_flush;
+};
@@ -0,0 +1,86 @@
+#include "upload_arena.h"
+
+#include <algorithm>
+
+#include "core/DXSampleHelper.h"
+
+namespace {
+
+UINT64 AlignUp(UINT64 value, UINT64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+UploadArena::UploadArena(ID3D12Device* pDevice, UINT64 initialSize) :
+  m_device(pDevice) {
+  AddPage(AlignUp(initialSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+}
+
+UploadArena::~UploadArena() {
+}
+
+UploadArena::Allocation UploadArena::Allocate(UINT64 size, UINT64 alignment) {
+  size = AlignUp(size, alignment);
+  UINT64 offset = AlignUp(m_offset, alignment);
+  while (offset + size > m_pages[m_currentPage].size) {
+    if (m_currentPage + 1 == m_pages.size()) {
+      AddPage((std::max)(m_pages.back().size * 2, size));
+    }
+    // The rest of the page, padding included, is left unused.
+    m_usedSize += m_pages[m_currentPage].size - m_offset;
+    ++m_currentPage;
+    m_offset = 0;
+    offset = 0;
+  }
+
+  Page& page = m_pages[m_currentPage];
+  m_usedSize += offset - m_offset + size;
+  m_offset = offset + size;
+
+  Allocation allocation;
+  allocation.pCpu = page.pCpu + offset;
+  allocation.gpuAddress = page.buffer->GetGPUVirtualAddress() + offset;
+  return allocation;
+}
+
+void UploadArena::Reset() {
+  // A frame overflowed: from now on one buffer holds everything it needed.
+  if (m_pages.size() > 1) {
+    const UINT64 capacity = GetCapacity();
+    m_pages.clear();
+    AddPage(capacity);
+  }
+  m_currentPage = 0;
+  m_offset = 0;
+  m_usedSize = 0;
+}
+
+UINT64 UploadArena::GetCapacity() const {
+  UINT64 capacity = 0;
+  for (const Page& page : m_pages) {
+    capacity += page.size;
+  }
+  return capacity;
+}
+
+void UploadArena::AddPage(UINT64 size) {
+  Page page;
+  page.size = size;
+
+  D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  ThrowIfFailed(m_device->CreateCommittedResource(
+    &heapProperty,
+    D3D12_HEAP_FLAG_NONE,
+    &resourceDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&page.buffer)));
+  NAME_D3D12_OBJECT(page.buffer);
+
+  // We don't unmap this until the page is released. Keeping buffer mapped for the lifetime of the resource is okay.
+  const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+  ThrowIfFailed(page.buffer->Map(0, &readRange, reinterpret_cast<void**>(&page.pCpu)));
+  m_pages.push_back(page);
+}
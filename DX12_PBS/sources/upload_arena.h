@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "core/stdafx.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Per-frame linear allocator over persistently mapped upload buffers.
+// Constants and other dynamic data are written straight into the memory the GPU reads, and bound by
+// GPU virtual address, so a pass needs no buffer of its own. Allocations live until Reset, which must
+// only be called once the GPU has finished with the frame that used them.
+// When a frame needs more than the arena holds, another page is added; the next Reset replaces the
+// pages with a single buffer big enough for all of them. Not thread safe.
+class UploadArena {
+public:
+  struct Allocation {
+    void* pCpu = nullptr;  // write only
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+  };
+
+  UploadArena(ID3D12Device* pDevice, UINT64 initialSize);
+  ~UploadArena();
+
+  UploadArena(const UploadArena&) = delete;
+  UploadArena& operator=(const UploadArena&) = delete;
+
+  // size is rounded up to alignment, so consecutive allocations never share an aligned block.
+  Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+  // Allocates a constant buffer and copies data into it.
+  template <typename T>
+  Allocation AllocateConstants(const T& data) {
+    const Allocation allocation = Allocate(sizeof(T));
+    memcpy(allocation.pCpu, &data, sizeof(T));
+    return allocation;
+  }
+
+  void Reset();
+
+  // Bytes handed out since the last Reset, including alignment and the ends of pages left for a new one.
+  UINT64 GetUsedSize() const {
+    return m_usedSize;
+  }
+
+  UINT64 GetCapacity() const;
+
+private:
+  struct Page {
+    ComPtr<ID3D12Resource> buffer;
+    UINT8* pCpu = nullptr;
+    UINT64 size = 0;
+  };
+
+  void AddPage(UINT64 size);
+
+  ComPtr<ID3D12Device> m_device;
+  std::vector<Page> m_pages;
+  size_t m_currentPage = 0;
+  UINT64 m_offset = 0;  // into the current page
+  UINT64 m_usedSize = 0;
+};
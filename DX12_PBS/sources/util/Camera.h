@@ -10,7 +10,7 @@
 //*********************************************************
 
 #pragma once
-#include "../core/stdafx.h"
+#include <DirectXMath.h>
 
 using namespace DirectX;
 
@@ -2,11 +2,45 @@
 
 #include "../core/DXSampleHelper.h"
 #include "../core/d3dx12.h"
+#include "../cpu_profiler.h"
 
 namespace util {
 
+namespace {
+
+D3D12_ROOT_DESCRIPTOR_FLAGS GetRootDescriptorFlags(const DescriptorDesc& descriptorDesc) {
+  switch (descriptorDesc.dataVolatility) {
+  case DataVolatility::kStatic:
+    return D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC;
+  case DataVolatility::kVolatile:
+    return D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
+  default:
+    return D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+  }
+}
+
+D3D12_DESCRIPTOR_RANGE_FLAGS GetDescriptorRangeFlags(const DescriptorDesc& descriptorDesc) {
+  D3D12_DESCRIPTOR_RANGE_FLAGS flags = descriptorDesc.descriptorsVolatile ?
+    D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+  switch (descriptorDesc.dataVolatility) {
+  case DataVolatility::kStatic:
+    flags |= D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+    break;
+  case DataVolatility::kVolatile:
+    flags |= D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+    break;
+  default:
+    flags |= descriptorDesc.type == DescriptorType::kUnorderedAccessView ?
+      D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+    break;
+  }
+  return flags;
+}
+
+}  // namespace
+
 void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc>& descriptorDescs, const std::vector<SamplerDesc>& samplerDescs,
-  ID3D12RootSignature** rootSignature, LPCWSTR name) {
+  ID3D12RootSignature** rootSignature, LPCWSTR name, D3D12_ROOT_SIGNATURE_FLAGS flags) {
   D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
 
   // This is the highest version the sample supports. If CheckFeatureSupport succeeds, the HighestVersion returned will not be greater than this.
@@ -19,6 +53,8 @@ void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc
 
   std::vector<CD3DX12_ROOT_PARAMETER1> rootParameters;
   std::vector<CD3DX12_DESCRIPTOR_RANGE1> ranges;
+  // Root parameters keep pointers into ranges, so it must not reallocate.
+  ranges.reserve(descriptorDescs.size());
   bool denyVertexAccess = true;
   bool denyPixelAccess = true;
   for (const auto& descriptorDesc : descriptorDescs) {
@@ -35,12 +71,23 @@ void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc
     CD3DX12_ROOT_PARAMETER1 parameter;
     switch (descriptorDesc.type) {
     case DescriptorType::kConstantBuffer:
-      parameter.InitAsConstantBufferView(descriptorDesc.baseShaderRegister, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, descriptorDesc.visibility);
+      parameter.InitAsConstantBufferView(descriptorDesc.baseShaderRegister, 0, GetRootDescriptorFlags(descriptorDesc), descriptorDesc.visibility);
+      break;
+    case DescriptorType::kRootShaderResourceView:
+      parameter.InitAsShaderResourceView(descriptorDesc.baseShaderRegister, 0, GetRootDescriptorFlags(descriptorDesc), descriptorDesc.visibility);
+      break;
+    case DescriptorType::kRootConstants:
+      parameter.InitAsConstants(descriptorDesc.numDescriptors, descriptorDesc.baseShaderRegister, 0, descriptorDesc.visibility);
       break;
     case DescriptorType::kShaderResourceView:
-      CD3DX12_DESCRIPTOR_RANGE1 range{};
-      range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, descriptorDesc.numDescriptors, descriptorDesc.baseShaderRegister, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
-      parameter.InitAsDescriptorTable(1, &range, descriptorDesc.visibility);
+      ranges.emplace_back();
+      ranges.back().Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, descriptorDesc.numDescriptors, descriptorDesc.baseShaderRegister, 0, GetDescriptorRangeFlags(descriptorDesc));
+      parameter.InitAsDescriptorTable(1, &ranges.back(), descriptorDesc.visibility);
+      break;
+    case DescriptorType::kUnorderedAccessView:
+      ranges.emplace_back();
+      ranges.back().Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, descriptorDesc.numDescriptors, descriptorDesc.baseShaderRegister, 0, GetDescriptorRangeFlags(descriptorDesc));
+      parameter.InitAsDescriptorTable(1, &ranges.back(), descriptorDesc.visibility);
       break;
     default:
       break;
@@ -54,16 +101,16 @@ void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc
     CD3DX12_STATIC_SAMPLER_DESC sampler{};
     sampler.Init(samplerDesc.baseShaderRegister, samplerDesc.filter,
       samplerDesc.addressMode, samplerDesc.addressMode, samplerDesc.addressMode,
-      0.0f, 0, D3D12_COMPARISON_FUNC_NEVER, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK,
+      0.0f, 0, samplerDesc.comparisonFunc, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK,
       0.0f, D3D12_FLOAT32_MAX,
-      D3D12_SHADER_VISIBILITY_PIXEL, 0);
+      samplerDesc.visibility, 0);
 
     samplers.emplace_back(sampler);
   }
 
   CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc{};
   // Performance tip: Limit root signature access when possible.
-  D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+  flags |= D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
     D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
     D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
     D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
@@ -82,15 +129,28 @@ void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc
   SetName(*rootSignature, name);
 }
 
-void CreatePipelineState(ID3D12Device* pDevice, DXSample* pSample, LPCWSTR shaderFilePath, const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputElementDescs,
+bool IsBindlessSupported(ID3D12Device* pDevice) {
+  D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_6 };
+  if (FAILED(pDevice->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel))) ||
+    shaderModel.HighestShaderModel < D3D_SHADER_MODEL_6_6) {
+    return false;
+  }
+  D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+  return SUCCEEDED(pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))) &&
+    options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_3;
+}
+
+void CreatePipelineState(PipelineLibrary* pPipelineLibrary, ShaderCache* pShaderCache, LPCWSTR shaderFilePath, const ShaderFeatureKey& shaderFeatures,
+  const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputElementDescs,
   ID3D12RootSignature* rootSignaturePtr, const std::vector<DXGI_FORMAT>& rtvFormats, 
   bool needDepthTest, D3D12_COMPARISON_FUNC depthFunc,
   ID3D12PipelineState** pipelineState, LPCWSTR name,
   bool frontFaceCounterClockwise) {
-  ComPtr<ID3DBlob> vertexShader;
-  ComPtr<ID3DBlob> pixelShader;
-  vertexShader = CompileShader(pSample->GetAssetFullPath(shaderFilePath).c_str(), nullptr, "VSMain", "vs_5_0");
-  pixelShader = CompileShader(pSample->GetAssetFullPath(shaderFilePath).c_str(), nullptr, "PSMain", "ps_5_1");
+  CPU_PROFILE_SCOPE("create pipeline state");
+  const std::vector<ShaderDefine> defines = shaderFeatures.GetDefines();
+  const std::string shaderModel = shaderFeatures.GetShaderModel();
+  const D3D12_SHADER_BYTECODE vertexShader = pShaderCache->GetShader(shaderFilePath, "VSMain", "vs_" + shaderModel, defines);
+  const D3D12_SHADER_BYTECODE pixelShader = pShaderCache->GetShader(shaderFilePath, "PSMain", "ps_" + shaderModel, defines);
 
   D3D12_INPUT_LAYOUT_DESC inputLayoutDesc{};
   inputLayoutDesc.pInputElementDescs = inputElementDescs.data();
@@ -99,8 +159,8 @@ void CreatePipelineState(ID3D12Device* pDevice, DXSample* pSample, LPCWSTR shade
   D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
   psoDesc.InputLayout = inputLayoutDesc;
   psoDesc.pRootSignature = rootSignaturePtr;
-  psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
-  psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+  psoDesc.VS = vertexShader;
+  psoDesc.PS = pixelShader;
   psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
   if (frontFaceCounterClockwise) {
     psoDesc.RasterizerState.FrontCounterClockwise = true;
@@ -119,46 +179,39 @@ void CreatePipelineState(ID3D12Device* pDevice, DXSample* pSample, LPCWSTR shade
     psoDesc.DepthStencilState.DepthFunc = depthFunc;
   }
 
-  ThrowIfFailed(pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipelineState)));
+  pPipelineLibrary->CreateGraphicsPipelineState(psoDesc, name, pipelineState);
+  SetName(*pipelineState, name);
+}
+
+void CreateComputePipelineState(PipelineLibrary* pPipelineLibrary, ShaderCache* pShaderCache, LPCWSTR shaderFilePath, const ShaderFeatureKey& shaderFeatures,
+  ID3D12RootSignature* rootSignaturePtr, ID3D12PipelineState** pipelineState, LPCWSTR name) {
+  CPU_PROFILE_SCOPE("create compute pipeline state");
+  const D3D12_SHADER_BYTECODE computeShader = pShaderCache->GetShader(shaderFilePath, "CSMain",
+    std::string("cs_") + shaderFeatures.GetShaderModel(), shaderFeatures.GetDefines());
+
+  D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+  psoDesc.pRootSignature = rootSignaturePtr;
+  psoDesc.CS = computeShader;
+
+  pPipelineLibrary->CreateComputePipelineState(psoDesc, name, pipelineState);
   SetName(*pipelineState, name);
 }
 
-void CreateBufferResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
-  size_t dataSize, ID3D12Resource** buffer, ID3D12Resource** bufferUpload, void* data) {
-  D3D12_HEAP_PROPERTIES defaultHeapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+void CreateBufferResourceCore(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
+  size_t dataSize, ID3D12Resource** buffer, const void* data) {
   D3D12_RESOURCE_DESC bufferResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(dataSize);
-  ThrowIfFailed(pDevice->CreateCommittedResource(
-    &defaultHeapProperty,
-    D3D12_HEAP_FLAG_NONE,
-    &bufferResourceDesc,
-    D3D12_RESOURCE_STATE_COPY_DEST,
-    nullptr,
-    IID_PPV_ARGS(buffer)));  
-
-  D3D12_HEAP_PROPERTIES uploadHeapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-  ThrowIfFailed(pDevice->CreateCommittedResource(
-    &uploadHeapProperty,
-    D3D12_HEAP_FLAG_NONE,
-    &bufferResourceDesc,
-    D3D12_RESOURCE_STATE_GENERIC_READ,
-    nullptr,
-    IID_PPV_ARGS(bufferUpload)));
-
-  // Copy data to the upload heap and then schedule a copy 
-  // from the upload heap to the vertex buffer.
-  D3D12_SUBRESOURCE_DATA subresourceData = {};
-  subresourceData.pData = data;
-  subresourceData.RowPitch = dataSize;
-  subresourceData.SlicePitch = dataSize;
-
-  UpdateSubresources<1>(pCommandList, *buffer, *bufferUpload, 0, 0, 1, &subresourceData);
+  pAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, bufferResourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, buffer);
+
+  // Stage the data in the upload ring and then schedule a copy 
+  // from the ring to the buffer.
+  pUploader->UploadBuffer(*buffer, data, dataSize);
 }
 
-void CreateVertexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
-  size_t vertexDataSize, ID3D12Resource** vertexBuffer, LPCWSTR name, ID3D12Resource** vertexBufferUpload, void* vertexData, 
+void CreateVertexBufferResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
+  size_t vertexDataSize, ID3D12Resource** vertexBuffer, LPCWSTR name, const void* vertexData, 
   D3D12_VERTEX_BUFFER_VIEW& vertexBufferView, UINT vertexStride) {
-  CreateBufferResourceCore(pDevice, pCommandList,
-    vertexDataSize, vertexBuffer, vertexBufferUpload, vertexData);
+  CreateBufferResourceCore(pDevice, pAllocator, pUploader,
+    vertexDataSize, vertexBuffer, vertexData);
 
   SetName(*vertexBuffer, name);
 
@@ -168,11 +221,11 @@ void CreateVertexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList
   vertexBufferView.StrideInBytes = vertexStride;
 }
 
-void CreateIndexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList, 
-  size_t indexDataSize, ID3D12Resource** indexBuffer, LPCWSTR name, ID3D12Resource** indexBufferUpload, void* indexData,
+void CreateIndexBufferResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader, 
+  size_t indexDataSize, ID3D12Resource** indexBuffer, LPCWSTR name, const void* indexData,
   D3D12_INDEX_BUFFER_VIEW& indexBufferView, DXGI_FORMAT indexFormat) {
-  CreateBufferResourceCore(pDevice, pCommandList,
-    indexDataSize, indexBuffer, indexBufferUpload, indexData);
+  CreateBufferResourceCore(pDevice, pAllocator, pUploader,
+    indexDataSize, indexBuffer, indexData);
 
   SetName(*indexBuffer, name);
 
@@ -182,10 +235,10 @@ void CreateIndexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList*
   indexBufferView.Format = DXGI_FORMAT_R32_UINT;
 }
 
-void CreateTextureResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void CreateTextureResourceCore(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   D3D12_RESOURCE_DIMENSION dimension, size_t width, UINT height, UINT16 depthOrArraySize, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, D3D12_SRV_DIMENSION srvViewDimension, D3D12_CPU_DESCRIPTOR_HANDLE srvCPUHandle) {
   CD3DX12_RESOURCE_DESC texDescOrigin(
     dimension,
@@ -200,38 +253,23 @@ void CreateTextureResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList*
     D3D12_TEXTURE_LAYOUT_UNKNOWN,
     flags);
 
-  D3D12_HEAP_PROPERTIES defaultHeapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-  ThrowIfFailed(pDevice->CreateCommittedResource(
-    &defaultHeapProperty,
-    D3D12_HEAP_FLAG_NONE,
-    &texDescOrigin,
-    initialState,
-    nullptr,
-    IID_PPV_ARGS(texture)));
+  pAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, texDescOrigin, initialState, nullptr, texture);
 
   auto texDesc = (*texture)->GetDesc();
 
   if (needUpload) {
+    // The subresources follow each other in textureData, slicePitch apart.
     const UINT subresourceCount = texDesc.DepthOrArraySize * texDesc.MipLevels;
-    UINT64 uploadBufferSize = GetRequiredIntermediateSize(*texture, 0, subresourceCount);
-    D3D12_HEAP_PROPERTIES uploadHeapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC bufferResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-    ThrowIfFailed(pDevice->CreateCommittedResource(
-      &uploadHeapProperty,
-      D3D12_HEAP_FLAG_NONE,
-      &bufferResourceDesc,
-      D3D12_RESOURCE_STATE_GENERIC_READ,
-      nullptr,
-      IID_PPV_ARGS(textureUpload)));
-
-    // Copy data to the intermediate upload heap and then schedule a copy
-    // from the upload heap to the Texture2D.
-    D3D12_SUBRESOURCE_DATA textureSubresourceData = {};
-    textureSubresourceData.pData = textureData;
-    textureSubresourceData.RowPitch = rowPitch;
-    textureSubresourceData.SlicePitch = slicePitch;
+    std::vector<D3D12_SUBRESOURCE_DATA> textureSubresourceData(subresourceCount);
+    for (UINT i = 0; i < subresourceCount; ++i) {
+      textureSubresourceData[i].pData = static_cast<const UINT8*>(textureData) + i * slicePitch;
+      textureSubresourceData[i].RowPitch = rowPitch;
+      textureSubresourceData[i].SlicePitch = slicePitch;
+    }
 
-    UpdateSubresources(pCommandList, *texture, *textureUpload, 0, 0, subresourceCount, &textureSubresourceData);
+    // Stage the data in the upload ring and then schedule a copy
+    // from the ring to the Texture2D.
+    pUploader->UploadTexture(*texture, 0, subresourceCount, textureSubresourceData.data());
 
     // Performance tip: You can avoid some resource barriers by relying on resource state promotion and decay.
     // Resources accessed on a copy queue will decay back to the COMMON after ExecuteCommandLists()
@@ -262,16 +300,16 @@ void CreateTextureResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList*
   }
 }
 
-void Create2DTextureResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void Create2DTextureResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   size_t width, UINT height, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, LPCWSTR name, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, const D3D12_CPU_DESCRIPTOR_HANDLE* srvCPUHandle,
   bool asRTV, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvCPUHandle) {
-  CreateTextureResourceCore(pDevice, pCommandList,
+  CreateTextureResourceCore(pDevice, pAllocator, pUploader,
     D3D12_RESOURCE_DIMENSION_TEXTURE2D, width, height, 1, mipLevels, format, flags,
     texture, initialState,
-    needUpload, textureUpload, textureData, rowPitch, slicePitch,
+    needUpload, textureData, rowPitch, slicePitch,
     asSRV, D3D12_SRV_DIMENSION_TEXTURE2D, *srvCPUHandle);
 
   if (asRTV) {
@@ -286,17 +324,17 @@ void Create2DTextureResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* p
   SetName(*texture, name);
 }
 
-void CreateCubeTextureResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void CreateCubeTextureResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   size_t width, UINT height, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, LPCWSTR name, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, const D3D12_CPU_DESCRIPTOR_HANDLE* srvCPUHandle,
   bool asRTV, const D3D12_CPU_DESCRIPTOR_HANDLE* startRtvCPUHandle, UINT rtvDescriptorSize) {
   constexpr UINT16 kCubeMapArraySize = 6;
-  CreateTextureResourceCore(pDevice, pCommandList,
+  CreateTextureResourceCore(pDevice, pAllocator, pUploader,
     D3D12_RESOURCE_DIMENSION_TEXTURE2D, width, height, kCubeMapArraySize, mipLevels, format, flags,
     texture, initialState,
-    needUpload, textureUpload, textureData, rowPitch, slicePitch,
+    needUpload, textureData, rowPitch, slicePitch,
     asSRV, D3D12_SRV_DIMENSION_TEXTURECUBE, *srvCPUHandle);
 
   if (asRTV) {
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "../core/stdafx.h"
-#include "../core/DXSample.h"
+#include "../pipeline_library.h"
+#include "../resource_allocator.h"
+#include "../shader_cache.h"
+#include "../shader_features.h"
+#include "../staging_ring.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -10,12 +14,25 @@ namespace util {
 enum class DescriptorType {
   kConstantBuffer,
   kShaderResourceView,
+  kUnorderedAccessView,
+  kRootShaderResourceView,  // root descriptor, e.g. for a StructuredBuffer
+  kRootConstants,  // numDescriptors is the number of 32-bit values
+};
+
+// How long the data a descriptor points to stays unchanged, a root signature 1.1 promise the driver
+// can use to fetch it early. Ignored by root constants and on devices without root signature 1.1.
+enum class DataVolatility {
+  kDefault,  // volatile for UAVs, static while set at execute otherwise
+  kStatic,  // unchanged from recording the Set call until the command list finishes executing
+  kVolatile,  // may change at any time, even by other command lists
 };
 
 struct DescriptorDesc {
   DescriptorDesc() = default;
-  DescriptorDesc(DescriptorType _type, D3D12_SHADER_VISIBILITY _visibility, UINT _numDescriptors, UINT _baseShaderRegister)
-    : type(_type), visibility(_visibility), numDescriptors(_numDescriptors), baseShaderRegister(_baseShaderRegister) {
+  DescriptorDesc(DescriptorType _type, D3D12_SHADER_VISIBILITY _visibility, UINT _numDescriptors, UINT _baseShaderRegister,
+    DataVolatility _dataVolatility = DataVolatility::kDefault, bool _descriptorsVolatile = false)
+    : type(_type), visibility(_visibility), numDescriptors(_numDescriptors), baseShaderRegister(_baseShaderRegister),
+    dataVolatility(_dataVolatility), descriptorsVolatile(_descriptorsVolatile) {
 
   }
 
@@ -23,59 +40,81 @@ struct DescriptorDesc {
   D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL;
   UINT numDescriptors = 1;
   UINT baseShaderRegister = 0;
+  DataVolatility dataVolatility = DataVolatility::kDefault;
+  // Descriptor tables only: the descriptors may still be written after the table is set, until the
+  // command list executes.
+  bool descriptorsVolatile = false;
 };
 
 struct SamplerDesc {
   SamplerDesc() = default;
-  SamplerDesc(D3D12_FILTER _filter, D3D12_TEXTURE_ADDRESS_MODE _addressMode, UINT _baseShaderRegister)
-    : filter(_filter), addressMode(_addressMode), baseShaderRegister(_baseShaderRegister) {
+  SamplerDesc(D3D12_FILTER _filter, D3D12_TEXTURE_ADDRESS_MODE _addressMode, UINT _baseShaderRegister,
+    D3D12_SHADER_VISIBILITY _visibility = D3D12_SHADER_VISIBILITY_PIXEL,
+    D3D12_COMPARISON_FUNC _comparisonFunc = D3D12_COMPARISON_FUNC_NEVER)
+    : filter(_filter), addressMode(_addressMode), baseShaderRegister(_baseShaderRegister), visibility(_visibility),
+    comparisonFunc(_comparisonFunc) {
 
   }
 
   D3D12_FILTER filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
   D3D12_TEXTURE_ADDRESS_MODE addressMode = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
   UINT baseShaderRegister = 0;
+  // Compute root signatures need D3D12_SHADER_VISIBILITY_ALL.
+  D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_PIXEL;
+  // Only used by comparison filters, e.g. for shadow maps.
+  D3D12_COMPARISON_FUNC comparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
 };
 
+// flags are added to the ones the helper derives, e.g. D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED.
 void CreateRootSignature(ID3D12Device* pDevice, const std::vector<DescriptorDesc>& descriptorDescs, const std::vector<SamplerDesc>& samplerDescs,
-  ID3D12RootSignature** rootSignature, LPCWSTR name);
+  ID3D12RootSignature** rootSignature, LPCWSTR name, D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
-void CreatePipelineState(ID3D12Device* pDevice, DXSample* pSample, LPCWSTR shaderFilePath, const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputElementDescs,
+// Shader model 6.6 and resource binding tier 3, which the BINDLESS shader variants need.
+bool IsBindlessSupported(ID3D12Device* pDevice);
+
+// The pipeline states come from pPipelineLibrary, which compiles them if it doesn't have them yet.
+// The shaders are the variant of shaderFeatures.
+// Thread safe, as long as every thread creates a different pipeline state.
+void CreatePipelineState(PipelineLibrary* pPipelineLibrary, ShaderCache* pShaderCache, LPCWSTR shaderFilePath, const ShaderFeatureKey& shaderFeatures,
+  const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputElementDescs,
   ID3D12RootSignature* rootSignaturePtr, const std::vector<DXGI_FORMAT>& rtvFormats,
   bool needDepthTest, D3D12_COMPARISON_FUNC depthFunc,
   ID3D12PipelineState** pipelineState, LPCWSTR name,
   bool frontFaceCounterClockwise = false);
 
-void CreateBufferResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
-  size_t dataSize, ID3D12Resource** buffer, ID3D12Resource** bufferUpload, void* data);
+void CreateComputePipelineState(PipelineLibrary* pPipelineLibrary, ShaderCache* pShaderCache, LPCWSTR shaderFilePath, const ShaderFeatureKey& shaderFeatures,
+  ID3D12RootSignature* rootSignaturePtr, ID3D12PipelineState** pipelineState, LPCWSTR name);
+
+void CreateBufferResourceCore(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
+  size_t dataSize, ID3D12Resource** buffer, const void* data);
 
-void CreateVertexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
-  size_t vertexDataSize, ID3D12Resource** vertexBuffer, LPCWSTR name, ID3D12Resource** vertexBufferUpload, void* vertexData,
+void CreateVertexBufferResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
+  size_t vertexDataSize, ID3D12Resource** vertexBuffer, LPCWSTR name, const void* vertexData,
   D3D12_VERTEX_BUFFER_VIEW& vertexBufferView, UINT vertexStride);
 
-void CreateIndexBufferResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
-  size_t indexDataSize, ID3D12Resource** indexBuffer, LPCWSTR name, ID3D12Resource** indexBufferUpload, void* indexData,
+void CreateIndexBufferResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
+  size_t indexDataSize, ID3D12Resource** indexBuffer, LPCWSTR name, const void* indexData,
   D3D12_INDEX_BUFFER_VIEW& indexBufferView, DXGI_FORMAT indexFormat);
 
-void CreateTextureResourceCore(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void CreateTextureResourceCore(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   D3D12_RESOURCE_DIMENSION dimension, size_t width, UINT height, UINT16 depthOrArraySize, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, D3D12_SRV_DIMENSION srvViewDimension, D3D12_CPU_DESCRIPTOR_HANDLE srvCPUHandle);
 
 // single 2D texture
-void Create2DTextureResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void Create2DTextureResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   size_t width, UINT height, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, LPCWSTR name, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, const D3D12_CPU_DESCRIPTOR_HANDLE* srvCPUHandle,
   bool asRTV, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvCPUHandle);
 
 // single cubemap texture
-void CreateCubeTextureResource(ID3D12Device* pDevice, ID3D12GraphicsCommandList* pCommandList,
+void CreateCubeTextureResource(ID3D12Device* pDevice, ResourceAllocator* pAllocator, StagingUploader* pUploader,
   size_t width, UINT height, UINT16 mipLevels, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
   ID3D12Resource** texture, LPCWSTR name, D3D12_RESOURCE_STATES initialState,
-  bool needUpload, ID3D12Resource** textureUpload, void* textureData, size_t rowPitch, size_t slicePitch,
+  bool needUpload, const void* textureData, size_t rowPitch, size_t slicePitch,
   bool asSRV, const D3D12_CPU_DESCRIPTOR_HANDLE* srvCPUHandle,
   bool asRTV, const D3D12_CPU_DESCRIPTOR_HANDLE* startRtvCPUHandle, UINT rtvDescriptorSize);
 
@@ -0,0 +1,101 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "cpu_profiler.h"
+
+WorkerPool::WorkerPool(UINT numThreads) {
+  m_threads.reserve(numThreads);
+  for (UINT i = 0; i < numThreads; ++i) {
+    m_threads.emplace_back(&WorkerPool::WorkerMain, this, i);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_taskAvailable.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void WorkerPool::Dispatch(std::function<void(UINT)> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = std::move(task);
+    m_pendingWorkers = GetThreadCount();
+    m_exception = nullptr;
+    ++m_generation;
+  }
+  m_taskAvailable.notify_all();
+}
+
+void WorkerPool::Wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_taskFinished.wait(lock, [this] { return m_pendingWorkers == 0; });
+  if (m_exception) {
+    std::exception_ptr exception = m_exception;
+    m_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void WorkerPool::ForEach(UINT count, const std::function<void(UINT)>& task) {
+  std::atomic<UINT> next(0);
+  auto runTasks = [&] {
+    for (UINT i = next++; i < count; i = next++) {
+      task(i);
+    }
+  };
+  Dispatch([&](UINT) { runTasks(); });
+  try {
+    runTasks();
+  } catch (...) {
+    // The workers still use next and task.
+    Wait();
+    throw;
+  }
+  Wait();
+}
+
+UINT WorkerPool::GetDefaultThreadCount(UINT maxThreads) {
+  const UINT hardwareThreads = std::thread::hardware_concurrency();
+  return (std::max)(1u, (std::min)(hardwareThreads > 1 ? hardwareThreads - 1 : 1u, maxThreads));
+}
+
+void WorkerPool::WorkerMain(UINT workerIndex) {
+  CpuProfiler::Get().SetThreadName("worker");
+  UINT64 generation = 0;
+  for (;;) {
+    std::function<void(UINT)> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskAvailable.wait(lock, [&] { return m_exit || m_generation != generation; });
+      if (m_exit) {
+        return;
+      }
+      generation = m_generation;
+      task = m_task;
+    }
+
+    std::exception_ptr exception;
+    try {
+      task(workerIndex);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (exception && !m_exception) {
+        m_exception = exception;
+      }
+      --m_pendingWorkers;
+    }
+    m_taskFinished.notify_all();
+  }
+}
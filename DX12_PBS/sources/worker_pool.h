@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/stdafx.h"
+
+// A fixed set of threads that all run the same task, e.g. recording one command list each.
+// Dispatch hands the task to every worker and returns at once, so the calling thread can do its
+// own share of the work before it calls Wait.
+class WorkerPool {
+public:
+  explicit WorkerPool(UINT numThreads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  UINT GetThreadCount() const {
+    return static_cast<UINT>(m_threads.size());
+  }
+
+  // Runs task(workerIndex) once on every worker. The previous dispatch must have been waited for.
+  void Dispatch(std::function<void(UINT)> task);
+  // Blocks until every worker has finished the task, and rethrows the first exception a worker threw.
+  void Wait();
+  // Runs task(i) for every i < count, spread over the workers and the calling thread, and waits.
+  void ForEach(UINT count, const std::function<void(UINT)>& task);
+
+  // Number of workers worth using on this machine, leaving one core to the calling thread.
+  static UINT GetDefaultThreadCount(UINT maxThreads);
+
+private:
+  void WorkerMain(UINT workerIndex);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_taskAvailable;
+  std::condition_variable m_taskFinished;
+  std::function<void(UINT)> m_task;
+  UINT64 m_generation = 0;  // incremented for every dispatch
+  UINT m_pendingWorkers = 0;
+  std::exception_ptr m_exception;
+  bool m_exit = false;
+};
@@ -0,0 +1,215 @@
+#include "asset_pack.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr uint32_t kContentVersion = 3;
+constexpr uint32_t kFormatR32G32B32A32Float = 2;  // DXGI_FORMAT_R32G32B32A32_FLOAT
+const char* const kPackPath = "asset_pack_test.pack";
+
+std::vector<char> ReadFile(const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const char* path, const std::vector<char>& contents) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+bool OpenPack(const std::vector<char>& contents, uint32_t contentVersion = kContentVersion) {
+  WriteFile(kPackPath, contents);
+  AssetPack pack;
+  return pack.Open(kPackPath, contentVersion);
+}
+
+// A texture of width x height texels of 16 bytes, whose bytes encode their position.
+struct SourceTexture {
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> texels;
+
+  SourceTexture(uint32_t width, uint32_t height, uint8_t seed) : width(width), height(height), texels(width * height * 16) {
+    for (size_t i = 0; i < texels.size(); ++i) {
+      texels[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+  }
+
+  AssetPackSourceSubresource GetSubresource() const {
+    return { texels.data(), width * 16ull, width * 16ull, height };
+  }
+};
+
+std::vector<uint32_t> MakeBuffer() {
+  std::vector<uint32_t> buffer(1000);
+  for (uint32_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = i * 2654435761u;
+  }
+  return buffer;
+}
+
+// A buffer and a 10x5 texture with two mips, whose rows of 160 and 80 bytes are padded to 256.
+bool WriteTestPack() {
+  const std::vector<uint32_t> buffer = MakeBuffer();
+  const SourceTexture mip0(10, 5, 1);
+  const SourceTexture mip1(5, 2, 2);
+  const AssetPackSourceSubresource subresources[] = { mip0.GetSubresource(), mip1.GetSubresource() };
+  const AssetPackTextureDesc desc = { kFormatR32G32B32A32Float, 10, 5, 1, 2 };
+
+  AssetPackWriter writer(kPackPath, kContentVersion);
+  return writer.AddBuffer("vertices", buffer.data(), buffer.size() * sizeof(uint32_t), 12) &&
+    writer.AddTexture("environment", desc, subresources) &&
+    writer.Finish();
+}
+
+void CheckSubresource(const AssetPack& pack, const AssetPackEntry& entry, uint32_t index, const SourceTexture& source) {
+  const AssetPackSubresource& subresource = pack.GetSubresources(entry)[index];
+  CHECK_EQUAL(0u, subresource.offset % kAssetPackPlacementAlignment);
+  CHECK_EQUAL(source.width * 16ull, subresource.rowSize);
+  CHECK_EQUAL(256u, subresource.rowPitch);
+  CHECK_EQUAL(source.height, subresource.numRows);
+  const uint8_t* pRows = pack.GetData(entry) + subresource.offset;
+  for (uint32_t y = 0; y < source.height; ++y) {
+    CHECK(memcmp(pRows + y * subresource.rowPitch, source.texels.data() + y * subresource.rowSize, static_cast<size_t>(subresource.rowSize)) == 0);
+  }
+}
+
+void TestRoundTrip() {
+  CHECK(WriteTestPack());
+  AssetPack pack;
+  CHECK(pack.Open(kPackPath, kContentVersion));
+  if (!pack.IsOpen()) {
+    return;
+  }
+
+  const AssetPackEntry* pBuffer = pack.Find("vertices", AssetPackEntryType::kBuffer);
+  CHECK(pBuffer != nullptr);
+  if (pBuffer != nullptr) {
+    const std::vector<uint32_t> buffer = MakeBuffer();
+    CHECK_EQUAL(0u, pBuffer->offset % kAssetPackBlobAlignment);
+    CHECK_EQUAL(12u, pBuffer->elementSize);
+    CHECK_EQUAL(buffer.size() * sizeof(uint32_t), pBuffer->size);
+    CHECK(memcmp(pack.GetData(*pBuffer), buffer.data(), buffer.size() * sizeof(uint32_t)) == 0);
+  }
+
+  const AssetPackEntry* pTexture = pack.Find("environment", AssetPackEntryType::kTexture);
+  CHECK(pTexture != nullptr);
+  if (pTexture != nullptr) {
+    CHECK_EQUAL(0u, pTexture->offset % kAssetPackBlobAlignment);
+    CHECK_EQUAL(kFormatR32G32B32A32Float, pTexture->format);
+    CHECK_EQUAL(10u, pTexture->width);
+    CHECK_EQUAL(5u, pTexture->height);
+    CHECK_EQUAL(1u, pTexture->arraySize);
+    CHECK_EQUAL(2u, pTexture->mipLevels);
+    CheckSubresource(pack, *pTexture, 0, SourceTexture(10, 5, 1));
+    CheckSubresource(pack, *pTexture, 1, SourceTexture(5, 2, 2));
+    // The last row isn't padded, like in a placed footprint.
+    const AssetPackSubresource& lastMip = pack.GetSubresources(*pTexture)[1];
+    CHECK_EQUAL(lastMip.offset + 256 + 80, pTexture->size);
+  }
+
+  // Entries are found by name and type.
+  CHECK(pack.Find("vertices", AssetPackEntryType::kTexture) == nullptr);
+  CHECK(pack.Find("indices", AssetPackEntryType::kBuffer) == nullptr);
+}
+
+void TestRejectsOtherVersions() {
+  CHECK(WriteTestPack());
+  const std::vector<char> contents = ReadFile(kPackPath);
+  CHECK(OpenPack(contents));
+  CHECK(!OpenPack(contents, kContentVersion + 1));
+
+  std::vector<char> otherFormat = contents;
+  const uint32_t formatVersion = kAssetPackFormatVersion + 1;
+  memcpy(otherFormat.data() + offsetof(AssetPackHeader, formatVersion), &formatVersion, sizeof(formatVersion));
+  CHECK(!OpenPack(otherFormat));
+
+  std::vector<char> otherMagic = contents;
+  otherMagic[0] = 'X';
+  CHECK(!OpenPack(otherMagic));
+
+  // A pack whose writer never finished has an empty header.
+  {
+    AssetPackWriter writer(kPackPath, kContentVersion);
+    const std::vector<uint32_t> buffer = MakeBuffer();
+    CHECK(writer.AddBuffer("vertices", buffer.data(), buffer.size() * sizeof(uint32_t), 12));
+  }
+  AssetPack pack;
+  CHECK(!pack.Open(kPackPath, kContentVersion));
+}
+
+void TestRejectsTruncatedFiles() {
+  CHECK(WriteTestPack());
+  const std::vector<char> contents = ReadFile(kPackPath);
+  AssetPackHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+
+  // Into the header, the blobs, the entries and the subresources.
+  const size_t subresourcesOffset = static_cast<size_t>(header.tocOffset) + header.entryCount * sizeof(AssetPackEntry);
+  for (size_t size : { static_cast<size_t>(0), sizeof(AssetPackHeader) - 1, static_cast<size_t>(5000),
+    static_cast<size_t>(header.tocOffset) + sizeof(AssetPackEntry) / 2, subresourcesOffset, contents.size() - 1 }) {
+    const std::vector<char> truncated(contents.begin(), contents.begin() + size);
+    CHECK(!OpenPack(truncated));
+  }
+  CHECK(!OpenPack(std::vector<char>()));
+}
+
+void TestRejectsEntriesOutsideTheFile() {
+  CHECK(WriteTestPack());
+  const std::vector<char> contents = ReadFile(kPackPath);
+  AssetPackHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+  const size_t entryOffset = static_cast<size_t>(header.tocOffset);  // the buffer
+
+  const auto withField = [&contents, entryOffset](size_t fieldOffset, uint64_t value) {
+    std::vector<char> patched = contents;
+    memcpy(patched.data() + entryOffset + fieldOffset, &value, sizeof(value));
+    return patched;
+  };
+  CHECK(!OpenPack(withField(offsetof(AssetPackEntry, offset), contents.size())));
+  CHECK(!OpenPack(withField(offsetof(AssetPackEntry, offset), UINT64_MAX - 8)));
+  CHECK(!OpenPack(withField(offsetof(AssetPackEntry, size), contents.size())));
+  CHECK(!OpenPack(withField(offsetof(AssetPackEntry, size), UINT64_MAX)));
+  // Up to the TOC is fine, one byte more overlaps it.
+  AssetPackEntry entry;
+  memcpy(&entry, contents.data() + entryOffset, sizeof(entry));
+  CHECK(OpenPack(withField(offsetof(AssetPackEntry, size), header.tocOffset - entry.offset)));
+  CHECK(!OpenPack(withField(offsetof(AssetPackEntry, size), header.tocOffset - entry.offset + 1)));
+
+  // More entries than the TOC holds.
+  std::vector<char> tooManyEntries = contents;
+  const uint32_t entryCount = header.entryCount + 100;
+  memcpy(tooManyEntries.data() + offsetof(AssetPackHeader, entryCount), &entryCount, sizeof(entryCount));
+  CHECK(!OpenPack(tooManyEntries));
+
+  // The TOC past the end of the file.
+  std::vector<char> tocOutside = contents;
+  const uint64_t tocOffset = (contents.size() + 7) / 8 * 8 + 8;
+  memcpy(tocOutside.data() + offsetof(AssetPackHeader, tocOffset), &tocOffset, sizeof(tocOffset));
+  CHECK(!OpenPack(tocOutside));
+
+  // A texture row past the end of its blob.
+  std::vector<char> rowOutside = contents;
+  const size_t subresourcesOffset = static_cast<size_t>(header.tocOffset) + header.entryCount * sizeof(AssetPackEntry);
+  const uint32_t numRows = 1000;
+  memcpy(rowOutside.data() + subresourcesOffset + offsetof(AssetPackSubresource, numRows), &numRows, sizeof(numRows));
+  CHECK(!OpenPack(rowOutside));
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestRejectsOtherVersions();
+  TestRejectsTruncatedFiles();
+  TestRejectsEntriesOutsideTheFile();
+  std::remove(kPackPath);
+  return test::Finish("asset_pack_test");
+}
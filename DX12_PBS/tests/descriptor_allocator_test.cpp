@@ -0,0 +1,150 @@
+#include "descriptor_allocator.h"
+
+#include "test_util.h"
+
+namespace {
+
+const uint32_t kInvalidOffset = DescriptorFreeList::kInvalidOffset;
+const uint32_t kRingInvalidOffset = DescriptorRing::kInvalidOffset;
+
+void TestFreeListFirstFit() {
+  DescriptorFreeList freeList(16);
+  const uint32_t a = freeList.Allocate(4);
+  const uint32_t b = freeList.Allocate(2);
+  const uint32_t c = freeList.Allocate(4);
+  CHECK_EQUAL(0u, a);
+  CHECK_EQUAL(4u, b);
+  CHECK_EQUAL(6u, c);
+  CHECK_EQUAL(6u, freeList.GetFreeCount());
+
+  // Free ranges are [0, 4) and [10, 16): the first one that is large enough is taken, even if a
+  // later one fits better.
+  freeList.Free(a, 4);
+  CHECK_EQUAL(0u, freeList.Allocate(3));
+  CHECK_EQUAL(10u, freeList.Allocate(2));
+  CHECK_EQUAL(3u, freeList.Allocate(1));
+  CHECK_EQUAL(4u, freeList.GetFreeCount());
+}
+
+void TestFreeListMerging() {
+  // Three ranges of 4 that fill the list, freed in every order: whatever order, the free slots end
+  // up as one range, so the whole list can be allocated at once.
+  const uint32_t orders[][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+  for (const auto& order : orders) {
+    DescriptorFreeList freeList(12);
+    uint32_t offsets[3];
+    for (uint32_t& offset : offsets) {
+      offset = freeList.Allocate(4);
+    }
+    CHECK_EQUAL(0u, freeList.GetFreeCount());
+    for (uint32_t i : order) {
+      freeList.Free(offsets[i], 4);
+    }
+    CHECK_EQUAL(12u, freeList.GetFreeCount());
+    CHECK_EQUAL(0u, freeList.Allocate(12));
+  }
+
+  // Freed next to the previous free range, then next to the following one.
+  DescriptorFreeList freeList(12);
+  const uint32_t a = freeList.Allocate(4);
+  const uint32_t b = freeList.Allocate(4);
+  const uint32_t c = freeList.Allocate(4);
+  freeList.Free(a, 4);
+  freeList.Free(b, 4);
+  CHECK_EQUAL(0u, freeList.Allocate(8));
+  freeList.Free(c, 4);
+  freeList.Free(4, 4);
+  CHECK_EQUAL(4u, freeList.Allocate(8));
+}
+
+void TestFreeListFailure() {
+  DescriptorFreeList freeList(8);
+  const uint32_t a = freeList.Allocate(3);
+  freeList.Allocate(2);
+  CHECK_EQUAL(3u, freeList.GetFreeCount());
+  freeList.Free(a, 3);
+
+  // 6 slots are free, but in ranges of 3.
+  CHECK_EQUAL(6u, freeList.GetFreeCount());
+  CHECK_EQUAL(kInvalidOffset, freeList.Allocate(4));
+  CHECK_EQUAL(kInvalidOffset, freeList.Allocate(9));
+  CHECK_EQUAL(kInvalidOffset, freeList.Allocate(0));
+  CHECK_EQUAL(6u, freeList.GetFreeCount());
+  CHECK_EQUAL(0u, freeList.Allocate(3));
+}
+
+void TestRingWrapAround() {
+  DescriptorRing ring(10);
+  CHECK_EQUAL(0u, ring.Allocate(4));
+  ring.EndFrame(1);
+  CHECK_EQUAL(4u, ring.Allocate(4));
+  ring.EndFrame(2);
+  ring.Reclaim(1);
+  CHECK_EQUAL(4u, ring.GetUsedCount());
+
+  // Slots 8 and 9 can't hold 3, so the range starts over at 0 and they are skipped.
+  CHECK_EQUAL(0u, ring.Allocate(3));
+  CHECK_EQUAL(9u, ring.GetUsedCount());
+  // The frame in flight is in the way of anything larger than what is left before it.
+  CHECK_EQUAL(kRingInvalidOffset, ring.Allocate(2));
+  CHECK_EQUAL(3u, ring.Allocate(1));
+  ring.EndFrame(3);
+
+  // The skipped slots are reclaimed with the frame that skipped them.
+  ring.Reclaim(2);
+  CHECK_EQUAL(6u, ring.GetUsedCount());
+  ring.Reclaim(3);
+  CHECK_EQUAL(0u, ring.GetUsedCount());
+  // Nothing in use, so the ring starts over at 0 instead of skipping.
+  CHECK_EQUAL(0u, ring.Allocate(10));
+  CHECK_EQUAL(kRingInvalidOffset, ring.Allocate(1));
+  CHECK_EQUAL(kRingInvalidOffset, DescriptorRing(10).Allocate(11));
+}
+
+void TestRingReclaim() {
+  DescriptorRing ring(12);
+  ring.Allocate(2);
+  ring.EndFrame(1);
+  // A frame that allocated nothing has nothing to reclaim, and doesn't hold back the next one.
+  ring.EndFrame(2);
+  ring.Allocate(3);
+  ring.EndFrame(3);
+  ring.Allocate(4);
+  ring.EndFrame(4);
+  CHECK_EQUAL(9u, ring.GetUsedCount());
+
+  // The fence can pass several frames at once.
+  ring.Reclaim(3);
+  CHECK_EQUAL(4u, ring.GetUsedCount());
+  // A completed value that is older than the last one reclaims nothing more.
+  ring.Reclaim(1);
+  CHECK_EQUAL(4u, ring.GetUsedCount());
+
+  // A frame tagged with a value that completes before an older frame's waits for it: the ring
+  // frees its slots in order.
+  ring.Allocate(2);
+  ring.EndFrame(2);
+  ring.Reclaim(2);
+  CHECK_EQUAL(6u, ring.GetUsedCount());
+  ring.Reclaim(4);
+  CHECK_EQUAL(0u, ring.GetUsedCount());
+
+  // The slots of the frame being recorded aren't reclaimed before it ends.
+  ring.Allocate(5);
+  ring.Reclaim(10);
+  CHECK_EQUAL(5u, ring.GetUsedCount());
+  ring.EndFrame(11);
+  ring.Reclaim(11);
+  CHECK_EQUAL(0u, ring.GetUsedCount());
+}
+
+}  // namespace
+
+int main() {
+  TestFreeListFirstFit();
+  TestFreeListMerging();
+  TestFreeListFailure();
+  TestRingWrapAround();
+  TestRingReclaim();
+  return test::Finish("descriptor_allocator_test");
+}
@@ -0,0 +1,112 @@
+#include "frame_upload_tracker.h"
+
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+using Range = FrameUploadTracker::Range;
+
+constexpr uint32_t kFrameCount = 3;
+constexpr uint32_t kMinCapacity = FrameUploadTracker::kMinCapacity;
+
+void CheckRanges(const std::vector<Range>& expected, const std::vector<Range>& ranges) {
+  CHECK_EQUAL(expected.size(), ranges.size());
+  for (size_t i = 0; i < expected.size() && i < ranges.size(); ++i) {
+    CHECK_EQUAL(expected[i].begin, ranges[i].begin);
+    CHECK_EQUAL(expected[i].end, ranges[i].end);
+  }
+}
+
+// Uploads everything once, so that only the changes after it are dirty.
+FrameUploadTracker CreateUploadedTracker(uint32_t count) {
+  FrameUploadTracker tracker(kFrameCount);
+  std::vector<Range> ranges;
+  for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+    tracker.FitCapacity(frame, count);
+    tracker.TakeDirtyRanges(frame, count, &ranges);
+  }
+  return tracker;
+}
+
+void TestDirtyRanges() {
+  FrameUploadTracker tracker = CreateUploadedTracker(40);
+  std::vector<Range> ranges;
+
+  // Moving lights, in the order LightManager's users touch them: neighbours extend one range, the
+  // others are merged when they overlap or touch once sorted.
+  for (uint32_t index : { 3u, 4u, 5u, 4u, 20u, 10u, 6u, 11u, 9u }) {
+    tracker.MarkDirty(index);
+  }
+  tracker.TakeDirtyRanges(0, 40, &ranges);
+  CheckRanges({ { 3, 7 }, { 9, 12 }, { 20, 21 } }, ranges);
+
+  // Each frame gets the changes, and forgets them once it uploaded them.
+  tracker.TakeDirtyRanges(0, 40, &ranges);
+  CheckRanges({}, ranges);
+  tracker.MarkDirty(30);
+  tracker.TakeDirtyRanges(1, 40, &ranges);
+  CheckRanges({ { 3, 7 }, { 9, 12 }, { 20, 21 }, { 30, 31 } }, ranges);
+  tracker.TakeDirtyRanges(0, 40, &ranges);
+  CheckRanges({ { 30, 31 } }, ranges);
+}
+
+void TestRemovedTail() {
+  // LightManager removes a light by moving the last one into its slot: the slot is dirty, and so may
+  // be lights past the new end, which aren't uploaded.
+  FrameUploadTracker tracker = CreateUploadedTracker(40);
+  std::vector<Range> ranges;
+  tracker.MarkDirty(38);
+  tracker.MarkDirty(39);
+  tracker.MarkDirty(5);
+  tracker.TakeDirtyRanges(0, 38, &ranges);
+  CheckRanges({ { 5, 6 } }, ranges);
+  tracker.TakeDirtyRanges(1, 39, &ranges);
+  CheckRanges({ { 5, 6 }, { 38, 39 } }, ranges);
+
+  tracker.Reset();
+  tracker.TakeDirtyRanges(2, 40, &ranges);
+  CheckRanges({}, ranges);
+}
+
+void TestCapacity() {
+  FrameUploadTracker tracker(kFrameCount);
+  std::vector<Range> ranges;
+  CHECK_EQUAL(0u, tracker.GetCapacity(0));
+  CHECK(tracker.FitCapacity(0, 0));
+  CHECK_EQUAL(kMinCapacity, tracker.GetCapacity(0));
+  tracker.TakeDirtyRanges(0, 0, &ranges);
+  CheckRanges({}, ranges);
+
+  // Growing doubles the capacity, and uploads the whole copy.
+  tracker.MarkDirty(16);
+  CHECK(!tracker.FitCapacity(0, kMinCapacity));
+  CHECK(tracker.FitCapacity(0, 100));
+  CHECK_EQUAL(128u, tracker.GetCapacity(0));
+  tracker.TakeDirtyRanges(0, 100, &ranges);
+  CheckRanges({ { 0, 100 } }, ranges);
+
+  // Only a buffer that is mostly unused shrinks, to the capacity that fits the count.
+  CHECK(!tracker.FitCapacity(0, 33));
+  CHECK_EQUAL(128u, tracker.GetCapacity(0));
+  CHECK(tracker.FitCapacity(0, 32));
+  CHECK_EQUAL(32u, tracker.GetCapacity(0));
+  tracker.TakeDirtyRanges(0, 32, &ranges);
+  CheckRanges({ { 0, 32 } }, ranges);
+  // Even without elements the capacity is kMinCapacity, which is more than a quarter of 32.
+  CHECK(!tracker.FitCapacity(0, 0));
+  CHECK_EQUAL(32u, tracker.GetCapacity(0));
+
+  // The frames are resized on their own, when they commit.
+  CHECK_EQUAL(0u, tracker.GetCapacity(1));
+}
+
+}  // namespace
+
+int main() {
+  TestDirtyRanges();
+  TestRemovedTail();
+  TestCapacity();
+  return test::Finish("frame_upload_tracker_test");
+}
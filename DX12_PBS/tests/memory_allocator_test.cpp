@@ -0,0 +1,144 @@
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+const uint64_t kInvalidOffset = BuddyAllocator::kInvalidOffset;
+
+void TestRandomAllocations() {
+  const uint64_t capacity = 1 << 20;
+  const uint64_t minBlockSize = 256;
+  BuddyAllocator allocator(capacity, minBlockSize);
+  std::mt19937 random(42);
+  std::map<uint64_t, uint64_t> allocations;  // offset to requested size
+  uint64_t requestedSize = 0;
+
+  for (int i = 0; i < 20000; ++i) {
+    if (allocations.empty() || random() % 3 != 0) {
+      const uint64_t size = 1 + random() % (64 * 1024);
+      const uint64_t alignment = 1ull << (random() % 17);
+      const uint64_t offset = allocator.Allocate(size, alignment);
+      if (offset == kInvalidOffset) {
+        // Only when no free block is large enough.
+        CHECK(allocator.GetLargestFreeBlock() < (std::max)(size, alignment));
+        continue;
+      }
+      CHECK_EQUAL(0u, offset % alignment);
+      CHECK(offset + size <= capacity);
+      // No overlap with the neighbours in address order.
+      const auto next = allocations.lower_bound(offset);
+      CHECK(next == allocations.end() || offset + size <= next->first);
+      if (next != allocations.begin()) {
+        const auto previous = std::prev(next);
+        CHECK(previous->first + previous->second <= offset);
+      }
+      allocations[offset] = size;
+      requestedSize += size;
+    } else {
+      auto allocation = allocations.begin();
+      std::advance(allocation, random() % allocations.size());
+      allocator.Free(allocation->first);
+      requestedSize -= allocation->second;
+      allocations.erase(allocation);
+    }
+    CHECK_EQUAL(allocations.size(), allocator.GetAllocationCount());
+    CHECK_EQUAL(requestedSize, allocator.GetRequestedSize());
+    CHECK(allocator.GetUsedSize() >= allocator.GetRequestedSize());
+    CHECK(allocator.GetUsedSize() <= capacity);
+  }
+
+  // Everything merges back into a single block.
+  for (const auto& allocation : allocations) {
+    allocator.Free(allocation.first);
+  }
+  CHECK_EQUAL(0u, allocator.GetAllocationCount());
+  CHECK_EQUAL(0u, allocator.GetUsedSize());
+  CHECK_EQUAL(0u, allocator.GetRequestedSize());
+  CHECK_EQUAL(capacity, allocator.GetLargestFreeBlock());
+  CHECK_EQUAL(0u, allocator.Allocate(capacity, 1));
+}
+
+void TestAlignmentAndRounding() {
+  BuddyAllocator allocator(4096, 256);
+  // Rounded up to the minimum block.
+  CHECK_EQUAL(0u, allocator.Allocate(1, 1));
+  CHECK_EQUAL(256u, allocator.GetUsedSize());
+  // Rounded up to the next power of two blocks, the lowest free offset first.
+  CHECK_EQUAL(512u, allocator.Allocate(300, 1));
+  CHECK_EQUAL(768u, allocator.GetUsedSize());
+  CHECK_EQUAL(256u, allocator.Allocate(256, 256));
+  // An alignment above the size takes a block of the alignment.
+  CHECK_EQUAL(1024u, allocator.Allocate(100, 1024));
+  CHECK_EQUAL(2048u, allocator.GetUsedSize());
+  CHECK_EQUAL(657u, allocator.GetRequestedSize());
+  CHECK_EQUAL(2048u, allocator.Allocate(2048, 2048));
+  CHECK_EQUAL(4096u, allocator.GetUsedSize());
+}
+
+void TestAllocationFailures() {
+  BuddyAllocator allocator(4096, 256);
+  CHECK(allocator.Allocate(0, 1) == kInvalidOffset);
+  CHECK(allocator.Allocate(4097, 1) == kInvalidOffset);
+  CHECK(allocator.Allocate(16, 8192) == kInvalidOffset);
+
+  std::vector<uint64_t> offsets;
+  for (int i = 0; i < 16; ++i) {
+    offsets.push_back(allocator.Allocate(200, 1));
+    CHECK_EQUAL(i * 256ull, offsets.back());
+  }
+  CHECK(allocator.Allocate(1, 1) == kInvalidOffset);
+  CHECK_EQUAL(0u, allocator.GetLargestFreeBlock());
+
+  allocator.Free(offsets[5]);
+  CHECK_EQUAL(offsets[5], allocator.Allocate(1, 1));
+  // Freeing an offset that isn't allocated changes nothing.
+  allocator.Free(100);
+  CHECK_EQUAL(16u, allocator.GetAllocationCount());
+  CHECK(allocator.Allocate(1, 1) == kInvalidOffset);
+}
+
+void TestStatistics() {
+  BuddyAllocator allocator(4096, 256);
+  CHECK_EQUAL(4096u, allocator.GetCapacity());
+  CHECK_EQUAL(4096u, allocator.GetLargestFreeBlock());
+
+  std::vector<uint64_t> offsets;
+  for (int i = 0; i < 16; ++i) {
+    offsets.push_back(allocator.Allocate(100, 1));
+  }
+  CHECK_EQUAL(4096u, allocator.GetUsedSize());
+  CHECK_EQUAL(1600u, allocator.GetRequestedSize());
+
+  // Every other block free: half of the memory, but no block larger than the minimum.
+  for (int i = 0; i < 16; i += 2) {
+    allocator.Free(offsets[i]);
+  }
+  CHECK_EQUAL(2048u, allocator.GetUsedSize());
+  CHECK_EQUAL(800u, allocator.GetRequestedSize());
+  CHECK_EQUAL(8u, allocator.GetAllocationCount());
+  CHECK_EQUAL(256u, allocator.GetLargestFreeBlock());
+
+  // Freeing a buddy merges the pair, then with the next pair once that is free too.
+  allocator.Free(offsets[1]);
+  CHECK_EQUAL(512u, allocator.GetLargestFreeBlock());
+  allocator.Free(offsets[3]);
+  CHECK_EQUAL(1024u, allocator.GetLargestFreeBlock());
+  CHECK(allocator.Allocate(1024, 1) == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestRandomAllocations();
+  TestAlignmentAndRounding();
+  TestAllocationFailures();
+  TestStatistics();
+  return test::Finish("memory_allocator_test");
+}
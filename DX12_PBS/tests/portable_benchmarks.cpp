@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "memory_allocator.h"
+#include "microbenchmark.h"
+#include "render_graph.h"
+#include "residency_tracker.h"
+#include "sample_meshes.h"
+#ifdef DX12_PBS_HAS_DIRECTXMATH
+#include "util/Camera.h"
+#endif
+
+// The microbenchmarks of the parts of the sample that build without the Windows SDK: the sphere mesh
+// and instance generation, the camera matrices when DirectXMath is found, the frame graph compile,
+// the residency tracker update and the buddy allocator. The sample's -cpuBenchmark runs the ones
+// that need D3D12 or DirectXTex.
+// usage: portable_benchmarks [results.csv [baseline.csv]]
+// Like -cpuBenchmark, compares the results with the baseline, which the first run creates, and fails
+// if a kernel regressed.
+
+namespace {
+
+constexpr size_t kSampleCount = 20;
+constexpr int64_t kMinSampleNanoseconds = 10 * 1000 * 1000;
+
+// D3D12_RESOURCE_STATES bits.
+constexpr RenderGraph::ResourceStates kStateCommon = 0x0;
+constexpr RenderGraph::ResourceStates kStateRenderTarget = 0x4;
+constexpr RenderGraph::ResourceStates kStateUnorderedAccess = 0x8;
+constexpr RenderGraph::ResourceStates kStateDepthWrite = 0x10;
+constexpr RenderGraph::ResourceStates kStateNonPixelShaderResource = 0x40;
+constexpr RenderGraph::ResourceStates kStatePixelShaderResource = 0x80;
+constexpr RenderGraph::ResourceStates kStateCopyDest = 0x400;
+constexpr RenderGraph::ResourceStates kStateCopySource = 0x800;
+
+void AddMeshBenchmarks(MicroBenchmark* pBenchmark) {
+  // The scene's sphere has 64 segments.
+  for (uint32_t segments : { 16u, 64u, 256u }) {
+    const uint32_t vertexCount = (segments + 1) * (segments + 1);
+    pBenchmark->Run("sphere_model/" + std::to_string(segments), vertexCount, [segments] {
+      SphereModel sphereModel(segments, segments);
+      const std::unique_ptr<MeshVertex[]> vertices = sphereModel.GetVertexData();
+      const std::unique_ptr<uint32_t[]> indices = sphereModel.GetIndexData();
+      MicroBenchmark::KeepAlive(vertices.get());
+      MicroBenchmark::KeepAlive(indices.get());
+    });
+  }
+
+  for (uint32_t numLayers : { 1u, 4u, 16u }) {
+    uint32_t instanceCount = 0;
+    GetSphereInstanceData(numLayers, instanceCount);
+    pBenchmark->Run("sphere_instances/" + std::to_string(numLayers), instanceCount, [numLayers] {
+      uint32_t instanceCount = 0;
+      const std::unique_ptr<SphereInstance[]> instances = GetSphereInstanceData(numLayers, instanceCount);
+      MicroBenchmark::KeepAlive(instances.get());
+    });
+  }
+}
+
+#ifdef DX12_PBS_HAS_DIRECTXMATH
+void AddCameraBenchmarks(MicroBenchmark* pBenchmark) {
+  // Once per frame in the scene, and in bulk to see the throughput without the call overhead.
+  for (uint32_t numCameras : { 1u, 1024u }) {
+    Camera camera;
+    camera.Set(XMVectorSet(0.0f, 0.0f, 3.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
+    pBenchmark->Run("camera_matrices/" + std::to_string(numCameras), numCameras, [&camera, numCameras] {
+      XMFLOAT4X4 view, projection;
+      for (uint32_t i = 0; i < numCameras; ++i) {
+        camera.RotateAroundYAxis(0.001f);
+        camera.Get3DViewProjMatrices(&view, &projection, 60.0f, 1280.0f, 720.0f, 0.1f, 100.0f);
+        MicroBenchmark::KeepAlive(&view);
+        MicroBenchmark::KeepAlive(&projection);
+      }
+    });
+  }
+}
+#endif
+
+// The graph PBSScene::BuildFrameGraph builds and compiles every frame in tiled deferred mode, with
+// postProcessPasses passes after it that each read the output of the previous one into a new
+// transient, to see how Compile scales. Returns the number of passes.
+uint32_t BuildFrameGraph(RenderGraph* pGraph, uint32_t postProcessPasses) {
+  const RenderGraph::ResourceStates shadowMapState = kStatePixelShaderResource | kStateNonPixelShaderResource;
+  const auto backBuffer = pGraph->ImportResource("back buffer", kStateCommon, kStateCommon);
+  const auto depth = pGraph->ImportResource("depth", kStateDepthWrite, kStateDepthWrite);
+  const auto cascadeShadowMaps = pGraph->ImportResource("cascade shadow maps", shadowMapState, shadowMapState);
+  const auto pointShadowMaps = pGraph->ImportResource("point shadow maps", shadowMapState, shadowMapState);
+  const auto gbufferNormal = pGraph->CreateTransientResource("G-buffer normal", 8 << 20, 65536, 0, kStateRenderTarget);
+  const auto gbufferMaterial = pGraph->CreateTransientResource("G-buffer material", 8 << 20, 65536, 0, kStateRenderTarget);
+  auto output = pGraph->CreateTransientResource("tiled shading output", 16 << 20, 65536, 1, kStateUnorderedAccess);
+
+  const auto shadowPass = pGraph->AddPass("shadow");
+  pGraph->Write(shadowPass, cascadeShadowMaps, kStateDepthWrite);
+  pGraph->Write(shadowPass, pointShadowMaps, kStateDepthWrite);
+
+  const auto gbufferPass = pGraph->AddPass("G-buffer");
+  pGraph->Write(gbufferPass, gbufferNormal, kStateRenderTarget);
+  pGraph->Write(gbufferPass, gbufferMaterial, kStateRenderTarget);
+  pGraph->Write(gbufferPass, depth, kStateDepthWrite);
+
+  const auto tiledShadingPass = pGraph->AddPass("tiled shading");
+  for (RenderGraph::ResourceHandle input : { gbufferNormal, gbufferMaterial, depth, cascadeShadowMaps, pointShadowMaps }) {
+    pGraph->Read(tiledShadingPass, input, kStateNonPixelShaderResource);
+  }
+  pGraph->Write(tiledShadingPass, output, kStateUnorderedAccess);
+
+  for (uint32_t i = 0; i < postProcessPasses; ++i) {
+    const auto postProcessOutput = pGraph->CreateTransientResource("post process " + std::to_string(i), 16 << 20, 65536, 1,
+      kStateUnorderedAccess);
+    const auto postProcessPass = pGraph->AddPass("post process " + std::to_string(i));
+    pGraph->Read(postProcessPass, output, kStateNonPixelShaderResource);
+    pGraph->Write(postProcessPass, postProcessOutput, kStateUnorderedAccess);
+    output = postProcessOutput;
+  }
+
+  const auto resolvePass = pGraph->AddPass("resolve");
+  pGraph->Read(resolvePass, output, kStateCopySource);
+  pGraph->Write(resolvePass, backBuffer, kStateCopyDest);
+
+  const auto skyboxPass = pGraph->AddPass("skybox");
+  pGraph->Write(skyboxPass, backBuffer, kStateRenderTarget);
+  pGraph->Read(skyboxPass, depth, kStateDepthWrite);
+  pGraph->Write(skyboxPass, depth, kStateDepthWrite);
+  return 5 + postProcessPasses;
+}
+
+void AddRenderGraphBenchmarks(MicroBenchmark* pBenchmark) {
+  for (uint32_t postProcessPasses : { 0u, 16u, 256u }) {
+    RenderGraph graph;
+    const uint32_t passCount = BuildFrameGraph(&graph, postProcessPasses);
+    pBenchmark->Run("render_graph_compile/" + std::to_string(passCount), passCount, [postProcessPasses] {
+      RenderGraph graph;
+      BuildFrameGraph(&graph, postProcessPasses);
+      graph.Compile();
+      MicroBenchmark::KeepAlive(&graph.GetFinalBarriers());
+    });
+  }
+}
+
+// A frame of ResidencyManager: every set is used by the frame's work, then the tracker updates with a
+// budget a quarter below the usage, so that the least recently used sets are evicted and made
+// resident again the next frame.
+void AddResidencyTrackerBenchmarks(MicroBenchmark* pBenchmark) {
+  for (uint32_t setCount : { 16u, 1024u }) {
+    ResidencyTracker tracker;
+    std::vector<ResidencyTracker::SetId> sets;
+    uint64_t totalSize = 0;
+    for (uint32_t i = 0; i < setCount; ++i) {
+      const uint64_t size = (1 + i % 8) << 20;
+      sets.push_back(tracker.AddSet(ResidencyTracker::Category::kMeshes, size, true));
+      totalSize += size;
+    }
+    const uint64_t budget = totalSize - totalSize / 4;
+    uint64_t fenceValue = 0;
+    pBenchmark->Run("residency_tracker_update/" + std::to_string(setCount), setCount, [&] {
+      ++fenceValue;
+      // Not all in the same order, so that the least recently used ones vary.
+      for (uint32_t i = 0; i < setCount; ++i) {
+        tracker.Use(sets[(i * 7 + fenceValue) % setCount], fenceValue);
+      }
+      const std::vector<ResidencyTracker::SetId> evicted = tracker.Update(budget, totalSize, fenceValue - 1);
+      MicroBenchmark::KeepAlive(evicted.data());
+    });
+  }
+}
+
+// Allocating the blocks of a frame's transients and IBL maps, then freeing them in another order.
+void AddBuddyAllocatorBenchmarks(MicroBenchmark* pBenchmark) {
+  for (size_t allocationCount : { 64u, 1024u }) {
+    std::mt19937 random(1);
+    std::vector<uint64_t> sizes(allocationCount);
+    for (uint64_t& size : sizes) {
+      size = 256 + random() % (256 * 1024);
+    }
+    std::vector<size_t> freeOrder(allocationCount);
+    std::iota(freeOrder.begin(), freeOrder.end(), 0);
+    std::shuffle(freeOrder.begin(), freeOrder.end(), random);
+
+    BuddyAllocator allocator(1ull << 30, 256);
+    std::vector<uint64_t> offsets(allocationCount);
+    pBenchmark->Run("buddy_allocator/" + std::to_string(allocationCount), 2 * allocationCount, [&] {
+      for (size_t i = 0; i < allocationCount; ++i) {
+        offsets[i] = allocator.Allocate(sizes[i], 65536);
+      }
+      MicroBenchmark::KeepAlive(offsets.data());
+      for (size_t i : freeOrder) {
+        allocator.Free(offsets[i]);
+      }
+    });
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const std::string resultsPath = argc > 1 ? argv[1] : "portable_benchmark.csv";
+  const std::string baselinePath = argc > 2 ? argv[2] : "portable_benchmark_baseline.csv";
+
+  MicroBenchmark benchmark(kSampleCount, kMinSampleNanoseconds);
+  AddMeshBenchmarks(&benchmark);
+#ifdef DX12_PBS_HAS_DIRECTXMATH
+  AddCameraBenchmarks(&benchmark);
+#else
+  printf("camera_matrices skipped: DirectXMath wasn't found\n");
+#endif
+  AddRenderGraphBenchmarks(&benchmark);
+  AddResidencyTrackerBenchmarks(&benchmark);
+  AddBuddyAllocatorBenchmarks(&benchmark);
+
+  for (const MicroBenchmark::Result& result : benchmark.GetResults()) {
+    printf("%s: %.1f ns median, %.1f mean +- %.1f, %.3g items/s\n",
+      result.name.c_str(), result.median, result.mean, result.standardDeviation, result.GetItemsPerSecond());
+  }
+  {
+    std::ofstream resultsFile(resultsPath);
+    benchmark.WriteCsv(resultsFile);
+  }
+
+  std::vector<MicroBenchmark::Result> baseline;
+  std::ifstream baselineFile(baselinePath);
+  if (!baselineFile || !MicroBenchmark::ReadCsv(baselineFile, &baseline)) {
+    // The first run sets the baseline; delete the file to take a new one.
+    baselineFile.close();
+    std::ofstream newBaselineFile(baselinePath);
+    benchmark.WriteCsv(newBaselineFile);
+    printf("no baseline, the results are the new one\n");
+    return 0;
+  }
+
+  bool passed = true;
+  for (const MicroBenchmark::Comparison& comparison : benchmark.Compare(baseline)) {
+    printf("%s: %+.1f%% against the baseline (t = %.1f)%s\n", comparison.name.c_str(),
+      100.0 * comparison.change, comparison.tStatistic, comparison.regression ? ", REGRESSION" : "");
+    passed = passed && !comparison.regression;
+  }
+  return passed ? 0 : 1;
+}
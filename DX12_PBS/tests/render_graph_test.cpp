@@ -0,0 +1,294 @@
+#include "render_graph.h"
+
+#include "test_util.h"
+
+namespace {
+
+using Barrier = RenderGraph::Barrier;
+using BarrierType = RenderGraph::BarrierType;
+using BarrierSplit = RenderGraph::BarrierSplit;
+
+// D3D12_RESOURCE_STATES bits.
+constexpr RenderGraph::ResourceStates kStateCommon = 0x0;
+constexpr RenderGraph::ResourceStates kStateRenderTarget = 0x4;
+constexpr RenderGraph::ResourceStates kStateUnorderedAccess = 0x8;
+constexpr RenderGraph::ResourceStates kStateNonPixelShaderResource = 0x40;
+constexpr RenderGraph::ResourceStates kStatePixelShaderResource = 0x80;
+constexpr RenderGraph::ResourceStates kStateCopySource = 0x800;
+
+// The barriers of resource in barriers.
+std::vector<Barrier> BarriersOf(const std::vector<Barrier>& barriers, RenderGraph::ResourceHandle resource) {
+  std::vector<Barrier> result;
+  for (const Barrier& barrier : barriers) {
+    if (barrier.resource == resource) {
+      result.push_back(barrier);
+    }
+  }
+  return result;
+}
+
+void CheckTransition(const Barrier& barrier, BarrierSplit split, RenderGraph::ResourceStates before, RenderGraph::ResourceStates after) {
+  CHECK(barrier.type == BarrierType::kTransition);
+  CHECK(barrier.split == split);
+  CHECK_EQUAL(before, barrier.stateBefore);
+  CHECK_EQUAL(after, barrier.stateAfter);
+}
+
+void TestPassCulling() {
+  RenderGraph graph;
+  const auto backBuffer = graph.ImportResource("back buffer", kStateCommon, kStateCommon);
+  const auto used = graph.CreateTransientResource("used", 1024, 256, 0, kStateCommon);
+  const auto unused = graph.CreateTransientResource("unused", 1024, 256, 0, kStateCommon);
+  const auto chained = graph.CreateTransientResource("chained", 1024, 256, 0, kStateCommon);
+
+  const auto writeUsed = graph.AddPass("write used");
+  graph.Write(writeUsed, used, kStateRenderTarget);
+  // Writes a transient nobody reads.
+  const auto writeUnused = graph.AddPass("write unused");
+  graph.Write(writeUnused, unused, kStateRenderTarget);
+  // Only read by a pass that is culled itself.
+  const auto writeChained = graph.AddPass("write chained");
+  graph.Write(writeChained, chained, kStateRenderTarget);
+  const auto readChained = graph.AddPass("read chained");
+  graph.Read(readChained, chained, kStatePixelShaderResource);
+  graph.Write(readChained, unused, kStateRenderTarget);
+  const auto sideEffects = graph.AddPass("side effects", true);
+  // Writes an imported resource.
+  const auto composite = graph.AddPass("composite");
+  graph.Read(composite, used, kStatePixelShaderResource);
+  graph.Write(composite, backBuffer, kStateRenderTarget);
+
+  graph.Compile();
+  CHECK(!graph.IsPassCulled(writeUsed));
+  CHECK(graph.IsPassCulled(writeUnused));
+  CHECK(graph.IsPassCulled(writeChained));
+  CHECK(graph.IsPassCulled(readChained));
+  CHECK(!graph.IsPassCulled(sideEffects));
+  CHECK(!graph.IsPassCulled(composite));
+  // Culled passes get no barriers, and their resources don't take memory.
+  CHECK(graph.GetBarriersBefore(writeChained).empty());
+  CHECK(graph.GetBarriersBefore(readChained).empty());
+  CHECK_EQUAL(1024u, graph.GetHeapSize(0));
+}
+
+void TestReadOnlyStateMerging() {
+  RenderGraph graph;
+  const auto texture = graph.ImportResource("texture", kStatePixelShaderResource, kStatePixelShaderResource);
+  const auto draw = graph.AddPass("draw", true);
+  graph.Write(draw, texture, kStateRenderTarget);
+  const auto pixelRead = graph.AddPass("pixel read", true);
+  graph.Read(pixelRead, texture, kStatePixelShaderResource);
+  const auto computeRead = graph.AddPass("compute read", true);
+  graph.Read(computeRead, texture, kStateNonPixelShaderResource);
+  const auto copyRead = graph.AddPass("copy read", true);
+  graph.Read(copyRead, texture, kStateCopySource);
+
+  graph.Compile();
+  // Right before the write, from the initial state.
+  const std::vector<Barrier> drawBarriers = BarriersOf(graph.GetBarriersBefore(draw), texture);
+  CHECK_EQUAL(1u, drawBarriers.size());
+  if (drawBarriers.size() == 1) {
+    CheckTransition(drawBarriers[0], BarrierSplit::kNone, kStatePixelShaderResource, kStateRenderTarget);
+  }
+  // The three reads share one transition to the union of their states.
+  const RenderGraph::ResourceStates readStates = kStatePixelShaderResource | kStateNonPixelShaderResource | kStateCopySource;
+  const std::vector<Barrier> readBarriers = BarriersOf(graph.GetBarriersBefore(pixelRead), texture);
+  CHECK_EQUAL(1u, readBarriers.size());
+  if (readBarriers.size() == 1) {
+    CheckTransition(readBarriers[0], BarrierSplit::kNone, kStateRenderTarget, readStates);
+  }
+  CHECK(graph.GetBarriersBefore(computeRead).empty());
+  CHECK(graph.GetBarriersBefore(copyRead).empty());
+  // The resource returns to exactly its final state after the last read.
+  const std::vector<Barrier> finalBarriers = BarriersOf(graph.GetFinalBarriers(), texture);
+  CHECK_EQUAL(1u, finalBarriers.size());
+  if (finalBarriers.size() == 1) {
+    CheckTransition(finalBarriers[0], BarrierSplit::kNone, readStates, kStatePixelShaderResource);
+  }
+
+  // A resource that is already readable in the required way needs no transition at all.
+  RenderGraph readOnlyGraph;
+  const auto lut = readOnlyGraph.ImportResource("lut", kStatePixelShaderResource | kStateNonPixelShaderResource,
+    kStatePixelShaderResource | kStateNonPixelShaderResource);
+  const auto lutRead = readOnlyGraph.AddPass("lut read", true);
+  readOnlyGraph.Read(lutRead, lut, kStateNonPixelShaderResource);
+  readOnlyGraph.Compile();
+  CHECK(readOnlyGraph.GetBarriersBefore(lutRead).empty());
+  CHECK(readOnlyGraph.GetFinalBarriers().empty());
+}
+
+void TestSplitBarriers() {
+  RenderGraph graph;
+  const auto shadowMap = graph.ImportResource("shadow map", kStatePixelShaderResource, kStatePixelShaderResource);
+  const auto output = graph.ImportResource("output", kStateUnorderedAccess, kStateCopySource);
+  const auto other = graph.ImportResource("other", kStateUnorderedAccess, kStateUnorderedAccess);
+
+  const auto renderShadows = graph.AddPass("render shadows");
+  graph.Write(renderShadows, shadowMap, kStateRenderTarget);
+  const auto compute = graph.AddPass("compute");
+  graph.Write(compute, output, kStateUnorderedAccess);
+  const auto idle = graph.AddPass("idle");
+  graph.Write(idle, other, kStateUnorderedAccess);
+  const auto shade = graph.AddPass("shade");
+  graph.Read(shade, shadowMap, kStatePixelShaderResource);
+  graph.Write(shade, other, kStateUnorderedAccess);
+
+  graph.Compile();
+  // The shadow map's transition begins right after it was written, and ends where it is read.
+  const std::vector<Barrier> beginBarriers = BarriersOf(graph.GetBarriersBefore(compute), shadowMap);
+  CHECK_EQUAL(1u, beginBarriers.size());
+  if (beginBarriers.size() == 1) {
+    CheckTransition(beginBarriers[0], BarrierSplit::kBegin, kStateRenderTarget, kStatePixelShaderResource);
+  }
+  CHECK(BarriersOf(graph.GetBarriersBefore(idle), shadowMap).empty());
+  const std::vector<Barrier> endBarriers = BarriersOf(graph.GetBarriersBefore(shade), shadowMap);
+  CHECK_EQUAL(1u, endBarriers.size());
+  if (endBarriers.size() == 1) {
+    CheckTransition(endBarriers[0], BarrierSplit::kEnd, kStateRenderTarget, kStatePixelShaderResource);
+  }
+
+  // The return to the final state begins after the last use, and ends after the last pass.
+  const std::vector<Barrier> outputBegin = BarriersOf(graph.GetBarriersBefore(idle), output);
+  CHECK_EQUAL(1u, outputBegin.size());
+  if (outputBegin.size() == 1) {
+    CheckTransition(outputBegin[0], BarrierSplit::kBegin, kStateUnorderedAccess, kStateCopySource);
+  }
+  const std::vector<Barrier> outputEnd = BarriersOf(graph.GetFinalBarriers(), output);
+  CHECK_EQUAL(1u, outputEnd.size());
+  if (outputEnd.size() == 1) {
+    CheckTransition(outputEnd[0], BarrierSplit::kEnd, kStateUnorderedAccess, kStateCopySource);
+  }
+
+  // Consecutive unordered access writes are ordered by a UAV barrier, not split.
+  const std::vector<Barrier> otherBarriers = BarriersOf(graph.GetBarriersBefore(shade), other);
+  CHECK_EQUAL(1u, otherBarriers.size());
+  if (otherBarriers.size() == 1) {
+    CHECK(otherBarriers[0].type == BarrierType::kUnorderedAccess);
+  }
+}
+
+void TestSplitBarriersAcrossCommandLists() {
+  RenderGraph graph;
+  const auto shadowMap = graph.ImportResource("shadow map", kStatePixelShaderResource, kStatePixelShaderResource);
+  const auto gbuffer = graph.ImportResource("G-buffer", kStateRenderTarget, kStatePixelShaderResource);
+  const auto output = graph.ImportResource("output", kStateUnorderedAccess, kStateUnorderedAccess);
+
+  const auto renderShadows = graph.AddPass("render shadows");
+  graph.Write(renderShadows, shadowMap, kStateRenderTarget);
+  const auto fillGBuffer = graph.AddPass("fill G-buffer");
+  graph.Write(fillGBuffer, gbuffer, kStateRenderTarget);
+  const auto compute = graph.AddPass("compute");
+  graph.SetCommandList(compute, 1);
+  graph.Write(compute, output, kStateUnorderedAccess);
+  const auto shade = graph.AddPass("shade");
+  graph.SetCommandList(shade, 1);
+  graph.Read(shade, shadowMap, kStatePixelShaderResource);
+  graph.Write(shade, output, kStateUnorderedAccess);
+
+  graph.Compile();
+  // The shadow map is idle from the G-buffer pass on, but that pass is in the other command list:
+  // the transition isn't split, it is done before the read.
+  CHECK(BarriersOf(graph.GetBarriersBefore(fillGBuffer), shadowMap).empty());
+  CHECK(BarriersOf(graph.GetBarriersBefore(compute), shadowMap).empty());
+  const std::vector<Barrier> shadowBarriers = BarriersOf(graph.GetBarriersBefore(shade), shadowMap);
+  CHECK_EQUAL(1u, shadowBarriers.size());
+  if (shadowBarriers.size() == 1) {
+    CheckTransition(shadowBarriers[0], BarrierSplit::kNone, kStateRenderTarget, kStatePixelShaderResource);
+  }
+
+  // The final barriers are in the last pass's command list, so the G-buffer's return to its final
+  // state can begin in the first pass of that list.
+  const std::vector<Barrier> gbufferBegin = BarriersOf(graph.GetBarriersBefore(compute), gbuffer);
+  CHECK_EQUAL(1u, gbufferBegin.size());
+  if (gbufferBegin.size() == 1) {
+    CheckTransition(gbufferBegin[0], BarrierSplit::kBegin, kStateRenderTarget, kStatePixelShaderResource);
+  }
+  const std::vector<Barrier> gbufferEnd = BarriersOf(graph.GetFinalBarriers(), gbuffer);
+  CHECK_EQUAL(1u, gbufferEnd.size());
+  if (gbufferEnd.size() == 1) {
+    CheckTransition(gbufferEnd[0], BarrierSplit::kEnd, kStateRenderTarget, kStatePixelShaderResource);
+  }
+
+  // Within a command list, transitions are still split.
+  graph.SetCommandList(fillGBuffer, 1);
+  graph.Compile();
+  const std::vector<Barrier> beginBarriers = BarriersOf(graph.GetBarriersBefore(fillGBuffer), shadowMap);
+  CHECK_EQUAL(1u, beginBarriers.size());
+  if (beginBarriers.size() == 1) {
+    CheckTransition(beginBarriers[0], BarrierSplit::kBegin, kStateRenderTarget, kStatePixelShaderResource);
+  }
+  const std::vector<Barrier> endBarriers = BarriersOf(graph.GetBarriersBefore(shade), shadowMap);
+  CHECK_EQUAL(1u, endBarriers.size());
+  if (endBarriers.size() == 1) {
+    CheckTransition(endBarriers[0], BarrierSplit::kEnd, kStateRenderTarget, kStatePixelShaderResource);
+  }
+}
+
+void TestTransientAliasing() {
+  RenderGraph graph;
+  const auto output = graph.ImportResource("output", kStateCommon, kStateCommon);
+  const auto first = graph.CreateTransientResource("first", 1000, 256, 0, kStateCommon);
+  const auto overlapping = graph.CreateTransientResource("overlapping", 300, 256, 0, kStateCommon);
+  const auto second = graph.CreateTransientResource("second", 800, 256, 0, kStateCommon);
+  const auto otherHeap = graph.CreateTransientResource("other heap", 500, 256, 1, kStateCommon);
+
+  const auto writeFirst = graph.AddPass("write first");
+  graph.Write(writeFirst, first, kStateRenderTarget);
+  graph.Write(writeFirst, overlapping, kStateRenderTarget);
+  const auto readFirst = graph.AddPass("read first");
+  graph.Read(readFirst, first, kStatePixelShaderResource);
+  graph.Write(readFirst, otherHeap, kStateRenderTarget);
+  const auto writeSecond = graph.AddPass("write second");
+  graph.Read(writeSecond, otherHeap, kStatePixelShaderResource);
+  graph.Read(writeSecond, overlapping, kStatePixelShaderResource);
+  graph.Write(writeSecond, second, kStateUnorderedAccess);
+  const auto readSecond = graph.AddPass("read second");
+  graph.Read(readSecond, second, kStateNonPixelShaderResource);
+  graph.Write(readSecond, output, kStateUnorderedAccess);
+
+  graph.Compile();
+  // The largest goes first at 0; the one that lives at the same time goes after it, aligned; the one
+  // that only lives after the first is done takes its memory.
+  CHECK_EQUAL(0u, graph.GetTransientPlacement(first).offset);
+  CHECK_EQUAL(1024u, graph.GetTransientPlacement(overlapping).offset);
+  CHECK_EQUAL(0u, graph.GetTransientPlacement(second).offset);
+  CHECK_EQUAL(1u, graph.GetTransientPlacement(otherHeap).heapIndex);
+  CHECK_EQUAL(0u, graph.GetTransientPlacement(otherHeap).offset);
+  CHECK_EQUAL(2u, graph.GetNumHeaps());
+  CHECK_EQUAL(1324u, graph.GetHeapSize(0));
+  CHECK_EQUAL(500u, graph.GetHeapSize(1));
+
+  // The resource taking over the memory gets an aliasing barrier, and is discarded since it is written first.
+  const std::vector<Barrier> secondBarriers = BarriersOf(graph.GetBarriersBefore(writeSecond), second);
+  CHECK(!secondBarriers.empty());
+  if (!secondBarriers.empty()) {
+    CHECK(secondBarriers[0].type == BarrierType::kAliasing);
+  }
+  const std::vector<RenderGraph::ResourceHandle>& discards = graph.GetDiscardsBefore(writeSecond);
+  CHECK_EQUAL(1u, discards.size());
+  if (discards.size() == 1) {
+    CHECK_EQUAL(second, discards[0]);
+  }
+  // The first one returns to its rest state after its last use, while it still owns the memory.
+  const std::vector<Barrier> firstBarriers = BarriersOf(graph.GetBarriersBefore(writeSecond), first);
+  CHECK_EQUAL(1u, firstBarriers.size());
+  if (firstBarriers.size() == 1) {
+    CheckTransition(firstBarriers[0], BarrierSplit::kNone, kStatePixelShaderResource, kStateCommon);
+  }
+  // A transient with memory of its own needs neither.
+  CHECK(graph.GetDiscardsBefore(readFirst).empty());
+  for (const Barrier& barrier : BarriersOf(graph.GetBarriersBefore(readFirst), otherHeap)) {
+    CHECK(barrier.type != BarrierType::kAliasing);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestPassCulling();
+  TestReadOnlyStateMerging();
+  TestSplitBarriers();
+  TestSplitBarriersAcrossCommandLists();
+  TestTransientAliasing();
+  return test::Finish("render_graph_test");
+}
@@ -0,0 +1,227 @@
+#include "residency_tracker.h"
+
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+using Category = ResidencyTracker::Category;
+using SetId = ResidencyTracker::SetId;
+
+uint64_t GetResidentSize(const ResidencyTracker& tracker, Category category) {
+  return tracker.GetTelemetry().residentSize[static_cast<uint32_t>(category)];
+}
+
+uint64_t GetEvictedSize(const ResidencyTracker& tracker, Category category) {
+  return tracker.GetTelemetry().evictedSize[static_cast<uint32_t>(category)];
+}
+
+// What the adapter would report: everything resident, evictable or not.
+uint64_t GetSimulatedUsage(const ResidencyTracker& tracker) {
+  uint64_t usage = 0;
+  for (uint64_t size : tracker.GetTelemetry().residentSize) {
+    usage += size;
+  }
+  return usage;
+}
+
+std::vector<SetId> Update(ResidencyTracker* pTracker, uint64_t budget, uint64_t completedFenceValue) {
+  return pTracker->Update(budget, GetSimulatedUsage(*pTracker), completedFenceValue);
+}
+
+void TestEvictsLeastRecentlyUsed() {
+  ResidencyTracker tracker;
+  const SetId environment = tracker.AddSet(Category::kIBL, 100, true);
+  const SetId spheres = tracker.AddSet(Category::kMeshes, 200, true);
+  const SetId floor = tracker.AddSet(Category::kMeshes, 300, true);
+  const SetId gbuffer = tracker.AddSet(Category::kRenderTargets, 400, false);
+  CHECK(!tracker.Use(environment, 3));
+  CHECK(!tracker.Use(spheres, 1));
+  CHECK(!tracker.Use(floor, 2));
+  CHECK(!tracker.Use(gbuffer, 3));
+
+  // Within the budget nothing is evicted.
+  CHECK(Update(&tracker, 1000, 3).empty());
+  CHECK_EQUAL(1000u, tracker.GetTelemetry().usage);
+  CHECK(!tracker.GetTelemetry().overBudget);
+
+  // Over it, the least recently used sets until it fits.
+  const std::vector<SetId> evicted = Update(&tracker, 700, 3);
+  CHECK_EQUAL(2u, evicted.size());
+  if (evicted.size() == 2) {
+    CHECK_EQUAL(spheres, evicted[0]);
+    CHECK_EQUAL(floor, evicted[1]);
+  }
+  CHECK(tracker.IsResident(environment));
+  CHECK(!tracker.IsResident(spheres));
+  CHECK(!tracker.IsResident(floor));
+  CHECK(tracker.IsResident(gbuffer));
+  CHECK_EQUAL(500u, tracker.GetTelemetry().usage);
+  CHECK_EQUAL(700u, tracker.GetTelemetry().budget);
+  CHECK(!tracker.GetTelemetry().overBudget);
+  CHECK_EQUAL(2u, tracker.GetTelemetry().evictionCount);
+  CHECK_EQUAL(100u, GetResidentSize(tracker, Category::kIBL));
+  CHECK_EQUAL(0u, GetResidentSize(tracker, Category::kMeshes));
+  CHECK_EQUAL(500u, GetEvictedSize(tracker, Category::kMeshes));
+  CHECK_EQUAL(400u, GetResidentSize(tracker, Category::kRenderTargets));
+
+  // A set the GPU still uses isn't evicted, and neither is one that isn't evictable: over budget.
+  CHECK(!tracker.Use(environment, 5));
+  CHECK(Update(&tracker, 200, 4).empty());
+  CHECK(tracker.IsResident(environment));
+  CHECK(tracker.GetTelemetry().overBudget);
+
+  // Once the GPU is done with it, it is, but that isn't enough.
+  const std::vector<SetId> evictedOnceDone = Update(&tracker, 200, 5);
+  CHECK_EQUAL(1u, evictedOnceDone.size());
+  if (evictedOnceDone.size() == 1) {
+    CHECK_EQUAL(environment, evictedOnceDone[0]);
+  }
+  CHECK_EQUAL(400u, tracker.GetTelemetry().usage);
+  CHECK(tracker.GetTelemetry().overBudget);
+
+  // And back within a larger budget.
+  CHECK(Update(&tracker, 500, 5).empty());
+  CHECK(!tracker.GetTelemetry().overBudget);
+}
+
+void TestEvictsSetsNeverUsedInOrderAdded() {
+  ResidencyTracker tracker;
+  const SetId first = tracker.AddSet(Category::kMeshes, 100, true);
+  const SetId second = tracker.AddSet(Category::kMeshes, 100, true);
+  const SetId used = tracker.AddSet(Category::kMeshes, 100, true);
+  tracker.Use(used, 1);
+  const SetId third = tracker.AddSet(Category::kMeshes, 100, true);
+
+  const std::vector<SetId> evicted = Update(&tracker, 50, 1);
+  CHECK_EQUAL(4u, evicted.size());
+  if (evicted.size() == 4) {
+    CHECK_EQUAL(first, evicted[0]);
+    CHECK_EQUAL(second, evicted[1]);
+    CHECK_EQUAL(third, evicted[2]);
+    CHECK_EQUAL(used, evicted[3]);
+  }
+  CHECK(!tracker.GetTelemetry().overBudget);
+  CHECK_EQUAL(0u, tracker.GetTelemetry().usage);
+}
+
+void TestUseMakesResident() {
+  ResidencyTracker tracker;
+  const SetId environment = tracker.AddSet(Category::kIBL, 300, true);
+  const SetId spheres = tracker.AddSet(Category::kMeshes, 200, true);
+  tracker.Use(environment, 1);
+  tracker.Use(spheres, 2);
+  CHECK_EQUAL(2u, tracker.EvictAll(2).size());
+  CHECK_EQUAL(0u, GetResidentSize(tracker, Category::kIBL));
+  CHECK_EQUAL(300u, GetEvictedSize(tracker, Category::kIBL));
+  Update(&tracker, 1000, 2);
+
+  // An evicted set has to be made resident before the work that uses it runs.
+  CHECK(tracker.Use(environment, 3));
+  CHECK(tracker.IsResident(environment));
+  CHECK_EQUAL(300u, GetResidentSize(tracker, Category::kIBL));
+  CHECK_EQUAL(0u, GetEvictedSize(tracker, Category::kIBL));
+  CHECK_EQUAL(300u, tracker.GetTelemetry().usage);
+  CHECK_EQUAL(1u, tracker.GetTelemetry().makeResidentCount);
+  // Then it is.
+  CHECK(!tracker.Use(environment, 4));
+  CHECK_EQUAL(1u, tracker.GetTelemetry().makeResidentCount);
+
+  // The other stays evicted, and is the first to go again once it's back.
+  CHECK(!tracker.IsResident(spheres));
+  CHECK_EQUAL(200u, GetEvictedSize(tracker, Category::kMeshes));
+  CHECK(tracker.Use(spheres, 2));
+  const std::vector<SetId> evicted = Update(&tracker, 400, 4);
+  CHECK_EQUAL(1u, evicted.size());
+  if (evicted.size() == 1) {
+    CHECK_EQUAL(spheres, evicted[0]);
+  }
+
+  // Sets that don't exist are never evicted.
+  CHECK(!tracker.Use(ResidencyTracker::kInvalidSet, 5));
+  CHECK(!tracker.IsResident(ResidencyTracker::kInvalidSet));
+}
+
+void TestSetSizeAndRemoveSet() {
+  ResidencyTracker tracker;
+  const SetId staging = tracker.AddSet(Category::kStaging, 1000, false);
+  const SetId environment = tracker.AddSet(Category::kIBL, 300, true);
+  const SetId spheres = tracker.AddSet(Category::kMeshes, 200, true);
+
+  tracker.SetSize(staging, 3000);
+  CHECK_EQUAL(3000u, GetResidentSize(tracker, Category::kStaging));
+  tracker.SetSize(staging, 2000);
+  CHECK_EQUAL(2000u, GetResidentSize(tracker, Category::kStaging));
+  // Only for sets that aren't evictable.
+  tracker.SetSize(environment, 5000);
+  CHECK_EQUAL(300u, GetResidentSize(tracker, Category::kIBL));
+  tracker.SetSize(ResidencyTracker::kInvalidSet, 5000);
+  CHECK_EQUAL(2500u, GetSimulatedUsage(tracker));
+
+  // Removing a set takes it out of the resident or the evicted bytes, whichever it is in.
+  tracker.Use(environment, 2);
+  tracker.Use(spheres, 1);
+  CHECK_EQUAL(1u, Update(&tracker, 2400, 2).size());
+  CHECK(!tracker.IsResident(spheres));
+  tracker.RemoveSet(spheres);
+  CHECK_EQUAL(0u, GetEvictedSize(tracker, Category::kMeshes));
+  CHECK_EQUAL(0u, GetResidentSize(tracker, Category::kMeshes));
+  tracker.RemoveSet(environment);
+  CHECK_EQUAL(0u, GetResidentSize(tracker, Category::kIBL));
+  tracker.RemoveSet(staging);
+  CHECK_EQUAL(0u, GetSimulatedUsage(tracker));
+  tracker.RemoveSet(staging);
+  CHECK_EQUAL(0u, GetResidentSize(tracker, Category::kStaging));
+
+  // A removed set is gone for good.
+  CHECK(!tracker.IsResident(environment));
+  CHECK(!tracker.Use(spheres, 2));
+  CHECK(tracker.EvictAll(2).empty());
+}
+
+void TestEvictAll() {
+  ResidencyTracker tracker;
+  const SetId environment = tracker.AddSet(Category::kIBL, 300, true);
+  const SetId spheres = tracker.AddSet(Category::kMeshes, 200, true);
+  const SetId floor = tracker.AddSet(Category::kMeshes, 100, true);
+  const SetId gbuffer = tracker.AddSet(Category::kRenderTargets, 400, false);
+  tracker.Use(environment, 2);
+  tracker.Use(spheres, 1);
+  tracker.Use(floor, 3);
+  Update(&tracker, 10000, 0);
+
+  // Whatever the budget, every evictable set the GPU is done with, least recently used first.
+  const std::vector<SetId> evicted = tracker.EvictAll(2);
+  CHECK_EQUAL(2u, evicted.size());
+  if (evicted.size() == 2) {
+    CHECK_EQUAL(spheres, evicted[0]);
+    CHECK_EQUAL(environment, evicted[1]);
+  }
+  CHECK(tracker.IsResident(floor));
+  CHECK(tracker.IsResident(gbuffer));
+  CHECK_EQUAL(500u, tracker.GetTelemetry().usage);
+  CHECK_EQUAL(2u, tracker.GetTelemetry().evictionCount);
+
+  // The sets already evicted aren't again.
+  const std::vector<SetId> evictedOnceDone = tracker.EvictAll(3);
+  CHECK_EQUAL(1u, evictedOnceDone.size());
+  if (evictedOnceDone.size() == 1) {
+    CHECK_EQUAL(floor, evictedOnceDone[0]);
+  }
+  CHECK(tracker.EvictAll(3).empty());
+  CHECK_EQUAL(400u, tracker.GetTelemetry().usage);
+  CHECK_EQUAL(400u, GetResidentSize(tracker, Category::kRenderTargets));
+  CHECK_EQUAL(600u, GetEvictedSize(tracker, Category::kIBL) + GetEvictedSize(tracker, Category::kMeshes));
+}
+
+}  // namespace
+
+int main() {
+  TestEvictsLeastRecentlyUsed();
+  TestEvictsSetsNeverUsedInOrderAdded();
+  TestUseMakesResident();
+  TestSetSizeAndRemoveSet();
+  TestEvictAll();
+  return test::Finish("residency_tracker_test");
+}
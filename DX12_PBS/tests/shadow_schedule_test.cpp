@@ -0,0 +1,212 @@
+#include "shadow_schedule.h"
+
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr uint32_t kCascadeCount = 4;
+constexpr uint32_t kCubeCount = 4;
+constexpr uint32_t kCubeFaces = ShadowSchedule::kCubeFaces;
+
+void CheckScheduled(const std::vector<uint32_t>& expected, const std::vector<uint32_t>& scheduled) {
+  CHECK_EQUAL(expected.size(), scheduled.size());
+  for (size_t i = 0; i < expected.size() && i < scheduled.size(); ++i) {
+    CHECK_EQUAL(expected[i], scheduled[i]);
+  }
+}
+
+// Schedules and records frames until nothing is stale.
+void RenderAll(ShadowSchedule* pSchedule) {
+  for (int frame = 0; frame < 16; ++frame) {
+    pSchedule->Schedule();
+    if (pSchedule->GetScheduledCascades().empty() && pSchedule->GetScheduledCubes().empty()) {
+      return;
+    }
+    pSchedule->MarkRendered();
+  }
+  CHECK(!"the views never all got rendered");
+}
+
+void TestBudget() {
+  // A cube and one more view per frame.
+  ShadowSchedule schedule(kCascadeCount, kCubeCount, kCubeFaces + 1);
+  schedule.EnableCube(0);
+  schedule.EnableCube(2);
+
+  // The cascades leave less than a cube.
+  schedule.Schedule();
+  CheckScheduled({ 0, 1, 2, 3 }, schedule.GetScheduledCascades());
+  CheckScheduled({}, schedule.GetScheduledCubes());
+  schedule.MarkRendered();
+  CHECK(schedule.IsCascadeRendered(0) && schedule.IsCascadeValid(0));
+  CHECK(!schedule.IsCubeRendered(0));
+
+  // So the cubes go first, while the cascades go on being refitted.
+  schedule.InvalidateCascade(0);
+  schedule.InvalidateCascade(1);
+  schedule.Schedule();
+  CheckScheduled({ 0 }, schedule.GetScheduledCubes());
+  CheckScheduled({ 0 }, schedule.GetScheduledCascades());
+  schedule.MarkRendered();
+  CHECK(schedule.IsCubeRendered(0) && schedule.IsCubeValid(0));
+  CHECK(!schedule.IsCubeRendered(2));
+
+  schedule.Schedule();
+  CheckScheduled({ 2 }, schedule.GetScheduledCubes());
+  CheckScheduled({ 1 }, schedule.GetScheduledCascades());
+  schedule.MarkRendered();
+
+  // Everything is up to date.
+  schedule.Schedule();
+  CheckScheduled({}, schedule.GetScheduledCascades());
+  CheckScheduled({}, schedule.GetScheduledCubes());
+  for (uint32_t i = 0; i < kCascadeCount; ++i) {
+    CHECK(schedule.IsCascadeRendered(i) && schedule.IsCascadeValid(i));
+  }
+  // Disabled cubes are never scheduled.
+  CHECK(!schedule.IsCubeRendered(1));
+  CHECK(!schedule.IsCubeRendered(3));
+}
+
+void TestInvalidation() {
+  ShadowSchedule schedule(kCascadeCount, kCubeCount, kCascadeCount + kCubeCount * kCubeFaces);
+  schedule.EnableCube(1);
+  RenderAll(&schedule);
+
+  schedule.InvalidateCascade(2);
+  schedule.InvalidateCube(1);
+  // Stale, but the previous contents shade until they are re-rendered.
+  CHECK(schedule.IsCascadeRendered(2) && !schedule.IsCascadeValid(2));
+  CHECK(schedule.IsCubeRendered(1) && !schedule.IsCubeValid(1));
+  schedule.Schedule();
+  CheckScheduled({ 2 }, schedule.GetScheduledCascades());
+  CheckScheduled({ 1 }, schedule.GetScheduledCubes());
+  schedule.MarkRendered();
+  CHECK(schedule.IsCascadeValid(2));
+  CHECK(schedule.IsCubeValid(1));
+
+  // A view invalidated between its scheduling and its recording is rendered, but stays stale.
+  schedule.InvalidateCascade(0);
+  schedule.Schedule();
+  schedule.InvalidateCascade(0);
+  schedule.MarkRendered();
+  CHECK(schedule.IsCascadeRendered(0) && !schedule.IsCascadeValid(0));
+  schedule.Schedule();
+  CheckScheduled({ 0 }, schedule.GetScheduledCascades());
+
+  // A cube disabled in between has nothing to shade with.
+  schedule.InvalidateCube(1);
+  schedule.Schedule();
+  CheckScheduled({ 1 }, schedule.GetScheduledCubes());
+  schedule.DisableCube(1);
+  schedule.MarkRendered();
+  CHECK(!schedule.IsCubeRendered(1));
+  schedule.Schedule();
+  CheckScheduled({}, schedule.GetScheduledCubes());
+}
+
+void TestUnrecordedFrames() {
+  // Views that are scheduled but never recorded stay stale, and are scheduled again.
+  ShadowSchedule schedule(kCascadeCount, kCubeCount, kCascadeCount + kCubeFaces);
+  schedule.EnableCube(3);
+  for (int frame = 0; frame < 3; ++frame) {
+    schedule.Schedule();
+    CheckScheduled({ 0, 1, 2, 3 }, schedule.GetScheduledCascades());
+    CheckScheduled({ 3 }, schedule.GetScheduledCubes());
+  }
+  for (uint32_t i = 0; i < kCascadeCount; ++i) {
+    CHECK(!schedule.IsCascadeRendered(i));
+  }
+  CHECK(!schedule.IsCubeRendered(3));
+
+  schedule.MarkRendered();
+  CHECK(schedule.IsCascadeValid(0));
+  CHECK(schedule.IsCubeValid(3));
+  // Marking again without scheduling changes nothing.
+  schedule.InvalidateCascade(1);
+  schedule.MarkRendered();
+  CHECK(!schedule.IsCascadeValid(1));
+}
+
+void TestShadowsOff() {
+  // With shadows off PBSScene culls the shadow pass, so the views it keeps scheduling aren't
+  // recorded. The ones that went stale meanwhile are rendered once shadows are back.
+  ShadowSchedule schedule(kCascadeCount, kCubeCount, kCascadeCount + kCubeFaces);
+  schedule.EnableCube(1);
+  RenderAll(&schedule);
+  for (int frame = 0; frame < 5; ++frame) {
+    schedule.InvalidateCascade(2);
+    schedule.InvalidateCube(1);
+    schedule.Schedule();
+  }
+  CHECK(!schedule.IsCascadeValid(2));
+  CHECK(!schedule.IsCubeValid(1));
+  CHECK(schedule.IsCascadeValid(0));
+
+  schedule.Schedule();
+  CheckScheduled({ 2 }, schedule.GetScheduledCascades());
+  CheckScheduled({ 1 }, schedule.GetScheduledCubes());
+  schedule.MarkRendered();
+  CHECK(schedule.IsCascadeValid(2));
+  CHECK(schedule.IsCubeValid(1));
+}
+
+// The frames of PBSScene until the first frame of the scene, with the meshes loaded in the background
+// (loadingFrames frames that draw the loading screen), or with -syncLoading (none). Loading frames set
+// the lights but neither schedule nor record shadow views.
+void RenderUntilFirstSceneFrame(ShadowSchedule* pSchedule, int loadingFrames) {
+  for (int frame = 0; frame < loadingFrames; ++frame) {
+    pSchedule->EnableCube(0);
+    pSchedule->InvalidateCube(0);
+    pSchedule->InvalidateCascade(frame % kCascadeCount);
+  }
+  pSchedule->EnableCube(0);
+  for (uint32_t i = 0; i < kCascadeCount; ++i) {
+    CHECK(!pSchedule->IsCascadeRendered(i));
+  }
+  CHECK(!pSchedule->IsCubeRendered(0));
+  pSchedule->Schedule();
+  pSchedule->MarkRendered();
+}
+
+void TestSyncAndAsyncLoading() {
+  // Even if the loading frames had scheduled views, they don't record them.
+  ShadowSchedule scheduledWhileLoading(kCascadeCount, kCubeCount, kCubeFaces);
+  scheduledWhileLoading.EnableCube(0);
+  for (int frame = 0; frame < 10; ++frame) {
+    scheduledWhileLoading.Schedule();
+  }
+
+  // Both ways the first frame of the scene renders the same views, with a budget that fits them all
+  // or not.
+  for (uint32_t budget : { kCubeFaces, kCascadeCount + kCubeFaces }) {
+    ShadowSchedule sync(kCascadeCount, kCubeCount, budget);
+    ShadowSchedule async(kCascadeCount, kCubeCount, budget);
+    RenderUntilFirstSceneFrame(&sync, 0);
+    RenderUntilFirstSceneFrame(&async, 30);
+    for (uint32_t i = 0; i < kCascadeCount; ++i) {
+      CHECK_EQUAL(sync.IsCascadeRendered(i), async.IsCascadeRendered(i));
+      CHECK_EQUAL(sync.IsCascadeValid(i), async.IsCascadeValid(i));
+    }
+    CHECK_EQUAL(sync.IsCubeRendered(0), async.IsCubeRendered(0));
+    CHECK_EQUAL(sync.IsCubeValid(0), async.IsCubeValid(0));
+    CHECK(async.IsCascadeRendered(0));
+  }
+  for (uint32_t i = 0; i < kCascadeCount; ++i) {
+    CHECK(!scheduledWhileLoading.IsCascadeRendered(i));
+  }
+  CHECK(!scheduledWhileLoading.IsCubeRendered(0));
+}
+
+}  // namespace
+
+int main() {
+  TestBudget();
+  TestInvalidation();
+  TestUnrecordedFrames();
+  TestShadowsOff();
+  TestSyncAndAsyncLoading();
+  return test::Finish("shadow_schedule_test");
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// Checks for the tests of the portable parts of the sample, which build without the Windows SDK.
+// A failed check reports itself and lets the test go on; the executable fails if any check did.
+
+namespace test {
+
+inline int& GetFailureCount() {
+  static int failureCount = 0;
+  return failureCount;
+}
+
+inline void ReportFailure(const char* file, int line, const std::string& message) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, message.c_str());
+  ++GetFailureCount();
+}
+
+template <typename Expected, typename Actual>
+void CheckEqual(const Expected& expected, const Actual& actual, const char* expression, const char* file, int line) {
+  if (!(expected == actual)) {
+    std::ostringstream message;
+    message << expression << ": expected " << expected << ", got " << actual;
+    ReportFailure(file, line, message.str());
+  }
+}
+
+// Returns the exit code of the test executable.
+inline int Finish(const char* name) {
+  if (GetFailureCount() > 0) {
+    fprintf(stderr, "%s: %d checks failed\n", name, GetFailureCount());
+    return 1;
+  }
+  printf("%s: passed\n", name);
+  return 0;
+}
+
+}  // namespace test
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      test::ReportFailure(__FILE__, __LINE__, #condition); \
+    } \
+  } while (false)
+
+#define CHECK_EQUAL(expected, actual) test::CheckEqual((expected), (actual), #actual, __FILE__, __LINE__)
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Compiles the shaders of the sample with DXC into the bytecode archive it loads at startup.
+
+usage: build_shader_cache.py --assets DIR --output FILE [--features FILE] [--dxc PATH] [--debug]
+
+Needs Python 3 and DXC v1.6.2112 or newer, for shader model 6.6 and HLSL 2021, which the shaders are
+compiled with. dxc is looked up on PATH unless --dxc is given; the one in the Windows SDK bin directory
+or a release of https://github.com/microsoft/DirectXShaderCompiler both work.
+
+Every VSMain, PSMain and CSMain of the .hlsl files in the assets directory is compiled for the
+targets util::CreatePipelineState asks for, with the defines of every ShaderFeatureKey: the
+SHADER_CONSTANTS and SHADER_OPTIONS lists of sources/shader_features.h. Variants that set
+SHADER_MODEL_6_6_OPTION are compiled for shader model 6.6, the others for 6.0. Bytecode is keyed like
+ComputeShaderKey in sources/shader_key.cpp, so the two have to change together; entries of an
+existing archive whose key is unchanged are kept without compiling them again.
+
+Archive layout, little endian:
+  char[4] 'SHDC', uint32 version, uint32 entry count,
+  entry count * (uint64 key, uint32 size),
+  the bytecode of every entry, in the same order.
+"""
+import argparse
+import itertools
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+MAGIC = b'SHDC'
+VERSION = 1
+ENTRY_POINTS = (('VSMain', 'vs'), ('PSMain', 'ps'), ('CSMain', 'cs'))
+
+FNV_OFFSET_BASIS = 14695981039346656037
+FNV_PRIME = 1099511628211
+INCLUDE_PATTERN = re.compile(r'^[ \t]*#[ \t]*include[ \t]*"([^"]*)"')
+LIST_ENTRY_PATTERN = re.compile(r'^\s*X\(([^)]*)\)')
+SHADER_MODEL_6_6_PATTERN = re.compile(r'^#define SHADER_MODEL_6_6_OPTION (\w+)')
+
+
+def hash_bytes(data, h):
+    for byte in data:
+        h = ((h ^ byte) * FNV_PRIME) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def hash_string(data, h):
+    return hash_bytes(data + b'\0', h)
+
+
+def hash_file(path, visited, h, sources):
+    if path in visited:
+        return h
+    visited.add(path)
+    try:
+        with open(path, 'rb') as f:
+            contents = f.read().replace(b'\r', b'')
+    except OSError:
+        return hash_string(b'', h)
+    h = hash_string(contents, h)
+    sources.append(contents)
+
+    directory = path[:max(path.rfind('/'), path.rfind('\\')) + 1]
+    for line in contents.split(b'\n'):
+        match = INCLUDE_PATTERN.match(line.decode('utf-8', 'replace'))
+        if match and match.group(1):
+            h = hash_file(directory + match.group(1), visited, h, sources)
+    return h
+
+
+def used_defines(sources, defines):
+    """The defines whose name appears in the sources as an identifier."""
+    text = b'\n'.join(sources)
+    return [(name, value) for name, value in defines
+            if re.search(rb'(?<![A-Za-z0-9_])' + re.escape(name.encode()) + rb'(?![A-Za-z0-9_])', text)]
+
+
+def compute_shader_key(shader_path, entry_point, target, defines=()):
+    sources = []
+    h = hash_file(shader_path, set(), FNV_OFFSET_BASIS, sources)
+    h = hash_string(entry_point.encode(), h)
+    h = hash_string(target.encode(), h)
+    for name, value in used_defines(sources, defines):
+        h = hash_string(('%s=%s' % (name, value)).encode(), h)
+    return h
+
+
+def read_list(lines, macro):
+    """The argument lists of the X(...) entries of a '#define macro(X)' list."""
+    entries = []
+    in_list = False
+    for line in lines:
+        if line.startswith('#define %s(X)' % macro):
+            in_list = True
+        elif in_list:
+            match = LIST_ENTRY_PATTERN.match(line)
+            if match:
+                entries.append([argument.strip() for argument in match.group(1).split(',')])
+            if not line.rstrip().endswith('\\'):
+                break
+    return entries
+
+
+def read_feature_defines(path):
+    """The defines and shader model of every ShaderFeatureKey, like ShaderFeatureKey::GetDefines and
+    GetShaderModel return them."""
+    with open(path) as f:
+        lines = f.read().splitlines()
+    constants = [(define, str(int(value, 0))) for _, define, value in read_list(lines, 'SHADER_CONSTANTS')]
+    options = [(define, int(count, 0)) for _, define, count, _ in read_list(lines, 'SHADER_OPTIONS')]
+    shader_model_6_6_option = None
+    for line in lines:
+        match = SHADER_MODEL_6_6_PATTERN.match(line)
+        if match:
+            shader_model_6_6_option = match.group(1)
+    variants = []
+    for values in itertools.product(*[range(count) for _, count in options]):
+        option_defines = [(define, str(value)) for (define, _), value in zip(options, values)]
+        shader_model = '6_6' if dict(option_defines).get(shader_model_6_6_option, '0') != '0' else '6_0'
+        variants.append((constants + option_defines, shader_model))
+    return variants
+
+
+def read_archive(path):
+    try:
+        with open(path, 'rb') as f:
+            data = f.read()
+    except OSError:
+        return {}
+    if len(data) < 12 or data[:4] != MAGIC or struct.unpack_from('<I', data, 4)[0] != VERSION:
+        return {}
+    count = struct.unpack_from('<I', data, 8)[0]
+    entries = {}
+    offset = 12 + count * 12
+    for i in range(count):
+        key, size = struct.unpack_from('<QI', data, 12 + i * 12)
+        entries[key] = data[offset:offset + size]
+        offset += size
+    return entries
+
+
+def write_archive(path, entries):
+    keys = sorted(entries)
+    directory = os.path.dirname(os.path.abspath(path))
+    os.makedirs(directory, exist_ok=True)
+    fd, temp_path = tempfile.mkstemp(dir=directory)
+    with os.fdopen(fd, 'wb') as f:
+        f.write(MAGIC + struct.pack('<II', VERSION, len(keys)))
+        for key in keys:
+            f.write(struct.pack('<QI', key, len(entries[key])))
+        for key in keys:
+            f.write(entries[key])
+    os.chmod(temp_path, 0o644)
+    os.replace(temp_path, path)
+
+
+def compile_shader(dxc, shader_path, entry_point, target, defines, debug):
+    fd, output_path = tempfile.mkstemp(suffix='.dxil')
+    os.close(fd)
+    try:
+        args = [dxc, '-nologo', '-HV', '2021', '-E', entry_point, '-T', target, '-Fo', output_path, '-Qstrip_reflect']
+        args += ['-Zi', '-Qembed_debug', '-Od'] if debug else ['-O3']
+        for name, value in defines:
+            args += ['-D', '%s=%s' % (name, value)]
+        args.append(shader_path)
+        result = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        if result.returncode != 0:
+            sys.stderr.write(result.stdout.decode('utf-8', 'replace'))
+            return None
+        with open(output_path, 'rb') as f:
+            return f.read()
+    finally:
+        os.remove(output_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--assets', required=True, help='directory of the .hlsl files')
+    parser.add_argument('--output', required=True, help='archive to write')
+    parser.add_argument('--features', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'sources', 'shader_features.h'),
+                        help='header with the shader constants and options')
+    parser.add_argument('--dxc', default='dxc', help='DXC executable')
+    parser.add_argument('--debug', action='store_true', help='unoptimized bytecode with debug info')
+    args = parser.parse_args()
+
+    if shutil.which(args.dxc) is None:
+        sys.stderr.write('shader cache: %s not found, put the directory of dxc on PATH or pass --dxc\n' % args.dxc)
+        return 1
+
+    previous = read_archive(args.output)
+    variants = read_feature_defines(args.features)
+    entries = {}
+    compiled = 0
+    failed = False
+    assets = args.assets.replace('\\', '/').rstrip('/') + '/'
+    for name in sorted(os.listdir(args.assets)):
+        if not name.endswith('.hlsl'):
+            continue
+        shader_path = assets + name
+        with open(shader_path, 'rb') as f:
+            source = f.read().decode('utf-8', 'replace')
+        for entry_point, stage in ENTRY_POINTS:
+            if not re.search(r'\b%s\s*\(' % entry_point, source):
+                continue
+            # Variants that differ only in defines the shader doesn't use share a key.
+            for defines, shader_model in variants:
+                target = '%s_%s' % (stage, shader_model)
+                key = compute_shader_key(shader_path, entry_point, target, defines)
+                if key in entries:
+                    continue
+                if key in previous:
+                    entries[key] = previous[key]
+                    continue
+                bytecode = compile_shader(args.dxc, shader_path, entry_point, target, defines, args.debug)
+                if bytecode is None:
+                    sys.stderr.write('%s(%s, %s): compilation failed with %s\n' % (
+                        shader_path, entry_point, target, ' '.join('%s=%s' % define for define in defines)))
+                    failed = True
+                    break
+                entries[key] = bytecode
+                compiled += 1
+
+    if failed:
+        return 1
+    if compiled > 0 or set(entries) != set(previous):
+        write_archive(args.output, entries)
+    print('shader cache: %d entries, %d compiled' % (len(entries), compiled))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())